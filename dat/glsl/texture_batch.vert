@@ -0,0 +1,13 @@
+uniform mat4 projection;
+
+in vec4 vertex;
+in vec2 vertex_tex;
+in vec4 vertex_color;
+out vec2 tex_coord;
+out vec4 color;
+
+void main(void) {
+   tex_coord = vertex_tex;
+   color = vertex_color;
+   gl_Position = projection * vertex;
+}
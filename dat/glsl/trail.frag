@@ -20,17 +20,13 @@ subroutine uniform trail_func_prototype trail_func;
 
 // For ideas: https://thebookofshaders.com/05/
 
-uniform vec4 c1;  // Start colour
-uniform vec4 c2;  // End colour
-uniform float t1; // Start time [0,1]
-uniform float t2; // End time [0,1]
-uniform float dt; // Current time (in seconds)
-uniform vec2 pos1;// Start position
-uniform vec2 pos2;// End position
-uniform float r;  // Unique value per trail [0,1]
 uniform vec3 nebu_col; // Base colour of the nebula, only changes when entering new system
 
-in vec2 pos;
+in vec2 trail_tex; // Time [0,1] along the trail and position [-1,1] across it
+in vec2 trail_px; // Position in pixels along and across the trail
+in vec4 trail_col; // Colour
+in float dt;      // Current time (in seconds)
+in float r;       // Unique value per trail [0,1]
 out vec4 color_out;
 
 /* Has a peak at 1/k */
@@ -265,20 +261,11 @@ vec4 trail_split( vec4 color, vec2 pos_tex, vec2 pos_px )
 }
 
 void main(void) {
-   vec2 pos_tex, pos_px;
-
-   // Interpolate
-   color_out = mix( c1, c2, pos.x );
-   pos_px    = mix( pos1, pos2, pos );
-   pos_px.y *= pos.y;
-   pos_tex.x = mix( t1, t2, pos.x );
-   pos_tex.y = 2. * pos.y - 1.;
-
 #ifdef HAS_GL_ARB_shader_subroutine
    // Use subroutines
-   color_out = trail_func( color_out, pos_tex, pos_px );
+   color_out = trail_func( trail_col, trail_tex, trail_px );
 #else /* HAS_GL_ARB_shader_subroutine */
    //* Just use default
-   color_out = trail_default( color_out, pos_tex, pos_px );
+   color_out = trail_default( trail_col, trail_tex, trail_px );
 #endif /* HAS_GL_ARB_shader_subroutine */
 }
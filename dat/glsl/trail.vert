@@ -0,0 +1,21 @@
+uniform mat4 projection;
+
+in vec4 vertex;
+in vec2 vertex_tex;
+in vec2 vertex_px;
+in vec4 vertex_color;
+in vec2 vertex_trail;
+out vec2 trail_tex;
+out vec2 trail_px;
+out vec4 trail_col;
+out float dt;
+out float r;
+
+void main(void) {
+   trail_tex   = vertex_tex;
+   trail_px    = vertex_px;
+   trail_col   = vertex_color;
+   dt          = vertex_trail.x;
+   r           = vertex_trail.y;
+   gl_Position = projection * vertex;
+}
@@ -126,6 +126,119 @@ special_ships["Heavy Drone"] = function( p )
 end
 
 
+--[[
+      Cache of solutions so identical spawns don't have to solve the same
+      optimization problem over and over
+--]]
+optimize.cache_enabled = true -- Whether or not to use the solution cache
+optimize.cache_max = 512 -- Maximum number of keys before the cache is flushed
+optimize.cache_variants = 3 -- Solutions kept per key so that params.rnd still gives variety
+local solution_cache = {}
+local solution_cache_size = 0
+local cache_hits, cache_misses = 0, 0
+
+-- Serializes a table in a stable order. Numbers are rounded to two
+-- significant digits so that the small random perturbations templates apply
+-- (such as to max_mass) still share solutions.
+local function cache_serialize( t )
+   local keys = {}
+   for k,v in pairs(t) do
+      -- "id" is scratch data written into type_range when solving
+      if k~="id" and type(v)~="function" then
+         table.insert( keys, k )
+      end
+   end
+   table.sort( keys, function( a, b ) return tostring(a) < tostring(b) end )
+   local s = {}
+   for i,k in ipairs(keys) do
+      local v = t[k]
+      if type(v)=="table" then
+         v = "{"..cache_serialize(v).."}"
+      elseif type(v)=="number" then
+         v = string.format("%.2g", v)
+      else
+         v = tostring(v)
+      end
+      s[i] = tostring(k).."="..v
+   end
+   return table.concat( s, "," )
+end
+
+-- Builds the key identifying an optimization problem. Must be called with the
+-- cores already equipped.
+local function cache_key( p, ps, outfit_list, params, nebu_vol )
+   local equipped = {}
+   for k,o in ipairs(p:outfitsList()) do
+      table.insert( equipped, o:nameRaw() )
+   end
+   table.sort( equipped )
+   local avail = {}
+   for k,o in ipairs(outfit_list) do
+      table.insert( avail, o:nameRaw() )
+   end
+   table.sort( avail )
+   -- Custom goodness functions are keyed by identity
+   local goodness = ""
+   if params.goodness ~= optimize.goodness_default then
+      goodness = tostring(params.goodness)
+   end
+   return string.format( "%s|%s|%s|%s|%s|%s|%.2g", ps:nameRaw(),
+         table.concat( equipped, "," ), table.concat( avail, "," ),
+         cache_serialize( params ), goodness,
+         tostring(params.budget), nebu_vol )
+end
+
+-- Equips a cached solution, returns false if it could not be equipped.
+local function cache_apply( p, sol )
+   for k,o in ipairs(sol) do
+      if p:outfitAdd( o, 1, true ) < 1 then
+         p:outfitRm( "all" )
+         return false
+      end
+   end
+   return true
+end
+
+-- Stores a solution in the cache.
+local function cache_store( key, params, sol )
+   local entry = solution_cache[key]
+   if not entry then
+      if solution_cache_size >= optimize.cache_max then
+         solution_cache = {}
+         solution_cache_size = 0
+      end
+      entry = {}
+      solution_cache[key] = entry
+      solution_cache_size = solution_cache_size+1
+   end
+   local variants = (params.rnd > 0 and optimize.cache_variants) or 1
+   if #entry < variants then
+      table.insert( entry, sol )
+   end
+end
+
+--[[--
+   Gets statistics of the solution cache.
+
+      @treturn number Number of optimizations that reused a cached solution.
+      @treturn number Number of optimizations that had to be solved.
+      @treturn number Number of different problems in the cache.
+--]]
+function optimize.cache_stats()
+   return cache_hits, cache_misses, solution_cache_size
+end
+
+--[[--
+   Clears the solution cache and its statistics.
+--]]
+function optimize.cache_clear()
+   solution_cache = {}
+   solution_cache_size = 0
+   cache_hits = 0
+   cache_misses = 0
+end
+
+
 --[[
       Goodness functions to rank how good each outfits are
 --]]
@@ -319,6 +432,27 @@ function optimize.optimize( p, cores, outfit_list, params )
       table.insert( outfit_list, o )
    end
 
+   -- Reuse a previous solution to the same problem if possible
+   local _nebu_dens, nebu_vol = system.cur():nebula()
+   local ckey
+   if optimize.cache_enabled and not pt.bioship then
+      ckey = cache_key( p, ps, outfit_list, params, nebu_vol )
+      local entry = solution_cache[ ckey ]
+      local variants = (params.rnd > 0 and optimize.cache_variants) or 1
+      if entry and #entry >= variants then
+         if cache_apply( p, choose_one( entry ) ) then
+            cache_hits = cache_hits+1
+            p:fillAmmo()
+            ai_setup.setup(p)
+            return true
+         end
+         -- Shouldn't happen, but solve again if it doesn't fit anymore
+         solution_cache[ ckey ] = nil
+         solution_cache_size = solution_cache_size-1
+      end
+      cache_misses = cache_misses+1
+   end
+
    -- Optimization problem definition
    local ncols = 0
    local nrows = 0
@@ -488,7 +622,6 @@ function optimize.optimize( p, cores, outfit_list, params )
       sworthy = sworthy + 1
    end
    -- For volatile systems we don't want ships to explode!
-   local _nebu_dens, nebu_vol = system.cur():nebula()
    if nebu_vol > 0 then
       sworthy = sworthy + 1
    end
@@ -677,9 +810,11 @@ function optimize.optimize( p, cores, outfit_list, params )
    local smod = 1
    local done
    local z, x, constraints
+   local added
    repeat
       try = try + 1
       done = true
+      added = {}
       -- All the magic is done here
       --lp:write_problem( "test.mps" )
       z, x, constraints = lp:solve( sparams )
@@ -732,6 +867,8 @@ function optimize.optimize( p, cores, outfit_list, params )
                local q = p:outfitAdd( o, 1, true )
                if q < 1 then
                   warn(string.format(_("Unable to equip outfit '%s' on '%s'!"), o,  p:name()))
+               else
+                  table.insert( added, o:nameRaw() )
                end
             end
             c = c + 1
@@ -770,6 +907,11 @@ function optimize.optimize( p, cores, outfit_list, params )
          return false
       end
    end
+
+   -- Remember the solution for identical spawns
+   if ckey then
+      cache_store( ckey, params, added )
+   end
    return true
 end
 
@@ -92,6 +92,7 @@
 #include "physics.h"
 #include "pilot.h"
 #include "player.h"
+#include "profile.h"
 #include "rng.h"
 #include "space.h"
 
@@ -416,10 +417,12 @@ void ai_setPilot( Pilot *p )
  */
 static void ai_run( nlua_env env, int nargs )
 {
+   PROFILE_BEGIN_NAME( PROFILE_LUA_AI, cur_pilot->ai->name );
    if (nlua_pcall(env, nargs, 0)) { /* error has occurred */
       WARN( _("Pilot '%s' ai '%s' error: %s"), cur_pilot->name, cur_pilot->ai->name, lua_tostring(naevL,-1));
       lua_pop(naevL,1);
    }
+   PROFILE_END( PROFILE_LUA_AI );
 }
 
 /**
@@ -745,9 +748,11 @@ void ai_think( Pilot* pilot, const double dt )
    /* Get current task. */
    t = ai_curTask( cur_pilot );
 
-   /* control function if pilot is idle or tick is up */
-   if ((cur_pilot->tcontrol < 0.) || (t == NULL)) {
+   /* control function if pilot is idle or tick is up, an overdue tick can wait
+    * a frame if the pilot went over its budget */
+   if ((t == NULL) || ((cur_pilot->tcontrol < 0.) && !nlua_budgetDefer( &cur_pilot->ai_budget ))) {
       double crate = cur_pilot->ai->control_rate;
+      uint64_t t0 = nlua_budgetStart();
       if (pilot_isFlag(pilot,PILOT_PLAYER) ||
           pilot_isFlag(cur_pilot, PILOT_MANUAL_CONTROL)) {
          lua_rawgeti( naevL, LUA_REGISTRYINDEX, cur_pilot->ai->ref_control_manual );
@@ -758,8 +763,12 @@ void ai_think( Pilot* pilot, const double dt )
          lua_pushnumber( naevL, crate-cur_pilot->tcontrol );
          ai_run(env, 1); /* run control */
       }
+      nlua_budgetStop( &cur_pilot->ai_budget, t0 );
       /* Try to desync control ticks when possible by adding randomness. */
       cur_pilot->tcontrol = crate * (0.9+0.2*RNGF());
+      /* Nobody is watching while entering a system, so think less often. */
+      if (space_isSimulation() && !space_isSimulationEffects())
+         cur_pilot->tcontrol *= SYSTEM_SIMULATE_AI_PRE;
 
       /* Task may have changed due to control tick. */
       t = ai_curTask( cur_pilot );
@@ -771,6 +780,7 @@ void ai_think( Pilot* pilot, const double dt )
 
    /* pilot has a currently running task */
    if (t != NULL) {
+      uint64_t t0 = nlua_budgetStart();
       /* Run subtask if available, otherwise run main task. */
       if (t->subtask != NULL) {
          lua_rawgeti( naevL, LUA_REGISTRYINDEX, t->subtask->func );
@@ -789,6 +799,7 @@ void ai_think( Pilot* pilot, const double dt )
          ai_run(env, 1);
       } else
          ai_run(env, 0);
+      nlua_budgetStop( &cur_pilot->ai_budget, t0 );
 
       /* Manual control must check if IDLE hook has to be run. */
       if (pilot_isFlag(cur_pilot, PILOT_MANUAL_CONTROL)) {
@@ -1884,7 +1895,9 @@ static int aiL_aim( lua_State *L )
 
    if (lua_isasteroid(L,1)) {
       Asteroid *a = luaL_validasteroid(L,1);
-      angle = pilot_aimAngle( cur_pilot, &a->pos, &a->vel );
+      vec2 apos = asteroid_pos( a );
+      vec2 avel = asteroid_vel( a );
+      angle = pilot_aimAngle( cur_pilot, &apos, &avel );
    }
    else {
       Pilot *p = luaL_validpilot(L,1);
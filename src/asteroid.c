@@ -8,6 +8,11 @@
  */
 /** @cond */
 #include "physfs.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif /* defined(__AVX__) */
 
 #include "naev.h"
 /** @endcond */
@@ -41,6 +46,52 @@ const double DEBRIS_BUFFER = 1000.; /**< Buffer to smooth appearance of debris *
 
 static const double SCAN_FADE = 10.; /**< 1/time it takes to fade in/out scanning text. */
 
+/*
+ * Vector operations used by the movement kernel. AVX handles 4 asteroids at a
+ * time and SSE2 2, otherwise only the scalar version is used.
+ */
+#if defined(__AVX__)
+#define AST_SIMD        4 /**< Number of asteroids processed at once. */
+typedef __m256d ast_vec;
+#define ast_load        _mm256_loadu_pd
+#define ast_store       _mm256_storeu_pd
+#define ast_set1        _mm256_set1_pd
+#define ast_zero        _mm256_setzero_pd
+#define ast_add         _mm256_add_pd
+#define ast_sub         _mm256_sub_pd
+#define ast_mul         _mm256_mul_pd
+#define ast_div         _mm256_div_pd
+#define ast_sqrt        _mm256_sqrt_pd
+#define ast_and         _mm256_and_pd
+#define ast_andnot      _mm256_andnot_pd
+#define ast_or          _mm256_or_pd
+#define ast_any(m)      (_mm256_movemask_pd(m) != 0)
+#define ast_cmpge(a,b)  _mm256_cmp_pd(a,b,_CMP_GE_OQ)
+#define ast_cmple(a,b)  _mm256_cmp_pd(a,b,_CMP_LE_OQ)
+#define ast_cmpgt(a,b)  _mm256_cmp_pd(a,b,_CMP_GT_OQ)
+#define ast_select(m,a,b) _mm256_blendv_pd(b,a,m)
+#elif defined(__SSE2__)
+#define AST_SIMD        2 /**< Number of asteroids processed at once. */
+typedef __m128d ast_vec;
+#define ast_load        _mm_loadu_pd
+#define ast_store       _mm_storeu_pd
+#define ast_set1        _mm_set1_pd
+#define ast_zero        _mm_setzero_pd
+#define ast_add         _mm_add_pd
+#define ast_sub         _mm_sub_pd
+#define ast_mul         _mm_mul_pd
+#define ast_div         _mm_div_pd
+#define ast_sqrt        _mm_sqrt_pd
+#define ast_and         _mm_and_pd
+#define ast_andnot      _mm_andnot_pd
+#define ast_or          _mm_or_pd
+#define ast_any(m)      (_mm_movemask_pd(m) != 0)
+#define ast_cmpge       _mm_cmpge_pd
+#define ast_cmple       _mm_cmple_pd
+#define ast_cmpgt       _mm_cmpgt_pd
+#define ast_select(m,a,b) _mm_or_pd(_mm_and_pd(m,a),_mm_andnot_pd(m,b))
+#endif /* defined(__AVX__) */
+
 static Debris *debris_stack = NULL; /**< All the debris in the current system (array.h). */
 static glTexture **debris_gfx = NULL; /**< Graphics to use for debris. */
 
@@ -60,10 +111,15 @@ static int astgroup_cmp( const void *p1, const void *p2 );
 static int astgroup_parse( AsteroidTypeGroup *ag, const char *file );
 static int asttype_load (void);
 
-static void asteroid_renderSingle( const Asteroid *a );
+static void asteroid_renderSingle( const AsteroidAnchor *field, const Asteroid *a );
 static void debris_renderSingle( const Debris *d, double cx, double cy );
 static void debris_init( Debris *deb );
-static int asteroid_init( Asteroid *ast, const AsteroidAnchor *field );
+static int asteroid_init( Asteroid *ast, AsteroidAnchor *field );
+static void asteroid_motionAlloc( AsteroidMotion *m, int n );
+static int asteroid_moveScalar( AsteroidMotion *m, int start, int n,
+      const AsteroidAnchor *field, const AsteroidExclusion *exc, double dt );
+static int asteroid_move( AsteroidMotion *m, int n,
+      const AsteroidAnchor *field, const AsteroidExclusion *exc, double dt );
 
 
 /**
@@ -75,82 +131,36 @@ void asteroids_update( double dt )
 {
    /* Asteroids/Debris update */
    for (int i=0; i<array_size(cur_system->asteroids); i++) {
-      int has_exclusion = 0;
       AsteroidAnchor *ast = &cur_system->asteroids[i];
+      AsteroidMotion *m = &ast->motion;
 
       for (int k=0; k<array_size(cur_system->astexclude); k++) {
          AsteroidExclusion *exc = &cur_system->astexclude[k];
-         if (vec2_dist2( &ast->pos, &exc->pos ) < pow2(ast->radius+exc->radius)) {
+         if (vec2_dist2( &ast->pos, &exc->pos ) < pow2(ast->radius+exc->radius))
             exc->affects = 1;
-            has_exclusion = 1;
-         }
          else
             exc->affects = 0;
       }
 
+      /* Inexistent asteroids don't move. */
+      for (int j=0; j<ast->nb; j++)
+         m->active[j] = (ast->asteroids[j].state != ASTEROID_XX);
+
+      /* Movement and timers of all the asteroids at once. */
+      asteroid_move( m, ast->nb, ast, cur_system->astexclude, dt );
+
       for (int j=0; j<ast->nb; j++) {
-         double offx, offy, d;
          Asteroid *a = &ast->asteroids[j];
-         int setvel = 0;
 
-         /* Skip inexistent asteroids. */
+         /* Inexistent asteroids only wait to appear. */
          if (a->state == ASTEROID_XX) {
-            a->timer -= dt;
-            if (a->timer < 0.) {
+            if (m->timer[j] < 0.) {
                a->state = ASTEROID_XX_TO_BG;
-               a->timer_max = a->timer = 1. + 3.*RNGF();
+               a->timer_max = m->timer[j] = 1. + 3.*RNGF();
             }
             continue;
          }
 
-         /* Push back towards center. */
-         offx = ast->pos.x - a->pos.x;
-         offy = ast->pos.y - a->pos.y;
-         d = pow2(offx)+pow2(offy);
-         if (d >= pow2(ast->radius)) {
-            d = sqrt(d);
-            a->vel.x += ast->thrust * dt * offx / d;
-            a->vel.y += ast->thrust * dt * offy / d;
-            setvel = 1;
-         }
-         else if (has_exclusion) {
-            /* Push away from exclusion areas. */
-            for (int k=0; k<array_size(cur_system->astexclude); k++) {
-               AsteroidExclusion *exc = &cur_system->astexclude[k];
-               double ex, ey, ed;
-
-               /* Ignore exclusion zones that shouldn't affect. */
-               if (!exc->affects)
-                  continue;
-
-               ex = a->pos.x - exc->pos.x;
-               ey = a->pos.y - exc->pos.y;
-               ed = pow2(ex) + pow2(ey);
-               if (ed <= pow2(exc->radius)) {
-                  ed = sqrt(ed);
-                  a->vel.x += ast->thrust * dt * ex / ed;
-                  a->vel.y += ast->thrust * dt * ey / ed;
-                  setvel = 1;
-               }
-            }
-         }
-
-         if (setvel) {
-            /* Enforce max speed. */
-            d = MOD(a->vel.x, a->vel.y);
-            if (d > ast->maxspeed) {
-               a->vel.x *= ast->maxspeed / d;
-               a->vel.y *= ast->maxspeed / d;
-            }
-         }
-
-         /* Update position. */
-         a->pos.x += a->vel.x * dt;
-         a->pos.y += a->vel.y * dt;
-
-         /* Update angle. */
-         a->ang += a->spin * dt;
-
          /* Update scanned state if necessary. */
          if (a->scanned) {
             if (a->state == ASTEROID_FG)
@@ -159,8 +169,7 @@ void asteroids_update( double dt )
                a->scan_alpha = MAX( a->scan_alpha-SCAN_FADE*dt, 0.);
          }
 
-         a->timer -= dt;
-         if (a->timer < 0.) {
+         if (m->timer[j] < 0.) {
             switch (a->state) {
                /* Transition states. */
                case ASTEROID_FG:
@@ -169,21 +178,21 @@ void asteroids_update( double dt )
                case ASTEROID_XB:
                case ASTEROID_BX:
                case ASTEROID_XX_TO_BG:
-                  a->timer_max = a->timer = 1. + 3.*RNGF();
+                  a->timer_max = m->timer[j] = 1. + 3.*RNGF();
                   break;
 
                /* Longer states. */
                case ASTEROID_FG_TO_BG:
-                  a->timer_max = a->timer = 10. + 20.*RNGF();
+                  a->timer_max = m->timer[j] = 10. + 20.*RNGF();
                   break;
                case ASTEROID_BG_TO_FG:
-                  a->timer_max = a->timer = 90. + 30.*RNGF();
+                  a->timer_max = m->timer[j] = 90. + 30.*RNGF();
                   break;
 
                /* Special case needs to respawn. */
                case ASTEROID_BG_TO_XX:
                   asteroid_init( a, ast );
-                  a->timer_max = a->timer = 10. + 20.*RNGF();
+                  a->timer_max = m->timer[j] = 10. + 20.*RNGF();
                   break;
 
                case ASTEROID_XX:
@@ -232,6 +241,200 @@ void asteroids_update( double dt )
    }
 }
 
+/**
+ * @brief Allocates the movement arrays for a number of asteroids.
+ *
+ *    @param m Movement arrays to allocate, previous contents are lost.
+ *    @param n Number of asteroids.
+ */
+static void asteroid_motionAlloc( AsteroidMotion *m, int n )
+{
+   double *buf = realloc( m->x, 8 * MAX(n,1) * sizeof(double) );
+   memset( buf, 0, 8 * MAX(n,1) * sizeof(double) );
+   m->x     = &buf[0*n];
+   m->y     = &buf[1*n];
+   m->vx    = &buf[2*n];
+   m->vy    = &buf[3*n];
+   m->ang   = &buf[4*n];
+   m->spin  = &buf[5*n];
+   m->timer = &buf[6*n];
+   m->active= &buf[7*n];
+}
+
+/**
+ * @brief Moves asteroids one at a time.
+ *
+ * Pushes the asteroids back into the field and out of exclusion zones,
+ * enforces the maximum speed and integrates the movement. Timers are updated
+ * for all asteroids, but only active ones move.
+ *
+ *    @param m Movement of the asteroids.
+ *    @param start First asteroid to update.
+ *    @param n Number of asteroids.
+ *    @param field Field the asteroids belong to.
+ *    @param exc Exclusion zones (array.h), only those marked as affecting are used.
+ *    @param dt Current delta tick.
+ *    @return Number of asteroids updated.
+ */
+static int asteroid_moveScalar( AsteroidMotion *m, int start, int n,
+      const AsteroidAnchor *field, const AsteroidExclusion *exc, double dt )
+{
+   double k = field->thrust * dt;
+   double r2 = pow2( field->radius );
+   for (int i=start; i<n; i++) {
+      double offx, offy, d;
+      int setvel = 0;
+
+      m->timer[i] -= dt;
+      if (m->active[i] <= 0.)
+         continue;
+
+      /* Push back towards center. */
+      offx = field->pos.x - m->x[i];
+      offy = field->pos.y - m->y[i];
+      d = pow2(offx)+pow2(offy);
+      if (d >= r2) {
+         /* Only at the center with no radius, nowhere to push to. */
+         if (d > 0.) {
+            d = sqrt(d);
+            m->vx[i] += k * offx / d;
+            m->vy[i] += k * offy / d;
+         }
+         setvel = 1;
+      }
+      else {
+         /* Push away from exclusion areas. */
+         for (int j=0; j<array_size(exc); j++) {
+            double ex, ey, ed;
+            if (!exc[j].affects)
+               continue;
+            ex = m->x[i] - exc[j].pos.x;
+            ey = m->y[i] - exc[j].pos.y;
+            ed = pow2(ex) + pow2(ey);
+            if ((ed <= pow2(exc[j].radius)) && (ed > 0.)) {
+               ed = sqrt(ed);
+               m->vx[i] += k * ex / ed;
+               m->vy[i] += k * ey / ed;
+               setvel = 1;
+            }
+         }
+      }
+
+      /* Enforce max speed. */
+      if (setvel) {
+         d = sqrt( pow2(m->vx[i]) + pow2(m->vy[i]) );
+         if (d > field->maxspeed) {
+            m->vx[i] *= field->maxspeed / d;
+            m->vy[i] *= field->maxspeed / d;
+         }
+      }
+
+      /* Update position and angle. */
+      m->x[i]   += m->vx[i] * dt;
+      m->y[i]   += m->vy[i] * dt;
+      m->ang[i] += m->spin[i] * dt;
+   }
+   return n-start;
+}
+
+/**
+ * @brief Moves the asteroids of a field, several at a time if possible.
+ *
+ * Same as asteroid_moveScalar(), but branches are replaced by masks so that
+ * it can run on vectors of asteroids. The remainder is done one at a time.
+ *
+ *    @param m Movement of the asteroids.
+ *    @param n Number of asteroids.
+ *    @param field Field the asteroids belong to.
+ *    @param exc Exclusion zones (array.h), only those marked as affecting are used.
+ *    @param dt Current delta tick.
+ *    @return Number of asteroids updated.
+ */
+static int asteroid_move( AsteroidMotion *m, int n,
+      const AsteroidAnchor *field, const AsteroidExclusion *exc, double dt )
+{
+   int i = 0;
+#ifdef AST_SIMD
+   int hasexc = 0;
+   const ast_vec vdt  = ast_set1( dt );
+   const ast_vec vk   = ast_set1( field->thrust * dt );
+   const ast_vec vcx  = ast_set1( field->pos.x );
+   const ast_vec vcy  = ast_set1( field->pos.y );
+   const ast_vec vr2  = ast_set1( pow2(field->radius) );
+   const ast_vec vmax = ast_set1( field->maxspeed );
+   const ast_vec zero = ast_zero();
+   const ast_vec one  = ast_set1( 1. );
+
+   for (int j=0; j<array_size(exc); j++)
+      hasexc |= exc[j].affects;
+
+   for (; i+AST_SIMD<=n; i+=AST_SIMD) {
+      ast_vec x, y, vx, vy, act, offx, offy, d2, out, setvel, spd, clamp, f;
+
+      ast_store( &m->timer[i], ast_sub( ast_load(&m->timer[i]), vdt ) );
+      act = ast_cmpgt( ast_load(&m->active[i]), zero );
+      if (!ast_any(act))
+         continue;
+
+      x  = ast_load( &m->x[i] );
+      y  = ast_load( &m->y[i] );
+      vx = ast_load( &m->vx[i] );
+      vy = ast_load( &m->vy[i] );
+
+      /* Push back towards center. Divisors of masked out lanes are set to 1
+       * so that no lane divides by zero (it traps with conf.fpu_except). */
+      offx = ast_sub( vcx, x );
+      offy = ast_sub( vcy, y );
+      d2   = ast_add( ast_mul(offx,offx), ast_mul(offy,offy) );
+      out  = ast_and( act, ast_cmpge( d2, vr2 ) );
+      setvel = out;
+      if (ast_any(out)) {
+         ast_vec push = ast_and( out, ast_cmpgt( d2, zero ) );
+         ast_vec d    = ast_select( push, ast_sqrt( d2 ), one );
+         vx = ast_add( vx, ast_and( push, ast_div( ast_mul(vk,offx), d ) ) );
+         vy = ast_add( vy, ast_and( push, ast_div( ast_mul(vk,offy), d ) ) );
+      }
+
+      /* Push away from exclusion areas. */
+      if (hasexc) {
+         ast_vec in = ast_andnot( out, act );
+         for (int j=0; j<array_size(exc); j++) {
+            ast_vec ex, ey, ed2, hit, ed;
+            if (!exc[j].affects)
+               continue;
+            ex  = ast_sub( x, ast_set1(exc[j].pos.x) );
+            ey  = ast_sub( y, ast_set1(exc[j].pos.y) );
+            ed2 = ast_add( ast_mul(ex,ex), ast_mul(ey,ey) );
+            hit = ast_and( in, ast_cmple( ed2, ast_set1(pow2(exc[j].radius)) ) );
+            hit = ast_and( hit, ast_cmpgt( ed2, zero ) );
+            if (!ast_any(hit))
+               continue;
+            ed  = ast_select( hit, ast_sqrt( ed2 ), one );
+            vx  = ast_add( vx, ast_and( hit, ast_div( ast_mul(vk,ex), ed ) ) );
+            vy  = ast_add( vy, ast_and( hit, ast_div( ast_mul(vk,ey), ed ) ) );
+            setvel = ast_or( setvel, hit );
+         }
+      }
+
+      /* Enforce max speed. */
+      spd   = ast_sqrt( ast_add( ast_mul(vx,vx), ast_mul(vy,vy) ) );
+      clamp = ast_and( setvel, ast_cmpgt( spd, vmax ) );
+      f     = ast_div( vmax, ast_select( clamp, spd, one ) );
+      vx    = ast_select( clamp, ast_mul(vx,f), vx );
+      vy    = ast_select( clamp, ast_mul(vy,f), vy );
+
+      /* Update position and angle. */
+      ast_store( &m->vx[i], vx );
+      ast_store( &m->vy[i], vy );
+      ast_store( &m->x[i], ast_add( x, ast_and( act, ast_mul(vx,vdt) ) ) );
+      ast_store( &m->y[i], ast_add( y, ast_and( act, ast_mul(vy,vdt) ) ) );
+      ast_store( &m->ang[i], ast_add( ast_load(&m->ang[i]),
+               ast_and( act, ast_mul( ast_load(&m->spin[i]), vdt ) ) ) );
+   }
+#endif /* AST_SIMD */
+   return i + asteroid_moveScalar( m, i, n, field, exc, dt );
+}
+
 /**
  * @brief Initializes the system.
  */
@@ -262,6 +465,7 @@ void asteroids_init (void)
 
       /* Add the asteroids to the anchor */
       ast->asteroids = realloc( ast->asteroids, (ast->nb) * sizeof(Asteroid) );
+      asteroid_motionAlloc( &ast->motion, ast->nb );
       for (int j=0; j<ast->nb; j++) {
          double r = RNGF();
          Asteroid *a = &ast->asteroids[j];
@@ -276,8 +480,8 @@ void asteroids_init (void)
             a->state = ASTEROID_BX;
          else
             a->state = ASTEROID_XX;
-         a->timer = a->timer_max = 30.*RNGF();
-         a->ang = RNGF() * M_PI * 2.;
+         ast->motion.timer[j] = a->timer_max = 30.*RNGF();
+         ast->motion.ang[j] = RNGF() * M_PI * 2.;
       }
 
       density_max = MAX( density_max, ast->density );
@@ -303,12 +507,14 @@ void asteroids_init (void)
  *    @param ast Asteroid to initialize.
  *    @param field Asteroid field the asteroid belongs to.
  */
-static int asteroid_init( Asteroid *ast, const AsteroidAnchor *field )
+static int asteroid_init( Asteroid *ast, AsteroidAnchor *field )
 {
    double mod, theta, wmax, r, r2;
    AsteroidType *at = NULL;
    int outfield, id;
    int attempts = 0;
+   AsteroidMotion *m = &field->motion;
+   vec2 pos;
 
    ast->parent  = field->id;
    ast->scanned = 0;
@@ -316,17 +522,19 @@ static int asteroid_init( Asteroid *ast, const AsteroidAnchor *field )
 
    do {
       /* Try to keep density uniform using cartesian coordinates. */
-      ast->pos.x = field->pos.x + (RNGF()*2.-1.)*field->radius;
-      ast->pos.y = field->pos.y + (RNGF()*2.-1.)*field->radius;
+      pos.x = field->pos.x + (RNGF()*2.-1.)*field->radius;
+      pos.y = field->pos.y + (RNGF()*2.-1.)*field->radius;
+      m->x[ast->id] = pos.x;
+      m->y[ast->id] = pos.y;
 
       /* Check if out of the field. */
-      outfield = (asteroids_inField(&ast->pos) < 0);
+      outfield = (asteroids_inField(&pos) < 0);
 
       /* If this is the first time and it's spawned outside the field,
        * we get rid of it so that density remains roughly consistent. */
-      if (asteroid_creating && outfield && (vec2_dist2( &ast->pos, &field->pos ) < r2)) {
+      if (asteroid_creating && outfield && (vec2_dist2( &pos, &field->pos ) < r2)) {
          ast->state = ASTEROID_XX;
-         ast->timer_max = ast->timer = HUGE_VAL; /* Don't reappear. */
+         ast->timer_max = m->timer[ast->id] = HUGE_VAL; /* Don't reappear. */
          /* TODO probably do a more proper solution removing total number of asteroids. */
          return -1;
       }
@@ -363,14 +571,15 @@ static int asteroid_init( Asteroid *ast, const AsteroidAnchor *field )
 
    /* And a random velocity/spin */
    theta     = RNGF()*2.*M_PI;
-   ast->spin = (1-2*RNGF())*field->maxspin;
+   m->spin[ast->id] = (1-2*RNGF())*field->maxspin;
    mod       = RNGF()*field->maxspeed;
-   vec2_pset( &ast->vel, mod, theta );
+   m->vx[ast->id] = mod * cos(theta);
+   m->vy[ast->id] = mod * sin(theta);
 
    /* Fade in stuff. */
    ast->state = ASTEROID_XX;
-   ast->timer_max = ast->timer = -1.;
-   ast->ang = RNGF() * M_PI * 2.;
+   ast->timer_max = m->timer[ast->id] = -1.;
+   m->ang[ast->id] = RNGF() * M_PI * 2.;
 
    return 0;
 }
@@ -772,11 +981,13 @@ void asteroids_renderOverlay (void)
    cy -= SCREEN_H/2.;
 
    /* Render the debris. */
+   gl_batchBegin();
    for (int j=0; j<array_size(debris_stack); j++) {
       Debris *d = &debris_stack[j];
       if (d->height > 1.)
          debris_renderSingle( d, cx, cy );
    }
+   gl_batchEnd();
 }
 
 /**
@@ -790,10 +1001,11 @@ void asteroids_render (void)
    cy -= SCREEN_H/2.;
 
    /* Render the asteroids & debris. */
+   gl_batchBegin();
    for (int i=0; i<array_size(cur_system->asteroids); i++) {
       AsteroidAnchor *ast = &cur_system->asteroids[i];
       for (int j=0; j<ast->nb; j++)
-        asteroid_renderSingle( &ast->asteroids[j] );
+        asteroid_renderSingle( ast, &ast->asteroids[j] );
    }
 
    /* Render the debris. */
@@ -805,24 +1017,31 @@ void asteroids_render (void)
 
    /* Render gatherable stuff. */
    gatherable_render();
+   gl_batchEnd();
 }
 
 /**
  * @brief Renders an asteroid.
+ *
+ *    @param field Field the asteroid belongs to.
+ *    @param a Asteroid to render.
  */
-static void asteroid_renderSingle( const Asteroid *a )
+static void asteroid_renderSingle( const AsteroidAnchor *field, const Asteroid *a )
 {
-   double nx, ny;
+   double nx, ny, x, y;
    const AsteroidType *at;
    glColour col;
    double progress;
    const glColour darkcol = cGrey20;
+   const AsteroidMotion *m = &field->motion;
 
    /* Skip invisible asteroids */
    if (a->state == ASTEROID_XX)
       return;
 
-   progress = a->timer / a->timer_max;
+   x = m->x[a->id];
+   y = m->y[a->id];
+   progress = m->timer[a->id] / a->timer_max;
    switch (a->state) {
       case ASTEROID_XX_TO_BG:
          col   = darkcol;
@@ -851,21 +1070,21 @@ static void asteroid_renderSingle( const Asteroid *a )
    }
 
    at = a->type;
-   gl_renderSpriteRotate( a->gfx, a->pos.x, a->pos.y, a->ang, 0, 0, &col );
+   gl_renderSpriteRotate( a->gfx, x, y, m->ang[a->id], 0, 0, &col );
 
    /* Add the commodities if scanned. */
    if (!a->scanned)
       return;
    col = cFontWhite;
    col.a = a->scan_alpha;
-   gl_gameToScreenCoords( &nx, &ny, a->pos.x, a->pos.y );
+   gl_gameToScreenCoords( &nx, &ny, x, y );
    gl_printRaw( &gl_smallFont, nx+a->gfx->sw/2, ny-gl_smallFont.h/2, &col, -1., _(at->scanned_msg) );
    /*
    for (int i=0; i<array_size(at->material); i++) {
       AsteroidReward *mat = &at->material[i];
       Commodity *com = mat->material;
       if (com->gfx_space!=NULL)
-         gl_renderSprite( com->gfx_space, a->pos.x, a->pos.y-10.*i, 0, 0, NULL );
+         gl_renderSprite( com->gfx_space, x, y-10.*i, 0, 0, NULL );
       snprintf(c, sizeof(c), "x%i", mat->quantity);
       gl_printRaw( &gl_smallFont, nx+10, ny-5-10.*i, &cFontWhite, -1., c );
    }
@@ -892,6 +1111,7 @@ void asteroid_free( AsteroidAnchor *ast )
 {
    free(ast->label);
    free(ast->asteroids);
+   free(ast->motion.x);
    array_free(ast->groups);
    array_free(ast->groupsw);
 }
@@ -1055,18 +1275,20 @@ void asteroid_explode( Asteroid *a, int max_rarity, double mining_bonus )
    const AsteroidType *at = a->type;
    AsteroidAnchor *field = &cur_system->asteroids[a->parent];
    Pilot *const* pilot_stack = pilot_getAll();
+   vec2 apos = asteroid_pos( a );
+   vec2 avel = asteroid_vel( a );
 
    /* Manage the explosion */
    dmg.type          = dtype_get("explosion_splash");
    dmg.damage        = at->damage;
    dmg.penetration   = at->penetration; /* Full penetration. */
    dmg.disable       = 0.;
-   expl_explode( a->pos.x, a->pos.y, a->vel.x, a->vel.y,
+   expl_explode( apos.x, apos.y, avel.x, avel.y,
                  at->exp_radius, &dmg, NULL, EXPL_MODE_SHIP );
 
    /* Play random explosion sound. */
    snprintf(buf, sizeof(buf), "explosion%d", RNG(0,2));
-   sound_playPos( sound_get(buf), a->pos.x, a->pos.y, a->vel.x, a->vel.y );
+   sound_playPos( sound_get(buf), apos.x, apos.y, avel.x, avel.y );
 
    /* Alert nearby pilots. */
    rad2 = pow2( at->alert_range );
@@ -1076,7 +1298,7 @@ void asteroid_explode( Asteroid *a, int max_rarity, double mining_bonus )
    for (int i=0; i<array_size(pilot_stack); i++) {
       Pilot *p = pilot_stack[i];
 
-      if (vec2_dist2( &p->solid->pos, &a->pos ) > rad2)
+      if (vec2_dist2( &p->solid->pos, &apos ) > rad2)
          continue;
 
       pilot_msg( NULL, p, "asteroid", -1 );
@@ -1108,8 +1330,8 @@ void asteroid_explode( Asteroid *a, int max_rarity, double mining_bonus )
             int nb = RNG(0, round((double)mat->quantity * mining_bonus));
             for (int j=0; j<nb; j++) {
                vec2 pos, vel;
-               pos = a->pos;
-               vel = a->vel;
+               pos = apos;
+               vel = avel;
                pos.x += (RNGF()*30.-15.);
                pos.y += (RNGF()*30.-15.);
                vel.x += (RNGF()*20.-10.);
@@ -1127,5 +1349,165 @@ void asteroid_explode( Asteroid *a, int max_rarity, double mining_bonus )
    /* Make it respawn elsewhere */
    asteroid_init( a, field );
    a->state = ASTEROID_BG_TO_XX;
-   a->timer_max = a->timer = 0.5;
+   a->timer_max = field->motion.timer[a->id] = 0.5;
+}
+
+/**
+ * @brief Gets the position of an asteroid.
+ *
+ *    @param a Asteroid to get the position of.
+ *    @return The position of the asteroid.
+ */
+vec2 asteroid_pos( const Asteroid *a )
+{
+   const AsteroidMotion *m = &cur_system->asteroids[a->parent].motion;
+   vec2 v;
+   vec2_cset( &v, m->x[a->id], m->y[a->id] );
+   return v;
+}
+
+/**
+ * @brief Gets the velocity of an asteroid.
+ *
+ *    @param a Asteroid to get the velocity of.
+ *    @return The velocity of the asteroid.
+ */
+vec2 asteroid_vel( const Asteroid *a )
+{
+   const AsteroidMotion *m = &cur_system->asteroids[a->parent].motion;
+   vec2 v;
+   vec2_cset( &v, m->vx[a->id], m->vy[a->id] );
+   return v;
+}
+
+/**
+ * @brief Gets the angle of an asteroid.
+ *
+ *    @param a Asteroid to get the angle of.
+ *    @return The angle of the asteroid.
+ */
+double asteroid_ang( const Asteroid *a )
+{
+   return cur_system->asteroids[a->parent].motion.ang[a->id];
+}
+
+/**
+ * @brief Gets the internal timer of an asteroid.
+ *
+ *    @param a Asteroid to get the timer of.
+ *    @return The time left in the current state of the asteroid.
+ */
+double asteroid_timer( const Asteroid *a )
+{
+   return cur_system->asteroids[a->parent].motion.timer[a->id];
+}
+
+/**
+ * @brief Sets the position of an asteroid.
+ *
+ *    @param a Asteroid to set the position of.
+ *    @param pos Position to set.
+ */
+void asteroid_setPos( Asteroid *a, const vec2 *pos )
+{
+   AsteroidMotion *m = &cur_system->asteroids[a->parent].motion;
+   m->x[a->id] = pos->x;
+   m->y[a->id] = pos->y;
+}
+
+/**
+ * @brief Sets the velocity of an asteroid.
+ *
+ *    @param a Asteroid to set the velocity of.
+ *    @param vel Velocity to set.
+ */
+void asteroid_setVel( Asteroid *a, const vec2 *vel )
+{
+   AsteroidMotion *m = &cur_system->asteroids[a->parent].motion;
+   m->vx[a->id] = vel->x;
+   m->vy[a->id] = vel->y;
+}
+
+/**
+ * @brief Sets the internal timer of an asteroid.
+ *
+ *    @param a Asteroid to set the timer of.
+ *    @param timer Time left in the current state of the asteroid.
+ */
+void asteroid_setTimer( Asteroid *a, double timer )
+{
+   cur_system->asteroids[a->parent].motion.timer[a->id] = timer;
+   a->timer_max = MAX( a->timer_max, timer );
+}
+
+#if DEBUGGING
+/**
+ * @brief Benchmarks the asteroid movement on a synthetic field.
+ *
+ * The field has a couple of exclusion zones and some asteroids start outside
+ * of it or inexistent, so that all the paths are exercised.
+ *
+ *    @param n Number of asteroids in the field.
+ *    @param steps Number of updates to run.
+ *    @param[out] simd Time in seconds taken by the vectorized movement.
+ *    @param[out] scalar Time in seconds taken by the scalar movement.
+ */
+void asteroids_benchmark( int n, int steps, double *simd, double *scalar )
+{
+   AsteroidAnchor field;
+   AsteroidExclusion *exc;
+   AsteroidMotion m;
+   double *init;
+   size_t size = 8 * MAX(n,1) * sizeof(double);
+   Uint64 t;
+   const double dt = 1./60.;
+
+   memset( &field, 0, sizeof(field) );
+   field.density  = ASTEROID_DEFAULT_DENSITY;
+   field.maxspeed = ASTEROID_DEFAULT_MAXSPEED;
+   field.maxspin  = ASTEROID_DEFAULT_MAXSPIN;
+   field.thrust   = ASTEROID_DEFAULT_THRUST;
+   field.radius   = sqrt( n * ASTEROID_REF_AREA / (M_PI * field.density) );
+   asteroids_computeInternals( &field );
+
+   exc = array_create( AsteroidExclusion );
+   for (int i=0; i<2; i++) {
+      AsteroidExclusion *e = &array_grow( &exc );
+      vec2_cset( &e->pos, (i==0 ? 0.5 : -0.5) * field.radius, 0. );
+      e->radius  = 0.2 * field.radius;
+      e->affects = 1;
+   }
+
+   memset( &m, 0, sizeof(m) );
+   asteroid_motionAlloc( &m, n );
+   for (int i=0; i<n; i++) {
+      double theta = RNGF()*2.*M_PI;
+      double mod   = RNGF()*field.maxspeed;
+      m.x[i]      = (RNGF()*2.2-1.1) * field.radius;
+      m.y[i]      = (RNGF()*2.2-1.1) * field.radius;
+      m.vx[i]     = mod * cos(theta);
+      m.vy[i]     = mod * sin(theta);
+      m.ang[i]    = RNGF() * M_PI * 2.;
+      m.spin[i]   = (1-2*RNGF())*field.maxspin;
+      m.timer[i]  = 30.*RNGF();
+      m.active[i] = (RNGF() > 0.1);
+   }
+   init = malloc( size );
+   memcpy( init, m.x, size );
+
+   t = SDL_GetPerformanceCounter();
+   for (int s=0; s<steps; s++)
+      asteroid_move( &m, n, &field, exc, dt );
+   *simd = (double)(SDL_GetPerformanceCounter() - t) / (double)SDL_GetPerformanceFrequency();
+
+   memcpy( m.x, init, size );
+   t = SDL_GetPerformanceCounter();
+   for (int s=0; s<steps; s++)
+      asteroid_moveScalar( &m, 0, n, &field, exc, dt );
+   *scalar = (double)(SDL_GetPerformanceCounter() - t) / (double)SDL_GetPerformanceFrequency();
+
+   free( init );
+   free( m.x );
+   array_free( exc );
 }
+#endif /* DEBUGGING */
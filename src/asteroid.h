@@ -82,18 +82,29 @@ typedef struct Asteroid_ {
    const glTexture *gfx; /**< Graphic of the asteroid. */
    CollPoly *polygon;   /**< Collision polygon associated to gfx. */
    double armour; /**< Current "armour" of the asteroid. */
-   /* Movement. */
-   vec2 pos;      /**< Position. */
-   vec2 vel;      /**< Velocity. */
-   double ang;    /**< Angle. */
-   double spin;   /**< Spin. */
    /* Stats. */
-   double timer;  /**< Internal timer for animations. */
    double timer_max; /**< Internal timer initial value. */
    double scan_alpha; /**< Alpha value for scanning stuff. */
    int scanned;   /**< Wether the player already scanned this asteroid. */
 } Asteroid;
 
+/**
+ * @brief Movement and timers of the asteroids of a field, as a structure of arrays.
+ *
+ * Kept apart from the Asteroid so that asteroids_update() can process several
+ * asteroids at once. Elsewhere use the accessors such as asteroid_pos().
+ */
+typedef struct AsteroidMotion_ {
+   double *x;     /**< X position of each asteroid. */
+   double *y;     /**< Y position of each asteroid. */
+   double *vx;    /**< X velocity of each asteroid. */
+   double *vy;    /**< Y velocity of each asteroid. */
+   double *ang;   /**< Angle of each asteroid. */
+   double *spin;  /**< Spin of each asteroid. */
+   double *timer; /**< Internal timer for animations of each asteroid. */
+   double *active;/**< 1. if the asteroid exists and moves, 0. otherwise. */
+} AsteroidMotion;
+
 /**
  * @brief Represents an asteroid field anchor.
  */
@@ -103,6 +114,7 @@ typedef struct AsteroidAnchor_ {
    vec2 pos;      /**< Position in the system (from center). */
    double density;/**< Density of the field. */
    Asteroid *asteroids; /**< Asteroids belonging to the field. */
+   AsteroidMotion motion; /**< Movement of the asteroids belonging to the field. */
    int nb;        /**< Number of asteroids. */
    double radius; /**< Radius of the anchor. */
    double area;   /**< Field's area. */
@@ -148,3 +160,17 @@ int asteroids_inField( const vec2 *p );
 void asteroids_computeInternals( AsteroidAnchor *a );
 void asteroid_hit( Asteroid *a, const Damage *dmg, int max_rarity, double mine_bonus );
 void asteroid_explode( Asteroid *a, int max_rarity, double mine_bonus );
+
+/* Movement accessors. */
+vec2 asteroid_pos( const Asteroid *a );
+vec2 asteroid_vel( const Asteroid *a );
+double asteroid_ang( const Asteroid *a );
+double asteroid_timer( const Asteroid *a );
+void asteroid_setPos( Asteroid *a, const vec2 *pos );
+void asteroid_setVel( Asteroid *a, const vec2 *vel );
+void asteroid_setTimer( Asteroid *a, double timer );
+
+#if DEBUGGING
+/* Benchmarking. */
+void asteroids_benchmark( int n, int steps, double *simd, double *scalar );
+#endif /* DEBUGGING */
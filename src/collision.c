@@ -15,6 +15,10 @@
 
 #include "log.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+# define strtok_r strtok_s
+#endif
+
 /*
  * Prototypes
  */
@@ -26,6 +30,8 @@ static int LineOnPolygon( const CollPoly* at, const vec2* ap,
 /**
  * @brief Loads a polygon from an xml node.
  *
+ * Can be called from any thread.
+ *
  *    @param[out] polygon Polygon.
  *    @param[in] node xml node.
  */
@@ -37,7 +43,8 @@ void LoadPolygon( CollPoly* polygon, xmlNodePtr node )
          char *list = xml_get(cur);
          int i = 0;
          /* split the list of coordiantes */
-         char *ch = strtok(list, ",");
+         char *saveptr;
+         char *ch = strtok_r(list, ",", &saveptr);
          polygon->x = malloc( sizeof(float) );
          polygon->xmin = 0;
          polygon->xmax = 0;
@@ -49,14 +56,15 @@ void LoadPolygon( CollPoly* polygon, xmlNodePtr node )
             polygon->x[i-1] = d;
             polygon->xmin = MIN( polygon->xmin, d );
             polygon->xmax = MAX( polygon->xmax, d );
-            ch = strtok(NULL, ",");
+            ch = strtok_r(NULL, ",", &saveptr);
          }
       }
       else if (xml_isNode(cur,"y")) {
          char *list = xml_get(cur);
          int i = 0;
          /* split the list of coordiantes */
-         char *ch = strtok(list, ",");
+         char *saveptr;
+         char *ch = strtok_r(list, ",", &saveptr);
          polygon->y = malloc( sizeof(float) );
          polygon->ymin = 0;
          polygon->ymax = 0;
@@ -68,7 +76,7 @@ void LoadPolygon( CollPoly* polygon, xmlNodePtr node )
             polygon->y[i-1] = d;
             polygon->ymin = MIN( polygon->ymin, d );
             polygon->ymax = MAX( polygon->ymax, d );
-            ch = strtok(NULL, ",");
+            ch = strtok_r(NULL, ",", &saveptr);
          }
          polygon->npt = i;
       }
@@ -26,6 +26,7 @@
 #include "gatherable.h"
 #include "hook.h"
 #include "log.h"
+#include "nameindex.h"
 #include "ndata.h"
 #include "nstring.h"
 #include "ntime.h"
@@ -42,6 +43,7 @@
 /* commodity stack */
 Commodity* commodity_stack = NULL; /**< Contains all the commodities. */
 static Commodity** commodity_temp = NULL; /**< Contains all the temporary commodities. */
+static NameIndex commodity_index; /**< Commodities indexed by name, temporary ones come after the stack. */
 
 /* @TODO remove externs. */
 extern int *econ_comm;
@@ -145,13 +147,12 @@ Commodity* commodity_get( const char* name )
  */
 Commodity* commodity_getW( const char* name )
 {
-   for (int i=0; i<array_size(commodity_stack); i++)
-      if (strcmp(commodity_stack[i].name, name) == 0)
-         return &commodity_stack[i];
-   for (int i=0; i<array_size(commodity_temp); i++)
-      if (strcmp(commodity_temp[i]->name, name) == 0)
-         return commodity_temp[i];
-   return NULL;
+   int id = nameindex_get( &commodity_index, name );
+   if (id < 0)
+      return NULL;
+   if (id < array_size(commodity_stack))
+      return &commodity_stack[id];
+   return commodity_temp[ id - array_size(commodity_stack) ];
 }
 
 /**
@@ -402,12 +403,9 @@ int commodity_checkIllegal( const Commodity *com, int faction )
  */
 int commodity_isTemp( const char* name )
 {
-   for (int i=0; i<array_size(commodity_temp); i++)
-      if (strcmp(commodity_temp[i]->name, name) == 0)
-         return 1;
-   for (int i=0; i<array_size(commodity_stack); i++)
-      if (strcmp(commodity_stack[i].name,name)==0)
-         return 0;
+   const Commodity *c = commodity_getW( name );
+   if (c != NULL)
+      return c->istemp;
 
    WARN(_("Commodity '%s' not found in stack"), name);
    return 0;
@@ -431,6 +429,8 @@ Commodity* commodity_newTemp( const char* name, const char* desc )
    (*c)->istemp   = 1;
    (*c)->name     = strdup(name);
    (*c)->description = strdup(desc);
+   nameindex_add( &commodity_index, (*c)->name,
+         array_size(commodity_stack) + array_size(commodity_temp)-1 );
    return *c;
 }
 
@@ -495,6 +495,12 @@ int commodity_load (void)
    }
    array_free( commodities );
 
+   /* Index by name. */
+   nameindex_init( &commodity_index );
+   nameindex_reserve( &commodity_index, array_size(commodity_stack) );
+   for (int i=0; i<array_size(commodity_stack); i++)
+      nameindex_add( &commodity_index, commodity_stack[i].name, i );
+
    if (conf.devmode) {
       time = SDL_GetTicks() - time;
       DEBUG( n_( "Loaded %d Commodity in %.3f s", "Loaded %d Commodities in %.3f s", array_size(commodity_stack) ), array_size(commodity_stack), time/1000. );
@@ -521,6 +527,7 @@ void commodity_free (void)
    }
    array_free( commodity_temp );
    commodity_temp = NULL;
+   nameindex_free( &commodity_index );
 
    /* More clean up. */
    array_free( econ_comm );
@@ -17,6 +17,12 @@
 #include "nluadef.h"
 
 static nlua_env cond_env = LUA_NOREF; /** Conditional Lua env. */
+static int cond_cache = LUA_NOREF; /**< Table of compiled conditionals indexed by their source. */
+
+/*
+ * Prototypes.
+ */
+static int cond_get( const char *cond );
 
 /**
  * @brief Initializes the conditional subsystem.
@@ -32,6 +38,9 @@ int cond_init (void)
       return -1;
    }
 
+   lua_newtable(naevL);
+   cond_cache = luaL_ref(naevL, LUA_REGISTRYINDEX);
+
    return 0;
 }
 
@@ -40,20 +49,37 @@ int cond_init (void)
  */
 void cond_exit (void)
 {
+   if (cond_cache != LUA_NOREF)
+      luaL_unref(naevL, LUA_REGISTRYINDEX, cond_cache);
+   cond_cache = LUA_NOREF;
    nlua_freeEnv(cond_env);
    cond_env = LUA_NOREF;
 }
 
 /**
- * @brief Checks to see if a condition is true.
+ * @brief Pushes the compiled chunk of a conditional, compiling it if necessary.
  *
- *    @param cond Condition to check.
- *    @return 0 if is false, 1 if is true, -1 on error.
+ * Conditionals that fail to compile are cached too so that the syntax error
+ * is only reported once.
+ *
+ *    @param cond Condition to get.
+ *    @return 0 on success and the chunk is pushed on the stack, -1 on error and nothing is pushed.
  */
-int cond_check( const char *cond )
+static int cond_get( const char *cond )
 {
    int ret;
-   char buf[STRMAX_SHORT];
+
+   lua_rawgeti(naevL, LUA_REGISTRYINDEX, cond_cache); /* t */
+   lua_getfield(naevL, -1, cond);                     /* t, f */
+   if (lua_isfunction(naevL, -1)) {
+      lua_remove(naevL, -2);                          /* f */
+      return 0;
+   }
+   else if (!lua_isnil(naevL, -1)) {
+      lua_pop(naevL, 2);                              /* */
+      return -1;
+   }
+   lua_pop(naevL, 1);                                 /* t */
 
    /* Load the string directly. */
    if (strstr( cond, "return" ) != NULL) {
@@ -64,13 +90,66 @@ int cond_check( const char *cond )
       lua_pushstring(naevL, "return ");
       lua_pushstring(naevL, cond);
       lua_concat(naevL, 2);
+   }                                                  /* t, s */
+   ret = luaL_loadbuffer(naevL, lua_tostring(naevL,-1),
+                         lua_strlen(naevL,-1), "Lua Conditional");
+   lua_remove(naevL, -2);                             /* t, f */
+   if (ret != 0) {
+      print_with_line_numbers( cond );
+      WARN(_("Lua conditional syntax error: %s"), lua_tostring(naevL, -1));
+      lua_pop(naevL, 1);                              /* t */
+      lua_pushboolean(naevL, 0);                      /* t, false */
+      lua_setfield(naevL, -2, cond);                  /* t */
+      lua_pop(naevL, 1);                              /* */
+      return -1;
    }
-   ret = nlua_dobufenv(cond_env, lua_tostring(naevL,-1),
-                       lua_strlen(naevL,-1), "Lua Conditional");
+   nlua_pushenv(naevL, cond_env);                     /* t, f, env */
+   lua_setfenv(naevL, -2);                            /* t, f */
+   lua_pushvalue(naevL, -1);                          /* t, f, f */
+   lua_setfield(naevL, -3, cond);                     /* t, f */
+   lua_remove(naevL, -2);                             /* f */
+   return 0;
+}
+
+/**
+ * @brief Compiles a conditional ahead of time so it is ready for cond_check().
+ *
+ * Syntax errors are reported here instead of when the conditional is first
+ * checked.
+ *
+ *    @param cond Condition to compile.
+ *    @return 0 on success, -1 on error.
+ */
+int cond_compile( const char *cond )
+{
+   if (cond_get( cond ))
+      return -1;
+   lua_pop(naevL, 1);
+   return 0;
+}
+
+/**
+ * @brief Checks to see if a condition is true.
+ *
+ * The conditional is only compiled the first time it is checked (or when
+ * passed to cond_compile()), afterwards the cached chunk is run directly.
+ *
+ *    @param cond Condition to check.
+ *    @return 0 if is false, 1 if is true, -1 on error.
+ */
+int cond_check( const char *cond )
+{
+   int ret;
+   char buf[STRMAX_SHORT];
+
+   /* Get the compiled chunk, syntax errors were already reported. */
+   if (cond_get( cond )) {
+      lua_settop(naevL, 0);
+      return -1;
+   }
+
+   ret = nlua_pcall(cond_env, 0, 1);
    switch (ret) {
-      case  LUA_ERRSYNTAX:
-         snprintf( buf, sizeof(buf), _("Lua conditional syntax error: %s"), lua_tostring(naevL, -1));
-         goto cond_err;
       case LUA_ERRRUN:
          snprintf( buf, sizeof(buf), _("Lua Conditional had a runtime error: %s"), lua_tostring(naevL, -1));
          goto cond_err;
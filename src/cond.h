@@ -5,4 +5,5 @@
 
 int cond_init (void);
 void cond_exit (void);
+int cond_compile( const char *cond );
 int cond_check( const char *cond );
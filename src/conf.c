@@ -103,6 +103,9 @@ static void print_usage( void )
    LOG(_("   -s f, --svol f        sets the sound volume to f"));
    LOG(_("   -d, --datapath        adds a new datapath to be mounted (i.e., appends it to the search path for game assets)"));
    LOG(_("   -X, --scale           defines the scale factor"));
+   LOG(_("   --headless s          simulates system s without playing, prints timings and exits"));
+   LOG(_("   --ticks n             number of updates to simulate with --headless"));
+   LOG(_("   --seed n              random seed to use with --headless"));
 #ifdef DEBUGGING
    LOG(_("   --devmode             enables dev mode perks like the editors"));
 #endif /* DEBUGGING */
@@ -149,6 +152,8 @@ void conf_setDefaults (void)
    conf.devautosave  = 0;
    conf.lua_enet     = 0;
    conf.lua_repl     = 0;
+   conf.lua_budget   = LUA_BUDGET_DEFAULT;
+   conf.lua_budget_defer = LUA_BUDGET_DEFER_DEFAULT;
    conf.lastversion  = strdup( "" );
    conf.translation_warning_seen = 0;
    memset( &conf.last_played, 0, sizeof(time_t) );
@@ -167,6 +172,7 @@ void conf_setDefaults (void)
 
    /* Debugging. */
    conf.fpu_except   = 0; /* Causes many issues. */
+   conf.headless_ticks = HEADLESS_TICKS_DEFAULT;
 
    /* Editor. */
    conf.dev_save_sys = strdup( DEV_SAVE_SYSTEM_DEFAULT );
@@ -189,6 +195,7 @@ void conf_setGameplayDefaults (void)
    conf.mouse_fly             = MOUSE_FLY_DEFAULT;
    conf.autonav_reset_dist    = AUTONAV_RESET_DIST_DEFAULT;
    conf.autonav_reset_shield  = AUTONAV_RESET_SHIELD_DEFAULT;
+   conf.weapon_threads        = WEAPON_THREADS_DEFAULT;
    conf.zoom_manual           = MANUAL_ZOOM_DEFAULT;
 }
 
@@ -411,10 +418,13 @@ int conf_loadConfig ( const char* file )
       conf_loadFloat( lEnv, "mouse_doubleclick", conf.mouse_doubleclick );
       conf_loadFloat( lEnv, "autonav_reset_dist", conf.autonav_reset_dist );
       conf_loadFloat( lEnv, "autonav_reset_shield", conf.autonav_reset_shield );
+      conf_loadInt( lEnv, "weapon_threads", conf.weapon_threads );
       conf_loadBool( lEnv, "devmode", conf.devmode );
       conf_loadBool( lEnv, "devautosave", conf.devautosave );
       conf_loadBool( lEnv, "lua_enet", conf.lua_enet );
       conf_loadBool( lEnv, "lua_repl", conf.lua_repl );
+      conf_loadFloat( lEnv, "lua_budget", conf.lua_budget );
+      conf_loadBool( lEnv, "lua_budget_defer", conf.lua_budget_defer );
       conf_loadBool( lEnv, "conf_nosave", conf.nosave );
       conf_loadString( lEnv, "lastversion", conf.lastversion );
       conf_loadBool( lEnv, "translation_warning_seen", conf.translation_warning_seen );
@@ -563,6 +573,9 @@ void conf_parseCLI( int argc, char** argv )
       { "mvol", required_argument, 0, 'm' },
       { "svol", required_argument, 0, 's' },
       { "scale", required_argument, 0, 'X' },
+      { "headless", required_argument, 0, 'B' },
+      { "ticks", required_argument, 0, 'T' },
+      { "seed", required_argument, 0, 'R' },
 #ifdef DEBUGGING
       { "devmode", no_argument, 0, 'D' },
 #endif /* DEBUGGING */
@@ -626,6 +639,20 @@ void conf_parseCLI( int argc, char** argv )
          case 'X':
             conf.scalefactor = atof(optarg);
             break;
+         case 'B':
+            free(conf.headless);
+            conf.headless = strdup(optarg);
+            /* Nothing is played or shown, and the configuration is left alone. */
+            conf.nosound = 1;
+            conf.fullscreen = 0;
+            conf.nosave = 1;
+            break;
+         case 'T':
+            conf.headless_ticks = atoi(optarg);
+            break;
+         case 'R':
+            conf.headless_seed = strtoul(optarg, NULL, 10);
+            break;
 #ifdef DEBUGGING
          case 'D':
             conf.devmode = 1;
@@ -1052,6 +1079,10 @@ int conf_saveConfig ( const char* file )
    conf_saveFloat("autonav_reset_shield",conf.autonav_reset_shield);
    conf_saveEmptyLine();
 
+   conf_saveComment(_("Threads to use for weapon collisions (0 uses one per CPU, 1 disables threading)."));
+   conf_saveInt("weapon_threads",conf.weapon_threads);
+   conf_saveEmptyLine();
+
    conf_saveComment(_("Enables developer mode (universe editor and the likes)"));
    conf_saveBool("devmode",conf.devmode);
    conf_saveEmptyLine();
@@ -1066,6 +1097,12 @@ int conf_saveConfig ( const char* file )
    conf_saveBool("lua_repl",conf.lua_repl);
    conf_saveEmptyLine();
 
+   conf_saveComment(_("Time in ms a single Lua script may take each frame before being warned about (0 disables)."));
+   conf_saveFloat("lua_budget",conf.lua_budget);
+   conf_saveComment(_("Whether scripts over the budget get their AI control and spawning ticks deferred to the next frame."));
+   conf_saveBool("lua_budget_defer",conf.lua_budget_defer);
+   conf_saveEmptyLine();
+
    conf_saveComment(_("Save the config every time game exits (rewriting this bit)"));
    conf_saveInt("conf_nosave",conf.nosave);
    conf_saveEmptyLine();
@@ -1190,6 +1227,7 @@ void conf_copy( PlayerConf_t *dest, const PlayerConf_t *src )
    STRDUP(dev_save_sys);
    STRDUP(dev_save_map);
    STRDUP(dev_save_spob);
+   STRDUP(headless);
    if (src->difficulty != NULL)
       STRDUP(difficulty);
 #undef STRDUP
@@ -1208,6 +1246,7 @@ void conf_free( PlayerConf_t *config )
    free(config->dev_save_sys);
    free(config->dev_save_map);
    free(config->dev_save_spob);
+   free(config->headless);
    free(config->difficulty);
 
    /* Clear memory. */
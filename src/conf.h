@@ -26,6 +26,10 @@
 #define MAP_OVERLAY_OPACITY_DEFAULT    0.3   /**< Opacity fraction (0-1) for the overlay map. */
 #define INPUT_MESSAGES_DEFAULT         5     /**< Amount of messages to display. */
 #define DIFFICULTY_DEFAULT             NULL  /**< Default difficulty. */
+#define WEAPON_THREADS_DEFAULT         0     /**< Threads to use for weapon collisions (0 is one per CPU). */
+#define LUA_BUDGET_DEFAULT             0.    /**< Time a Lua script may take each frame (in ms, 0 disables). */
+#define LUA_BUDGET_DEFER_DEFAULT       0     /**< Whether or not scripts over the budget get deferred. */
+#define HEADLESS_TICKS_DEFAULT         3600  /**< Updates to simulate when headless. */
 /* Video options */
 #define RESOLUTION_W_MIN               1280  /**< Minimum screen width (below which graphics are downscaled). */
 #define RESOLUTION_H_MIN               720   /**< Minimum screen height (below which graphics are downscaled). */
@@ -154,10 +158,13 @@ typedef struct PlayerConf_s {
    double mouse_doubleclick; /**< How long to consider double-clicks for. */
    double autonav_reset_dist; /**< Enemy distance condition for resetting autonav. */
    double autonav_reset_shield; /**< Shield condition for resetting autonav speed. */
+   int weapon_threads; /**< Threads to use for weapon collisions, 0 for one per CPU and 1 to disable. */
    int devmode; /**< Developer mode. */
    int devautosave; /**< Developer mode autosave. */
    int lua_enet; /**< Enable the lua-enet library. */
    int lua_repl; /**< Enable the experimental CLI based on lua-repl. */
+   double lua_budget; /**< Time a Lua script may take each frame (in ms), 0 to disable. */
+   int lua_budget_defer; /**< Defer deferrable calls of scripts over the budget instead of just warning. */
    int nosave; /**< Disables conf saving. */
    char *lastversion; /**< The last version the game was ran in. */
    int translation_warning_seen; /**< No need to warn about incomplete game translations again. */
@@ -165,6 +172,9 @@ typedef struct PlayerConf_s {
 
    /* Debugging. */
    int fpu_except; /**< Enable FPU exceptions? */
+   char *headless; /**< System to simulate without playing, NULL to play normally. */
+   int headless_ticks; /**< Number of updates to simulate when headless. */
+   unsigned int headless_seed; /**< Random seed to use when headless. */
 
    /* Editor. */
    char *dev_save_sys; /**< Path to save systems to. */
@@ -566,6 +566,7 @@ static void sysedit_btnRemove( unsigned int wid_unused, const char *unused )
             free(file);
 
             system_rmSpob( sysedit_sys, sp->name );
+            space_reconstructPresences();
          }
          else if (sel->type == SELECT_ASTEROID) {
             AsteroidAnchor *ast = &sysedit_sys->asteroids[ sel->u.asteroid ];
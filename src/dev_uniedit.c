@@ -1431,9 +1431,8 @@ static void uniedit_renameSys (void)
 
       free(oldName);
       free(newName);
-      free(sys->name);
 
-      sys->name = name;
+      system_rename( sys, name );
       dsys_saveSystem(sys);
 
       /* Re-save adjacent systems. */
@@ -2129,7 +2128,8 @@ static void uniedit_btnEditRmSpob( unsigned int wid, const char *unused )
       return;
    }
 
-   /* Update economy due to galaxy modification. */
+   /* Update presence and economy due to galaxy modification. */
+   space_reconstructPresences();
    economy_execQueued();
 
    uniedit_editGenList( wid );
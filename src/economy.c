@@ -142,7 +142,7 @@ credits_t economy_getPriceAtTime( const Commodity *com,
 
    /* and get the index on this spob */
    for (i=0; i<array_size(p->commodities); i++) {
-      if ((strcmp(p->commodities[i]->name, com->name)==0))
+      if (p->commodities[i] == com)
          break;
    }
    if (i >= array_size(p->commodities)) {
@@ -209,7 +209,7 @@ int economy_getAverageSpobPrice( const Commodity *com, const Spob *p, credits_t
 
    /* and get the index on this spob */
    for (i=0; i<array_size(p->commodities); i++) {
-      if ((strcmp(p->commodities[i]->name, com->name) == 0))
+      if (p->commodities[i] == com)
          break;
    }
    if (i >= array_size(p->commodities)) {
@@ -286,7 +286,7 @@ int economy_getAveragePrice( const Commodity *com, credits_t *mean, double *std
 
          /* and get the index on this spob */
          for (k=0; k<array_size(p->commodities); k++) {
-            if ((strcmp(p->commodities[k]->name, com->name) == 0 ))
+            if (p->commodities[k] == com)
                break;
          }
          if (k < array_size(p->commodityPrice)) {
@@ -733,7 +733,7 @@ static void economy_modifySystemCommodityPrice( StarSystem *sys )
          spob->commodityPrice[j].sysPeriod = 2000. / (array_size(sys->jumps) + 1);
 
          for (k=0; k<array_size(avprice); k++) {
-            if ( ( strcmp( spob->commodities[j]->name, avprice[k].name ) == 0 ) ) {
+            if (spob->commodities[j]->name == avprice[k].name) {
                avprice[k].updateTime++;
                avprice[k].price+=spob->commodityPrice[j].price;
                avprice[k].spobPeriod+=spob->commodityPrice[j].spobPeriod;
@@ -768,7 +768,7 @@ static void economy_modifySystemCommodityPrice( StarSystem *sys )
       Spob *spob = sys->spobs[i];
       for (int j=0; j<array_size(spob->commodities); j++) {
          for ( k=0; k<array_size(avprice); k++ ) {
-            if ( ( strcmp( spob->commodities[j]->name, avprice[k].name ) == 0 ) ) {
+            if (spob->commodities[j]->name == avprice[k].name) {
                spob->commodityPrice[j].price*=0.25;
                spob->commodityPrice[j].price+=0.75*avprice[k].price;
                spob->commodityPrice[j].sysVariation=0.2*avprice[k].spobVariation;
@@ -801,7 +801,7 @@ static void economy_smoothCommodityPrice(StarSystem *sys)
       for ( i=0; i<array_size(sys->jumps); i++ ) {/* for each neighbouring system */
          neighbour=sys->jumps[i].target;
          for ( k=0; k<array_size(neighbour->averagePrice); k++ ) {
-            if ( ( strcmp( neighbour->averagePrice[k].name, avprice[j].name ) == 0 ) ) {
+            if (neighbour->averagePrice[k].name == avprice[j].name) {
                price+=neighbour->averagePrice[k].price;
                n++;
                break;
@@ -834,7 +834,7 @@ static void economy_calcUpdatedCommodityPrice(StarSystem *sys)
       spob=sys->spobs[i];
       for ( j=0; j<array_size(spob->commodities); j++ ) {
          for ( k=0; k<array_size(avprice); k++ ) {
-            if ( ( strcmp(avprice[k].name, spob->commodities[j]->name) == 0 ) ) {
+            if (avprice[k].name == spob->commodities[j]->name) {
                spob->commodityPrice[j].price = (
                      0.25*spob->commodityPrice[j].price
                         + 0.75*avprice[k].price );
@@ -911,6 +911,100 @@ void economy_initialiseCommodityPrices(void)
    }
 }
 
+/**
+ * @brief Initialises the commodity prices of only the systems affected by some changes.
+ *
+ * The prices of a system depend on its spobs and on the average prices of the
+ * systems it has jumps to, so the changed systems and the systems with jumps
+ * to them are recomputed, giving the same prices as
+ * economy_initialiseCommodityPrices(). The systems they jump to are only used
+ * for smoothing and are left untouched.
+ *
+ *    @param systems Array (array.h) of IDs of the systems that changed.
+ */
+void economy_initialiseCommodityPricesPartial( const int *systems )
+{
+   int n = array_size(systems_stack);
+   char *state; /* 0: unaffected, 1: recompute, 2: only needed for smoothing. */
+   int *update, *outer;
+   CommodityPrice *saved;
+
+   if (array_size(systems) == 0)
+      return;
+
+   /* Changed systems and the systems that smooth with them. */
+   state = calloc( n, sizeof(char) );
+   for (int i=0; i<array_size(systems); i++)
+      state[ systems[i] ] = 1;
+   update = array_create( int );
+   for (int i=0; i<n; i++) {
+      const StarSystem *sys = &systems_stack[i];
+      int changed = (state[i] == 1);
+      for (int j=0; !changed && j<array_size(sys->jumps); j++)
+         changed = (state[ sys->jumps[j].targetid ] == 1);
+      if (changed)
+         array_push_back( &update, i );
+   }
+   for (int i=0; i<array_size(update); i++)
+      state[ update[i] ] = 1;
+
+   /* Their neighbours need their average prices, but their own prices must not change. */
+   outer = array_create( int );
+   saved = array_create( CommodityPrice );
+   for (int i=0; i<array_size(update); i++) {
+      const StarSystem *sys = &systems_stack[ update[i] ];
+      for (int j=0; j<array_size(sys->jumps); j++) {
+         int t = sys->jumps[j].targetid;
+         if (state[t] != 0)
+            continue;
+         state[t] = 2;
+         array_push_back( &outer, t );
+         for (int k=0; k<array_size(systems_stack[t].spobs); k++) {
+            const Spob *spob = systems_stack[t].spobs[k];
+            for (int l=0; l<array_size(spob->commodityPrice); l++)
+               array_push_back( &saved, spob->commodityPrice[l] );
+         }
+      }
+   }
+
+   /* Same steps as economy_initialiseCommodityPrices(). */
+   for (int i=0; i<n; i++) {
+      StarSystem *sys = &systems_stack[i];
+      if (state[i] == 0)
+         continue;
+      for (int j=0; j<array_size(sys->spobs); j++) {
+         Spob *spob = sys->spobs[j];
+         for (int k=0; k<array_size(spob->commodities); k++)
+            if (economy_calcPrice(spob, spob->commodities[k], &spob->commodityPrice[k]))
+               break;
+      }
+   }
+   for (int i=0; i<n; i++)
+      if (state[i] != 0)
+         economy_modifySystemCommodityPrice( &systems_stack[i] );
+   for (int i=0; i<array_size(update); i++)
+      economy_smoothCommodityPrice( &systems_stack[ update[i] ] );
+   for (int i=0; i<array_size(update); i++)
+      economy_calcUpdatedCommodityPrice( &systems_stack[ update[i] ] );
+
+   /* Restore the neighbours. */
+   for (int i=0, m=0; i<array_size(outer); i++) {
+      StarSystem *sys = &systems_stack[ outer[i] ];
+      array_free( sys->averagePrice );
+      sys->averagePrice = NULL;
+      for (int k=0; k<array_size(sys->spobs); k++) {
+         Spob *spob = sys->spobs[k];
+         for (int l=0; l<array_size(spob->commodityPrice); l++)
+            spob->commodityPrice[l] = saved[m++];
+      }
+   }
+
+   array_free( saved );
+   array_free( outer );
+   array_free( update );
+   free( state );
+}
+
 /*
  * Calculates commodity prices for a single spob (e.g. as added by the unidiff), and does some smoothing over the system, but not neighbours.
  */
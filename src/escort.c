@@ -136,6 +136,7 @@ unsigned int escort_create( Pilot *p, const char *ship,
    e = pilot_create( s, NULL, p->faction, "escort", dir, pos, vel, f, parent, dockslot );
    pe = pilot_get(e);
    pe->parent = parent;
+   pilot_nearbyInvalidate(); /* Followers are always visible to their leader. */
 
    /* Make invincible to player. */
    if (pe->parent == PLAYER_ID)
@@ -193,6 +194,7 @@ unsigned int escort_createRef( Pilot *p, Pilot *pe,
    else
       pilot_reset( pe ); /* Reset internals. */
    pe->parent = p->id;
+   pilot_nearbyInvalidate(); /* Followers are always visible to their leader. */
 
    /* Make invincible to player. */
    if (pe->parent == PLAYER_ID)
@@ -509,6 +509,10 @@ static int event_parseXML( EventData *temp, const xmlNodePtr parent )
       }
    }
 
+   /* Compile the conditional now so syntax errors show up when loading. */
+   if ((temp->cond != NULL) && cond_compile( temp->cond ))
+      WARN(_("Event '%s' has an invalid conditional"), temp->name );
+
 #define MELEMENT(o,s) \
    if (o) WARN(_("Event '%s' missing/invalid '%s' element"), temp->name, s)
    MELEMENT(temp->trigger==EVENT_TRIGGER_NULL,"location");
@@ -640,8 +644,8 @@ static int event_parseFile( const char* file, EventData *temp )
    temp->sourcefile = strdup(file);
 
 #ifdef DEBUGGING
-   /* Check to see if syntax is valid. */
-   ret = luaL_loadbuffer(naevL, temp->lua, strlen(temp->lua), temp->name );
+   /* Check to see if syntax is valid, this also fills the chunk cache. */
+   ret = nlua_loadbuffer(naevL, temp->lua, strlen(temp->lua), temp->sourcefile );
    if (ret == LUA_ERRSYNTAX) {
       WARN(_("Event Lua '%s' syntax error: %s"),
             file, lua_tostring(naevL,-1) );
@@ -1239,6 +1239,8 @@ static void gl_fontRenderStartH( const glFontStash* stsh, const mat4 *H, const g
    else
       col = c;
 
+   /* Textures being batched go below the text. */
+   gl_batchFlush();
    glUseProgram(shaders.font.program);
    gl_uniformAColor(shaders.font.color, col, a);
    if (outlineR == 0.)
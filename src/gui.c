@@ -396,8 +396,8 @@ static void gui_renderSpobTarget (void)
       Asteroid *ast = &field->asteroids[player.p->nav_asteroid];
       c = &cWhite;
 
-      x = ast->pos.x;
-      y = ast->pos.y;
+      x = field->motion.x[ ast->id ];
+      y = field->motion.y[ ast->id ];
       r = ast->gfx->sw * 0.5;
       gui_renderTargetReticles( &shaders.targetship, x, y, r, 0., c );
    }
@@ -1175,6 +1175,7 @@ void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int
    int i, j, targeted;
    double x, y, r, sx, sy;
    double px, py;
+   vec2 pos;
    const glColour *col;
 
    /* Skip invisible asteroids */
@@ -1190,13 +1191,14 @@ void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int
       return;
 
    /* Get position. */
+   pos = asteroid_pos( a );
    if (overlay) {
-      x = (a->pos.x / res);
-      y = (a->pos.y / res);
+      x = (pos.x / res);
+      y = (pos.y / res);
    }
    else {
-      x = ((a->pos.x - player.p->solid->pos.x) / res);
-      y = ((a->pos.y - player.p->solid->pos.y) / res);
+      x = ((pos.x - player.p->solid->pos.x) / res);
+      y = ((pos.y - player.p->solid->pos.y) / res);
    }
 
    /* Get size. */
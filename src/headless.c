@@ -0,0 +1,89 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file headless.c
+ *
+ * @brief Simulates a system without playing to benchmark the game logic.
+ *
+ * The data is loaded as usual (which needs an OpenGL context, although the
+ * window is never shown), but instead of opening the main menu a system is
+ * entered and updated a fixed number of times with a fixed time step and random
+ * seed. The time spent in each part of the update is then printed so that runs
+ * can be compared between builds.
+ */
+/** @cond */
+#include "SDL_timer.h"
+
+#include "naev.h"
+/** @endcond */
+
+#include "headless.h"
+
+#include "array.h"
+#include "log.h"
+#include "pilot.h"
+#include "profile.h"
+#include "rng.h"
+#include "safelanes.h"
+#include "space.h"
+
+#define HEADLESS_DT  (1./60.) /**< Time step of each update. */
+
+/**
+ * @brief Enters a system and simulates it, printing the timings.
+ *
+ *    @param sysname Name of the system to simulate.
+ *    @param ticks Number of updates to run.
+ *    @param seed Random seed to use.
+ *    @return 0 on success.
+ */
+int headless_run( const char *sysname, int ticks, unsigned int seed )
+{
+   Uint64 start;
+   double total, tsim;
+   int steps;
+
+   if (ticks <= 0) {
+      WARN(_("Headless run needs a positive amount of updates, not %d!"), ticks);
+      return -1;
+   }
+   if (system_get( sysname ) == NULL)
+      return -1;
+
+   /* Everything random from here on depends only on the seed. */
+   rng_seed( seed );
+
+   /* Enter the system like the main menu background does. */
+   pilots_cleanAll();
+   if (!safelanes_calculated())
+      safelanes_recalculate();
+   space_init( sysname, 1 );
+   space_simulationStats( &tsim, &steps );
+
+   /* Run the updates. */
+   naev_setrealdt( HEADLESS_DT );
+   profile_reset();
+   profile_enable( 1 );
+   start = SDL_GetPerformanceCounter();
+   for (int i=0; i<ticks; i++)
+      update_routine( HEADLESS_DT, 0 );
+   total = (double)(SDL_GetPerformanceCounter()-start) / (double)SDL_GetPerformanceFrequency();
+   profile_enable( 0 );
+
+   /* Print results. */
+   LOG(_("Headless run of '%s' with seed %u:"), sysname, seed);
+   LOG(_("   entering: %.3f ms (%d steps)"), tsim*1000., steps);
+   LOG(_("   %d updates of %.3f ms game time, %d pilots remaining"),
+         ticks, HEADLESS_DT*1000., array_size(pilot_getAll()));
+   LOG(_("   %-14s %12s %12s %12s %8s"), _("zone"), _("total (ms)"), _("self (ms)"), _("update (ms)"), "%");
+   for (int i=0; i<PROFILE_ZONES; i++) {
+      double t = profile_time( i );
+      if (profile_calls( i ) <= 0)
+         continue;
+      LOG("   %-14s %12.3f %12.3f %12.5f %7.1f%%", profile_name( i ),
+            t*1000., profile_timeSelf( i )*1000., t*1000./ticks, (total>0.) ? 100.*t/total : 0.);
+   }
+   LOG("   %-14s %12.3f %12s %12.5f %7.1f%%", _("total"), total*1000., "", total*1000./ticks, 100.);
+   return 0;
+}
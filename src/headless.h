@@ -0,0 +1,6 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+int headless_run( const char *sysname, int ticks, unsigned int seed );
@@ -41,6 +41,7 @@
 #include "nstring.h"
 #include "nxml.h"
 #include "player.h"
+#include "profile.h"
 #include "space.h"
 
 /**
@@ -139,6 +140,7 @@ int hook_save( xmlTextWriterPtr writer );
 int hook_load( xmlNodePtr parent );
 /* Misc. */
 static Mission *hook_getMission( Hook *hook );
+static const char *hook_profileName( Hook *hook, char *buf, size_t n );
 
 /**
  * Adds a hook to the queue.
@@ -400,6 +402,7 @@ static int hook_runEvent( Hook *hook, const HookParam *param, int claims )
 static int hook_run( Hook *hook, const HookParam *param, int claims )
 {
    int ret;
+   char buf[STRMAX_SHORT];
 
    /* Do not run if pending deletion. */
    if (hook->delete)
@@ -409,6 +412,7 @@ static int hook_run( Hook *hook, const HookParam *param, int claims )
    if (menu_isOpen(MENU_MAIN))
       return 0;
 
+   PROFILE_BEGIN_NAME( PROFILE_LUA_HOOK, hook_profileName( hook, buf, sizeof(buf) ) );
    switch (hook->type) {
       case HOOK_TYPE_MISN:
          ret = hook_runMisn(hook, param, claims);
@@ -429,8 +433,10 @@ static int hook_run( Hook *hook, const HookParam *param, int claims )
       default:
          WARN(_("Invalid hook type '%d', deleting."), hook->type);
          hook->delete = 1;
-         return -1;
+         ret = -1;
+         break;
    }
+   PROFILE_END( PROFILE_LUA_HOOK );
 
    return ret;
 }
@@ -766,6 +772,34 @@ void hooks_update( double dt )
    hooks_purgeList();
 }
 
+/**
+ * @brief Gets the name of the script run by a hook for the profiler.
+ *
+ *    @param hook Hook to get the name of.
+ *    @param[out] buf Buffer to write the name to.
+ *    @param n Size of the buffer.
+ *    @return The name, or NULL if the hook does not run a script.
+ */
+static const char *hook_profileName( Hook *hook, char *buf, size_t n )
+{
+   const Mission *misn;
+   switch (hook->type) {
+      case HOOK_TYPE_MISN:
+         misn = hook_getMission( hook );
+         if (misn == NULL)
+            return NULL;
+         snprintf( buf, n, "%s:%s", misn->data->name, hook->u.misn.func );
+         return buf;
+
+      case HOOK_TYPE_EVENT:
+         snprintf( buf, n, "%s:%s", event_getData( hook->u.event.parent ), hook->u.event.func );
+         return buf;
+
+      default:
+         return NULL;
+   }
+}
+
 /**
  * @brief Gets the mission of a hook.
  */
@@ -8,6 +8,7 @@
  */
 
 /** @cond */
+#include "libxml/xmlreader.h"
 #include "physfs.h"
 
 #include "naev.h"
@@ -61,10 +62,49 @@ typedef struct player_saves_s {
    nsave_t *saves;
 } player_saves_t;
 
+/**
+ * @brief Stages of loading a game, in the order they have to be run.
+ */
+typedef enum LoadStage_ {
+   LOAD_STAGE_DIFFS,    /**< Universe diffs, must be first. */
+   LOAD_STAGE_CARGO,    /**< Mission cargo, must be before the player. */
+   LOAD_STAGE_FACTIONS, /**< Faction standings, must be before the player. */
+   LOAD_STAGE_PLAYER,   /**< Player, ships and such. */
+   LOAD_STAGE_SPACE,    /**< Known systems. */
+   LOAD_STAGE_VARS,     /**< Mission variables. */
+   LOAD_STAGE_MISSIONS, /**< Active missions. */
+   LOAD_STAGE_EVENTS,   /**< Active events. */
+   LOAD_STAGE_NEWS,     /**< News articles. */
+   LOAD_STAGE_HOOKS,    /**< Hooks. */
+   LOAD_STAGE_ECONOMY,  /**< Commodity prices. */
+   LOAD_STAGE_SHIPLOG,  /**< Ship log. */
+   LOAD_STAGES          /**< Number of stages, not a real stage. */
+} LoadStage;
+
+/**
+ * @brief Top-level sections of a save each stage reads. The ones after the
+ * first NULL only show up in older saves.
+ */
+static const char *load_stage_sections[LOAD_STAGES][7] = {
+   [LOAD_STAGE_DIFFS]     = { "diffs", NULL },
+   [LOAD_STAGE_CARGO]     = { "temporary_cargo", NULL, "mission_cargo", NULL },
+   [LOAD_STAGE_FACTIONS]  = { "factions", NULL },
+   [LOAD_STAGE_PLAYER]    = { "player", "missions_done", "events_done", "escorts", "metadata", NULL },
+   [LOAD_STAGE_SPACE]     = { "space", NULL },
+   [LOAD_STAGE_VARS]      = { "vars", NULL },
+   [LOAD_STAGE_MISSIONS]  = { "missions", NULL },
+   [LOAD_STAGE_EVENTS]    = { "events", NULL },
+   [LOAD_STAGE_NEWS]      = { "news", NULL },
+   [LOAD_STAGE_HOOKS]     = { "hooks", NULL },
+   [LOAD_STAGE_ECONOMY]   = { "economy", NULL },
+   [LOAD_STAGE_SHIPLOG]   = { "shiplog", NULL },
+};
+
 static player_saves_t *load_saves = NULL; /**< Array of saves */
 static player_saves_t *load_player = NULL; /**< Points to current element in load_saves. */
 static int old_saves_detected = 0, player_warned = 0;
 static char *selected_player = NULL;
+static int load_full = 0; /**< Whether to fully parse saves when listing them, like older versions did. */
 extern int save_loaded; /**< From save.c */
 
 /*
@@ -103,9 +143,18 @@ static void load_snapshot_menu_save( unsigned int wdw, const char *str );
 static void display_save_info( unsigned int wid, const nsave_t *ns );
 static void move_old_save( const char *path, const char *fname, const char *ext, const char *new_name );
 static int load_load( nsave_t *save, const char *path );
+static int load_loadInfo( nsave_t *save, const char *path );
+static void load_parseInfo( nsave_t *save, xmlNodePtr parent, const char *path );
+static void load_parsePlayerInfo( nsave_t *save, xmlNodePtr node );
+static void load_freeSave( nsave_t *ns );
 static int load_game( nsave_t *ns );
 static int load_gameInternal( const char* file, const char* version );
 static int load_gameInternalHook( void *data );
+static void load_gameStart (void);
+static void load_gameStage( LoadStage stage, xmlNodePtr parent, const char *version, Spob **pnt );
+static int load_gameStream( const char *file, const char *version, Spob **pnt );
+static size_t load_xmlSize( const xmlNode *node );
+static int load_sectionStage( const char *name );
 static int load_enumerateCallback( void* data, const char* origdir, const char* fname );
 static int load_enumerateCallbackPlayer( void* data, const char* origdir, const char* fname );
 static int load_compatibilityTest( const nsave_t *ns );
@@ -115,6 +164,179 @@ static int load_sortComparePlayers( const void *p1, const void *p2 );
 static int load_sortCompare( const void *p1, const void *p2 );
 static xmlDocPtr load_xml_parsePhysFS( const char* filename );
 
+/**
+ * @brief Parses a top-level node of a save that is shown in the load menu.
+ *
+ *    @param save Save to fill in.
+ *    @param parent Node to parse ("version" or "plugins"), others are ignored.
+ *    @param path Path of the save, for warnings.
+ */
+static void load_parseInfo( nsave_t *save, xmlNodePtr parent, const char *path )
+{
+   xmlNodePtr node;
+
+   if (xml_isNode(parent, "version")) {
+      node = parent->xmlChildrenNode;
+      do {
+         xmlr_strd(node, "naev", save->version);
+         xmlr_strd(node, "data", save->data);
+      } while (xml_nextNode(node));
+   }
+   else if (xml_isNode(parent, "plugins")) {
+      save->plugins = array_create( char* );
+      /* Parse rest. */
+      node = parent->xmlChildrenNode;
+      do {
+         xml_onlyNodes(node);
+
+         if (xml_isNode(node, "plugin")) {
+            const char *name = xml_get(node);
+            if (name != NULL)
+               array_push_back( &save->plugins, strdup(name) );
+            else
+               WARN(_("Save '%s' has unnamed plugin node!"), path);
+         }
+      } while (xml_nextNode(node));
+   }
+}
+
+/**
+ * @brief Parses a child of the "player" node of a save that is shown in the load menu.
+ *
+ *    @param save Save to fill in.
+ *    @param node Child of the "player" node, those not shown are ignored.
+ */
+static void load_parsePlayerInfo( nsave_t *save, xmlNodePtr node )
+{
+   xmlNodePtr cur;
+   int cycles, periods, seconds;
+
+   /* Player info. */
+   if (xml_isNode(node, "location")) {
+      free( save->spob );
+      save->spob = xml_getStrd(node);
+   }
+   else if (xml_isNode(node, "credits"))
+      save->credits = xml_getULong(node);
+   else if (xml_isNode(node, "chapter")) {
+      free( save->chapter );
+      save->chapter = xml_getStrd(node);
+   }
+   else if (xml_isNode(node, "difficulty")) {
+      free( save->difficulty );
+      save->difficulty = xml_getStrd(node);
+   }
+
+   /* Time. */
+   else if (xml_isNode(node, "time")) {
+      cur = node->xmlChildrenNode;
+      cycles = periods = seconds = 0;
+      do {
+         xmlr_int(cur, "SCU", cycles);
+         xmlr_int(cur, "STP", periods);
+         xmlr_int(cur, "STU", seconds);
+      } while (xml_nextNode(cur));
+      save->date = ntime_create( cycles, periods, seconds );
+   }
+
+   /* Ship info. */
+   else if (xml_isNode(node, "ship")) {
+      xmlr_attr_strd(node, "name", save->shipname);
+      xmlr_attr_strd(node, "model", save->shipmodel);
+   }
+}
+
+/**
+ * @brief Loads the information shown in the load menu from the start of a save.
+ *
+ * Everything the menu needs is written before the player's ships, so the file
+ * is streamed and reading stops at the current ship, without ever building the
+ * full document. This works with older saves too.
+ *
+ *    @param[out] save Structure to populate.
+ *    @param path PhysicsFS path (i.e., relative path starting with "saves/").
+ *    @return 0 on success.
+ */
+static int load_loadInfo( nsave_t *save, const char *path )
+{
+   char buf[PATH_MAX];
+   xmlTextReaderPtr reader;
+   int ret, done;
+
+   memset( save, 0, sizeof(nsave_t) );
+   snprintf( buf, sizeof(buf), "%s/%s", PHYSFS_getWriteDir(), path );
+   reader = xmlReaderForFile( buf, NULL, 0 );
+   if (reader == NULL)
+      return -1;
+
+   done = 0;
+   ret = xmlTextReaderRead( reader );
+   while ((ret == 1) && !done) {
+      xmlNodePtr node;
+      int depth = xmlTextReaderDepth( reader );
+      const char *name = (const char*) xmlTextReaderConstName( reader );
+
+      if ((depth == 0) || (xmlTextReaderNodeType( reader ) != XML_READER_TYPE_ELEMENT)) {
+         ret = xmlTextReaderRead( reader );
+         continue;
+      }
+
+      /* Top-level sections, only the player's is descended into. */
+      if (depth == 1) {
+         if (strcmp( name, "player" ) == 0) {
+            xmlChar *pname = xmlTextReaderGetAttribute( reader, (const xmlChar*) "name" );
+            if (pname != NULL) {
+               save->player_name = strdup( (const char*) pname );
+               xmlFree( pname );
+            }
+            ret = xmlTextReaderRead( reader );
+            continue;
+         }
+         if ((strcmp( name, "version" ) == 0) || (strcmp( name, "plugins" ) == 0)) {
+            node = xmlTextReaderExpand( reader );
+            if (node != NULL)
+               load_parseInfo( save, node, path );
+         }
+      }
+      /* Children of the player, the current ship is the last thing we need. */
+      else if (depth == 2) {
+         if (strcmp( name, "ship" ) == 0) {
+            xmlChar *sname = xmlTextReaderGetAttribute( reader, (const xmlChar*) "name" );
+            xmlChar *smodel = xmlTextReaderGetAttribute( reader, (const xmlChar*) "model" );
+            if (sname != NULL)
+               save->shipname = strdup( (const char*) sname );
+            if (smodel != NULL)
+               save->shipmodel = strdup( (const char*) smodel );
+            xmlFree( sname );
+            xmlFree( smodel );
+            done = 1;
+            break;
+         }
+         node = xmlTextReaderExpand( reader );
+         if (node != NULL)
+            load_parsePlayerInfo( save, node );
+      }
+      ret = xmlTextReaderNext( reader );
+   }
+   xmlFreeTextReader( reader );
+
+   if (!done || (save->player_name == NULL)) {
+      load_freeSave( save );
+      return -1;
+   }
+
+   /* Save path. */
+   save->path = strdup(path);
+
+   /* Defaults. */
+   if (save->chapter==NULL)
+      save->chapter = strdup( start_chapter() );
+
+   save->compatible = load_compatibility( save );
+
+   return 0;
+}
+
 /**
  * @brief Loads an individual save.
  * @param[out] save Structure to populate.
@@ -124,8 +346,7 @@ static xmlDocPtr load_xml_parsePhysFS( const char* filename );
 static int load_load( nsave_t *save, const char *path )
 {
    xmlDocPtr doc;
-   xmlNodePtr root, parent, node, cur;
-   int cycles, periods, seconds;
+   xmlNodePtr root, parent, node;
 
    memset( save, 0, sizeof(nsave_t) );
 
@@ -151,68 +372,18 @@ static int load_load( nsave_t *save, const char *path )
       xml_onlyNodes(parent);
 
       /* Info. */
-      if (xml_isNode(parent, "version")) {
-         node = parent->xmlChildrenNode;
-         do {
-            xmlr_strd(node, "naev", save->version);
-            xmlr_strd(node, "data", save->data);
-         } while (xml_nextNode(node));
-         continue;
-      }
-
-      else if (xml_isNode(parent, "player")) {
+      if (xml_isNode(parent, "player")) {
          /* Get name. */
          xmlr_attr_strd(parent, "name", save->player_name);
          /* Parse rest. */
          node = parent->xmlChildrenNode;
          do {
             xml_onlyNodes(node);
-
-            /* Player info. */
-            xmlr_strd(node, "location", save->spob);
-            xmlr_ulong(node, "credits", save->credits);
-            xmlr_strd(node, "chapter", save->chapter);
-            xmlr_strd(node, "difficulty", save->difficulty);
-
-            /* Time. */
-            if (xml_isNode(node, "time")) {
-               cur = node->xmlChildrenNode;
-               cycles = periods = seconds = 0;
-               do {
-                  xmlr_int(cur, "SCU", cycles);
-                  xmlr_int(cur, "STP", periods);
-                  xmlr_int(cur, "STU", seconds);
-               } while (xml_nextNode(cur));
-               save->date = ntime_create( cycles, periods, seconds );
-               continue;
-            }
-
-            /* Ship info. */
-            if (xml_isNode(node, "ship")) {
-               xmlr_attr_strd(node, "name", save->shipname);
-               xmlr_attr_strd(node, "model", save->shipmodel);
-               continue;
-            }
-         } while (xml_nextNode(node));
-         continue;
-      }
-      else if (xml_isNode(parent, "plugins")) {
-         save->plugins = array_create( char* );
-         /* Parse rest. */
-         node = parent->xmlChildrenNode;
-         do {
-            xml_onlyNodes(node);
-
-            if (xml_isNode(node, "plugin")) {
-               const char *name = xml_get(node);
-               if (name != NULL)
-                  array_push_back( &save->plugins, strdup(name) );
-               else
-                  WARN(_("Save '%s' has unnamed plugin node!"), path);
-            }
+            load_parsePlayerInfo( save, node );
          } while (xml_nextNode(node));
          continue;
       }
+      load_parseInfo( save, parent, path );
    } while (xml_nextNode(parent));
 
    /* Defaults. */
@@ -227,30 +398,124 @@ static int load_load( nsave_t *save, const char *path )
    return 0;
 }
 
+/**
+ * @brief Frees the information of a save.
+ */
+static void load_freeSave( nsave_t *ns )
+{
+   for (int k=0; k<array_size(ns->plugins); k++)
+      free( ns->plugins[k] );
+   array_free( ns->plugins );
+   free(ns->save_name);
+   free(ns->player_name);
+   free(ns->path);
+   free(ns->version);
+   free(ns->data);
+   free(ns->spob);
+   free(ns->chapter);
+   free(ns->difficulty);
+   free(ns->shipname);
+   free(ns->shipmodel);
+   memset( ns, 0, sizeof(nsave_t) );
+}
+
 /**
  * @brief Loads or refreshes saved games for the player.
  */
 int load_refresh (void)
 {
+   load_refreshFull( 0 );
+   return 0;
+}
+
+/**
+ * @brief Loads or refreshes saved games for the player.
+ *
+ *    @param full Whether to parse the whole saves instead of only what the menu needs.
+ *    @return Number of saves found.
+ */
+int load_refreshFull( int full )
+{
+   int n = 0;
+
+   /* Make sure saves still being written show up. */
+   save_flush();
+
    if (load_saves != NULL)
       load_free();
 
    /* load the saves */
+   load_full = full;
    load_saves = array_create( player_saves_t );
    PHYSFS_enumerate( "saves", load_enumerateCallback, NULL );
    qsort( load_saves, array_size(load_saves), sizeof(player_saves_t), load_sortComparePlayers );
+   load_full = 0;
 
-   return 0;
+   for (int i=0; i<array_size(load_saves); i++)
+      n += array_size(load_saves[i].saves);
+   return n;
 }
 
+#if DEBUGGING
+#define LOAD_BENCHMARK_DIR "saves/benchmark" /**< Directory of the synthetic benchmark saves. */
+/**
+ * @brief Creates or removes synthetic saves for benchmarking the load menu.
+ *
+ * The copies are made from the current player's autosave and kept in their
+ * own directory, so removing them never touches real saves.
+ *
+ *    @param n Number of copies to create, or 0 to remove them.
+ *    @return Number of saves created or removed, -1 on error.
+ */
+int load_benchmarkSaves( int n )
+{
+   char src[PATH_MAX], path[PATH_MAX];
+   int ret = 0;
+
+   if (n > 0) {
+      if (player.name == NULL)
+         return -1;
+      save_flush();
+      snprintf( src, sizeof(src), "saves/%s/autosave.ns", player.name );
+      if (!PHYSFS_exists( src ) || !PHYSFS_mkdir( LOAD_BENCHMARK_DIR ))
+         return -1;
+      for (int i=0; i<n; i++) {
+         snprintf( path, sizeof(path), LOAD_BENCHMARK_DIR"/benchmark_%03d.ns", i+1 );
+         if (ndata_copyIfExists( src, path ))
+            break;
+         ret++;
+      }
+      return ret;
+   }
+
+   /* Only remove what load_benchmarkSaves created. */
+   char **files = PHYSFS_enumerateFiles( LOAD_BENCHMARK_DIR );
+   for (char **f=files; (f!=NULL) && (*f!=NULL); f++) {
+      if (strncmp( *f, "benchmark_", 10 ) != 0)
+         continue;
+      snprintf( path, sizeof(path), LOAD_BENCHMARK_DIR"/%s", *f );
+      if (PHYSFS_delete( path ))
+         ret++;
+   }
+   PHYSFS_freeList( files );
+   PHYSFS_delete( LOAD_BENCHMARK_DIR );
+   return ret;
+}
+#endif /* DEBUGGING */
+
 static int load_enumerateCallbackPlayer( void* data, const char* origdir, const char* fname )
 {
    char *path;
    const char *fmt;
-   size_t dir_len;
+   size_t dir_len, name_len;
    PHYSFS_Stat stat;
 
    dir_len = strlen( origdir );
+   name_len = strlen( fname );
+
+   /* Ignore anything that isn't a saved game, such as partially written ones. */
+   if (name_len < 4 || strcmp( &fname[name_len-3], ".ns" ))
+      return PHYSFS_ENUM_OK;
 
    fmt = dir_len && origdir[dir_len-1]=='/' ? "%s%s" : "%s/%s";
    SDL_asprintf( &path, fmt, origdir, fname );
@@ -261,7 +526,9 @@ static int load_enumerateCallbackPlayer( void* data, const char* origdir, const
    else if (stat.filetype == PHYSFS_FILETYPE_REGULAR) {
       player_saves_t *ps = (player_saves_t*) data;
       nsave_t ns;
-      int ret = load_load( &ns, path );
+      int ret = load_full ? -1 : load_loadInfo( &ns, path );
+      if (ret != 0)
+         ret = load_load( &ns, path ); /* Fall back to parsing the whole thing. */
       if (ret == 0) {
          ns.save_name = strdup( fname );
          ns.save_name[ strlen(ns.save_name)-3 ] = '\0';
@@ -455,22 +722,8 @@ void load_free (void)
    for (int i=0; i<array_size(load_saves); i++) {
       player_saves_t *ps = &load_saves[i];
       free( ps->name );
-      for (int j=0; j<array_size(ps->saves); j++) {
-         nsave_t *ns = &ps->saves[j];
-         for (int k=0; k<array_size(ns->plugins); k++)
-            free( ns->plugins[k] );
-         array_free( ns->plugins );
-         free(ns->save_name);
-         free(ns->player_name);
-         free(ns->path);
-         free(ns->version);
-         free(ns->data);
-         free(ns->spob);
-         free(ns->chapter);
-         free(ns->difficulty);
-         free(ns->shipname);
-         free(ns->shipmodel);
-      }
+      for (int j=0; j<array_size(ps->saves); j++)
+         load_freeSave( &ps->saves[j] );
       array_free( ps->saves );
    }
    array_free( load_saves );
@@ -667,6 +920,7 @@ static void load_snapshot_menu_save( unsigned int wdw, const char *str )
    if (save_name == NULL)
       return;
    char path[PATH_MAX];
+   int ret;
    snprintf(path, sizeof(path), "saves/%s/%s.ns", player.name, save_name);
    if (PHYSFS_exists( path )) {
       int r = dialogue_YesNo(_("Overwrite"),
@@ -677,7 +931,14 @@ static void load_snapshot_menu_save( unsigned int wdw, const char *str )
          return;
       }
    }
-   if (save_all_with_name(save_name) < 0)
+   /* The snapshot is listed right away, so wait for it to be written and
+    * report failures here instead of from the main loop. */
+   ret = save_all_with_name( save_name );
+   if (ret == 0) {
+      save_flush();
+      ret = save_status();
+   }
+   if (ret < 0)
       dialogue_alert( _("Failed to save the game! You should exit and check the log to see what happened and then file a bug report!") );
    else {
       load_refresh();
@@ -1118,6 +1379,9 @@ static int load_gameInternal( const char* file, const char* version )
 {
    const char** data;
 
+   /* The save may still be being written. */
+   save_flush();
+
    /* Make sure it exists. */
    if (!PHYSFS_exists( file )) {
       dialogue_alert( _("Saved game file seems to have been deleted.") );
@@ -1154,58 +1418,39 @@ static int load_gameInternalHook( void *data )
 {
    xmlNodePtr node;
    xmlDocPtr doc;
-   Spob *pnt;
+   int ret;
+   Spob *pnt = NULL;
    const char **sdata = data;
    const char *file = sdata[0];
    const char *version = sdata[1];
-   int version_diff = (version!=NULL) ? naev_versionCompare(version) : 0;
    free(data);
 
-   /* Load the XML. */
-   doc = load_xml_parsePhysFS( file );
-   if (doc == NULL)
+   /* Stream the save, only falling back to loading it whole if it can't be opened. */
+   doc = NULL;
+   ret = load_gameStream( file, version, &pnt );
+   if (ret < -1)
       goto err;
-   node  = doc->xmlChildrenNode; /* base node */
-   if (node == NULL)
-      goto err_doc;
-
-   /* Clean up possible stuff that should be cleaned. */
-   unidiff_universeDefer( 1 );
-   player_cleanup();
-
-   /* Welcome message - must be before space_init. */
-   player_message( _("#gWelcome to %s!"), APPNAME );
-   player_message( "#g v%s", naev_version(0) );
-
-   /* Now begin to load. */
-   diff_load(node); /* Must load first to work properly. */
-   unidiff_universeDefer( 0 );
-   missions_loadCommodity(node); /* Must be loaded before player. */
-   pfaction_load(node); /* Must be loaded before player so the messages show up properly. */
-   pnt = player_load(node);
-   player.loaded_version = strdup( (version!=NULL) ? version : naev_version(0) );
-
-   /* Sanitize for new version. */
-   if (version_diff <= -2) {
-      WARN( _("Old version detected. Sanitizing ships for slots") );
-      load_compatSlots();
+   else if (ret != 0) {
+      /* Load the XML. */
+      doc = load_xml_parsePhysFS( file );
+      if (doc == NULL)
+         goto err;
+      node  = doc->xmlChildrenNode; /* base node */
+      if (node == NULL)
+         goto err_doc;
+
+      DEBUG( _("Loaded '%s' whole (%zu bytes)"), file, load_xmlSize( node ) );
+
+      load_gameStart();
+      for (int i=0; i<LOAD_STAGES; i++)
+         load_gameStage( i, node, version, &pnt );
    }
 
-   /* Load more stuff. */
-   space_sysLoad(node);
-   var_load(node);
-   missions_loadActive(node);
-   events_loadActive(node);
-   news_loadArticles( node );
-   hook_load(node);
-
-   /* Initialize the economy. */
-   economy_init();
-   economy_sysLoad(node);
-
-   /* Initialise the ship log */
-   shiplog_new();
-   shiplog_load(node);
+   /* Don't try to run a game without a player. */
+   if (player.p == NULL) {
+      player_cleanup();
+      goto err_doc;
+   }
 
    /* Check validity. */
    event_checkValidity();
@@ -1244,6 +1489,220 @@ err:
    return -1;
 }
 
+/**
+ * @brief Cleans up the current game before the saved one starts being loaded.
+ */
+static void load_gameStart (void)
+{
+   /* Clean up possible stuff that should be cleaned. */
+   unidiff_universeDefer( 1 );
+   player_cleanup();
+
+   /* Welcome message - must be before space_init. */
+   player_message( _("#gWelcome to %s!"), APPNAME );
+   player_message( "#g v%s", naev_version(0) );
+}
+
+/**
+ * @brief Runs a stage of loading a game.
+ *
+ *    @param stage Stage to run, all the previous ones must have been run.
+ *    @param parent Node containing (at least) the sections the stage reads.
+ *    @param version Version string of game being loaded.
+ *    @param[out] pnt Spob the player is landed at, set by the player stage.
+ */
+static void load_gameStage( LoadStage stage, xmlNodePtr parent, const char *version, Spob **pnt )
+{
+   switch (stage) {
+      case LOAD_STAGE_DIFFS:
+         diff_load(parent); /* Must load first to work properly. */
+         unidiff_universeDefer( 0 );
+         break;
+      case LOAD_STAGE_CARGO:
+         missions_loadCommodity(parent); /* Must be loaded before player. */
+         break;
+      case LOAD_STAGE_FACTIONS:
+         pfaction_load(parent); /* Must be loaded before player so the messages show up properly. */
+         break;
+      case LOAD_STAGE_PLAYER:
+         *pnt = player_load(parent);
+         player.loaded_version = strdup( (version!=NULL) ? version : naev_version(0) );
+
+         /* Sanitize for new version. */
+         if ((version!=NULL) && (naev_versionCompare(version) <= -2)) {
+            WARN( _("Old version detected. Sanitizing ships for slots") );
+            load_compatSlots();
+         }
+         break;
+      case LOAD_STAGE_SPACE:
+         space_sysLoad(parent);
+         break;
+      case LOAD_STAGE_VARS:
+         var_load(parent);
+         break;
+      case LOAD_STAGE_MISSIONS:
+         missions_loadActive(parent);
+         break;
+      case LOAD_STAGE_EVENTS:
+         events_loadActive(parent);
+         break;
+      case LOAD_STAGE_NEWS:
+         news_loadArticles( parent );
+         break;
+      case LOAD_STAGE_HOOKS:
+         hook_load(parent);
+         break;
+      case LOAD_STAGE_ECONOMY:
+         /* Initialize the economy. */
+         economy_init();
+         economy_sysLoad(parent);
+         break;
+      case LOAD_STAGE_SHIPLOG:
+         /* Initialise the ship log */
+         shiplog_new();
+         shiplog_load(parent);
+         break;
+      default:
+         break;
+   }
+}
+
+/**
+ * @brief Gets the load stage that reads a top-level section of a save.
+ *
+ *    @param name Name of the section.
+ *    @return The stage or -1 if no stage reads the section.
+ */
+static int load_sectionStage( const char *name )
+{
+   for (int i=0; i<LOAD_STAGES; i++) {
+      int nulls = 0;
+      for (int j=0; (j<7) && (nulls<2); j++) {
+         const char *sec = load_stage_sections[i][j];
+         if (sec == NULL)
+            nulls++;
+         else if (strcmp( sec, name ) == 0)
+            return i;
+      }
+   }
+   return -1;
+}
+
+/**
+ * @brief Gets the memory used by an XML tree.
+ *
+ *    @param node Node to get the memory used by, including its children.
+ *    @return Bytes used by the nodes, attributes and text of the tree.
+ */
+static size_t load_xmlSize( const xmlNode *node )
+{
+   size_t size = sizeof(xmlNode);
+   if (node->content != NULL)
+      size += xmlStrlen( node->content ) + 1;
+   if (node->type == XML_ELEMENT_NODE) {
+      for (const xmlAttr *a=node->properties; a!=NULL; a=a->next) {
+         size += sizeof(xmlAttr);
+         for (const xmlNode *c=a->children; c!=NULL; c=c->next)
+            size += load_xmlSize( c );
+      }
+   }
+   for (const xmlNode *c=node->children; c!=NULL; c=c->next)
+      size += load_xmlSize( c );
+   return size;
+}
+
+/**
+ * @brief Loads a game while reading it in a single pass.
+ *
+ * Instead of building the whole document, the top-level sections read by the
+ * load stages are moved to a document of their own as they are read, and
+ * everything else is skipped. The stages are only run once the save has been
+ * read to the end, so that the current game is never replaced by part of a
+ * corrupt or truncated save, and the sections of each stage are freed as soon
+ * as it has been run.
+ *
+ *    @param file PhysicsFS path (i.e., relative path starting with "saves/").
+ *    @param version Version string of game to load.
+ *    @param[out] pnt Spob the player is landed at.
+ *    @return 0 on success, -1 if the save couldn't be opened and nothing was
+ *            loaded, -2 if the save is invalid.
+ */
+static int load_gameStream( const char *file, const char *version, Spob **pnt )
+{
+   char buf[PATH_MAX];
+   xmlTextReaderPtr reader;
+   xmlDocPtr doc;
+   xmlNodePtr root;
+   int ret, hasplayer, total;
+   size_t size;
+
+   snprintf( buf, sizeof(buf), "%s/%s", PHYSFS_getWriteDir(), file );
+   reader = xmlReaderForFile( buf, NULL, 0 );
+   if (reader == NULL)
+      return -1;
+
+   /* Sections are moved to a document of their own until their stage is run. */
+   doc  = xmlNewDoc( (const xmlChar*) "1.0" );
+   root = xmlNewNode( NULL, (const xmlChar*) "naev_save" );
+   xmlDocSetRootElement( doc, root );
+
+   hasplayer = total = 0;
+   ret = xmlTextReaderRead( reader );
+   while (ret == 1) {
+      xmlNodePtr node;
+      const char *name;
+
+      if ((xmlTextReaderDepth( reader ) != 1) || (xmlTextReaderNodeType( reader ) != XML_READER_TYPE_ELEMENT)) {
+         ret = xmlTextReaderRead( reader );
+         continue;
+      }
+      name = (const char*) xmlTextReaderConstName( reader );
+      if (load_sectionStage( name ) < 0) {
+         ret = xmlTextReaderNext( reader );
+         continue;
+      }
+      if (strcmp( name, "player" ) == 0)
+         hasplayer = 1;
+
+      /* Read the section. */
+      node = xmlTextReaderExpand( reader );
+      if (node == NULL) {
+         ret = -1;
+         break;
+      }
+      xmlAddChild( root, xmlDocCopyNode( node, doc, 1 ) );
+      total++;
+      ret = xmlTextReaderNext( reader );
+   }
+   xmlFreeTextReader( reader );
+
+   /* Nothing has been loaded yet, so a bad save leaves the current game alone. */
+   if ((ret < 0) || !hasplayer) {
+      WARN( _("Saved game '%s' could not be read."), file );
+      xmlFreeDoc( doc );
+      return -2;
+   }
+   size = load_xmlSize( root );
+
+   /* Run the stages, freeing the sections as they stop being needed. */
+   load_gameStart();
+   for (int stage=0; stage<LOAD_STAGES; stage++) {
+      xmlNodePtr n, next;
+      load_gameStage( stage, root, version, pnt );
+      for (n=root->children; n!=NULL; n=next) {
+         next = n->next;
+         if (load_sectionStage( (const char*) n->name ) != stage)
+            continue;
+         xmlUnlinkNode( n );
+         xmlFreeNode( n );
+      }
+   }
+   xmlFreeDoc( doc );
+
+   DEBUG( _("Loaded '%s' keeping %d sections (%zu bytes)"), file, total, size );
+   return 0;
+}
+
 /**
  * @brief Temporary (hopefully) wrapper around xml_parsePhysFS in support of gzipped XML (like .ns files).
  */
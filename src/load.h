@@ -52,5 +52,9 @@ int load_gameDiff( const char* file );
 int load_gameFile( const char* file );
 
 int load_refresh (void);
+int load_refreshFull( int full );
+#if DEBUGGING
+int load_benchmarkSaves( int n );
+#endif /* DEBUGGING */
 void load_free (void);
 const nsave_t *load_getList( const char *name );
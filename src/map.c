@@ -29,6 +29,7 @@
 #include "nstring.h"
 #include "nxml.h"
 #include "opengl.h"
+#include "pathfind.h"
 #include "player.h"
 #include "space.h"
 #include "toolkit.h"
@@ -36,7 +37,6 @@
 
 #define BUTTON_WIDTH    100 /**< Map button width. */
 #define BUTTON_HEIGHT   30 /**< Map button height. */
-#define MAP_LOOP_PROT   1000 /**< Number of iterations max in pathfinding before aborting. */
 #define MAP_TEXT_INDENT   45 /**< Indentation of the text below the titles. */
 #define MAP_MARKER_CYCLE  750 /**< Time of a mission marker's animation cycle in milliseconds. */
 #define MAP_MOVE_THRESHOLD 20. /**< Mouse movement distance threshold */
@@ -2625,139 +2625,8 @@ void map_toggleNotes()
 {
    map_show_notes = !map_show_notes;
 }
-/*
- * A* algorithm for shortest path finding
- *
- * Note since that we can't actually get an admissible heurestic for A* this is
- * in reality just Djikstras. I've removed the heurestic bit to make sure I
- * don't try to implement an admissible heuristic when I'm pretty sure there is
- * none.
- */
-/**
- * @brief Node structure for A* pathfinding.
- */
-typedef struct SysNode_ {
-   struct SysNode_ *next; /**< Next node */
-   struct SysNode_ *gnext; /**< Next node in the garbage collector. */
-
-   struct SysNode_ *parent; /**< Parent node. */
-   StarSystem* sys; /**< System in node. */
-   int g; /**< step */
-} SysNode; /**< System Node for use in A* pathfinding. */
-static SysNode *A_gc;
 /* prototypes */
-static SysNode* A_newNode( StarSystem* sys );
-static int A_g( SysNode* n );
-static SysNode* A_add( SysNode *first, SysNode *cur );
-static SysNode* A_rm( SysNode *first, StarSystem *cur );
-static SysNode* A_in( SysNode *first, StarSystem *cur );
-static SysNode* A_lowest( SysNode *first );
-static void A_freeList( SysNode *first );
 static int map_decorator_parse( MapDecorator *temp, const char *file );
-/** @brief Creates a new node link to star system. */
-static SysNode* A_newNode( StarSystem* sys )
-{
-   SysNode *n = malloc(sizeof(SysNode));
-
-   n->next  = NULL;
-   n->sys   = sys;
-
-   n->gnext = A_gc;
-   A_gc     = n;
-
-   return n;
-}
-/** @brief Gets the g from a node. */
-static int A_g( SysNode* n )
-{
-   return n->g;
-}
-/** @brief Adds a node to the linked list. */
-static SysNode* A_add( SysNode *first, SysNode *cur )
-{
-   SysNode *n;
-
-   if (first == NULL)
-      return cur;
-
-   n = first;
-   while (n->next != NULL)
-      n = n->next;
-   n->next = cur;
-
-   return first;
-}
-/* @brief Removes a node from a linked list. */
-static SysNode* A_rm( SysNode *first, StarSystem *cur )
-{
-   SysNode *n, *p;
-
-   if (first->sys == cur) {
-      n = first->next;
-      first->next = NULL;
-      return n;
-   }
-
-   p = first;
-   n = p->next;
-   do {
-      if (n->sys == cur) {
-         n->next = NULL;
-         p->next = n->next;
-         break;
-      }
-      p = n;
-   } while ((n=n->next) != NULL);
-
-   return first;
-}
-/** @brief Checks to see if node is in linked list. */
-static SysNode* A_in( SysNode *first, StarSystem *cur )
-{
-   SysNode *n;
-
-   if (first == NULL)
-      return NULL;
-
-   n = first;
-   do {
-      if (n->sys == cur)
-         return n;
-   } while ((n=n->next) != NULL);
-   return NULL;
-}
-/** @brief Returns the lowest ranking node from a linked list of nodes. */
-static SysNode* A_lowest( SysNode *first )
-{
-   SysNode *lowest, *n;
-
-   if (first == NULL)
-      return NULL;
-
-   n = first;
-   lowest = n;
-   do {
-      if (n->g < lowest->g)
-         lowest = n;
-   } while ((n=n->next) != NULL);
-   return lowest;
-}
-/** @brief Frees a linked list. */
-static void A_freeList( SysNode *first )
-{
-   SysNode *p, *n;
-
-   if (first == NULL)
-      return;
-
-   p = NULL;
-   n = first;
-   do {
-      free(p);
-      p = n;
-   } while ((n=n->gnext) != NULL);
-   free(p);
-}
 
 /** @brief Sets map_zoom to zoom and recreates the faction disk texture. */
 void map_setZoom( unsigned int wid, double zoom )
@@ -2779,14 +2648,9 @@ void map_setZoom( unsigned int wid, double zoom )
 StarSystem** map_getJumpPath( const char* sysstart, const char* sysend,
     int ignore_known, int show_hidden, StarSystem** old_data )
 {
-   int j, cost, njumps, ojumps;
-   StarSystem *ssys, *esys, **res;
-
-   SysNode *cur,   *neighbour;
-   SysNode *open,  *closed;
-   SysNode *ocost, *ccost;
+   int njumps, ojumps;
+   StarSystem *ssys, *esys, **res, **path;
 
-   A_gc = NULL;
    res = old_data;
    ojumps = array_size( old_data );
 
@@ -2799,7 +2663,7 @@ StarSystem** map_getJumpPath( const char* sysstart, const char* sysend,
       ssys = system_get( array_back( old_data )->name );
 
    /* Check self. */
-   if (ssys==esys || array_size(ssys->jumps)==0) {
+   if (ssys==NULL || esys==NULL || ssys==esys || array_size(ssys->jumps)==0) {
       array_free( res );
       return NULL;
    }
@@ -2811,94 +2675,20 @@ StarSystem** map_getJumpPath( const char* sysstart, const char* sysend,
       return NULL;
    }
 
-   /* start the linked lists */
-   open     = closed = NULL;
-   cur      = A_newNode( ssys );
-   cur->parent = NULL;
-   cur->g   = 0;
-   open     = A_add( open, cur ); /* Initial open node is the start system */
-
-   j = 0;
-   while ((cur = A_lowest(open))) {
-      /* End condition. */
-      if (cur->sys == esys)
-         break;
-
-      /* Break if infinite loop. */
-      j++;
-      if (j > MAP_LOOP_PROT)
-         break;
-
-      /* Get best from open and toss to closed */
-      open   = A_rm( open, cur->sys );
-      closed = A_add( closed, cur );
-      cost   = A_g(cur) + 1; /* Base unit is jump and always increases by 1. */
-
-      for (int i=0; i<array_size(cur->sys->jumps); i++) {
-         JumpPoint *jp  = &cur->sys->jumps[i];
-         StarSystem *sys = jp->target;
-
-         /* Make sure it's reachable */
-         if (!ignore_known) {
-            if (!jp_isKnown(jp))
-               continue;
-            if (!sys_isKnown(sys) && !space_sysReachable(sys))
-               continue;
-         }
-         if (jp_isFlag( jp, JP_EXITONLY ))
-            continue;
-
-         /* Skip hidden jumps if they're not specifically requested */
-         if (!show_hidden && jp_isFlag( jp, JP_HIDDEN ))
-            continue;
-
-         /* Check to see if it's already in the closed set. */
-         ccost = A_in(closed, sys);
-         if ((ccost != NULL) && (cost >= A_g(ccost)))
-            continue;
-            //closed = A_rm( closed, sys );
-
-         /* Remove if it exists and current is better. */
-         ocost = A_in(open, sys);
-         if (ocost != NULL) {
-            if (cost < A_g(ocost))
-               open = A_rm( open, sys ); /* New path is better */
-            else
-               continue; /* This node is worse, so ignore it. */
-         }
-
-         /* Create the node. */
-         neighbour         = A_newNode( sys );
-         neighbour->parent = cur;
-         neighbour->g      = cost;
-         open              = A_add( open, neighbour );
-      }
-
-      /* Safety check in case not linked. */
-      if (open == NULL)
-         break;
-   }
-
-   /* Build path backwards if not broken from loop. */
-   if (cur != NULL && esys == cur->sys) {
-      njumps = A_g(cur) + ojumps;
-      assert( njumps > ojumps );
-      if (res == NULL)
-         res = array_create_size( StarSystem*, njumps );
-      array_resize( &res, njumps );
-      /* Build path. */
-      for (int i=0; i<njumps-ojumps; i++) {
-         res[njumps-i-1] = cur->sys;
-         cur = cur->parent;
-      }
-   }
-   else {
-      res = NULL;
+   path = pathfind_jumpPath( ssys, esys, ignore_known, show_hidden );
+   if (path == NULL) {
       array_free( old_data );
+      return NULL;
    }
 
-   /* free the linked lists */
-   A_freeList(A_gc);
+   /* Append to the old path. */
+   njumps = array_size(path) + ojumps;
+   if (res == NULL)
+      res = array_create_size( StarSystem*, njumps );
+   array_resize( &res, njumps );
+   for (int i=0; i<array_size(path); i++)
+      res[ojumps+i] = path[i];
+   array_free( path );
    return res;
 }
 
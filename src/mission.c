@@ -1032,6 +1032,10 @@ static int mission_parseXML( MissionData *temp, const xmlNodePtr parent )
       }
    }
 
+   /* Compile the conditional now so syntax errors show up when loading. */
+   if ((temp->avail.cond != NULL) && cond_compile( temp->avail.cond ))
+      WARN(_("Mission '%s' has an invalid conditional"), temp->name );
+
 #define MELEMENT(o,s) \
    if (o) WARN( _("Mission '%s' missing/invalid '%s' element"), temp->name, s)
    MELEMENT(temp->avail.loc==MIS_AVAIL_UNSET,"location");
@@ -1163,8 +1167,8 @@ static int mission_parseFile( const char* file, MissionData *temp )
    temp->sourcefile = strdup(file);
 
 #ifdef DEBUGGING
-   /* Check to see if syntax is valid. */
-   int ret = luaL_loadbuffer(naevL, temp->lua, strlen(temp->lua), temp->name );
+   /* Check to see if syntax is valid, this also fills the chunk cache. */
+   int ret = nlua_loadbuffer(naevL, temp->lua, strlen(temp->lua), temp->sourcefile );
    if (ret == LUA_ERRSYNTAX) {
       WARN(_("Mission Lua '%s' syntax error: %s"),
             file, lua_tostring(naevL,-1) );
@@ -1211,14 +1215,13 @@ void missions_cleanup (void)
 }
 
 /**
- * @brief Saves the player's active missions.
+ * @brief Saves the player's special mission commodities.
  *
- *    @param writer XML Write to use to save missions.
+ *    @param writer XML Write to use to save the commodities.
  *    @return 0 on success.
  */
-int missions_saveActive( xmlTextWriterPtr writer )
+int missions_saveCommodity( xmlTextWriterPtr writer )
 {
-   /* We also save specially created cargos here. */
    PilotCommodity *pcom = pfleet_cargoList();
    xmlw_startElem(writer,"temporary_cargo");
    for (int i=0; i<array_size(pcom); i++) {
@@ -1231,7 +1234,17 @@ int missions_saveActive( xmlTextWriterPtr writer )
    }
    xmlw_endElem(writer); /* "missions_cargo */
    array_free(pcom);
+   return 0;
+}
 
+/**
+ * @brief Saves the player's active missions.
+ *
+ *    @param writer XML Write to use to save missions.
+ *    @return 0 on success.
+ */
+int missions_saveActive( xmlTextWriterPtr writer )
+{
    xmlw_startElem(writer,"missions");
    for (int i=0; i<array_size(player_missions); i++) {
       Mission *misn = player_missions[i];
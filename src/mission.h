@@ -149,6 +149,7 @@ int missions_loadActive( xmlNodePtr parent );
 int missions_loadCommodity( xmlNodePtr parent );
 Commodity* missions_loadTempCommodity( xmlNodePtr parent );
 int missions_saveActive( xmlTextWriterPtr writer );
+int missions_saveCommodity( xmlTextWriterPtr writer );
 int missions_saveTempCommodity( xmlTextWriterPtr writer, const Commodity* c );
 void mission_cleanup( Mission* misn );
 void mission_shift( int pos );
@@ -27,6 +27,7 @@
 /** @endcond */
 
 #include "ai.h"
+#include "array.h"
 #include "background.h"
 #include "camera.h"
 #include "cond.h"
@@ -42,6 +43,7 @@
 #include "faction.h"
 #include "font.h"
 #include "gui.h"
+#include "headless.h"
 #include "hook.h"
 #include "input.h"
 #include "joystick.h"
@@ -63,6 +65,7 @@
 #include "nlua_tex.h"
 #include "nlua_colour.h"
 #include "nlua_gfx.h"
+#include "nlua_linopt.h"
 #include "nlua_naev.h"
 #include "nlua_rnd.h"
 #include "nlua_vec2.h"
@@ -79,9 +82,11 @@
 #include "pilot.h"
 #include "player.h"
 #include "plugin.h"
+#include "profile.h"
 #include "render.h"
 #include "rng.h"
 #include "safelanes.h"
+#include "save.h"
 #include "semver.h"
 #include "ship.h"
 #include "slots.h"
@@ -122,6 +127,16 @@ static nlua_env load_env = LUA_NOREF; /**< Environment for displaying load messa
 static int load_force_render = 0;
 static unsigned int load_last_render = 0;
 
+/**
+ * @brief Timing of a loading stage.
+ */
+typedef struct LoadStage_ {
+   const char *msg;  /**< Message displayed while loading the stage. */
+   double time;      /**< Time spent in the stage (seconds). */
+} LoadStage;
+static LoadStage *load_stages = NULL; /**< Array (array.h): Timings of the loading stages. */
+static Uint64 load_stage_start = 0; /**< When the current loading stage started. */
+
 /*
  * prototypes
  */
@@ -139,6 +154,8 @@ static void fps_control (void);
 static void update_all (void);
 /* Misc. */
 static void loadscreen_update( double done, const char *msg );
+static void load_stage( double done, const char *msg );
+static void load_stageReport (void);
 void main_loop( int update ); /* dialogue.c */
 
 /**
@@ -168,6 +185,7 @@ int main( int argc, char** argv )
 {
    char conf_file_path[PATH_MAX], **search_path;
    Uint32 starttime;
+   int exit_code = EXIT_SUCCESS;
 
 #ifdef DEBUGGING
    /* Set Debugging flags. */
@@ -369,13 +387,26 @@ int main( int argc, char** argv )
    /* Unload load screen. */
    loadscreen_unload();
 
-   /* Start menu. */
-   menu_main();
-
-   if (conf.devmode)
-      LOG( _( "Reached main menu in %.3f s" ), (SDL_GetTicks()-starttime)/1000. );
-   else
-      LOG( _( "Reached main menu" ) );
+   /* Headless runs just simulate a system and quit. */
+   if (conf.headless != NULL) {
+      if (headless_run( conf.headless, conf.headless_ticks, conf.headless_seed ))
+         exit_code = EXIT_FAILURE;
+      quit = 1;
+   }
+   else {
+      /* Start menu. */
+      menu_main();
+
+      if (conf.devmode) {
+         NLuaCacheStats stats;
+         double saved = nlua_cacheStats( &stats );
+         LOG( _( "Reached main menu in %.3f s" ), (SDL_GetTicks()-starttime)/1000. );
+         DEBUG( _("Lua chunks: %d compiled in %.3f s, %d loaded from cache in %.3f s (%.3f s saved)"),
+               stats.misses, stats.compile_time, stats.hits, stats.load_time, saved );
+      }
+      else
+         LOG( _( "Reached main menu" ) );
+   }
 
    fps_init(); /* initializes the time_ms */
 
@@ -388,10 +419,11 @@ int main( int argc, char** argv )
    while (SDL_PollEvent(&event));
 
    /* Show plugin compatibility. */
-   plugin_check();
+   if (conf.headless == NULL)
+      plugin_check();
 
    /* Incomplete translation note (shows once if we pick an incomplete translation based on user's locale). */
-   if ( !conf.translation_warning_seen && conf.language == NULL ) {
+   if ( conf.headless == NULL && !conf.translation_warning_seen && conf.language == NULL ) {
       const char* language = gettext_getLanguage();
       double coverage = gettext_languageCoverage(language);
 
@@ -407,7 +439,7 @@ int main( int argc, char** argv )
    }
 
    /* Incomplete game note (shows every time version number changes). */
-   if ( conf.lastversion == NULL || naev_versionCompare(conf.lastversion) != 0 ) {
+   if ( conf.headless == NULL && (conf.lastversion == NULL || naev_versionCompare(conf.lastversion) != 0) ) {
       free( conf.lastversion );
       conf.lastversion = strdup( naev_version(0) );
       dialogue_msg(
@@ -448,6 +480,10 @@ int main( int argc, char** argv )
       }
 
       main_loop( 1 );
+
+      /* Saves are written in the background, so failures show up later. */
+      if (save_status() < 0)
+         dialogue_alert( _("Failed to save game! You should exit and check the log to see what happened and then file a bug report!") );
    }
 
    /* Save configuration. */
@@ -464,6 +500,7 @@ int main( int argc, char** argv )
    start_cleanup(); /* Cleanup from start.c, not the first cleanup step. :) */
 
    /* exit subsystems */
+   save_exit(); /* Finishes writing saved games. */
    plugin_exit();
    cli_exit(); /* Clean up the console. */
    map_system_exit(); /* Destroys the solar system map. */
@@ -475,6 +512,7 @@ int main( int argc, char** argv )
    input_exit(); /* Cleans up keybindings */
    nebu_exit(); /* Destroys the nebula */
    render_exit(); /* Cleans up post-processing. */
+   profile_exit(); /* Cleans up the profiler graph. */
    news_exit(); /* Destroys the news. */
    difficulty_free(); /* Clean up difficulties. */
    music_exit(); /* Kills Lua state. */
@@ -509,7 +547,7 @@ int main( int argc, char** argv )
 
    /* all is well */
    debug_enableLeakSanitizer();
-   return 0;
+   return exit_code;
 }
 
 /**
@@ -609,6 +647,48 @@ static void loadscreen_unload (void)
    nlua_freeEnv( load_env );
 }
 
+/**
+ * @brief Starts a new loading stage, updating the loading screen.
+ *
+ *    @param done Amount of loading done [0:1].
+ *    @param msg Message of the stage.
+ */
+static void load_stage( double done, const char *msg )
+{
+   LoadStage *ls;
+
+   /* Finish the previous stage. */
+   if (load_stages == NULL)
+      load_stages = array_create( LoadStage );
+   else if (array_size(load_stages) > 0)
+      array_back(load_stages).time = (double)(SDL_GetPerformanceCounter() - load_stage_start) / (double)SDL_GetPerformanceFrequency();
+
+   loadscreen_update( done, msg );
+
+   ls = &array_grow( &load_stages );
+   ls->msg  = msg;
+   ls->time = 0.;
+   load_stage_start = SDL_GetPerformanceCounter();
+}
+
+/**
+ * @brief Logs the time taken by each loading stage and frees the timings.
+ */
+static void load_stageReport (void)
+{
+   if (conf.devmode) {
+      double total = 0.;
+      /* The last stage is just the "completed" message. */
+      for (int i=0; i<array_size(load_stages)-1; i++) {
+         DEBUG( _("%8.3f s   %s"), load_stages[i].time, load_stages[i].msg );
+         total += load_stages[i].time;
+      }
+      DEBUG( _("%8.3f s   Total"), total );
+   }
+   array_free( load_stages );
+   load_stages = NULL;
+}
+
 /**
  * @brief Loads all the data, makes main() simpler.
  */
@@ -620,55 +700,55 @@ void load_all (void)
    sp_load();
 
    /* order is very important as they're interdependent */
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Commodities…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Commodities…") );
    commodity_load(); /* dep for space */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Special Effects…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Special Effects…") );
    spfx_load(); /* no dep */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Effects…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Effects…") );
    effect_load(); /* no dep */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Damage Types…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Damage Types…") );
    dtype_load(); /* dep for outfits */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Outfits…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Outfits…") );
    outfit_load(); /* dep for ships, factions */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Ships…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Ships…") );
    ships_load(); /* dep for fleet */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Factions…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Factions…") );
    factions_load(); /* dep for fleet, space, missions, AI */
 
    /* Handle outfit loading part that may use ships and factions. */
    outfit_loadPost();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading AI…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading AI…") );
    ai_load(); /* dep for fleets */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Techs…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Techs…") );
    tech_load(); /* dep for space */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading the Universe…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading the Universe…") );
    space_load(); /* dep for events/missions */
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Events…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Events…") );
    events_load();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading Missions…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading Missions…") );
    missions_load();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Loading the UniDiffs…") );
+   load_stage( ++stage/LOADING_STAGES, _("Loading the UniDiffs…") );
    diff_loadAvailable();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Populating Maps…") );
+   load_stage( ++stage/LOADING_STAGES, _("Populating Maps…") );
    outfit_mapParse();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Calculating Patrols…") );
+   load_stage( ++stage/LOADING_STAGES, _("Calculating Patrols…") );
    safelanes_init();
 
-   loadscreen_update( ++stage/LOADING_STAGES, _("Initializing Details…") );
+   load_stage( ++stage/LOADING_STAGES, _("Initializing Details…") );
 #if DEBUGGING
    if (stage > LOADING_STAGES)
       WARN(_("Too many loading stages, please increase LOADING_STAGES"));
@@ -681,7 +761,8 @@ void load_all (void)
    pilots_init();
    weapon_init();
    player_init(); /* Initialize player stuff. */
-   loadscreen_update( 1., _("Loading Completed!") );
+   load_stage( 1., _("Loading Completed!") );
+   load_stageReport();
 }
 /**
  * @brief Unloads all data, simplifies main().
@@ -690,6 +771,7 @@ void unload_all (void)
 {
    /* cleanup some stuff */
    player_cleanup(); /* cleans up the player stuff */
+   linopt_exit(); /* waits for asynchronous solves */
    gui_free(); /* cleans up the player's GUI */
    weapon_exit(); /* destroys all active weapons */
    pilots_free(); /* frees the pilots, they were locked up :( */
@@ -725,6 +807,7 @@ void main_loop( int update )
     * Control FPS.
     */
    fps_control(); /* everyone loves fps control */
+   PROFILE_BEGIN( PROFILE_FRAME );
 
    /*
     * Handle update.
@@ -745,6 +828,9 @@ void main_loop( int update )
    /* Safe hook should be run every frame regardless of whether game is paused or not. */
    hooks_run( "safe" );
 
+   /* Hand back any linear programs solved in the background. */
+   linopt_update();
+
    /* Checks to see if we want to land. */
    space_checkLand();
 
@@ -755,10 +841,17 @@ void main_loop( int update )
                    state where things are corrupted when trying to exit the game.
                    Avoid rendering when quitting just in case. */
       /* Clear buffer. */
+      PROFILE_BEGIN( PROFILE_RENDER );
       render_all( game_dt, real_dt );
+      PROFILE_END( PROFILE_RENDER );
       /* Draw buffer. */
       SDL_GL_SwapWindow( gl_screen.window );
    }
+
+   PROFILE_END( PROFILE_FRAME );
+   if (profile_enabled)
+      profile_frame();
+   nlua_accountFrame();
 }
 
 /**
@@ -929,10 +1022,18 @@ void display_fps( const double dt )
    x = fps_x;
    y = fps_y;
    if (conf.fps_show) {
+      unsigned int draws, sprites;
       gl_print( &gl_defFontMono, x, y, &cFontWhite, "%3.2f", fps );
       y -= gl_defFontMono.h + 5.;
+      gl_drawStats( &draws, &sprites );
+      gl_print( &gl_defFontMono, x, y, &cFontWhite, _("%u draws, %u sprites"), draws, sprites );
+      y -= gl_defFontMono.h + 5.;
    }
 
+   /* Profiler graph. */
+   if (profile_enabled)
+      y = profile_render( x, y );
+
    if ((player.p != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
          !player_isFlag(PLAYER_CREATING)) {
       dt_mod_base = player_dt_default();
@@ -1007,10 +1108,18 @@ void update_routine( double dt, int enter_sys )
    }
 
    /* Update engine stuff. */
+   PROFILE_BEGIN( PROFILE_SPACE );
    space_update(dt, real_dt);
+   PROFILE_END( PROFILE_SPACE );
+   PROFILE_BEGIN( PROFILE_WEAPONS );
    weapons_update(dt);
+   PROFILE_END( PROFILE_WEAPONS );
+   PROFILE_BEGIN( PROFILE_SPFX );
    spfx_update(dt, real_dt);
+   PROFILE_END( PROFILE_SPFX );
+   PROFILE_BEGIN( PROFILE_PILOTS );
    pilots_update(dt);
+   PROFILE_END( PROFILE_PILOTS );
 
    /* Update camera. */
    cam_update( dt );
@@ -1020,6 +1129,7 @@ void update_routine( double dt, int enter_sys )
 
    if (!enter_sys) {
       HookParam h[3];
+      PROFILE_BEGIN( PROFILE_HOOKS );
       hook_exclusionEnd( dt );
       /* Hook set up. */
       h[0].type = HOOK_PARAM_NUMBER;
@@ -1029,6 +1139,7 @@ void update_routine( double dt, int enter_sys )
       h[2].type = HOOK_PARAM_SENTINEL;
       /* Run the update hook. */
       hooks_runParam( "update", h );
+      PROFILE_END( PROFILE_HOOKS );
    }
 }
 
@@ -1125,3 +1236,13 @@ double naev_getrealdt (void)
 {
    return real_dt;
 }
+
+/**
+ * @brief Sets the real delta-tick when updating outside of the main loop.
+ *
+ *    @param dt Real delta-tick to use.
+ */
+void naev_setrealdt( double dt )
+{
+   real_dt = dt;
+}
@@ -81,5 +81,6 @@ int naev_versionCompare( const char *version );
 void naev_quit (void);
 int naev_isQuit (void);
 double naev_getrealdt (void);
+void naev_setrealdt( double dt );
 
 void naev_renderLoadscreen (void);
@@ -0,0 +1,174 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file nameindex.c
+ *
+ * @brief Hash index for looking up objects by name.
+ *
+ * Used by the universe stacks (commodities, outfits, ships, systems and spobs)
+ * so that resolving a name is a single hash probe instead of a linear or
+ * binary search with strcmp. Once resolved, objects can be compared by pointer
+ * instead of by name.
+ */
+/** @cond */
+#include <stdlib.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "nameindex.h"
+
+#define NAMEINDEX_MIN   64 /**< Minimum amount of slots when not empty. */
+
+static void nameindex_grow( NameIndex *ni, int cap );
+
+/**
+ * @brief Hashes a name (FNV-1a).
+ *
+ *    @param name Name to hash.
+ *    @return Hash of the name.
+ */
+uint32_t nameindex_hash( const char *name )
+{
+   uint32_t h = 2166136261u;
+   for (const unsigned char *c=(const unsigned char*)name; *c!='\0'; c++) {
+      h ^= *c;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/**
+ * @brief Initializes an empty name index.
+ *
+ *    @param ni Name index to initialize.
+ */
+void nameindex_init( NameIndex *ni )
+{
+   memset( ni, 0, sizeof(NameIndex) );
+}
+
+/**
+ * @brief Frees the resources used by a name index.
+ *
+ *    @param ni Name index to free.
+ */
+void nameindex_free( NameIndex *ni )
+{
+   free( ni->slots );
+   memset( ni, 0, sizeof(NameIndex) );
+}
+
+/**
+ * @brief Removes all the names from a name index, keeping the memory.
+ *
+ *    @param ni Name index to clear.
+ */
+void nameindex_clear( NameIndex *ni )
+{
+   if (ni->slots != NULL)
+      memset( ni->slots, 0, sizeof(NameIndexEntry) * ni->ncap );
+   ni->n = 0;
+}
+
+/**
+ * @brief Rehashes the name index into a larger table.
+ *
+ *    @param ni Name index to grow.
+ *    @param cap New amount of slots (power of two).
+ */
+static void nameindex_grow( NameIndex *ni, int cap )
+{
+   NameIndexEntry *old = ni->slots;
+   int oldcap = ni->ncap;
+   int start = 0;
+   uint32_t mask = cap-1;
+
+   ni->slots = calloc( cap, sizeof(NameIndexEntry) );
+   ni->ncap  = cap;
+
+   /* Start after an empty slot so that probe sequences wrapping around the
+    * end are reinserted in order, keeping duplicate names in the order they
+    * were added. */
+   while ((start < oldcap) && (old[start].name != NULL))
+      start++;
+   for (int k=1; k<=oldcap; k++) {
+      const NameIndexEntry *e = &old[ (start+k) % oldcap ];
+      uint32_t j;
+      if (e->name == NULL)
+         continue;
+      for (j=e->hash&mask; ni->slots[j].name!=NULL; j=(j+1)&mask);
+      ni->slots[j] = *e;
+   }
+   free( old );
+}
+
+/**
+ * @brief Makes sure the name index can hold a number of names without growing.
+ *
+ *    @param ni Name index to reserve space in.
+ *    @param n Number of names it should be able to hold.
+ */
+void nameindex_reserve( NameIndex *ni, int n )
+{
+   int cap = MAX( NAMEINDEX_MIN, ni->ncap );
+   /* Keep the load factor under 0.5. */
+   while (2*n > cap)
+      cap *= 2;
+   if (cap > ni->ncap)
+      nameindex_grow( ni, cap );
+}
+
+/**
+ * @brief Adds a name to the name index.
+ *
+ * If the name is already in the index, lookups keep returning the object that
+ * was added first.
+ *
+ *    @param ni Name index to add to.
+ *    @param name Name of the object, must stay valid while in the index.
+ *    @param id Identifier of the object.
+ */
+void nameindex_add( NameIndex *ni, const char *name, int id )
+{
+   uint32_t h, mask, i;
+
+   if (name == NULL)
+      return;
+
+   nameindex_reserve( ni, ni->n+1 );
+
+   h     = nameindex_hash( name );
+   mask  = ni->ncap-1;
+   for (i=h&mask; ni->slots[i].name!=NULL; i=(i+1)&mask);
+   ni->slots[i].name = name;
+   ni->slots[i].hash = h;
+   ni->slots[i].id   = id;
+   ni->n++;
+}
+
+/**
+ * @brief Looks up a name in the name index.
+ *
+ *    @param ni Name index to look up in.
+ *    @param name Name to look up.
+ *    @return Identifier of the object with the name or -1 if not found.
+ */
+int nameindex_get( const NameIndex *ni, const char *name )
+{
+   uint32_t h, mask;
+
+   if ((name == NULL) || (ni->n == 0))
+      return -1;
+
+   h     = nameindex_hash( name );
+   mask  = ni->ncap-1;
+   for (uint32_t i=h&mask; ni->slots[i].name!=NULL; i=(i+1)&mask) {
+      const NameIndexEntry *e = &ni->slots[i];
+      /* Names are usually passed in from the object itself. */
+      if ((e->hash == h) && ((e->name == name) || (strcmp(e->name, name)==0)))
+         return e->id;
+   }
+   return -1;
+}
@@ -0,0 +1,39 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+/** @cond */
+#include <stdint.h>
+/** @endcond */
+
+/**
+ * @brief A slot in a name index.
+ */
+typedef struct NameIndexEntry_ {
+   const char *name; /**< Name of the object (not owned), NULL if the slot is empty. */
+   uint32_t hash;    /**< Hash of the name. */
+   int id;           /**< Identifier given by the user (usually an index into a stack). */
+} NameIndexEntry;
+
+/**
+ * @brief Hash index mapping names to objects.
+ *
+ * The names are not copied, the index points at the name owned by the object
+ * so each name is stored once and resolving a string gives the canonical
+ * object. Stacks index their objects by position so that the index survives
+ * the stack being reallocated, but it has to be rebuilt when names change.
+ */
+typedef struct NameIndex_ {
+   NameIndexEntry *slots; /**< Open addressing table (linear probing). */
+   int ncap;         /**< Number of slots (power of two). */
+   int n;            /**< Number of names in the index. */
+} NameIndex;
+
+void nameindex_init( NameIndex *ni );
+void nameindex_free( NameIndex *ni );
+void nameindex_clear( NameIndex *ni );
+void nameindex_reserve( NameIndex *ni, int n );
+void nameindex_add( NameIndex *ni, const char *name, int id );
+int nameindex_get( const NameIndex *ni, const char *name );
+uint32_t nameindex_hash( const char *name );
@@ -8,6 +8,7 @@
  */
 
 /** @cond */
+#include <inttypes.h>
 #include "physfs.h"
 
 #include "naev.h"
@@ -16,6 +17,7 @@
 #include "nlua.h"
 
 #include "log.h"
+#include "array.h"
 #include "conf.h"
 #include "lua_enet.h"
 #include "lutf8lib.h"
@@ -47,20 +49,60 @@
 #include "nluadef.h"
 #include "nstring.h"
 
+#define NLUA_BCACHE_MAX   (16*1024*1024) /**< Maximum bytes of bytecode kept in the chunk cache. */
+
 lua_State *naevL = NULL;
 nlua_env __NLUA_CURENV = LUA_NOREF;
 static char *common_script; /**< Common script to run when creating environments. */
 static size_t common_sz; /**< Common script size. */
 static int nlua_envs = LUA_NOREF;
+static int nlua_bcache = LUA_NOREF; /**< Table of compiled chunks ({bytecode, last use}) indexed by hash, size and name. */
+static size_t nlua_bcache_bytes = 0; /**< Bytes of bytecode in the chunk cache. */
+static double nlua_bcache_tick = 0.; /**< Counter used to order the cached chunks by last use. */
+static NLuaCacheStats nlua_bcache_stats; /**< Statistics of the chunk cache. */
+
+/**
+ * @brief CPU accounting of an environment.
+ */
+typedef struct NLuaAccount_ {
+   char *name;       /**< Name of the first script run in the environment. */
+   Uint64 time;      /**< Ticks spent since accounting was enabled. */
+   Uint64 frame;     /**< Ticks spent during the current frame. */
+   Uint64 worst;     /**< Most ticks spent in a single frame. */
+   int calls;        /**< Number of calls since accounting was enabled. */
+   int over;         /**< Frames over the budget since accounting was enabled. */
+   int active;       /**< Whether or not it is in nlua_acctActive. */
+   int warned;       /**< Whether or not going over the budget was warned about. */
+} NLuaAccount;
+static NLuaAccount *nlua_acct = NULL; /**< Array (array.h): Accounting indexed by environment. */
+static nlua_env *nlua_acctActive = NULL; /**< Array (array.h): Environments run during the current frame. */
+static Uint64 nlua_acctNested = 0; /**< Ticks spent in environments called by the running one. */
+static int nlua_acctConsole = 0; /**< Whether accounting was requested explicitly. */
+static int nlua_acctFrame = 1; /**< Current frame number. */
+static int nlua_acctFrames = 0; /**< Frames since accounting was enabled. */
+int nlua_accounting = 0; /**< Whether or not the time spent in environments is being accounted. */
+
+/**
+ * @brief Growing buffer used to dump the bytecode of a chunk.
+ */
+typedef struct NLuaDump_ {
+   char *buf;  /**< Data. */
+   size_t len; /**< Amount of data written. */
+   size_t cap; /**< Allocated size. */
+} NLuaDump;
 
 /*
  * prototypes
  */
+static uint64_t nlua_hash( const char *buf, size_t sz );
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud );
 static int nlua_package_loader_lua( lua_State* L );
 static int nlua_package_loader_c( lua_State* L );
 static int nlua_package_loader_croot( lua_State* L );
 static int nlua_require( lua_State* L );
 static lua_State *nlua_newState (void); /* creates a new state */
+static NLuaAccount *nlua_accountGet( nlua_env env );
+static int nlua_accountCmp( const void *p1, const void *p2 );
 static int nlua_loadBasic( lua_State* L );
 static int luaB_loadstring( lua_State *L );
 /* gettext */
@@ -184,6 +226,13 @@ void lua_init (void)
    lua_newtable( naevL );
    nlua_envs = luaL_ref(naevL, LUA_REGISTRYINDEX);
 
+   /* Compiled chunk cache. */
+   lua_newtable( naevL );
+   nlua_bcache = luaL_ref(naevL, LUA_REGISTRYINDEX);
+   nlua_bcache_bytes = 0;
+   nlua_bcache_tick = 0.;
+   memset( &nlua_bcache_stats, 0, sizeof(NLuaCacheStats) );
+
    /* Better clean up. */
    lua_atpanic( naevL, nlua_panic );
 }
@@ -211,11 +260,210 @@ static int luaB_loadstring( lua_State *L )
  */
 void lua_exit (void)
 {
+   for (int i=0; i<array_size(nlua_acct); i++)
+      free( nlua_acct[i].name );
+   array_free( nlua_acct );
+   nlua_acct = NULL;
+   array_free( nlua_acctActive );
+   nlua_acctActive = NULL;
+
    free( common_script );
    lua_close(naevL);
    naevL = NULL;
 }
 
+/**
+ * @brief Hashes a chunk of Lua source (FNV-1a).
+ */
+static uint64_t nlua_hash( const char *buf, size_t sz )
+{
+   uint64_t h = 14695981039346656037ULL;
+   for (size_t i=0; i<sz; i++) {
+      h ^= (unsigned char) buf[i];
+      h *= 1099511628211ULL;
+   }
+   return h;
+}
+
+/**
+ * @brief lua_dump writer that appends to a NLuaDump.
+ */
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud )
+{
+   NLuaDump *d = (NLuaDump*) ud;
+   (void) L;
+   if (d->len + sz > d->cap) {
+      char *buf;
+      size_t cap = MAX( 2*d->cap, d->len + sz );
+      buf = realloc( d->buf, cap );
+      if (buf == NULL)
+         return 1;
+      d->buf = buf;
+      d->cap = cap;
+   }
+   memcpy( &d->buf[d->len], p, sz );
+   d->len += sz;
+   return 0;
+}
+
+/**
+ * @brief Evicts the least recently used chunks until the cache fits its budget.
+ *
+ *    @param L Lua state with the cache.
+ *    @param sz Bytes that are about to be added to the cache.
+ */
+static void nlua_cacheEvict( lua_State *L, size_t sz )
+{
+   lua_rawgeti( L, LUA_REGISTRYINDEX, nlua_bcache ); /* t */
+   while ((nlua_bcache_bytes > 0) && (nlua_bcache_bytes + sz > NLUA_BCACHE_MAX)) {
+      double oldest = HUGE_VAL;
+      size_t oldsz = 0;
+
+      /* Find the least recently used, linear but only done when full. */
+      lua_pushnil( L ); /* t, o */
+      lua_pushnil( L ); /* t, o, nil */
+      while (lua_next( L, -3 ) != 0) { /* t, o, k, e */
+         double tick;
+         lua_rawgeti( L, -1, 2 ); /* t, o, k, e, tick */
+         tick = lua_tonumber( L, -1 );
+         lua_pop( L, 1 ); /* t, o, k, e */
+         if (tick < oldest) {
+            oldest = tick;
+            lua_rawgeti( L, -1, 1 ); /* t, o, k, e, bc */
+            oldsz = lua_objlen( L, -1 );
+            lua_pop( L, 1 ); /* t, o, k, e */
+            lua_pushvalue( L, -2 ); /* t, o, k, e, k */
+            lua_replace( L, -4 ); /* t, k, k, e */
+         }
+         lua_pop( L, 1 ); /* t, o, k */
+      }
+      if (lua_isnil( L, -1 )) {
+         lua_pop( L, 1 ); /* t */
+         break;
+      }
+
+      /* Remove it. */
+      lua_pushnil( L ); /* t, o, nil */
+      lua_rawset( L, -3 ); /* t */
+      nlua_bcache_bytes -= MIN( oldsz, nlua_bcache_bytes );
+      nlua_bcache_stats.evictions++;
+   }
+   lua_pop( L, 1 ); /* */
+}
+
+/**
+ * @brief Loads a chunk of Lua source, reusing the compiled bytecode if the same
+ *        chunk was already loaded before.
+ *
+ * Behaves like luaL_loadbuffer(). Chunks are identified by their name and the
+ * hash and size of their source, so modified sources are always recompiled.
+ * Chunks whose name starts with '=' (not loaded from a file, like console
+ * input) are one-off and never cached. The cache keeps at most
+ * NLUA_BCACHE_MAX bytes of bytecode, evicting the least recently used chunks.
+ *
+ *    @param L Lua state to load into.
+ *    @param buf Source to load.
+ *    @param sz Size of the source.
+ *    @param name Name of the chunk.
+ *    @return 0 on success and the function is pushed on the stack, otherwise the
+ *            error code of luaL_loadbuffer() and the message is pushed.
+ */
+int nlua_loadbuffer( lua_State *L, const char *buf, size_t sz, const char *name )
+{
+   char key[PATH_MAX];
+   Uint64 t0;
+   double dt;
+   int ret;
+   NLuaDump dump;
+
+   if ((nlua_bcache == LUA_NOREF) || (name[0] == '='))
+      return luaL_loadbuffer( L, buf, sz, name );
+
+   snprintf( key, sizeof(key), "%016"PRIx64":%zu:%s", nlua_hash( buf, sz ), sz, name );
+
+   /* Try to load the cached bytecode. */
+   lua_rawgeti( L, LUA_REGISTRYINDEX, nlua_bcache ); /* t */
+   lua_getfield( L, -1, key ); /* t, e */
+   if (lua_istable( L, -1 )) {
+      size_t bcsz;
+      const char *bc;
+      lua_pushnumber( L, ++nlua_bcache_tick ); /* t, e, tick */
+      lua_rawseti( L, -2, 2 ); /* t, e */
+      lua_rawgeti( L, -1, 1 ); /* t, e, s */
+      bc  = lua_tolstring( L, -1, &bcsz );
+      t0  = SDL_GetPerformanceCounter();
+      ret = luaL_loadbuffer( L, bc, bcsz, name ); /* t, e, s, f */
+      dt  = (double)(SDL_GetPerformanceCounter() - t0) / (double)SDL_GetPerformanceFrequency();
+      lua_replace( L, -4 ); /* f, e, s */
+      lua_pop( L, 2 ); /* f */
+      if (ret == 0) {
+         nlua_bcache_stats.hits++;
+         nlua_bcache_stats.hit_bytes += sz;
+         nlua_bcache_stats.load_time += dt;
+         return 0;
+      }
+      /* Shouldn't happen, but drop it and recompile from source just in case. */
+      lua_pop( L, 1 ); /* */
+      lua_rawgeti( L, LUA_REGISTRYINDEX, nlua_bcache ); /* t */
+      lua_pushnil( L ); /* t, nil */
+      lua_setfield( L, -2, key ); /* t */
+      lua_pop( L, 1 ); /* */
+      nlua_bcache_bytes -= MIN( bcsz, nlua_bcache_bytes );
+   }
+   else
+      lua_pop( L, 2 ); /* */
+
+   /* Compile from source. */
+   t0  = SDL_GetPerformanceCounter();
+   ret = luaL_loadbuffer( L, buf, sz, name ); /* f */
+   dt  = (double)(SDL_GetPerformanceCounter() - t0) / (double)SDL_GetPerformanceFrequency();
+   nlua_bcache_stats.misses++;
+   nlua_bcache_stats.miss_bytes += sz;
+   nlua_bcache_stats.compile_time += dt;
+   if (ret != 0)
+      return ret;
+
+   /* Store the bytecode for next time. */
+   memset( &dump, 0, sizeof(dump) );
+   if ((lua_dump( L, nlua_dumpWriter, &dump ) == 0) && (dump.len <= NLUA_BCACHE_MAX)) {
+      nlua_cacheEvict( L, dump.len );
+      lua_rawgeti( L, LUA_REGISTRYINDEX, nlua_bcache ); /* f, t */
+      lua_createtable( L, 2, 0 ); /* f, t, e */
+      lua_pushlstring( L, dump.buf, dump.len ); /* f, t, e, s */
+      lua_rawseti( L, -2, 1 ); /* f, t, e */
+      lua_pushnumber( L, ++nlua_bcache_tick ); /* f, t, e, tick */
+      lua_rawseti( L, -2, 2 ); /* f, t, e */
+      lua_setfield( L, -2, key ); /* f, t */
+      lua_pop( L, 1 ); /* f */
+      nlua_bcache_bytes += dump.len;
+   }
+   free( dump.buf );
+   return 0;
+}
+
+/**
+ * @brief Gets the statistics of the compiled chunk cache.
+ *
+ * The time saved is estimated from the average compile time per byte of the
+ * chunks that had to be compiled.
+ *
+ *    @param[out] stats Statistics of the cache.
+ *    @return Estimated time saved by the cache in seconds.
+ */
+double nlua_cacheStats( NLuaCacheStats *stats )
+{
+   const NLuaCacheStats *s = &nlua_bcache_stats;
+   double saved;
+   if (stats != NULL) {
+      *stats = *s;
+      stats->bytes = nlua_bcache_bytes;
+   }
+   if (s->miss_bytes <= 0)
+      return 0.;
+   saved = s->compile_time * (double)s->hit_bytes / (double)s->miss_bytes;
+   return MAX( 0., saved - s->load_time );
+}
+
 /*
  * @brief Run code from buffer in Lua environment.
  *
@@ -231,7 +479,10 @@ int nlua_dobufenv( nlua_env env,
                    const char *name )
 {
    int ret;
-   ret = luaL_loadbuffer(naevL, buff, sz, name);
+   NLuaAccount *a = nlua_accountGet( env );
+   if ((a != NULL) && (a->name == NULL))
+      a->name = strdup( name );
+   ret = nlua_loadbuffer(naevL, buff, sz, name);
    if (ret != 0)
       return ret;
    nlua_pushenv(naevL, env);
@@ -338,7 +589,7 @@ nlua_env nlua_newEnv (void)
          WARN(_("Unable to load common script '%s'!"), LUA_COMMON_PATH);
    }
    if (common_script != NULL) {
-      if (luaL_loadbuffer(naevL, common_script, common_sz, LUA_COMMON_PATH) == 0) {
+      if (nlua_loadbuffer(naevL, common_script, common_sz, LUA_COMMON_PATH) == 0) {
          if (nlua_pcall( ref, 0, 0 ) != 0) {
             WARN(_("Failed to run '%s':\n%s"), LUA_COMMON_PATH, lua_tostring(naevL,-1));
             lua_pop(naevL, 1);
@@ -366,6 +617,9 @@ void nlua_freeEnv( nlua_env env )
    if (env == LUA_NOREF)
       return;
 
+   /* Asynchronous solves can't call back into it anymore. */
+   linopt_cancel( env );
+
    /* Remove from the environment table. */
    lua_rawgeti(naevL, LUA_REGISTRYINDEX, nlua_envs);
    lua_rawgeti(naevL, LUA_REGISTRYINDEX, env);
@@ -373,6 +627,25 @@ void nlua_freeEnv( nlua_env env )
    lua_rawset(naevL, -3);
    lua_pop(naevL,1);
 
+   /* The reference can be reused by another environment. */
+   if (env < array_size(nlua_acct)) {
+      NLuaAccount *a = &nlua_acct[env];
+      free( a->name );
+      a->name  = NULL;
+      a->time  = a->frame = a->worst = 0;
+      a->calls = a->over = a->warned = 0;
+      /* Drop it from this frame so the reused reference starts clean. */
+      if (a->active) {
+         for (int i=0; i<array_size(nlua_acctActive); i++) {
+            if (nlua_acctActive[i] != env)
+               continue;
+            array_erase( &nlua_acctActive, &nlua_acctActive[i], &nlua_acctActive[i+1] );
+            break;
+         }
+         a->active = 0;
+      }
+   }
+
    /* Unref. */
    luaL_unref(naevL, LUA_REGISTRYINDEX, env);
 }
@@ -602,7 +875,7 @@ static int nlua_package_loader_lua( lua_State* L )
    }
 
    /* Try to process the Lua. It will leave a function or message on the stack, as required. */
-   luaL_loadbuffer(L, buf, bufsize, path_filename);
+   nlua_loadbuffer(L, buf, bufsize, path_filename);
    free(buf);
    return 1;
 }
@@ -835,7 +1108,30 @@ int nlua_pcall( nlua_env env, int nargs, int nresults )
    prev_env = __NLUA_CURENV;
    __NLUA_CURENV = env;
 
-   ret = lua_pcall(naevL, nargs, nresults, errf);
+   if (nlua_accounting) {
+      /* Time spent in environments called from this one is not ours. */
+      Uint64 nested = nlua_acctNested;
+      Uint64 t0 = SDL_GetPerformanceCounter();
+      Uint64 elapsed;
+      NLuaAccount *a;
+      nlua_acctNested = 0;
+      ret = lua_pcall(naevL, nargs, nresults, errf);
+      elapsed = SDL_GetPerformanceCounter() - t0;
+      a = nlua_accountGet( env );
+      if (a != NULL) {
+         Uint64 self = elapsed - MIN( elapsed, nlua_acctNested );
+         a->time  += self;
+         a->frame += self;
+         a->calls++;
+         if (!a->active) {
+            a->active = 1;
+            array_push_back( &nlua_acctActive, env );
+         }
+      }
+      nlua_acctNested = nested + elapsed;
+   }
+   else
+      ret = lua_pcall(naevL, nargs, nresults, errf);
 
    __NLUA_CURENV = prev_env;
 
@@ -846,6 +1142,175 @@ int nlua_pcall( nlua_env env, int nargs, int nresults )
    return ret;
 }
 
+/**
+ * @brief Gets the accounting of an environment, making room for it if necessary.
+ */
+static NLuaAccount *nlua_accountGet( nlua_env env )
+{
+   int n = array_size( nlua_acct );
+   if (env < 0)
+      return NULL;
+   if (nlua_acct == NULL)
+      nlua_acct = array_create( NLuaAccount );
+   if (env >= n) {
+      array_resize( &nlua_acct, env+1 );
+      memset( &nlua_acct[n], 0, sizeof(NLuaAccount) * (env+1-n) );
+   }
+   return &nlua_acct[env];
+}
+
+/**
+ * @brief Enables or disables accounting the time spent in each environment.
+ *
+ * Accounting is also enabled while there is a budget set with the "lua_budget"
+ * option. Enabling it clears the previous results.
+ *
+ *    @param enable Whether or not to account time.
+ */
+void nlua_accountEnable( int enable )
+{
+   if (enable && !nlua_acctConsole) {
+      for (int i=0; i<array_size(nlua_acct); i++) {
+         NLuaAccount *a = &nlua_acct[i];
+         a->time  = a->worst = 0;
+         a->calls = a->over = 0;
+      }
+      nlua_acctFrames = 0;
+   }
+   nlua_acctConsole = enable;
+   nlua_accounting = nlua_acctConsole || (conf.lua_budget > 0.);
+}
+
+/**
+ * @brief Ends a frame, checking the environments that ran against the budget.
+ *
+ * Should be called once per frame, even when accounting is disabled.
+ */
+void nlua_accountFrame (void)
+{
+   double freq = (double)SDL_GetPerformanceFrequency() / 1000.;
+   for (int i=0; i<array_size(nlua_acctActive); i++) {
+      double ms;
+      NLuaAccount *a;
+      nlua_env env = nlua_acctActive[i];
+      if (env >= array_size(nlua_acct))
+         continue;
+      a = &nlua_acct[env];
+      ms = (double)a->frame / freq;
+      a->worst = MAX( a->worst, a->frame );
+      if ((conf.lua_budget > 0.) && (ms > conf.lua_budget)) {
+         a->over++;
+         if (!a->warned) {
+            WARN(_("Lua script '%s' took %.3f ms in a single frame, over the budget of %.3f ms!"),
+                  (a->name!=NULL) ? a->name : _("unknown"), ms, conf.lua_budget );
+            a->warned = 1;
+         }
+      }
+      a->frame  = 0;
+      a->active = 0;
+   }
+   array_erase( &nlua_acctActive, array_begin(nlua_acctActive), array_end(nlua_acctActive) );
+   nlua_acctFrame++;
+   if (nlua_accounting)
+      nlua_acctFrames++;
+
+   /* Budget can be changed from the options at any time. */
+   nlua_accounting = nlua_acctConsole || (conf.lua_budget > 0.);
+}
+
+/**
+ * @brief Compares the accounting of environments to sort by time spent, most first.
+ */
+static int nlua_accountCmp( const void *p1, const void *p2 )
+{
+   const NLuaEnvStats *s1 = (const NLuaEnvStats*) p1;
+   const NLuaEnvStats *s2 = (const NLuaEnvStats*) p2;
+   if (s1->time > s2->time)
+      return -1;
+   else if (s1->time < s2->time)
+      return +1;
+   return s1->env - s2->env;
+}
+
+/**
+ * @brief Gets the time spent in each environment since accounting was enabled.
+ *
+ *    @param[out] stats Array (array.h) to store the environments that ran in, most time first.
+ *    @return Number of frames since accounting was enabled.
+ */
+int nlua_accountStats( NLuaEnvStats **stats )
+{
+   double freq = (double)SDL_GetPerformanceFrequency();
+   array_erase( stats, array_begin(*stats), array_end(*stats) );
+   for (int i=0; i<array_size(nlua_acct); i++) {
+      const NLuaAccount *a = &nlua_acct[i];
+      NLuaEnvStats *s;
+      if (a->calls <= 0)
+         continue;
+      s = &array_grow( stats );
+      s->env   = i;
+      s->name  = a->name;
+      s->time  = (double)a->time / freq;
+      s->worst = (double)a->worst / freq;
+      s->calls = a->calls;
+      s->over  = a->over;
+   }
+   qsort( *stats, array_size(*stats), sizeof(NLuaEnvStats), nlua_accountCmp );
+   return nlua_acctFrames;
+}
+
+/**
+ * @brief Starts timing a deferrable call for nlua_budgetStop.
+ *
+ *    @return Performance counter at the start or 0 if deferring is disabled.
+ */
+uint64_t nlua_budgetStart (void)
+{
+   if (!conf.lua_budget_defer || (conf.lua_budget <= 0.))
+      return 0;
+   return SDL_GetPerformanceCounter();
+}
+
+/**
+ * @brief Charges the time since nlua_budgetStart to the object making the call.
+ *
+ * Environments can be shared (pilots with the same AI profile share one), so
+ * the budget is tracked by the caller and not by the environment.
+ *
+ *    @param b Budget of the object making the call.
+ *    @param t0 Value returned by nlua_budgetStart.
+ */
+void nlua_budgetStop( NLuaBudget *b, uint64_t t0 )
+{
+   double ms;
+   if (t0 == 0)
+      return;
+   if (b->frame != nlua_acctFrame) {
+      b->frame = nlua_acctFrame;
+      b->ticks = 0;
+   }
+   b->ticks += SDL_GetPerformanceCounter() - t0;
+   ms = (double)b->ticks * 1000. / (double)SDL_GetPerformanceFrequency();
+   if (ms > conf.lua_budget)
+      b->overframe = nlua_acctFrame;
+}
+
+/**
+ * @brief Checks to see if a deferrable call should wait.
+ *
+ * Only calls that are fine being run a frame later (such as timers that are
+ * already overdue) should be deferred.
+ *
+ *    @param b Budget of the object making the call.
+ *    @return 1 if the object went over the budget in the previous frame and deferring is enabled.
+ */
+int nlua_budgetDefer( const NLuaBudget *b )
+{
+   if (!conf.lua_budget_defer || (conf.lua_budget <= 0.))
+      return 0;
+   return (b->overframe > 0) && (b->overframe == nlua_acctFrame-1);
+}
+
 /**
  * @brief Gets the reference of a global in a lua environment.
  *
@@ -4,6 +4,7 @@
 #pragma once
 
 /** @cond */
+#include <stdint.h>
 #include <lua.h>
 #include <lauxlib.h>
 /** @endcond */
@@ -16,8 +17,48 @@
    (lua_isnoneornil(L,ind) ? (def) : checkfunc(L,ind))
 
 typedef int nlua_env;
+
+/**
+ * @brief Statistics of the compiled chunk cache.
+ */
+typedef struct NLuaCacheStats_ {
+   int hits;            /**< Chunks loaded from the cache. */
+   int misses;          /**< Chunks that had to be compiled. */
+   size_t hit_bytes;    /**< Source bytes of the chunks loaded from the cache. */
+   size_t miss_bytes;   /**< Source bytes of the chunks that had to be compiled. */
+   double load_time;    /**< Time spent loading cached bytecode in seconds. */
+   double compile_time; /**< Time spent compiling source in seconds. */
+   int evictions;       /**< Chunks evicted to keep the cache within its budget. */
+   size_t bytes;        /**< Bytes of bytecode currently in the cache. */
+} NLuaCacheStats;
+
+/**
+ * @brief CPU time used by a Lua environment.
+ */
+typedef struct NLuaEnvStats_ {
+   nlua_env env;     /**< Environment. */
+   const char *name; /**< Name of the first script run in the environment. */
+   double time;      /**< Seconds spent running the environment, not counting other environments it called. */
+   double worst;     /**< Most seconds spent in the environment in a single frame. */
+   int calls;        /**< Number of calls into the environment. */
+   int over;         /**< Number of frames the environment went over the budget. */
+} NLuaEnvStats;
+
+/**
+ * @brief Lua time spent by an object calling into an environment.
+ *
+ * Used to defer calls of objects, such as pilots, that can share their
+ * environment with others.
+ */
+typedef struct NLuaBudget_ {
+   uint64_t ticks;   /**< Performance counter ticks spent during the frame. */
+   int frame;        /**< Frame the ticks were counted in. */
+   int overframe;    /**< Last frame that went over the budget. */
+} NLuaBudget;
+
 extern lua_State *naevL;
 extern nlua_env __NLUA_CURENV;
+extern int nlua_accounting;
 
 /*
  * standard Lua stuff wrappers
@@ -31,6 +72,8 @@ void nlua_setenv(lua_State* L, nlua_env env, const char *name);
 void nlua_getenv(lua_State* L, nlua_env env, const char *name);
 void nlua_register(nlua_env env, const char *libname,
                    const luaL_Reg *l, int metatable);
+int nlua_loadbuffer( lua_State *L, const char *buf, size_t sz, const char *name );
+double nlua_cacheStats( NLuaCacheStats *stats );
 int nlua_dobufenv(nlua_env env,
                   const char *buff,
                   size_t sz,
@@ -43,6 +86,14 @@ int nlua_refenv( nlua_env env, const char *name );
 int nlua_refenvtype( nlua_env env, const char *name, int type );
 int nlua_reffield( int objref, const char *name );
 
+/* CPU accounting. */
+void nlua_accountEnable( int enable );
+void nlua_accountFrame (void);
+int nlua_accountStats( NLuaEnvStats **stats );
+uint64_t nlua_budgetStart (void);
+void nlua_budgetStop( NLuaBudget *b, uint64_t t0 );
+int nlua_budgetDefer( const NLuaBudget *b );
+
 /* Reference stuff. */
 int nlua_ref( lua_State *L, int idx );
 void nlua_unref( lua_State *L, int idx );
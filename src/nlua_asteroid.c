@@ -40,6 +40,9 @@ static int asteroidL_armour( lua_State *L );
 static int asteroidL_setArmour( lua_State *L );
 static int asteroidL_alertRange( lua_State *L );
 static int asteroidL_materials( lua_State *L );
+#if DEBUGGING
+static int asteroidL_benchmark( lua_State *L );
+#endif /* DEBUGGING */
 static const luaL_Reg asteroidL_methods[] = {
    { "__eq", asteroidL_eq },
    { "getAll", asteroidL_getAll },
@@ -59,6 +62,9 @@ static const luaL_Reg asteroidL_methods[] = {
    { "setArmour", asteroidL_setArmour },
    { "alertRange", asteroidL_alertRange },
    { "materials", asteroidL_materials },
+#if DEBUGGING
+   { "benchmark", asteroidL_benchmark },
+#endif /* DEBUGGING */
    {0,0}
 }; /**< AsteroidLua methods. */
 
@@ -296,7 +302,7 @@ static int asteroidL_get( lua_State *L )
          if (a->state != ASTEROID_FG)
             continue;
 
-         d2 = vec2_dist2( pos, &a->pos );
+         d2 = pow2( pos->x - ast->motion.x[j] ) + pow2( pos->y - ast->motion.y[j] );
          if (d2 > dist2)
             continue;
 
@@ -442,7 +448,7 @@ static int asteroidL_field( lua_State *L )
 static int asteroidL_pos( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
-   lua_pushvector(L,a->pos);
+   lua_pushvector(L,asteroid_pos(a));
    return 1;
 }
 
@@ -456,7 +462,7 @@ static int asteroidL_pos( lua_State *L )
 static int asteroidL_vel( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
-   lua_pushvector(L,a->vel);
+   lua_pushvector(L,asteroid_vel(a));
    return 1;
 }
 
@@ -471,7 +477,7 @@ static int asteroidL_setPos( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
    vec2 *v = luaL_checkvector(L,2);
-   a->pos = *v;
+   asteroid_setPos( a, v );
    return 0;
 }
 
@@ -486,7 +492,7 @@ static int asteroidL_setVel( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
    vec2 *v = luaL_checkvector(L,2);
-   a->vel = *v;
+   asteroid_setVel( a, v );
    return 0;
 }
 
@@ -515,7 +521,7 @@ static int asteroidL_scanned( lua_State *L )
 static int asteroidL_timer( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
-   lua_pushnumber(L,a->timer);
+   lua_pushnumber(L,asteroid_timer(a));
    lua_pushnumber(L,a->timer_max);
    return 2;
 }
@@ -530,8 +536,7 @@ static int asteroidL_timer( lua_State *L )
 static int asteroidL_setTimer( lua_State *L )
 {
    Asteroid *a = luaL_validasteroid(L,1);
-   a->timer = luaL_checknumber(L,2);
-   a->timer_max = MAX( a->timer_max, a->timer );
+   asteroid_setTimer( a, luaL_checknumber(L,2) );
    return 0;
 }
 
@@ -610,3 +615,28 @@ static int asteroidL_materials( lua_State *L )
 
    return 1;
 }
+
+#if DEBUGGING
+/**
+ * @brief Benchmarks the movement of the asteroids on a synthetic field.
+ *
+ * The field is not part of the current system and is freed afterwards. Only
+ * available in debug builds.
+ *
+ *    @luatparam[opt=50000] number n Number of asteroids in the field.
+ *    @luatparam[opt=600] number steps Number of updates to run.
+ *    @luatreturn number Seconds taken by the vectorized movement.
+ *    @luatreturn number Seconds taken by the scalar movement.
+ * @luafunc benchmark
+ */
+static int asteroidL_benchmark( lua_State *L )
+{
+   int n = luaL_optinteger(L,1,50000);
+   int steps = luaL_optinteger(L,2,600);
+   double simd, scalar;
+   asteroids_benchmark( n, steps, &simd, &scalar );
+   lua_pushnumber(L,simd);
+   lua_pushnumber(L,scalar);
+   return 2;
+}
+#endif /* DEBUGGING */
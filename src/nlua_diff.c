@@ -19,6 +19,7 @@
 
 #include "nlua_diff.h"
 
+#include "array.h"
 #include "log.h"
 #include "nluadef.h"
 #include "unidiff.h"
@@ -27,10 +28,12 @@
 static int diffL_apply( lua_State *L );
 static int diffL_remove( lua_State *L );
 static int diffL_isapplied( lua_State *L );
+static int diffL_available( lua_State *L );
 static const luaL_Reg diffL_methods[] = {
    { "apply", diffL_apply },
    { "remove", diffL_remove },
    { "isApplied", diffL_isapplied },
+   { "available", diffL_available },
    {0,0}
 }; /**< Unidiff Lua methods. */
 
@@ -61,9 +64,10 @@ int nlua_loadDiff( nlua_env env )
 /**
  * @brief Applies a diff by name.
  *
- * If your diff modifies a Spob or a system, the safe lanes will be re-computed
- * just after it is applied, causing the game to freeze for a short time.
- * As a result, prefer not to apply a diff when the player is in space.
+ * If your diff modifies the spobs, jumps or presence of a system, the safe
+ * lanes will be re-computed just after it is applied, causing the game to
+ * freeze for a short time. As a result, prefer not to apply a diff when the
+ * player is in space.
  *
  *    @luatparam string name Name of the diff to apply.
  * @luafunc apply
@@ -101,3 +105,21 @@ static int diffL_isapplied( lua_State *L )
    lua_pushboolean(L,diff_isApplied(name));
    return 1;
 }
+
+/**
+ * @brief Gets the names of all the diffs that can be applied.
+ *
+ *    @luatreturn table Table of the names of all the available diffs.
+ * @luafunc available
+ */
+static int diffL_available( lua_State *L )
+{
+   const char **names = diff_getAvailable();
+   lua_newtable(L);
+   for (int i=0; i<array_size(names); i++) {
+      lua_pushstring(L, names[i]);
+      lua_rawseti(L,-2,i+1);
+   }
+   array_free( names );
+   return 1;
+}
@@ -55,6 +55,9 @@ static int gfxL_printText( lua_State *L );
 static int gfxL_setBlendMode( lua_State *L );
 static int gfxL_setScissor( lua_State *L );
 static int gfxL_screenshot( lua_State *L );
+#if DEBUGGING
+static int gfxL_benchmarkSprites( lua_State *L );
+#endif /* DEBUGGING */
 static const luaL_Reg gfxL_methods[] = {
    /* Information. */
    { "dim", gfxL_dim },
@@ -85,6 +88,9 @@ static const luaL_Reg gfxL_methods[] = {
    { "setBlendMode", gfxL_setBlendMode },
    { "setScissor", gfxL_setScissor },
    { "screenshot", gfxL_screenshot },
+#if DEBUGGING
+   { "benchmarkSprites", gfxL_benchmarkSprites },
+#endif /* DEBUGGING */
    {0,0}
 }; /**< GFX methods. */
 
@@ -1036,3 +1042,38 @@ static int gfxL_screenshot( lua_State * L )
       free( lc );
    return 1;
 }
+
+#if DEBUGGING
+/**
+ * @brief Benchmarks rendering sprites one by one and in batches.
+ *
+ * Sprites are drawn directly to the screen and the rendering is finished
+ *  before timing, so the time spent by the GPU is included. Only available in
+ *  debug builds.
+ *
+ * @usage immediate, batched, dimm, dbat = gfx.benchmarkSprites( tex, 2000, 50 )
+ *
+ *    @luatparam Tex tex Texture to use as a sprite sheet.
+ *    @luatparam[opt=2000] number n Number of sprites to render.
+ *    @luatparam[opt=50] number reps Number of times to render all the sprites.
+ *    @luatreturn number Seconds taken rendering one by one.
+ *    @luatreturn number Seconds taken rendering in batches.
+ *    @luatreturn number Draw calls per repetition when rendering one by one.
+ *    @luatreturn number Draw calls per repetition when rendering in batches.
+ * @luafunc benchmarkSprites
+ */
+static int gfxL_benchmarkSprites( lua_State *L )
+{
+   double immediate, batched;
+   unsigned int dimmediate, dbatched;
+   const glTexture *tex = luaL_checktex( L, 1 );
+   int n    = luaL_optinteger( L, 2, 2000 );
+   int reps = luaL_optinteger( L, 3, 50 );
+   gl_benchmarkSprites( tex, n, reps, &immediate, &batched, &dimmediate, &dbatched );
+   lua_pushnumber( L, immediate );
+   lua_pushnumber( L, batched );
+   lua_pushinteger( L, dimmediate );
+   lua_pushinteger( L, dbatched );
+   return 4;
+}
+#endif /* DEBUGGING */
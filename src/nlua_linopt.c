@@ -18,9 +18,11 @@
 
 #include "nlua_linopt.h"
 
+#include "array.h"
 #include "log.h"
 #include "nstring.h"
 #include "nluadef.h"
+#include "threadpool.h"
 
 #define LINOPT_MAX_TM   1000  /**< Maximum time to optimize (in ms). Applied to linear relaxation and MIP independently. */
 
@@ -31,8 +33,38 @@ typedef struct LuaLinOpt_s {
    int ncols;        /**< Number of structural variables. */
    int nrows;        /**< Number of auxiliary variables (constraints). */
    glp_prob *prob;   /**< Problem structure itself. */
+   int busy;         /**< Being solved asynchronously, can not be modified. */
 } LuaLinOpt_t;
 
+/**
+ * @brief A single solve of a linear program, possibly running on a worker thread.
+ */
+typedef struct LinOptSolve_s {
+   glp_prob *prob;   /**< Problem to solve. */
+   int ncols;        /**< Number of structural variables. */
+   int nrows;        /**< Number of auxiliary variables (constraints). */
+   int ismip;        /**< Whether or not it is a mixed integer program. */
+   glp_smcp parm_smcp; /**< Simplex parameters. */
+   glp_iocp parm_iocp; /**< Integer optimization parameters. */
+   const char *err;  /**< Error message if failed, NULL otherwise. */
+   double z;         /**< Value of the objective function. */
+   double *x;        /**< Values of the columns (1-index based). */
+   double *c;        /**< Values of the rows (1-index based). */
+   /* Only used when solving asynchronously. */
+   LuaLinOpt_t *lp;  /**< Linear program being solved. */
+   int lp_ref;       /**< Reference to the linear program to keep it alive. */
+   int func_ref;     /**< Reference to the callback. */
+   nlua_env env;     /**< Environment to run the callback in. */
+   int cancelled;    /**< Callback is not to be run, only touched by the main thread. */
+   struct LinOptSolve_s *next; /**< Next finished solve. */
+} LinOptSolve;
+
+static SDL_mutex *linopt_lock = NULL; /**< Lock for linopt_done. */
+static SDL_cond *linopt_cond = NULL; /**< Signalled when a solve finishes. */
+static LinOptSolve *linopt_done = NULL; /**< Asynchronous solves waiting for their callback. */
+static LinOptSolve **linopt_jobs = NULL; /**< Asynchronous solves not yet handed back (array.h), only touched by the main thread. */
+static SDL_atomic_t linopt_pending; /**< Number of asynchronous solves not yet handed back. */
+
 /* Optim metatable methods. */
 static int linoptL_gc( lua_State *L );
 static int linoptL_eq( lua_State *L );
@@ -46,6 +78,7 @@ static int linoptL_loadmatrix( lua_State *L );
 static int linoptL_solve( lua_State *L );
 static int linoptL_readProblem( lua_State *L );
 static int linoptL_writeProblem( lua_State *L );
+static LuaLinOpt_t* linopt_checkIdle( lua_State *L, int ind );
 static const luaL_Reg linoptL_methods[] = {
    { "__gc", linoptL_gc },
    { "__eq", linoptL_eq },
@@ -106,6 +139,21 @@ LuaLinOpt_t* luaL_checklinopt( lua_State *L, int ind )
    return NULL;
 }
 
+/**
+ * @brief Gets a linopt that is not being solved or raises an error.
+ *
+ *    @param L Lua state to get linopt from.
+ *    @param ind Index position to find linopt.
+ *    @return Optim found at the index in the state.
+ */
+static LuaLinOpt_t* linopt_checkIdle( lua_State *L, int ind )
+{
+   LuaLinOpt_t *lp = luaL_checklinopt(L,ind);
+   if (lp->busy)
+      NLUA_ERROR(L, _("Linear program is being solved and can not be modified!"));
+   return lp;
+}
+
 /**
  * @brief Pushes a linopt on the stack.
  *
@@ -196,6 +244,7 @@ static int linoptL_new( lua_State *L )
    lp.ncols = luaL_checkinteger(L,2);
    lp.nrows = luaL_checkinteger(L,3);
    max      = lua_toboolean(L,4);
+   lp.busy  = 0;
 
 #ifdef DEBUGGING
    if (lp.ncols <= 0)
@@ -239,7 +288,7 @@ static int linoptL_size( lua_State *L )
  */
 static int linoptL_addcols( lua_State *L )
 {
-   LuaLinOpt_t *lp   = luaL_checklinopt(L,1);
+   LuaLinOpt_t *lp   = linopt_checkIdle(L,1);
    int toadd         = luaL_checkinteger(L,2);
    glp_add_cols( lp->prob, toadd );
    lp->ncols += toadd;
@@ -255,7 +304,7 @@ static int linoptL_addcols( lua_State *L )
  */
 static int linoptL_addrows( lua_State *L )
 {
-   LuaLinOpt_t *lp   = luaL_checklinopt(L,1);
+   LuaLinOpt_t *lp   = linopt_checkIdle(L,1);
    int toadd         = luaL_checkinteger(L,2);
    glp_add_rows( lp->prob, toadd );
    lp->nrows += toadd;
@@ -276,7 +325,7 @@ static int linoptL_addrows( lua_State *L )
  */
 static int linoptL_setcol( lua_State *L )
 {
-   LuaLinOpt_t *lp   = luaL_checklinopt(L,1);
+   LuaLinOpt_t *lp   = linopt_checkIdle(L,1);
    int idx           = luaL_checkinteger(L,2);
    const char *name  = luaL_checkstring(L,3);
    double coef       = luaL_checknumber(L,4);
@@ -332,7 +381,7 @@ static int linoptL_setcol( lua_State *L )
  */
 static int linoptL_setrow( lua_State *L )
 {
-   LuaLinOpt_t *lp   = luaL_checklinopt(L,1);
+   LuaLinOpt_t *lp   = linopt_checkIdle(L,1);
    int idx           = luaL_checkinteger(L,2);
    const char *name  = luaL_checkstring(L,3);
    int haslb, hasub, type;
@@ -377,7 +426,7 @@ static int linoptL_loadmatrix( lua_State *L )
    size_t n;
    int *ia, *ja;
    double *ar;
-   LuaLinOpt_t *lp   = luaL_checklinopt(L,1);
+   LuaLinOpt_t *lp   = linopt_checkIdle(L,1);
    luaL_checktype(L, 2, LUA_TTABLE);
    luaL_checktype(L, 3, LUA_TTABLE);
    luaL_checktype(L, 4, LUA_TTABLE);
@@ -578,36 +627,31 @@ static int opt_onoff( const char *str, int def )
 }
 #undef STRCHK
 
-#define GETOPT_IOCP( name, func, def ) do {lua_getfield(L,2,#name); parm_iocp.name = func( luaL_optstring(L,-1,NULL), def ); lua_pop(L,1); } while (0)
-#define GETOPT_SMCP( name, func, def ) do {lua_getfield(L,2,#name); parm_smcp.name = func( luaL_optstring(L,-1,NULL), def ); lua_pop(L,1); } while (0)
+#define GETOPT_IOCP( name, func, def ) do {lua_getfield(L,2,#name); s->parm_iocp.name = func( luaL_optstring(L,-1,NULL), def ); lua_pop(L,1); } while (0)
+#define GETOPT_SMCP( name, func, def ) do {lua_getfield(L,2,#name); s->parm_smcp.name = func( luaL_optstring(L,-1,NULL), def ); lua_pop(L,1); } while (0)
 /**
- * @brief Solves the linear optimization problem.
+ * @brief Loads the solver parameters from the Lua stack.
  *
- *    @luatparam LinOpt lp Linear program to modify.
- *    @luatreturn number The value of the primal funcation.
- *    @luatreturn table Table of column values.
- * @luafunc solve
+ *    @param L Lua state with the parameter table at index 2.
+ *    @param lp Linear program to be solved.
+ *    @param[out] s Solve to set up.
  */
-static int linoptL_solve( lua_State *L )
+static void linopt_solveParams( lua_State *L, LuaLinOpt_t *lp, LinOptSolve *s )
 {
-   LuaLinOpt_t *lp = luaL_checklinopt(L,1);
-   double z;
-   int ret, ismip;
-   glp_iocp parm_iocp;
-   glp_smcp parm_smcp;
-#if DEBUGGING
-   Uint32 starttime = SDL_GetTicks();
-#endif /* DEBUGGING */
+   memset( s, 0, sizeof(LinOptSolve) );
+   s->prob  = lp->prob;
+   s->ncols = lp->ncols;
+   s->nrows = lp->nrows;
 
    /* Parameters. */
-   ismip = (glp_get_num_int( lp->prob ) > 0);
-   glp_init_smcp(&parm_smcp);
-   parm_smcp.msg_lev = GLP_MSG_ERR;
-   parm_smcp.tm_lim = LINOPT_MAX_TM;
-   if (ismip) {
-      glp_init_iocp(&parm_iocp);
-      parm_iocp.msg_lev  = GLP_MSG_ERR;
-      parm_iocp.tm_lim = LINOPT_MAX_TM;
+   s->ismip = (glp_get_num_int( lp->prob ) > 0);
+   glp_init_smcp(&s->parm_smcp);
+   s->parm_smcp.msg_lev = GLP_MSG_ERR;
+   s->parm_smcp.tm_lim = LINOPT_MAX_TM;
+   if (s->ismip) {
+      glp_init_iocp(&s->parm_iocp);
+      s->parm_iocp.msg_lev  = GLP_MSG_ERR;
+      s->parm_iocp.tm_lim = LINOPT_MAX_TM;
    }
 
    /* Load parameters. */
@@ -616,7 +660,7 @@ static int linoptL_solve( lua_State *L )
       GETOPT_SMCP( pricing, opt_pricing, PRICING_DEF );
       GETOPT_SMCP( r_test,  opt_r_test,  R_TEST_DEF );
       GETOPT_SMCP( presolve,opt_onoff,   PRESOLVE_DEF );
-      if (ismip) {
+      if (s->ismip) {
          GETOPT_IOCP( br_tech,  opt_br_tech, BR_TECH_DEF );
          GETOPT_IOCP( bt_tech,  opt_bt_tech, BT_TECH_DEF );
          GETOPT_IOCP( pp_tech,  opt_pp_tech, PP_TECH_DEF );
@@ -629,94 +673,284 @@ static int linoptL_solve( lua_State *L )
          GETOPT_IOCP( clq_cuts, opt_onoff,   CLQ_CUTS_DEF );
       }
    }
-#if 0
-   else {
-      parm_smcp.meth    = METH_DEF;
-      parm_smcp.pricing = PRICING_DEF;
-      parm_smcp.r_test  = R_TEST_DEF;
-      parm_smcp.presolve= PRESOLVE_DEF;
-      if (ismip) {
-         parm_iocp.br_tech  = BR_TECH_DEF;
-         parm_iocp.bt_tech  = BT_TECH_DEF;
-         parm_iocp.pp_tech  = PP_TECH_DEF;
-         parm_iocp.sr_heur  = SR_HEUR_DEF;
-         parm_iocp.fp_heur  = FP_HEUR_DEF;
-         parm_iocp.ps_heur  = PS_HEUR_DEF;
-         parm_iocp.gmi_cuts = GMI_CUTS_DEF;
-         parm_iocp.mir_cuts = MIR_CUTS_DEF;
-         parm_iocp.cov_cuts = COV_CUTS_DEF;
-         parm_iocp.clq_cuts = CLQ_CUTS_DEF;
-      }
-   }
-#endif
+}
+#undef GETOPT_IOCP
+#undef GETOPT_SMCP
+
+/**
+ * @brief Runs the optimization and stores the results.
+ *
+ * Does not touch the Lua state so that it can be run from a worker thread.
+ *
+ *    @param s Solve to run.
+ */
+static void linopt_solveRun( LinOptSolve *s )
+{
+   int ret;
+#if DEBUGGING
+   Uint32 starttime = SDL_GetTicks();
+#endif /* DEBUGGING */
 
    /* Optimization. */
-   if (!ismip || !parm_iocp.presolve) {
-      ret = glp_simplex( lp->prob, &parm_smcp );
+   if (!s->ismip || !s->parm_iocp.presolve) {
+      ret = glp_simplex( s->prob, &s->parm_smcp );
       if ((ret != 0) && (ret != GLP_ETMLIM)) {
-         lua_pushnil(L);
-         lua_pushstring(L, linopt_error(ret));
-         return 2;
+         s->err = linopt_error(ret);
+         return;
       }
       /* Check for optimality of continuous problem. */
-      ret = glp_get_status(lp->prob);
+      ret = glp_get_status(s->prob);
       if ((ret != GLP_OPT) && (ret != GLP_FEAS)) {
-         lua_pushnil(L);
-         lua_pushstring(L, linopt_status(ret));
-         return 2;
+         s->err = linopt_status(ret);
+         return;
       }
    }
-   if (ismip) {
-      ret = glp_intopt( lp->prob, &parm_iocp );
+   if (s->ismip) {
+      ret = glp_intopt( s->prob, &s->parm_iocp );
       if ((ret != 0) && (ret != GLP_ETMLIM)) {
-         lua_pushnil(L);
-         lua_pushstring(L, linopt_error(ret));
-         return 2;
+         s->err = linopt_error(ret);
+         return;
       }
       /* Check for optimality of discrete problem. */
-      ret = glp_mip_status(lp->prob);
+      ret = glp_mip_status(s->prob);
       if ((ret != GLP_OPT) && (ret != GLP_FEAS)) {
-         lua_pushnil(L);
-         lua_pushstring(L, linopt_status(ret));
-         return 2;
+         s->err = linopt_status(ret);
+         return;
       }
    }
-   z = glp_get_obj_val( lp->prob );
+   s->z = glp_get_obj_val( s->prob );
+
+   /* Go over variables and constraints and store them. */
+   s->x = malloc( sizeof(double) * (s->ncols+1) );
+   for (int i=1; i<=s->ncols; i++)
+      s->x[i] = s->ismip ? glp_mip_col_val( s->prob, i ) : glp_get_col_prim( s->prob, i );
+   s->c = malloc( sizeof(double) * (s->nrows+1) );
+   for (int i=1; i<=s->nrows; i++)
+      s->c[i] = s->ismip ? glp_mip_row_val( s->prob, i ) : glp_get_row_prim( s->prob, i );
+
+   /* Complain about time. */
+#if DEBUGGING
+   if (SDL_GetTicks() - starttime > LINOPT_MAX_TM)
+      WARN(_("glpk: too over 1 second to optimize!"));
+#endif /* DEBUGGING */
+}
+
+/**
+ * @brief Pushes the results of a solve and frees them.
+ *
+ *    @param L Lua state to push results to.
+ *    @param s Solve to push results of.
+ *    @return Number of values pushed.
+ */
+static int linopt_solvePush( lua_State *L, LinOptSolve *s )
+{
+   if (s->err != NULL) {
+      lua_pushnil(L);
+      lua_pushstring(L, s->err);
+      return 2;
+   }
 
    /* Output function value. */
-   lua_pushnumber(L,z);
+   lua_pushnumber(L,s->z);
 
-   /* Go over variables and store them. */
+   /* Variables. */
    lua_newtable(L); /* t */
-   for (int i=1; i<=lp->ncols; i++) {
-      if (ismip)
-         z = glp_mip_col_val( lp->prob, i );
-      else
-         z = glp_get_col_prim( lp->prob, i );
-      lua_pushnumber( L, z ); /* t, z */
+   for (int i=1; i<=s->ncols; i++) {
+      lua_pushnumber( L, s->x[i] ); /* t, z */
       lua_rawseti( L, -2, i ); /* t */
    }
 
-   /* Go over constraints and store them. */
+   /* Constraints. */
    lua_newtable(L); /* t */
-   for (int i=1; i<=lp->nrows; i++) {
-      if (ismip)
-         z = glp_mip_row_val( lp->prob, i );
-      else
-         z = glp_get_row_prim( lp->prob, i );
-      lua_pushnumber( L, z ); /* t, z */
+   for (int i=1; i<=s->nrows; i++) {
+      lua_pushnumber( L, s->c[i] ); /* t, z */
       lua_rawseti( L, -2, i ); /* t */
    }
 
-   /* Complain about time. */
-#if DEBUGGING
-   if (SDL_GetTicks() - starttime > LINOPT_MAX_TM)
-      WARN(_("glpk: too over 1 second to optimize!"));
-#endif /* DEBUGGING */
-
+   free( s->x );
+   free( s->c );
+   s->x = NULL;
+   s->c = NULL;
    return 3;
 }
-#undef GETOPT_IOCP
+
+/**
+ * @brief Threadpool job that solves a copy of a linear program.
+ *
+ * The problem is copied in the worker thread so that everything allocated by
+ * GLPK stays within the thread's GLPK environment. The original is only read
+ * and can not be modified while the job is running.
+ */
+static int linopt_solveJob( void *data )
+{
+   LinOptSolve *s = data;
+   glp_prob *orig = s->prob;
+
+   s->prob = glp_create_prob();
+   glp_copy_prob( s->prob, orig, GLP_OFF );
+   linopt_solveRun( s );
+   glp_delete_prob( s->prob );
+   s->prob = NULL;
+
+   /* Hand it back to the main thread. */
+   SDL_mutexP( linopt_lock );
+   s->next = linopt_done;
+   linopt_done = s;
+   SDL_CondSignal( linopt_cond );
+   SDL_mutexV( linopt_lock );
+   return 0;
+}
+
+/**
+ * @brief Runs the callbacks of the asynchronous solves that have finished.
+ *
+ * Should be called once a frame from the main thread.
+ */
+void linopt_update (void)
+{
+   LinOptSolve *s, *done, *prev;
+
+   if ((linopt_lock == NULL) || (SDL_AtomicGet( &linopt_pending ) <= 0))
+      return;
+
+   SDL_mutexP( linopt_lock );
+   done = linopt_done;
+   linopt_done = NULL;
+   SDL_mutexV( linopt_lock );
+
+   /* Reverse so that callbacks run in the order the jobs finished. */
+   prev = NULL;
+   while (done != NULL) {
+      s = done->next;
+      done->next = prev;
+      prev = done;
+      done = s;
+   }
+
+   for (s=prev; s!=NULL; s=done) {
+      done = s->next;
+      SDL_AtomicAdd( &linopt_pending, -1 );
+      s->lp->busy = 0;
+      for (int i=0; i<array_size(linopt_jobs); i++) {
+         if (linopt_jobs[i] != s)
+            continue;
+         array_erase( &linopt_jobs, &linopt_jobs[i], &linopt_jobs[i+1] );
+         break;
+      }
+
+      if (!s->cancelled) {
+         int n;
+         lua_rawgeti( naevL, LUA_REGISTRYINDEX, s->func_ref ); /* f */
+         n = linopt_solvePush( naevL, s ); /* f, z, x, c */
+         if (nlua_pcall( s->env, n, 0 )) {
+            WARN(_("linopt: solve callback failed: %s"), lua_tostring(naevL,-1));
+            lua_pop(naevL,1);
+         }
+         luaL_unref( naevL, LUA_REGISTRYINDEX, s->func_ref );
+      }
+      free( s->x );
+      free( s->c );
+
+      /* The linear program could only be let go once the worker was done with it. */
+      luaL_unref( naevL, LUA_REGISTRYINDEX, s->lp_ref );
+      free( s );
+   }
+}
+
+/**
+ * @brief Cancels the callbacks of the asynchronous solves of an environment.
+ *
+ * The solves themselves keep running, but their results are thrown away. Must
+ * be called before the environment is freed, as the callbacks run in it.
+ *
+ *    @param env Environment to cancel the solves of, or LUA_NOREF for all of them.
+ */
+void linopt_cancel( nlua_env env )
+{
+   for (int i=0; i<array_size(linopt_jobs); i++) {
+      LinOptSolve *s = linopt_jobs[i];
+      if (s->cancelled || ((env != LUA_NOREF) && (s->env != env)))
+         continue;
+      s->cancelled = 1;
+      luaL_unref( naevL, LUA_REGISTRYINDEX, s->func_ref );
+   }
+}
+
+/**
+ * @brief Cancels all the asynchronous solves and waits for them to finish.
+ */
+void linopt_exit (void)
+{
+   linopt_cancel( LUA_NOREF );
+   while (SDL_AtomicGet( &linopt_pending ) > 0) {
+      SDL_mutexP( linopt_lock );
+      if (linopt_done == NULL)
+         SDL_CondWait( linopt_cond, linopt_lock );
+      SDL_mutexV( linopt_lock );
+      linopt_update();
+   }
+   array_free( linopt_jobs );
+   linopt_jobs = NULL;
+
+   if (linopt_lock != NULL) {
+      SDL_DestroyCond( linopt_cond );
+      SDL_DestroyMutex( linopt_lock );
+      linopt_cond = NULL;
+      linopt_lock = NULL;
+   }
+}
+
+/**
+ * @brief Solves the linear optimization problem.
+ *
+ * If a callback is passed, the problem is solved on a worker thread instead
+ * and the function returns immediately. The callback is run from the main
+ * thread with the same return values once the problem has been solved. The
+ * linear program can not be modified until then.
+ *
+ *    @luatparam LinOpt lp Linear program to modify.
+ *    @luatparam[opt=nil] table params Parameters to use for the solver.
+ *    @luatparam[opt=nil] function callback Function to call with the results when solving asynchronously.
+ *    @luatreturn number The value of the primal funcation.
+ *    @luatreturn table Table of column values.
+ *    @luatreturn table Table of constraint values.
+ * @luafunc solve
+ */
+static int linoptL_solve( lua_State *L )
+{
+   LuaLinOpt_t *lp = linopt_checkIdle(L,1);
+   LinOptSolve s;
+
+   linopt_solveParams( L, lp, &s );
+
+   /* Asynchronous solve. */
+   if (!lua_isnoneornil(L,3)) {
+      LinOptSolve *job;
+      luaL_checktype(L, 3, LUA_TFUNCTION);
+      if (linopt_lock == NULL) {
+         linopt_lock = SDL_CreateMutex();
+         linopt_cond = SDL_CreateCond();
+      }
+      if (linopt_jobs == NULL)
+         linopt_jobs = array_create( LinOptSolve* );
+      job = malloc( sizeof(LinOptSolve) );
+      *job = s;
+      job->env = __NLUA_CURENV;
+      lua_pushvalue(L,3);
+      job->func_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+      lua_pushvalue(L,1); /* Keep it from being garbage collected. */
+      job->lp_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+      job->lp = lp;
+      lp->busy = 1;
+      array_push_back( &linopt_jobs, job );
+      SDL_AtomicAdd( &linopt_pending, 1 );
+      threadpool_newJob( linopt_solveJob, job );
+      return 0;
+   }
+
+   linopt_solveRun( &s );
+   return linopt_solvePush( L, &s );
+}
 
 /**
  * @brief Reads an optimization problem from a file for debugging purposes.
@@ -748,6 +982,7 @@ static int linoptL_readProblem( lua_State *L )
    }
    lp.ncols = glp_get_num_cols( lp.prob );
    lp.nrows = glp_get_num_rows( lp.prob );
+   lp.busy  = 0;
    if (maximize)
       glp_set_obj_dir( lp.prob, GLP_MAX );
    lua_pushlinopt( L, lp );
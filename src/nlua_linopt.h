@@ -14,6 +14,9 @@ typedef struct LuaLinOpt_s LuaLinOpt_t;
  * Library loading
  */
 int nlua_loadLinOpt( nlua_env env );
+void linopt_update (void);
+void linopt_cancel( nlua_env env );
+void linopt_exit (void);
 
 /* Basic operations. */
 LuaLinOpt_t* lua_tolinopt( lua_State *L, int ind );
@@ -8,6 +8,7 @@
  */
 /** @cond */
 #include <lauxlib.h>
+#include "physfs.h"
 
 #include "naev.h"
 /** @endcond */
@@ -19,6 +20,7 @@
 #include "hook.h"
 #include "input.h"
 #include "land.h"
+#include "load.h"
 #include "log.h"
 #include "info.h"
 #include "menu.h"
@@ -30,7 +32,9 @@
 #include "pause.h"
 #include "player.h"
 #include "plugin.h"
+#include "profile.h"
 #include "semver.h"
+#include "weapon.h"
 
 static int cache_table = LUA_NOREF; /* No reference. */
 
@@ -53,6 +57,12 @@ static int naevL_missionTest( lua_State *L );
 static int naevL_missionReload( lua_State *L );
 static int naevL_shadersReload( lua_State *L );
 static int naevL_isSimulation( lua_State *L );
+static int naevL_simulationStats( lua_State *L );
+static int naevL_collisionStats( lua_State *L );
+static int naevL_scriptCacheStats( lua_State *L );
+static int naevL_profile( lua_State *L );
+static int naevL_profileTrace( lua_State *L );
+static int naevL_scriptStats( lua_State *L );
 static int naevL_conf( lua_State *L );
 static int naevL_confSet( lua_State *L );
 static int naevL_cache( lua_State *L );
@@ -68,6 +78,9 @@ static int naevL_hasTextInput( lua_State *L );
 static int naevL_setTextInput( lua_State *L );
 #if DEBUGGING
 static int naevL_envs( lua_State *L );
+static int naevL_savesBenchmark( lua_State *L );
+static int naevL_savesRefresh( lua_State *L );
+static int naevL_simulate( lua_State *L );
 #endif /* DEBUGGING */
 static const luaL_Reg naev_methods[] = {
    { "version", naevL_version },
@@ -88,6 +101,12 @@ static const luaL_Reg naev_methods[] = {
    { "missionReload", naevL_missionReload },
    { "shadersReload", naevL_shadersReload },
    { "isSimulation", naevL_isSimulation },
+   { "simulationStats", naevL_simulationStats },
+   { "collisionStats", naevL_collisionStats },
+   { "scriptCacheStats", naevL_scriptCacheStats },
+   { "profile", naevL_profile },
+   { "profileTrace", naevL_profileTrace },
+   { "scriptStats", naevL_scriptStats },
    { "conf", naevL_conf },
    { "confSet", naevL_confSet },
    { "cache", naevL_cache },
@@ -103,6 +122,9 @@ static const luaL_Reg naev_methods[] = {
    { "setTextInput", naevL_setTextInput },
 #if DEBUGGING
    { "envs", naevL_envs },
+   { "savesBenchmark", naevL_savesBenchmark },
+   { "savesRefresh", naevL_savesRefresh },
+   { "simulate", naevL_simulate },
 #endif /* DEBUGGING */
    {0,0}
 }; /**< Naev Lua methods. */
@@ -434,6 +456,197 @@ static int naevL_isSimulation( lua_State *L )
    return 1;
 }
 
+/**
+ * @brief Gets statistics of the simulation done when last entering a system.
+ *
+ *    @luatreturn number Real time the simulation took (in seconds).
+ *    @luatreturn number Number of updates done by the simulation.
+ * @luafunc simulationStats
+ */
+static int naevL_simulationStats( lua_State *L )
+{
+   double time;
+   int steps;
+   space_simulationStats( &time, &steps );
+   lua_pushnumber( L, time );
+   lua_pushinteger( L, steps );
+   return 2;
+}
+
+/**
+ * @brief Gets and resets the weapon collision detection statistics.
+ *
+ * Statistics are only collected after having been enabled with this function.
+ * The returned table has the fields "ticks" (number of updates), "time"
+ * (seconds spent doing collision detection), "checks" (number of
+ * candidates returned by the broadphase), and "weapons" (sum of weapons
+ * alive at each update).
+ *
+ * @usage naev.collisionStats( true ) -- Start collecting
+ * @usage stats = naev.collisionStats( false ) -- Get results and stop
+ *
+ *    @luatparam[opt=false] boolean enable Whether or not to keep collecting statistics.
+ *    @luatreturn table Statistics collected since the last call.
+ * @luafunc collisionStats
+ */
+static int naevL_collisionStats( lua_State *L )
+{
+   WeaponCollisionStats stats;
+   weapons_collisionStats( &stats, lua_toboolean(L,1) );
+   lua_newtable(L);
+   lua_pushinteger( L, stats.ticks );
+   lua_setfield( L, -2, "ticks" );
+   lua_pushnumber( L, stats.time );
+   lua_setfield( L, -2, "time" );
+   lua_pushnumber( L, stats.checks );
+   lua_setfield( L, -2, "checks" );
+   lua_pushnumber( L, stats.weapons );
+   lua_setfield( L, -2, "weapons" );
+   return 1;
+}
+
+/**
+ * @brief Gets the statistics of the compiled Lua chunk cache.
+ *
+ * The returned table has the fields "hits" (chunks loaded from the cache),
+ * "misses" (chunks compiled from source), "compile_time" and "load_time"
+ * (seconds spent compiling source and loading cached chunks respectively),
+ * "evictions" (chunks dropped to keep the cache within its budget), "bytes"
+ * (bytecode currently cached) and "saved" (estimated seconds saved by the
+ * cache).
+ *
+ * @usage stats = naev.scriptCacheStats()
+ *
+ *    @luatreturn table Statistics of the cache since the game started.
+ * @luafunc scriptCacheStats
+ */
+static int naevL_scriptCacheStats( lua_State *L )
+{
+   NLuaCacheStats stats;
+   double saved = nlua_cacheStats( &stats );
+   lua_newtable(L);
+   lua_pushinteger( L, stats.hits );
+   lua_setfield( L, -2, "hits" );
+   lua_pushinteger( L, stats.misses );
+   lua_setfield( L, -2, "misses" );
+   lua_pushnumber( L, stats.compile_time );
+   lua_setfield( L, -2, "compile_time" );
+   lua_pushnumber( L, stats.load_time );
+   lua_setfield( L, -2, "load_time" );
+   lua_pushinteger( L, stats.evictions );
+   lua_setfield( L, -2, "evictions" );
+   lua_pushnumber( L, stats.bytes );
+   lua_setfield( L, -2, "bytes" );
+   lua_pushnumber( L, saved );
+   lua_setfield( L, -2, "saved" );
+   return 1;
+}
+
+/**
+ * @brief Gets the profiler results and enables or disables it.
+ *
+ * While enabled, the time spent in each part of the game loop is shown as a
+ * graph below the FPS. Enabling a disabled profiler clears the previous
+ * results. The returned table has an entry for each part of the game loop
+ * (such as "pilots", "render" or "lua_hook"), each a table with the fields
+ * "time" (seconds spent in it), "self" (seconds spent in it minus the parts
+ * nested in it) and "calls" (number of times it was timed).
+ *
+ * @usage naev.profile( true ) -- Start profiling
+ * @usage stats = naev.profile( false ) -- Get results and stop
+ *
+ *    @luatparam[opt=false] boolean enable Whether or not to keep profiling.
+ *    @luatreturn table Results collected since the profiler was enabled.
+ * @luafunc profile
+ */
+static int naevL_profile( lua_State *L )
+{
+   int enable = lua_toboolean(L,1);
+   lua_newtable(L);
+   for (int i=0; i<PROFILE_ZONES; i++) {
+      lua_newtable(L);
+      lua_pushnumber( L, profile_time( i ) );
+      lua_setfield( L, -2, "time" );
+      lua_pushnumber( L, profile_timeSelf( i ) );
+      lua_setfield( L, -2, "self" );
+      lua_pushinteger( L, profile_calls( i ) );
+      lua_setfield( L, -2, "calls" );
+      lua_setfield( L, -2, profile_name( i ) );
+   }
+   if (enable && !profile_enabled)
+      profile_reset();
+   profile_enable( enable );
+   return 1;
+}
+
+/**
+ * @brief Writes the last profiled frames as a Chrome trace.
+ *
+ * The trace can be opened with chrome://tracing or https://ui.perfetto.dev. It
+ * contains the last parts of the game loop that were timed since the profiler
+ * was enabled with naev.profile().
+ *
+ * @usage naev.profile( true ) -- Start profiling, then play a bit
+ * @usage naev.profileTrace( "stutter.json" )
+ *
+ *    @luatparam[opt="profile.json"] string filename File to write to (relative to the write directory).
+ *    @luatreturn boolean Whether or not the trace was written.
+ * @luafunc profileTrace
+ */
+static int naevL_profileTrace( lua_State *L )
+{
+   const char *filename = luaL_optstring( L, 1, "profile.json" );
+   lua_pushboolean( L, profile_trace( filename )==0 );
+   return 1;
+}
+
+/**
+ * @brief Gets the scripts that took the most time and enables or disables accounting it.
+ *
+ * The time spent in each Lua environment (AI profile, mission, event, outfit,
+ * spawn script, etc.) is only accounted after having been enabled with this
+ * function or while a budget is set with the "lua_budget" option. Time spent in
+ * environments called from another one is only charged to the callee.
+ * Returns an ordered list of tables with the fields "name" (script that created
+ * the environment), "ms" (average milliseconds per frame), "worst" (most
+ * milliseconds in a single frame), "calls" (number of calls per frame) and
+ * "over" (frames over the budget).
+ *
+ * @usage naev.scriptStats( true ) -- Start accounting
+ * @usage for k,s in ipairs(naev.scriptStats( true, 5 )) do print( s.name, s.ms ) end -- Top 5 so far
+ *
+ *    @luatparam[opt=false] boolean enable Whether or not to keep accounting.
+ *    @luatparam[opt=10] number n Maximum number of scripts to return.
+ *    @luatreturn table Scripts that took the most time, most first.
+ * @luafunc scriptStats
+ */
+static int naevL_scriptStats( lua_State *L )
+{
+   NLuaEnvStats *stats = array_create( NLuaEnvStats );
+   int enable = lua_toboolean(L,1);
+   int n = luaL_optinteger(L,2,10);
+   int frames = MAX( 1, nlua_accountStats( &stats ) );
+   lua_newtable(L);
+   for (int i=0; i<MIN(n,array_size(stats)); i++) {
+      const NLuaEnvStats *st = &stats[i];
+      lua_newtable(L);
+      lua_pushstring( L, (st->name!=NULL) ? st->name : _("unknown") );
+      lua_setfield( L, -2, "name" );
+      lua_pushnumber( L, st->time * 1000. / frames );
+      lua_setfield( L, -2, "ms" );
+      lua_pushnumber( L, st->worst * 1000. );
+      lua_setfield( L, -2, "worst" );
+      lua_pushnumber( L, (double)st->calls / frames );
+      lua_setfield( L, -2, "calls" );
+      lua_pushinteger( L, st->over );
+      lua_setfield( L, -2, "over" );
+      lua_rawseti( L, -2, i+1 );
+   }
+   array_free( stats );
+   nlua_accountEnable( enable );
+   return 1;
+}
+
 #define PUSH_STRING( L, name, value ) \
 lua_pushstring( L, name ); \
 lua_pushstring( L, value ); \
@@ -842,4 +1055,68 @@ static int naevL_envs( lua_State *L )
    nlua_pushEnvTable( L );
    return 1;
 }
+
+/**
+ * @brief Creates or removes synthetic saves used to benchmark the load menu.
+ *
+ * The saves are copies of the current player's autosave. Only available in
+ * debug builds.
+ *
+ *    @luatparam[opt=0] number n Number of saves to create, or 0 to remove them.
+ *    @luatreturn number Number of saves created or removed.
+ * @luafunc savesBenchmark
+ */
+static int naevL_savesBenchmark( lua_State *L )
+{
+   int n = luaL_optinteger( L, 1, 0 );
+   int ret = load_benchmarkSaves( n );
+   if (ret < 0)
+      NLUA_ERROR(L, _("Unable to create benchmark saves."));
+   lua_pushinteger( L, ret );
+   return 1;
+}
+
+/**
+ * @brief Refreshes the list of saved games shown in the load menu.
+ *
+ * Normally only the start of each save is read, this is mainly useful to
+ * benchmark that against parsing the whole saves. Only available in debug
+ * builds.
+ *
+ *    @luatparam[opt=false] boolean full Whether or not to parse the whole saves.
+ *    @luatreturn number Number of saved games found.
+ * @luafunc savesRefresh
+ */
+static int naevL_savesRefresh( lua_State *L )
+{
+   lua_pushinteger( L, load_refreshFull( lua_toboolean(L,1) ) );
+   return 1;
+}
+
+/**
+ * @brief Runs game updates right away, without rendering anything.
+ *
+ * Meant for benchmark scripts run from the console that need the game to run
+ * for a while, it must not be called from hooks. Only available in debug
+ * builds.
+ *
+ *    @luatparam number ticks Number of updates to run.
+ *    @luatparam[opt=1/60] number dt Game time of each update in seconds.
+ * @luafunc simulate
+ */
+static int naevL_simulate( lua_State *L )
+{
+   static int running = 0;
+   int ticks = luaL_checkinteger( L, 1 );
+   double dt = luaL_optnumber( L, 2, 1./60. );
+   if ((player.p == NULL) || landed)
+      NLUA_ERROR(L, _("The game can only be simulated when the player is in space."));
+   if (running)
+      NLUA_ERROR(L, _("The game is already being simulated."));
+   running = 1;
+   for (int i=0; i<ticks; i++)
+      update_routine( dt, 0 );
+   running = 0;
+   return 0;
+}
 #endif /* DEBUGGING */
@@ -434,6 +434,10 @@ static int pilotL_setFlagWrapper( lua_State *L, int flag )
    else
       pilot_rmFlag( p, flag );
 
+   /* Visibility from any distance is tracked by the neighbourhood index. */
+   if ((flag == PILOT_VISIBLE) || (flag == PILOT_VISPLAYER))
+      pilot_nearbyInvalidate();
+
    return 0;
 }
 
@@ -951,7 +955,8 @@ static int pilotL_getPilots( lua_State *L )
  */
 static int pilotL_getFriendOrFoe( lua_State *L, int friend )
 {
-   int k;
+   int k, n;
+   const int *near;
    double dd, d2;
    Pilot *p;
    double dist;
@@ -990,10 +995,12 @@ static int pilotL_getFriendOrFoe( lua_State *L, int friend )
 
    /* Now put all the matching pilots in a table. */
    pilot_stack = pilot_getAll();
+   near = (dist >= 0.) ? pilot_nearbyRange( v->x, v->y, dist ) : NULL;
+   n = (near != NULL) ? array_size(near) : array_size(pilot_stack);
    lua_newtable(L);
    k = 1;
-   for (int i=0; i<array_size(pilot_stack); i++) {
-      Pilot *plt = pilot_stack[i];
+   for (int j=0; j<n; j++) {
+      Pilot *plt = pilot_stack[ (near != NULL) ? near[j] : j ];
 
       /* Check if dead. */
       if (pilot_isFlag(plt, PILOT_DELETE))
@@ -1144,16 +1151,18 @@ static int pilotL_getInrange( lua_State *L )
    vec2 *v = luaL_checkvector(L,1);
    double d = luaL_checknumber(L,2);
    int dis = lua_toboolean(L,3);
+   const int *near;
    Pilot *const* pilot_stack;
 
+   near = pilot_nearbyRange( v->x, v->y, d );
    d = pow2(d); /* Square it. */
 
    /* Now put all the matching pilots in a table. */
    pilot_stack = pilot_getAll();
    lua_newtable(L);
    k = 1;
-   for (int i=0; i<array_size(pilot_stack); i++) {
-      Pilot *p = pilot_stack[i];
+   for (int j=0; j<array_size(near); j++) {
+      Pilot *p = pilot_stack[ near[j] ];
 
       /* Check if dead. */
       if (pilot_isFlag(p, PILOT_DELETE))
@@ -2380,6 +2389,8 @@ static int pilotL_setPosition( lua_State *L )
 
    /* Warp pilot to new position. */
    p->solid->pos = *vec;
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
 
    /* Update if necessary. */
    if (pilot_isPlayer(p))
@@ -5304,6 +5315,7 @@ static int pilotL_leader( lua_State *L )
       Pilot *l = pilot_get( p->parent );
       if ((l == NULL) || pilot_isFlag( l, PILOT_DEAD )) {
          p->parent = 0; /* Clear parent for future calls. */
+         pilot_nearbyInvalidate();
          lua_pushnil(L);
       }
       else
@@ -5352,6 +5364,7 @@ static int pilotL_setLeader( lua_State *L )
    /* Just clear parent, will already be gone from parent escort list. */
    if (lua_isnoneornil(L, 2)) {
       p->parent = 0;
+      pilot_nearbyInvalidate();
    }
    else {
       PilotOutfitSlot* dockslot;
@@ -5405,6 +5418,9 @@ static int pilotL_setLeader( lua_State *L )
          escort_addList( leader, pe->ship->name, e->type, pe->id, 0 );
          escort_rmListIndex( p, i );
       }
+
+      /* Followers are always visible to their leader. */
+      pilot_nearbyInvalidate();
    }
 
    return 0;
@@ -5473,9 +5489,10 @@ static int pilotL_collisionTest( lua_State *L )
    if (lua_isasteroid(L,2)) {
       Asteroid *a = luaL_validasteroid( L, 2 );
       CollPoly rpoly;
-      RotatePolygon( &rpoly, a->polygon, (float) a->ang );
+      vec2 apos = asteroid_pos( a );
+      RotatePolygon( &rpoly, a->polygon, (float) asteroid_ang( a ) );
       int ret = CollidePolygon( getCollPoly(p), &p->solid->pos,
-            &rpoly, &a->pos, &crash );
+            &rpoly, &apos, &crash );
       free(rpoly.x);
       free(rpoly.y);
       if (!ret)
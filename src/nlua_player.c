@@ -49,6 +49,7 @@
 #include "player_fleet.h"
 #include "player_inventory.h"
 #include "save.h"
+#include "weapon.h"
 
 #define PLAYER_CHECK() if (player.p == NULL) return 0
 
@@ -913,6 +914,8 @@ static int playerL_land( lua_State *L )
       ovr_initAlpha();
    }
    player.p->solid->pos = spob->pos; /* Set position to target. */
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
 
    /* Do whatever the spob wants to do. */
    if (spob->lua_land != LUA_NOREF) {
@@ -1954,6 +1957,8 @@ static int playerL_teleport( lua_State *L )
    /* Move to spob. */
    if (pnt != NULL)
       player.p->solid->pos = pnt->pos;
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
 
    /* Move all escorts to new position. */
    Pilot *const* pilot_stack = pilot_getAll();
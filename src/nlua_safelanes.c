@@ -26,8 +26,10 @@
 
 /* diffs */
 static int safelanesL_get( lua_State *L );
+static int safelanesL_recalculate( lua_State *L );
 static const luaL_Reg safelanesL_methods[] = {
    { "get", safelanesL_get },
+   { "recalculate", safelanesL_recalculate },
    {0,0}
 }; /**< Safelane Lua methods. */
 
@@ -141,3 +143,23 @@ static int safelanesL_get( lua_State *L )
 
    return 1;
 }
+
+/**
+ * @brief Recalculates the safe lanes of the whole universe.
+ *
+ * This is done automatically when the universe changes, and is mainly useful for benchmarking.
+ *
+ * @usage safelanes.recalculate() -- Recalculate, reusing cached data when possible
+ * @usage safelanes.recalculate( true ) -- Recalculate from scratch
+ * @usage safelanes.recalculate( true, true ) -- Recalculate as on startup, loading the lanes from the disk cache if possible
+ *    @luatparam[opt=false] boolean cold Whether or not to discard the cached data first.
+ *    @luatparam[opt=false] boolean disk Whether or not a cold recalculation may use the lanes cached on disk.
+ * @luafunc recalculate
+ */
+static int safelanesL_recalculate( lua_State *L )
+{
+   if (lua_toboolean(L,1))
+      safelanes_invalidate( !lua_toboolean(L,2) );
+   safelanes_recalculate();
+   return 0;
+}
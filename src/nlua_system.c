@@ -28,6 +28,7 @@
 #include "nlua_spob.h"
 #include "nlua_vec2.h"
 #include "nluadef.h"
+#include "pathfind.h"
 #include "rng.h"
 #include "space.h"
 
@@ -487,6 +488,15 @@ static int systemL_jumpdistance( lua_State *L )
       return 1;
    }
 
+   /* Distances ignoring the player's knowledge are cached. */
+   if (k) {
+      const StarSystem *ssys = system_get( start );
+      const StarSystem *esys = system_get( goal );
+      int d = ((ssys==NULL) || (esys==NULL)) ? -1 : pathfind_jumpDist( ssys, esys, h );
+      lua_pushnumber(L, (d < 0) ? HUGE_VAL : (double)d);
+      return 1;
+   }
+
    s = map_getJumpPath( start, goal, k, h, NULL );
    if (s==NULL) {
       lua_pushnumber(L, HUGE_VAL);
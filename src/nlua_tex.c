@@ -39,6 +39,7 @@ static int texL_sprites( lua_State *L );
 static int texL_spriteFromDir( lua_State *L );
 static int texL_setFilter( lua_State *L );
 static int texL_setWrap( lua_State *L );
+static int texL_cacheStats( lua_State *L );
 static const luaL_Reg texL_methods[] = {
    { "__gc", texL_close },
    { "new", texL_new },
@@ -50,6 +51,7 @@ static const luaL_Reg texL_methods[] = {
    { "spriteFromDir", texL_spriteFromDir },
    { "setFilter", texL_setFilter },
    { "setWrap", texL_setWrap },
+   { "cacheStats", texL_cacheStats },
    {0,0}
 }; /**< Texture metatable methods. */
 
@@ -548,3 +550,32 @@ static int texL_setWrap( lua_State *L )
 
    return 0;
 }
+
+/**
+ * @brief Gets the statistics of the texture cache.
+ *
+ * The returned table has the fields "hits" and "misses" (number of texture
+ * loads that did or didn't find the texture already loaded), "textures"
+ * (number of textures in the cache), and "bytes" (estimated memory used by
+ * the cached textures).
+ *
+ * @usage stats = tex.cacheStats()
+ *
+ *    @luatreturn table Statistics of the texture cache.
+ * @luafunc cacheStats
+ */
+static int texL_cacheStats( lua_State *L )
+{
+   glTexCacheStats stats;
+   gl_texCacheStats( &stats );
+   lua_newtable(L);
+   lua_pushnumber( L, stats.hits );
+   lua_setfield( L, -2, "hits" );
+   lua_pushnumber( L, stats.misses );
+   lua_setfield( L, -2, "misses" );
+   lua_pushinteger( L, stats.textures );
+   lua_setfield( L, -2, "textures" );
+   lua_pushnumber( L, stats.bytes );
+   lua_setfield( L, -2, "bytes" );
+   return 1;
+}
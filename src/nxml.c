@@ -12,8 +12,48 @@
 
 #include "nxml.h"
 
+#include "array.h"
 #include "ndata.h"
 #include "nstring.h"
+#include "threadpool.h"
+
+/** @cond */
+#include "SDL_mutex.h"
+/** @endcond */
+
+#define XML_PARSE_CHUNK    8  /**< Files parsed by each threadpool job. */
+#define XML_PARSE_AHEAD    16 /**< Jobs to run ahead of the file being used. */
+
+/**
+ * @brief Files to be parsed by a threadpool job.
+ */
+typedef struct XmlParseJob_ {
+   struct XmlParseList_ *pl; /**< List the job belongs to. */
+   int start;           /**< First file to parse. */
+   int end;             /**< One past the last file to parse. */
+   int done;            /**< Whether the job has finished, protected by the list lock. */
+} XmlParseJob;
+
+/**
+ * @brief A list of files being parsed ahead of their use.
+ */
+struct XmlParseList_ {
+   char *const *files;  /**< Files to parse. */
+   int n;               /**< Number of files. */
+   const char *ext;     /**< Extension the files must have or NULL. */
+   XmlPrepareFunc prep; /**< Run on each parsed document on the threadpool, or NULL. */
+   void (*prep_free)( void *data ); /**< Frees unclaimed data returned by prep. */
+   xmlDocPtr *docs;     /**< Parsed documents not yet claimed. */
+   void **data;         /**< Data returned by prep not yet claimed. */
+   XmlParseJob *jobs;   /**< Jobs, one per XML_PARSE_CHUNK files. */
+   int njobs;           /**< Number of jobs. */
+   int queued;          /**< Number of jobs given to the threadpool so far. */
+   SDL_mutex *lock;     /**< Protects the done flag of the jobs. */
+   SDL_cond *cond;      /**< Signals a job finishing. */
+};
+
+static int xml_parseJob( void *data );
+static void xml_parseListQueue( XmlParseList *pl, int njobs );
 
 /**
  * @brief Parses a texture handling the sx and sy elements.
@@ -97,6 +137,145 @@ xmlDocPtr xml_parsePhysFS( const char* filename )
    return doc;
 }
 
+/**
+ * @brief Parses a chunk of files for an XmlParseList.
+ */
+static int xml_parseJob( void *data )
+{
+   XmlParseJob *job = (XmlParseJob*) data;
+   XmlParseList *pl = job->pl;
+   for (int i=job->start; i<job->end; i++) {
+      if ((pl->ext != NULL) && !ndata_matchExt( pl->files[i], pl->ext ))
+         continue;
+      pl->docs[i] = xml_parsePhysFS( pl->files[i] );
+      if ((pl->prep != NULL) && (pl->docs[i] != NULL))
+         pl->data[i] = pl->prep( pl->docs[i], pl->files[i] );
+   }
+   SDL_mutexP( pl->lock );
+   job->done = 1;
+   SDL_CondBroadcast( pl->cond );
+   SDL_mutexV( pl->lock );
+   return 0;
+}
+
+/**
+ * @brief Gives jobs to the threadpool until the first njobs are running.
+ */
+static void xml_parseListQueue( XmlParseList *pl, int njobs )
+{
+   njobs = MIN( njobs, pl->njobs );
+   while (pl->queued < njobs)
+      threadpool_newJob( xml_parseJob, &pl->jobs[ pl->queued++ ] );
+}
+
+/**
+ * @brief Starts reading and parsing a list of files on the threadpool.
+ *
+ * Files are parsed a bit ahead of the one being used, so only a limited
+ * amount of documents is in memory at once. They should be claimed with
+ * xml_parseListGet() in the order of the list and processed on the main
+ * thread.
+ *
+ *    @param files Array (array.h) of PhysFS file names, must outlive the list.
+ *    @param ext Extension the files have to match to be parsed or NULL to parse all.
+ *    @param prep Function run on the threadpool on each parsed document to
+ *           do work that doesn't need the main thread, or NULL.
+ *    @param prep_free Function to free data returned by prep that wasn't claimed.
+ *    @return The list being parsed, free with xml_parseListFree().
+ */
+XmlParseList* xml_parseListCreate( char *const *files, const char *ext,
+      XmlPrepareFunc prep, void (*prep_free)( void *data ) )
+{
+   XmlParseList *pl = calloc( 1, sizeof(XmlParseList) );
+   pl->files   = files;
+   pl->n       = array_size( files );
+   pl->ext     = ext;
+   pl->prep    = prep;
+   pl->prep_free = prep_free;
+   pl->docs    = calloc( MAX(pl->n,1), sizeof(xmlDocPtr) );
+   pl->data    = calloc( MAX(pl->n,1), sizeof(void*) );
+   pl->njobs   = (pl->n + XML_PARSE_CHUNK - 1) / XML_PARSE_CHUNK;
+   pl->jobs    = calloc( MAX(pl->njobs,1), sizeof(XmlParseJob) );
+   pl->lock    = SDL_CreateMutex();
+   pl->cond    = SDL_CreateCond();
+   for (int i=0; i<pl->njobs; i++) {
+      XmlParseJob *job = &pl->jobs[i];
+      job->pl     = pl;
+      job->start  = i * XML_PARSE_CHUNK;
+      job->end    = MIN( pl->n, job->start + XML_PARSE_CHUNK );
+   }
+   xml_parseListQueue( pl, XML_PARSE_AHEAD );
+   return pl;
+}
+
+/**
+ * @brief Claims a parsed document from a list, waiting for it if needed.
+ *
+ *    @param pl List to get the document from.
+ *    @param i Position of the file in the list.
+ *    @param[out] data Data returned by the prepare function or NULL, must be
+ *                freed by the caller. If NULL, the data is freed.
+ *    @return The document (must xmlFreeDoc) or NULL if the file was skipped or
+ *            failed to parse.
+ */
+xmlDocPtr xml_parseListGet( XmlParseList *pl, int i, void **data )
+{
+   XmlParseJob *job;
+   xmlDocPtr doc;
+
+   if (data != NULL)
+      *data = NULL;
+   if ((i < 0) || (i >= pl->n))
+      return NULL;
+
+   /* Keep the threadpool busy with the files coming up. */
+   job = &pl->jobs[ i / XML_PARSE_CHUNK ];
+   xml_parseListQueue( pl, i / XML_PARSE_CHUNK + 1 + XML_PARSE_AHEAD );
+   SDL_mutexP( pl->lock );
+   while (!job->done)
+      SDL_CondWait( pl->cond, pl->lock );
+   SDL_mutexV( pl->lock );
+
+   doc = pl->docs[i];
+   pl->docs[i] = NULL;
+   if (data != NULL)
+      *data = pl->data[i];
+   else if ((pl->data[i] != NULL) && (pl->prep_free != NULL))
+      pl->prep_free( pl->data[i] );
+   pl->data[i] = NULL;
+   return doc;
+}
+
+/**
+ * @brief Frees a list of parsed files, along with the documents not claimed.
+ *
+ *    @param pl List to free.
+ */
+void xml_parseListFree( XmlParseList *pl )
+{
+   if (pl == NULL)
+      return;
+
+   /* Jobs still running point to the list. */
+   SDL_mutexP( pl->lock );
+   for (int i=0; i<pl->queued; i++)
+      while (!pl->jobs[i].done)
+         SDL_CondWait( pl->cond, pl->lock );
+   SDL_mutexV( pl->lock );
+
+   for (int i=0; i<pl->n; i++) {
+      xmlFreeDoc( pl->docs[i] );
+      if ((pl->data[i] != NULL) && (pl->prep_free != NULL))
+         pl->prep_free( pl->data[i] );
+   }
+   SDL_DestroyCond( pl->cond );
+   SDL_DestroyMutex( pl->lock );
+   free( pl->jobs );
+   free( pl->docs );
+   free( pl->data );
+   free( pl );
+}
+
 int xmlw_saveTime( xmlTextWriterPtr writer, const char *name, time_t t )
 {
    xmlw_elem( writer, name, "%lu", t );
@@ -157,10 +157,24 @@ do {if (xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL) < 0) { \
 do {if (xmlTextWriterEndDocument(w) < 0) { \
    ERR("xmlw: unable to end document"); return -1; } } while (0)
 
+/**
+ * @brief Function run on the threadpool on each document of an XmlParseList.
+ *
+ *    @param doc Parsed document, must not be freed.
+ *    @param file File the document was parsed from.
+ *    @return Data handed to the main thread with the document.
+ */
+typedef void* (*XmlPrepareFunc)( xmlDocPtr doc, const char *file );
+typedef struct XmlParseList_ XmlParseList; /**< List of files parsed on the threadpool. */
+
 /*
  * Functions for generic complex reading.
  */
 xmlDocPtr xml_parsePhysFS( const char* filename );
+XmlParseList* xml_parseListCreate( char *const *files, const char *ext,
+      XmlPrepareFunc prep, void (*prep_free)( void *data ) );
+xmlDocPtr xml_parseListGet( XmlParseList *pl, int i, void **data );
+void xml_parseListFree( XmlParseList *pl );
 glTexture* xml_parseTexture( xmlNodePtr node,
       const char *path, int defsx, int defsy,
       const unsigned int flags );
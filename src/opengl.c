@@ -304,7 +304,8 @@ static int gl_getFullscreenMode (void)
  */
 static int gl_createWindow( unsigned int flags )
 {
-   flags |= SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI;
+   /* Headless runs still need a context to load the data, but nothing is shown. */
+   flags |= ((conf.headless!=NULL) ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN) | SDL_WINDOW_ALLOW_HIGHDPI;
    if (!conf.notresizable)
       flags |= SDL_WINDOW_RESIZABLE;
    if (conf.borderless)
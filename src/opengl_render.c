@@ -22,6 +22,13 @@
  *  raw commands.  In this third type, the (0.,0.) is actually in middle of the
  *  screen.  (-SCREEN_W/2.,-SCREEN_H/2.) is bottom left and
  *  (+SCREEN_W/2.,+SCREEN_H/2.) is top right.
+ *
+ * Textures can be batched by rendering them between gl_batchBegin() and
+ *  gl_batchEnd(). Instead of being drawn right away, the quads are then
+ *  transformed on the CPU and appended to a streaming VBO, which is drawn
+ *  all at once whenever the texture changes, the batch is full or it gets
+ *  flushed. Anything that is not a texture rendered inside a batch must call
+ *  gl_batchFlush() before drawing to keep the order.
  */
 /** @cond */
 #include "naev.h"
@@ -36,8 +43,11 @@
 #include "ndata.h"
 #include "nstring.h"
 #include "opengl.h"
+#include "rng.h"
 
 #define OPENGL_RENDER_VBO_SIZE      256 /**< Size of VBO. */
+#define OPENGL_BATCH_SIZE           512 /**< Maximum amount of quads in a sprite batch. */
+#define OPENGL_BATCH_VERTEX         8   /**< Floats per batched vertex: position, texture coordinates and colour. */
 
 static gl_vbo *gl_renderVBO = 0; /**< VBO for rendering stuff. */
 gl_vbo *gl_squareVBO = 0;
@@ -48,8 +58,28 @@ static gl_vbo *gl_triangleVBO = 0;
 static int gl_renderVBOtexOffset = 0; /**< VBO texture offset. */
 static int gl_renderVBOcolOffset = 0; /**< VBO colour offset. */
 
+/* Sprite batching. */
+static gl_vbo *gl_batchVBO = NULL; /**< Streaming VBO for the sprite batch. */
+static GLfloat *gl_batchData = NULL; /**< Vertices of the sprite batch, 6 per quad. */
+static int gl_batchDepth = 0; /**< How many times gl_batchBegin() was called without gl_batchEnd(). */
+static int gl_batchN = 0; /**< Number of quads in the batch. */
+static GLuint gl_batchTex = 0; /**< Texture being used by the batch. */
+static mat4 gl_batchView; /**< View matrix used by the batch. */
+
+/* Statistics. */
+static unsigned int gl_draws = 0; /**< Draw calls so far this frame. */
+static unsigned int gl_sprites = 0; /**< Textures rendered so far this frame. */
+static unsigned int gl_drawsLast = 0; /**< Draw calls of the previous frame. */
+static unsigned int gl_spritesLast = 0; /**< Textures rendered in the previous frame. */
+
+static void gl_batchAdd( GLuint texture, uint8_t flags,
+      double x, double y, double w, double h,
+      double tx, double ty, double tw, double th,
+      const glColour *c, double angle );
+
 void gl_beginSolidProgram(mat4 projection, const glColour *c)
 {
+   gl_batchFlush();
    glUseProgram(shaders.solid.program);
    glEnableVertexAttribArray(shaders.solid.vertex);
    gl_uniformColor(shaders.solid.color, c);
@@ -65,6 +95,7 @@ void gl_endSolidProgram (void)
 
 void gl_beginSmoothProgram(mat4 projection)
 {
+   gl_batchFlush();
    glUseProgram(shaders.smooth.program);
    glEnableVertexAttribArray(shaders.smooth.vertex);
    glEnableVertexAttribArray(shaders.smooth.vertex_color);
@@ -128,10 +159,12 @@ void gl_renderRectH( const mat4 *H, const glColour *c, int filled )
    if (filled) {
       gl_vboActivateAttribOffset( gl_squareVBO, shaders.solid.vertex, 0, 2, GL_FLOAT, 0 );
       glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+      gl_draws++;
    }
    else {
       gl_vboActivateAttribOffset( gl_squareEmptyVBO, shaders.solid.vertex, 0, 2, GL_FLOAT, 0 );
       glDrawArrays( GL_LINE_STRIP, 0, 5 );
+      gl_draws++;
    }
    gl_endSolidProgram();
 }
@@ -146,6 +179,7 @@ void gl_renderRectH( const mat4 *H, const glColour *c, int filled )
  */
 void gl_renderCross( double x, double y, double r, const glColour *c )
 {
+   gl_batchFlush();
    glUseProgram(shaders.crosshairs.program);
    glUniform1f(shaders.crosshairs.paramf, 1.); /* No outline. */
    gl_renderShader( x, y, r, r, 0., &shaders.crosshairs, c, 1 );
@@ -172,6 +206,7 @@ void gl_renderTriangleEmpty( double x, double y, double a, double s, double leng
    gl_beginSolidProgram(projection, c);
    gl_vboActivateAttribOffset( gl_triangleVBO, shaders.solid.vertex, 0, 2, GL_FLOAT, 0 );
    glDrawArrays( GL_LINE_STRIP, 0, 4 );
+   gl_draws++;
    gl_endSolidProgram();
 }
 
@@ -200,6 +235,14 @@ void gl_renderTextureRaw( GLuint texture, uint8_t flags,
    double hw, hh;
    mat4 projection, tex_mat;
 
+   gl_sprites++;
+
+   /* Defer to the batch if there is one. */
+   if (gl_batchDepth > 0) {
+      gl_batchAdd( texture, flags, x, y, w, h, tx, ty, tw, th, c, angle );
+      return;
+   }
+
    glUseProgram(shaders.texture.program);
 
    /* Bind the texture. */
@@ -240,6 +283,7 @@ void gl_renderTextureRaw( GLuint texture, uint8_t flags,
 
    /* Draw. */
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+   gl_draws++;
 
    /* Clear state. */
    glDisableVertexAttribArray( shaders.texture.vertex );
@@ -250,6 +294,221 @@ void gl_renderTextureRaw( GLuint texture, uint8_t flags,
    glUseProgram(0);
 }
 
+/**
+ * @brief Adds a texture to the sprite batch, flushing it if necessary.
+ *
+ * Parameters are the same as gl_renderTextureRaw().
+ */
+static void gl_batchAdd( GLuint texture, uint8_t flags,
+      double x, double y, double w, double h,
+      double tx, double ty, double tw, double th,
+      const glColour *c, double angle )
+{
+   static const double corners[6][2] = {
+      {0.,0.}, {1.,0.}, {0.,1.}, /* First triangle. */
+      {0.,1.}, {1.,0.}, {1.,1.}, /* Second triangle. */
+   };
+   double hw, hh, cs, sn;
+   GLfloat *v;
+
+   /* Batch can only hold one texture and view. */
+   if ((gl_batchN > 0) && ((gl_batchTex != texture) || (gl_batchN >= OPENGL_BATCH_SIZE) ||
+         (memcmp( &gl_batchView, &gl_view_matrix, sizeof(mat4) ) != 0)))
+      gl_batchFlush();
+   gl_batchTex  = texture;
+   gl_batchView = gl_view_matrix;
+
+   /* Must have colour for now. */
+   if (c == NULL)
+      c = &cWhite;
+
+   /* Same transformation as gl_renderTextureRaw(), but done here. */
+   hw = w/2.;
+   hh = h/2.;
+   cs = (angle==0.) ? 1. : cos(angle);
+   sn = (angle==0.) ? 0. : sin(angle);
+   v  = &gl_batchData[ gl_batchN * 6 * OPENGL_BATCH_VERTEX ];
+   for (int i=0; i<6; i++) {
+      double dx = corners[i][0]*w - hw;
+      double dy = corners[i][1]*h - hh;
+      double t  = ty + corners[i][1]*th;
+      v[0] = x + hw + cs*dx - sn*dy;
+      v[1] = y + hh + sn*dx + cs*dy;
+      v[2] = tx + corners[i][0]*tw;
+      v[3] = (flags & OPENGL_TEX_VFLIP) ? 1.-t : t;
+      v[4] = c->r;
+      v[5] = c->g;
+      v[6] = c->b;
+      v[7] = c->a;
+      v += OPENGL_BATCH_VERTEX;
+   }
+   gl_batchN++;
+}
+
+/**
+ * @brief Starts batching textures.
+ *
+ * Batches can be nested, textures are only drawn when the outermost batch
+ *  ends or when the batch gets flushed.
+ */
+void gl_batchBegin (void)
+{
+   gl_batchDepth++;
+}
+
+/**
+ * @brief Draws all the textures in the sprite batch.
+ */
+void gl_batchFlush (void)
+{
+   GLsizei stride = sizeof(GLfloat) * OPENGL_BATCH_VERTEX;
+
+   if (gl_batchN <= 0)
+      return;
+
+   glUseProgram(shaders.texture_batch.program);
+   glBindTexture( GL_TEXTURE_2D, gl_batchTex );
+
+   gl_vboData( gl_batchVBO, stride * 6 * gl_batchN, gl_batchData );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex_tex );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex_color );
+   gl_vboActivateAttribOffset( gl_batchVBO, shaders.texture_batch.vertex,
+         0, 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( gl_batchVBO, shaders.texture_batch.vertex_tex,
+         sizeof(GLfloat) * 2, 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( gl_batchVBO, shaders.texture_batch.vertex_color,
+         sizeof(GLfloat) * 4, 4, GL_FLOAT, stride );
+   gl_uniformMat4(shaders.texture_batch.projection, &gl_batchView);
+
+   /* Draw. */
+   glDrawArrays( GL_TRIANGLES, 0, 6 * gl_batchN );
+   gl_draws++;
+   gl_batchN = 0;
+
+   /* Clear state. */
+   glDisableVertexAttribArray( shaders.texture_batch.vertex );
+   glDisableVertexAttribArray( shaders.texture_batch.vertex_tex );
+   glDisableVertexAttribArray( shaders.texture_batch.vertex_color );
+
+   /* anything failed? */
+   gl_checkErr();
+
+   glUseProgram(0);
+}
+
+/**
+ * @brief Stops batching textures, drawing them if it was the outermost batch.
+ */
+void gl_batchEnd (void)
+{
+   if (gl_batchDepth <= 0) {
+      WARN(_("Ending a sprite batch that was not started!"));
+      return;
+   }
+   gl_batchDepth--;
+   if (gl_batchDepth == 0)
+      gl_batchFlush();
+}
+
+/**
+ * @brief Starts counting the draw calls of a new frame.
+ */
+void gl_drawStatsReset (void)
+{
+   gl_drawsLast   = gl_draws;
+   gl_spritesLast = gl_sprites;
+   gl_draws       = 0;
+   gl_sprites     = 0;
+}
+
+/**
+ * @brief Adds draw calls made outside of this file to the statistics.
+ *
+ *    @param draws Number of draw calls made.
+ */
+void gl_drawStatsAdd( unsigned int draws )
+{
+   gl_draws += draws;
+}
+
+/**
+ * @brief Gets the draw call statistics of the previous frame.
+ *
+ * Only draw calls made through the rendering routines in this file or
+ *  reported with gl_drawStatsAdd() are counted.
+ *
+ *    @param[out] draws Number of draw calls.
+ *    @param[out] sprites Number of textures rendered.
+ */
+void gl_drawStats( unsigned int *draws, unsigned int *sprites )
+{
+   *draws   = gl_drawsLast;
+   *sprites = gl_spritesLast;
+}
+
+#if DEBUGGING
+/**
+ * @brief Benchmarks rendering many sprites with and without batching.
+ *
+ * Sprites are rendered rotated at random positions on the screen, the frame
+ *  is finished before stopping the timers so the GPU time is included.
+ *
+ *    @param tex Texture to use as a sprite sheet.
+ *    @param n Number of sprites to render.
+ *    @param reps Number of times to render all the sprites.
+ *    @param[out] immediate Time in seconds taken rendering one by one.
+ *    @param[out] batched Time in seconds taken rendering in batches.
+ *    @param[out] draws_immediate Draw calls per repetition one by one.
+ *    @param[out] draws_batched Draw calls per repetition in batches.
+ */
+void gl_benchmarkSprites( const glTexture *tex, int n, int reps,
+      double *immediate, double *batched,
+      unsigned int *draws_immediate, unsigned int *draws_batched )
+{
+   double *data = malloc( 5 * n * sizeof(double) );
+   for (int i=0; i<n; i++) {
+      int sx = RNG( 0, (int)tex->sx-1 );
+      int sy = RNG( 0, (int)tex->sy-1 );
+      data[5*i+0] = RNGF() * SCREEN_W;
+      data[5*i+1] = RNGF() * SCREEN_H;
+      data[5*i+2] = RNGF() * 2. * M_PI;
+      data[5*i+3] = tex->sw*(double)sx/tex->w;
+      data[5*i+4] = tex->sh*(tex->sy-(double)sy-1)/tex->h;
+   }
+
+   for (int b=0; b<2; b++) {
+      unsigned int draws = gl_draws;
+      Uint64 t;
+
+      glFinish();
+      t = SDL_GetPerformanceCounter();
+      for (int r=0; r<reps; r++) {
+         if (b)
+            gl_batchBegin();
+         for (int i=0; i<n; i++)
+            gl_renderTexture( tex, data[5*i+0], data[5*i+1], tex->sw, tex->sh,
+                  data[5*i+3], data[5*i+4], tex->srw, tex->srh, NULL, data[5*i+2] );
+         if (b)
+            gl_batchEnd();
+      }
+      glFinish();
+      t = SDL_GetPerformanceCounter() - t;
+
+      if (b) {
+         *batched = (double)t / (double)SDL_GetPerformanceFrequency();
+         *draws_batched = (gl_draws - draws) / MAX(reps,1);
+      }
+      else {
+         *immediate = (double)t / (double)SDL_GetPerformanceFrequency();
+         *draws_immediate = (gl_draws - draws) / MAX(reps,1);
+      }
+   }
+
+   free( data );
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief Texture blitting backend.
  *
@@ -312,6 +571,10 @@ void gl_renderTextureInterpolate(  const glTexture* ta,
       return;
    }
 
+   /* Can't be batched. */
+   gl_batchFlush();
+   gl_sprites++;
+
    mat4 projection, tex_mat;
 
    glUseProgram(shaders.texture_interpolate.program);
@@ -349,6 +612,7 @@ void gl_renderTextureInterpolate(  const glTexture* ta,
 
    /* Draw. */
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+   gl_draws++;
 
    /* Clear state. */
    glDisableVertexAttribArray( shaders.texture_interpolate.vertex );
@@ -910,6 +1174,7 @@ void gl_renderShaderH( const SimpleShader *shd, const mat4 *H, const glColour *c
    gl_uniformMat4(shd->projection, H);
 
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+   gl_draws++;
 
    glDisableVertexAttribArray(shd->vertex);
    glUseProgram(0);
@@ -949,6 +1214,7 @@ void gl_renderCircleH( const mat4 *H, const glColour *c, int filled )
    // TODO handle shearing and different x/y scaling
    GLfloat r = H->m[0][0] / gl_view_matrix.m[0][0];
 
+   gl_batchFlush();
    glUseProgram( shaders.circle.program );
    glUniform2f( shaders.circle.dimensions, r, r );
    glUniform1i( shaders.circle.parami, filled );
@@ -970,6 +1236,7 @@ void gl_renderLine( double x1, double y1,
    double a = atan2( y2-y1, x2-x1 );
    double s = hypotf( x2-x1, y2-y1 );
 
+   gl_batchFlush();
    glUseProgram(shaders.sdfsolid.program);
    glUniform1f(shaders.sdfsolid.paramf, 1.); /* No outline. */
    gl_renderShader( (x1+x2)/2., (y1+y2)/2., s/2.+0.5, 1.0, a, &shaders.sdfsolid, c, 1 );
@@ -990,6 +1257,7 @@ void gl_clipRect( int x, int y, int w, int h )
    ry = (y + gl_screen.y) / gl_screen.myscale;
    rw = w / gl_screen.mxscale;
    rh = h / gl_screen.myscale;
+   gl_batchFlush();
    glScissor( rx, ry, rw, rh );
    glEnable( GL_SCISSOR_TEST );
 }
@@ -999,6 +1267,7 @@ void gl_clipRect( int x, int y, int w, int h )
  */
 void gl_unclipRect (void)
 {
+   gl_batchFlush();
    glDisable( GL_SCISSOR_TEST );
    glScissor( 0, 0, gl_screen.rw, gl_screen.rh );
 }
@@ -1066,6 +1335,11 @@ int gl_initRender (void)
    vertex[7] = vertex[1];
    gl_triangleVBO = gl_vboCreateStatic( sizeof(GLfloat) * 8, vertex );
 
+   /* Sprite batch. */
+   gl_batchData = malloc( sizeof(GLfloat) * OPENGL_BATCH_SIZE * 6 * OPENGL_BATCH_VERTEX );
+   gl_batchVBO = gl_vboCreateStream( sizeof(GLfloat) *
+         OPENGL_BATCH_SIZE * 6 * OPENGL_BATCH_VERTEX, NULL );
+
    gl_checkErr();
 
    return 0;
@@ -1083,5 +1357,9 @@ void gl_exitRender (void)
    gl_vboDestroy( gl_squareEmptyVBO );
    gl_vboDestroy( gl_lineVBO );
    gl_vboDestroy( gl_triangleVBO );
+   gl_vboDestroy( gl_batchVBO );
    gl_renderVBO = NULL;
+   gl_batchVBO = NULL;
+   free( gl_batchData );
+   gl_batchData = NULL;
 }
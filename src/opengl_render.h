@@ -123,3 +123,18 @@ void gl_renderTriangleEmpty( double x, double y, double a, double s, double leng
 /* Clipping. */
 void gl_clipRect( int x, int y, int w, int h );
 void gl_unclipRect (void);
+
+/* Sprite batching. */
+void gl_batchBegin (void);
+void gl_batchFlush (void);
+void gl_batchEnd (void);
+
+/* Statistics. */
+void gl_drawStatsReset (void);
+void gl_drawStatsAdd( unsigned int draws );
+void gl_drawStats( unsigned int *draws, unsigned int *sprites );
+#if DEBUGGING
+void gl_benchmarkSprites( const glTexture *tex, int n, int reps,
+      double *immediate, double *batched,
+      unsigned int *draws_immediate, unsigned int *draws_batched );
+#endif /* DEBUGGING */
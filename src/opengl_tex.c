@@ -24,15 +24,17 @@
 #include "nstring.h"
 #include "opengl.h"
 
+#define TEX_CACHE_MIN  256 /**< Minimum amount of slots in the texture cache. */
+
 /*
- * graphic list
+ * graphic cache
  */
 /**
- * @brief Represents a node in the texture list.
+ * @brief Represents a slot in the texture cache.
  */
 typedef struct glTexList_ {
-   struct glTexList_ *next; /**< Next in linked list */
-   glTexture *tex; /**< associated texture */
+   glTexture *tex; /**< associated texture, NULL if the slot is empty */
+   uint32_t hash; /**< hash of the texture name */
    int used; /**< counts how many times texture is being used */
    /* TODO We currently treat images with different number of sprites as
     * different images, i.e., they get reloaded and use more memory. However,
@@ -41,7 +43,15 @@ typedef struct glTexList_ {
    int sx; /**< X sprites */
    int sy; /**< Y sprites */
 } glTexList;
-static glTexList* texture_list = NULL; /**< Texture list. */
+/**
+ * Open addressing hash table (linear probing) of named textures. Slots are
+ *  indexed by the hash of the name only, so that textures can also be found by
+ *  pointer for reference counting.
+ */
+static glTexList* texture_list = NULL; /**< Texture cache slots. */
+static int texture_ncap = 0; /**< Number of slots in the texture cache (power of two). */
+static int texture_n = 0; /**< Number of textures in the texture cache. */
+static glTexCacheStats texture_stats; /**< Texture cache statistics. */
 
 /*
  * prototypes
@@ -56,6 +66,10 @@ static GLuint gl_loadSurface( SDL_Surface* surface, unsigned int flags, int free
 static glTexture* gl_loadNewImage( const char* path, unsigned int flags );
 static glTexture* gl_loadNewImageRWops( const char *path, SDL_RWops *rw, unsigned int flags );
 /* List. */
+static uint32_t gl_texHash( const char *name );
+static glTexList* gl_texFind( const glTexture *tex );
+static void gl_texRemove( glTexList *slot );
+static void gl_texGrow (void);
 static glTexture* gl_texExists( const char* path, int sx, int sy );
 static int gl_texAdd( glTexture *tex, int sx, int sy );
 
@@ -420,8 +434,9 @@ glTexture* gl_loadImagePadTrans( const char *name, SDL_Surface* surface, SDL_RWo
       }
    }
 
+   /* Already looked up above, don't count a second miss. */
    if (texture == NULL)
-      texture = gl_loadImagePad( name, surface, flags, w, h, sx, sy, freesur );
+      texture = gl_loadImagePad( name, surface, flags | OPENGL_TEX_SKIPCACHE, w, h, sx, sy, freesur );
    else if (freesur)
       SDL_FreeSurface( surface );
    texture->trans = trans;
@@ -454,7 +469,7 @@ glTexture* gl_loadImagePad( const char *name, SDL_Surface* surface,
    }
 
    if (flags & OPENGL_TEX_MAPTRANS)
-      return gl_loadImagePadTrans( name, surface, NULL, flags, w, h,
+      return gl_loadImagePadTrans( name, surface, NULL, flags | OPENGL_TEX_SKIPCACHE, w, h,
             sx, sy, freesur );
 
    /* set up the texture defaults */
@@ -495,10 +510,103 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
    return gl_loadImagePad( NULL, surface, flags, surface->w, surface->h, 1, 1, 1 );
 }
 
+/**
+ * @brief Hashes a texture name (FNV-1a).
+ *
+ *    @param name Name to hash.
+ *    @return Hash of the name.
+ */
+static uint32_t gl_texHash( const char *name )
+{
+   uint32_t h = 2166136261u;
+   for (const unsigned char *c=(const unsigned char*)name; *c!='\0'; c++) {
+      h ^= *c;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/**
+ * @brief Finds the cache slot of a texture.
+ *
+ *    @param tex Texture to find.
+ *    @return The slot of the texture or NULL if not cached.
+ */
+static glTexList* gl_texFind( const glTexture *tex )
+{
+   uint32_t mask;
+
+   if ((tex->name == NULL) || (texture_n == 0))
+      return NULL;
+
+   mask = texture_ncap-1;
+   for (uint32_t i=gl_texHash(tex->name)&mask; texture_list[i].tex!=NULL; i=(i+1)&mask)
+      if (texture_list[i].tex == tex)
+         return &texture_list[i];
+   return NULL;
+}
+
+/**
+ * @brief Removes a slot from the texture cache.
+ *
+ * Entries after it in the probe sequence are shifted back so that there is no
+ *  need for tombstones.
+ *
+ *    @param slot Slot to remove.
+ */
+static void gl_texRemove( glTexList *slot )
+{
+   uint32_t mask = texture_ncap-1;
+   uint32_t i = slot - texture_list;
+   uint32_t j = i;
+
+   while (1) {
+      uint32_t k;
+      j = (j+1) & mask;
+      if (texture_list[j].tex == NULL)
+         break;
+      /* Move the entry back if its home slot is not in (i,j]. */
+      k = texture_list[j].hash & mask;
+      if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+         continue;
+      texture_list[i] = texture_list[j];
+      i = j;
+   }
+   memset( &texture_list[i], 0, sizeof(glTexList) );
+   texture_n--;
+}
+
+/**
+ * @brief Makes sure there is room for another texture in the cache.
+ */
+static void gl_texGrow (void)
+{
+   glTexList *old = texture_list;
+   int oldcap = texture_ncap;
+
+   /* Keep the load factor under 0.5. */
+   if (2*(texture_n+1) <= texture_ncap)
+      return;
+
+   texture_ncap = MAX( TEX_CACHE_MIN, 2*oldcap );
+   texture_list = calloc( texture_ncap, sizeof(glTexList) );
+   for (int i=0; i<oldcap; i++) {
+      uint32_t mask = texture_ncap-1;
+      uint32_t j;
+      if (old[i].tex == NULL)
+         continue;
+      for (j=old[i].hash&mask; texture_list[j].tex!=NULL; j=(j+1)&mask);
+      texture_list[j] = old[i];
+   }
+   free( old );
+}
+
 /**
  * @brief Check to see if a texture matching a path already exists.
  *
- * Note this increments the used counter if it exists.
+ * Note this increments the used counter if it exists. Every call counts as a
+ * hit or a miss, so loaders that already looked a texture up pass
+ * OPENGL_TEX_SKIPCACHE to the functions they call.
  *
  *    @param path Path to the texture.
  *    @param sx X sprites.
@@ -507,53 +615,54 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
  */
 static glTexture* gl_texExists( const char* path, int sx, int sy )
 {
+   uint32_t mask;
+
    /* Null does never exist. */
    if (path==NULL)
       return NULL;
 
    /* check to see if it already exists */
-   if (texture_list == NULL)
-      return NULL;
-
-   for (glTexList *cur=texture_list; cur!=NULL; cur=cur->next) {
-      /* Must match filename. */
-      if (strcmp(path,cur->tex->name)!=0)
-         continue;
-      /* Must match size. */
-      if ((cur->sx!=sx) || (cur->sy!=sy))
-         continue;
-
-      /* Use new texture. */
-      cur->used++;
-      return cur->tex;
+   if (texture_n > 0) {
+      mask = texture_ncap-1;
+      for (uint32_t i=gl_texHash(path)&mask; texture_list[i].tex!=NULL; i=(i+1)&mask) {
+         glTexList *cur = &texture_list[i];
+         /* Must match filename. */
+         if (strcmp(path,cur->tex->name)!=0)
+            continue;
+         /* Must match size. */
+         if ((cur->sx!=sx) || (cur->sy!=sy))
+            continue;
+
+         /* Use new texture. */
+         cur->used++;
+         texture_stats.hits++;
+         return cur->tex;
+      }
    }
 
+   texture_stats.misses++;
    return NULL;
 }
 
 /**
- * @brief Adds a texture to the list under the name of path.
+ * @brief Adds a texture to the cache under the name of path.
  */
 static int gl_texAdd( glTexture *tex, int sx, int sy )
 {
-   glTexList *new, *last = texture_list;
+   uint32_t mask, i, h;
 
-   /* Create the new node */
-   new = malloc( sizeof(glTexList) );
-   new->next = NULL;
-   new->used = 1;
-   new->tex  = tex;
-   new->sx   = sx;
-   new->sy   = sy;
+   gl_texGrow();
 
-   if (texture_list == NULL) /* special condition - creating new list */
-      texture_list = new;
-   else {
-      while (last->next != NULL)
-         last = last->next;
-
-      last->next = new;
-   }
+   /* Goes after any other texture with the same name. */
+   h     = gl_texHash( tex->name );
+   mask  = texture_ncap-1;
+   for (i=h&mask; texture_list[i].tex!=NULL; i=(i+1)&mask);
+   texture_list[i].tex  = tex;
+   texture_list[i].hash = h;
+   texture_list[i].used = 1;
+   texture_list[i].sx   = sx;
+   texture_list[i].sy   = sy;
+   texture_n++;
 
    return 0;
 }
@@ -576,8 +685,8 @@ glTexture* gl_newImage( const char* path, const unsigned int flags )
          return t;
    }
 
-   /* Load the image */
-   return gl_loadNewImage( path, flags );
+   /* Load the image, the cache was already checked. */
+   return gl_loadNewImage( path, flags | OPENGL_TEX_SKIPCACHE );
 }
 
 /**
@@ -601,8 +710,8 @@ glTexture* gl_newImageRWops( const char* path, SDL_RWops *rw, const unsigned int
          return t;
    }
 
-   /* Load the image */
-   return gl_loadNewImageRWops( path, rw, flags );
+   /* Load the image, the cache was already checked. */
+   return gl_loadNewImageRWops( path, rw, flags | OPENGL_TEX_SKIPCACHE );
 }
 
 /**
@@ -709,6 +818,49 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
    return texture;
 }
 
+/**
+ * @brief Loads an already decoded image as a sprite.
+ *
+ * Same as gl_newSprite(), but the image can be decoded on another thread.
+ *
+ *    @param path Image name for deduplication.
+ *    @param surface Decoded image, gets freed.
+ *    @param sx Number of X sprites in image.
+ *    @param sy Number of Y sprites in image.
+ *    @param flags Flags to control image parameters.
+ *    @return Texture loaded.
+ */
+glTexture* gl_newSpriteSurface( const char* path, SDL_Surface *surface,
+   const int sx, const int sy, const unsigned int flags )
+{
+   glTexture* texture;
+
+   /* Check if it already exists. */
+   if (!(flags & OPENGL_TEX_SKIPCACHE)) {
+      texture = gl_texExists( path, sx, sy );
+      if (texture != NULL) {
+         SDL_FreeSurface( surface );
+         return texture;
+      }
+   }
+
+   /* Create new image, same as gl_loadNewImageRWops(). */
+   texture = gl_loadImagePad( path, surface, flags | OPENGL_TEX_SKIPCACHE | OPENGL_TEX_VFLIP,
+         surface->w, surface->h, 1, 1, 1 );
+   if (texture == NULL)
+      return NULL;
+
+   /* will possibly overwrite an existing texture properties
+    * so we have to load same texture always the same sprites */
+   texture->sx    = (double) sx;
+   texture->sy    = (double) sy;
+   texture->sw    = texture->w / texture->sx;
+   texture->sh    = texture->h / texture->sy;
+   texture->srw   = texture->sw / texture->w;
+   texture->srh   = texture->sh / texture->h;
+   return texture;
+}
+
 /**
  * @brief Loads the texture immediately, but also sets it as a sprite.
  *
@@ -754,37 +906,26 @@ glTexture* gl_newSpriteRWops( const char* path, SDL_RWops *rw,
  */
 void gl_freeTexture( glTexture *texture )
 {
-   glTexList *last;
+   glTexList *cur;
 
    if (texture == NULL)
       return;
 
-   /* see if we can find it in stack */
-   last = NULL;
-   for (glTexList *cur=texture_list; cur!=NULL; cur=cur->next) {
-      if (cur->tex == texture) { /* found it */
-         cur->used--;
-         if (cur->used <= 0) { /* not used anymore */
-            /* free the texture */
-            glDeleteTextures( 1, &texture->texture );
-            free(texture->trans);
-            free(texture->name);
-            free(texture);
-
-            /* free the list node */
-            if (last == NULL) { /* case there's no texture before it */
-               if (cur->next != NULL)
-                  texture_list = cur->next;
-               else /* case it's the last texture */
-                  texture_list = NULL;
-            }
-            else
-               last->next = cur->next;
-            free(cur);
-         }
-         return; /* we already found it so we can exit */
+   /* see if we can find it in the cache */
+   cur = gl_texFind( texture );
+   if (cur != NULL) {
+      cur->used--;
+      if (cur->used <= 0) { /* not used anymore */
+         /* free the cache slot */
+         gl_texRemove( cur );
+
+         /* free the texture */
+         glDeleteTextures( 1, &texture->texture );
+         free(texture->trans);
+         free(texture->name);
+         free(texture);
       }
-      last = cur;
+      return; /* we already found it so we can exit */
    }
 
    /* Not found */
@@ -808,18 +949,17 @@ void gl_freeTexture( glTexture *texture )
  */
 glTexture* gl_dupTexture( const glTexture *texture )
 {
+   glTexList *cur;
+
    /* No segfaults kthxbye. */
    if (texture == NULL)
       return NULL;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (glTexList *cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (texture == cur->tex) {
-            cur->used++;
-            return cur->tex;
-         }
-      }
+   cur = gl_texFind( texture );
+   if (cur != NULL) {
+      cur->used++;
+      return cur->tex;
    }
 
    /* Invalid texture. */
@@ -921,10 +1061,44 @@ int gl_initTextures (void)
 void gl_exitTextures (void)
 {
    /* Make sure there's no texture leak */
-   if (texture_list != NULL) {
+   if (texture_n > 0) {
       DEBUG(_("Texture leak detected!"));
-      for (glTexList *tex=texture_list; tex!=NULL; tex=tex->next)
+      for (int i=0; i<texture_ncap; i++) {
+         const glTexList *tex = &texture_list[i];
+         if (tex->tex == NULL)
+            continue;
          DEBUG( n_( "   '%s' opened %d time", "   '%s' opened %d times", tex->used ), tex->tex->name, tex->used );
+      }
+   }
+   else {
+      free( texture_list );
+      texture_list = NULL;
+      texture_ncap = 0;
+   }
+}
+
+/**
+ * @brief Gets the texture cache statistics.
+ *
+ *    @param[out] stats Statistics of the texture cache.
+ */
+void gl_texCacheStats( glTexCacheStats *stats )
+{
+   *stats = texture_stats;
+   stats->textures = texture_n;
+   stats->bytes    = 0;
+   for (int i=0; i<texture_ncap; i++) {
+      const glTexture *tex = texture_list[i].tex;
+      size_t bytes;
+      if (tex == NULL)
+         continue;
+      /* Assume 8 bits per channel RGBA, mipmaps add a third. */
+      bytes = 4 * (size_t)tex->w * (size_t)tex->h;
+      if (tex->flags & OPENGL_TEX_MIPMAPS)
+         bytes += bytes / 3;
+      if (tex->trans != NULL)
+         bytes += gl_transSize( (int)tex->w, (int)tex->h );
+      stats->bytes += bytes;
    }
 }
 
@@ -54,6 +54,16 @@ typedef struct glTexture_ {
    uint8_t flags; /**< flags used for texture properties */
 } glTexture;
 
+/**
+ * @brief Statistics of the texture cache.
+ */
+typedef struct glTexCacheStats_ {
+   long hits; /**< Times a texture was found in the cache. */
+   long misses; /**< Times a texture was not found in the cache. */
+   int textures; /**< Textures in the cache. */
+   size_t bytes; /**< Estimated memory used by the textures in the cache. */
+} glTexCacheStats;
+
 /*
  * Init/exit.
  */
@@ -73,6 +83,8 @@ glTexture* gl_newImage( const char* path, const unsigned int flags );
 glTexture* gl_newImageRWops( const char* path, SDL_RWops *rw, const unsigned int flags ); /* Does not close the RWops. */
 glTexture* gl_newSprite( const char* path, const int sx, const int sy,
       const unsigned int flags );
+glTexture* gl_newSpriteSurface( const char* path, SDL_Surface *surface,
+      const int sx, const int sy, const unsigned int flags );
 glTexture* gl_newSpriteRWops( const char* path, SDL_RWops *rw,
    const int sx, const int sy, const unsigned int flags );
 glTexture* gl_dupTexture( const glTexture *texture );
@@ -94,3 +106,4 @@ int gl_isTrans( const glTexture* t, const int x, const int y );
 void gl_getSpriteFromDir( int* x, int* y, const glTexture* t, const double dir );
 glTexture** gl_copyTexArray( glTexture **tex, int *n );
 glTexture** gl_addTexArray( glTexture **tex, int *n, glTexture *t );
+void gl_texCacheStats( glTexCacheStats *stats );
@@ -25,6 +25,7 @@
 #include "damagetype.h"
 #include "log.h"
 #include "mapData.h"
+#include "nameindex.h"
 #include "ndata.h"
 #include "nfile.h"
 #include "nlua.h"
@@ -53,6 +54,7 @@
  * the stack
  */
 static Outfit* outfit_stack = NULL; /**< Stack of outfits. */
+static NameIndex outfit_index; /**< Outfits indexed by name. */
 static char **license_stack = NULL; /**< Stack of available licenses. */
 
 /*
@@ -87,7 +89,7 @@ static OutfitType outfit_strToOutfitType( char *buf );
 /* parsing */
 static int outfit_loadDir( char *dir );
 static int outfit_parseDamage( Damage *dmg, xmlNodePtr node );
-static int outfit_parse( Outfit* temp, const char* file );
+static int outfit_parse( Outfit* temp, xmlDocPtr doc, const char* file );
 static void outfit_parseSBolt( Outfit* temp, const xmlNodePtr parent );
 static void outfit_parseSBeam( Outfit* temp, const xmlNodePtr parent );
 static void outfit_parseSLauncher( Outfit* temp, const xmlNodePtr parent );
@@ -131,8 +133,10 @@ const Outfit* outfit_get( const char* name )
  */
 const Outfit* outfit_getW( const char* name )
 {
-   const Outfit s = {.name = (char*)name };
-   return bsearch( &s, outfit_stack, array_size(outfit_stack), sizeof(Outfit), outfit_cmp );
+   int id = nameindex_get( &outfit_index, name );
+   if (id < 0)
+      return NULL;
+   return &outfit_stack[id];
 }
 
 /**
@@ -2200,17 +2204,17 @@ if (o) WARN(_("Outfit '%s' missing/invalid '%s' element"), temp->name, s)
  * @brief Parses and returns Outfit from parent node.
 
  *    @param temp Outfit to load into.
+ *    @param doc Parsed XML of the outfit, gets freed.
  *    @param file Path to the XML file (relative to base directory).
  *    @return 0 on success.
  */
-static int outfit_parse( Outfit* temp, const char* file )
+static int outfit_parse( Outfit* temp, xmlDocPtr doc, const char* file )
 {
    xmlNodePtr node, parent;
    char *prop, *desc_extra;
    const char *cprop;
    int group, l;
 
-   xmlDocPtr doc = xml_parsePhysFS( file );
    if (doc == NULL)
       return -1;
 
@@ -2485,18 +2489,21 @@ if (o) WARN( _("Outfit '%s' missing/invalid '%s' element"), temp->name, s) /**<
 static int outfit_loadDir( char *dir )
 {
    char **outfit_files = ndata_listRecursive( dir );
+   XmlParseList *outfit_docs = xml_parseListCreate( outfit_files, "xml", NULL, NULL );
    for (int i=0; i < array_size( outfit_files ); i++) {
       if (ndata_matchExt( outfit_files[i], "xml" )) {
          Outfit o;
-         int ret = outfit_parse( &o, outfit_files[i] );
+         int ret = outfit_parse( &o, xml_parseListGet( outfit_docs, i, NULL ), outfit_files[i] );
          if (ret == 0)
             array_push_back( &outfit_stack, o );
 
          /* Render if necessary. */
          naev_renderLoadscreen();
       }
-      free( outfit_files[i] );
    }
+   xml_parseListFree( outfit_docs );
+   for (int i=0; i < array_size( outfit_files ); i++)
+      free( outfit_files[i] );
    array_free( outfit_files );
 
    return 0;
@@ -2519,6 +2526,10 @@ int outfit_load (void)
    noutfits = array_size(outfit_stack);
    /* Sort up licenses. */
    qsort( outfit_stack, noutfits, sizeof(Outfit), outfit_cmp );
+   nameindex_init( &outfit_index );
+   nameindex_reserve( &outfit_index, noutfits );
+   for (int i=0; i<noutfits; i++)
+      nameindex_add( &outfit_index, outfit_stack[i].name, i );
    if (license_stack != NULL)
       qsort( license_stack, array_size(license_stack), sizeof(char*), strsort );
 
@@ -2831,4 +2842,5 @@ void outfit_free (void)
 
    array_free(outfit_stack);
    array_free(license_stack);
+   nameindex_free( &outfit_index );
 }
@@ -0,0 +1,347 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file pathfind.c
+ *
+ * @brief Finds paths through the jump network.
+ *
+ * Every jump costs the same, so there is no admissible heuristic and the
+ * search is really Dijkstra's algorithm. Nodes are kept in flat arrays indexed
+ * by the system id and the open set is an indexed binary heap. Ties are
+ * broken by the order in which the systems were opened, which gives the same
+ * paths as the old linked list implementation.
+ *
+ * Hop distances ignoring the player's knowledge only change when the jumps
+ * themselves change, so they are computed one breadth-first search per start
+ * system on demand and cached until pathfind_invalidate() is called.
+ */
+/** @cond */
+#include <stdlib.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "pathfind.h"
+
+#include "array.h"
+
+/**
+ * @brief State of a system during the search.
+ */
+typedef enum PathState_ {
+   PATH_NONE,  /**< Not reached yet. */
+   PATH_OPEN,  /**< In the open set (heap). */
+   PATH_CLOSED,/**< Shortest path found. */
+} PathState;
+
+/**
+ * @brief Node of the search, indexed by system id.
+ */
+typedef struct PathNode_ {
+   int g;         /**< Jumps from the start. */
+   int parent;    /**< System id of the previous system in the path. */
+   int order;     /**< When the node was opened, used to break ties. */
+   int heap;      /**< Position in the heap. */
+   PathState state; /**< State of the node. */
+} PathNode;
+
+static PathNode *path_nodes = NULL; /**< Array (array.h): Nodes of the search. */
+static int *path_heap   = NULL; /**< Array (array.h): Open set as a binary heap of system ids. */
+
+static int *path_hops[2] = { NULL, NULL }; /**< Hop distances without and with hidden jumps, row per start system. */
+static char *path_hopsValid[2] = { NULL, NULL }; /**< Whether or not each row of path_hops was computed. */
+static int path_hopsN   = 0; /**< Number of systems path_hops was allocated for. */
+
+/*
+ * Prototypes.
+ */
+static int path_jumpUsable( const JumpPoint *jp, int ignore_known, int show_hidden );
+static int path_less( int a, int b );
+static void path_heapSwap( int i, int j );
+static void path_heapUp( int i );
+static void path_heapDown( int i );
+static int path_heapPop (void);
+static void path_hopsRow( int s, int show_hidden );
+
+/**
+ * @brief Checks to see if a jump can be used for pathfinding.
+ */
+static int path_jumpUsable( const JumpPoint *jp, int ignore_known, int show_hidden )
+{
+   /* Make sure it's reachable */
+   if (!ignore_known) {
+      if (!jp_isKnown(jp))
+         return 0;
+      if (!sys_isKnown(jp->target) && !space_sysReachable(jp->target))
+         return 0;
+   }
+   if (jp_isFlag( jp, JP_EXITONLY ))
+      return 0;
+
+   /* Skip hidden jumps if they're not specifically requested */
+   if (!show_hidden && jp_isFlag( jp, JP_HIDDEN ))
+      return 0;
+
+   return 1;
+}
+
+/**
+ * @brief Compares two nodes of the open set.
+ */
+static int path_less( int a, int b )
+{
+   const PathNode *na = &path_nodes[a];
+   const PathNode *nb = &path_nodes[b];
+   if (na->g != nb->g)
+      return (na->g < nb->g);
+   return (na->order < nb->order);
+}
+
+/**
+ * @brief Swaps two elements of the heap.
+ */
+static void path_heapSwap( int i, int j )
+{
+   int t = path_heap[i];
+   path_heap[i] = path_heap[j];
+   path_heap[j] = t;
+   path_nodes[ path_heap[i] ].heap = i;
+   path_nodes[ path_heap[j] ].heap = j;
+}
+
+/**
+ * @brief Moves an element of the heap up to its place.
+ */
+static void path_heapUp( int i )
+{
+   while (i > 0) {
+      int p = (i-1)/2;
+      if (!path_less( path_heap[i], path_heap[p] ))
+         break;
+      path_heapSwap( i, p );
+      i = p;
+   }
+}
+
+/**
+ * @brief Moves an element of the heap down to its place.
+ */
+static void path_heapDown( int i )
+{
+   int n = array_size(path_heap);
+   while (1) {
+      int l = 2*i+1;
+      int r = l+1;
+      int m = i;
+      if ((l < n) && path_less( path_heap[l], path_heap[m] ))
+         m = l;
+      if ((r < n) && path_less( path_heap[r], path_heap[m] ))
+         m = r;
+      if (m == i)
+         break;
+      path_heapSwap( i, m );
+      i = m;
+   }
+}
+
+/**
+ * @brief Removes the best system from the heap.
+ *
+ *    @return The system id or -1 if the heap is empty.
+ */
+static int path_heapPop (void)
+{
+   int s, n = array_size(path_heap);
+   if (n <= 0)
+      return -1;
+   s = path_heap[0];
+   path_heapSwap( 0, n-1 );
+   array_erase( &path_heap, &path_heap[n-1], array_end(path_heap) );
+   path_heapDown( 0 );
+   return s;
+}
+
+/**
+ * @brief Gets the shortest jump path between two systems.
+ *
+ *    @param ssys System to start from.
+ *    @param esys System to end at.
+ *    @param ignore_known Whether or not to ignore if systems and jump points are known.
+ *    @param show_hidden Whether or not to use hidden jumps points.
+ *    @return Array (array.h): the systems in the path, excluding the start. NULL if there is none.
+ */
+StarSystem** pathfind_jumpPath( const StarSystem *ssys, const StarSystem *esys,
+      int ignore_known, int show_hidden )
+{
+   int n, cur, order;
+   StarSystem **res;
+
+   if (ssys == esys)
+      return NULL;
+
+   /* Set up the nodes. */
+   n = array_size(system_getAll());
+   if (path_nodes == NULL)
+      path_nodes  = array_create_size( PathNode, n );
+   if (path_heap == NULL)
+      path_heap   = array_create_size( int, n );
+   array_resize( &path_nodes, n );
+   memset( path_nodes, 0, n*sizeof(PathNode) );
+   array_erase( &path_heap, array_begin(path_heap), array_end(path_heap) );
+
+   /* Initial open node is the start system */
+   order = 0;
+   path_nodes[ ssys->id ].state  = PATH_OPEN;
+   path_nodes[ ssys->id ].parent = -1;
+   path_nodes[ ssys->id ].order  = order++;
+   array_push_back( &path_heap, ssys->id );
+
+   while ((cur = path_heapPop()) >= 0) {
+      const StarSystem *sys;
+      int cost;
+
+      /* End condition. */
+      if (cur == esys->id)
+         break;
+
+      path_nodes[cur].state = PATH_CLOSED;
+      cost = path_nodes[cur].g + 1; /* Base unit is jump and always increases by 1. */
+      sys  = system_getIndex( cur );
+
+      for (int i=0; i<array_size(sys->jumps); i++) {
+         const JumpPoint *jp = &sys->jumps[i];
+         PathNode *node;
+
+         if (!path_jumpUsable( jp, ignore_known, show_hidden ))
+            continue;
+
+         node = &path_nodes[ jp->target->id ];
+         if (node->state == PATH_CLOSED)
+            continue;
+         if ((node->state == PATH_OPEN) && (cost >= node->g))
+            continue; /* This node is worse, so ignore it. */
+
+         node->g      = cost;
+         node->parent = cur;
+         node->order  = order++;
+         if (node->state == PATH_OPEN)
+            path_heapUp( node->heap );
+         else {
+            node->state = PATH_OPEN;
+            node->heap  = array_size(path_heap);
+            array_push_back( &path_heap, jp->target->id );
+            path_heapUp( node->heap );
+         }
+      }
+   }
+
+   /* Not found. */
+   if (cur != esys->id)
+      return NULL;
+
+   /* Build path backwards. */
+   n = path_nodes[cur].g;
+   res = array_create_size( StarSystem*, n );
+   array_resize( &res, n );
+   for (int i=n-1; i>=0; i--) {
+      res[i] = system_getIndex( cur );
+      cur = path_nodes[cur].parent;
+   }
+   return res;
+}
+
+/**
+ * @brief Computes the hop distances from a system to all the others.
+ *
+ *    @param s Id of the start system.
+ *    @param show_hidden Whether or not to use hidden jumps points.
+ */
+static void path_hopsRow( int s, int show_hidden )
+{
+   int *row = &path_hops[show_hidden][ s*path_hopsN ];
+   int *queue = path_heap; /* Reused as a plain FIFO. */
+   int head = 0;
+
+   for (int i=0; i<path_hopsN; i++)
+      row[i] = -1;
+   row[s] = 0;
+
+   array_resize( &queue, 0 );
+   array_push_back( &queue, s );
+   while (head < array_size(queue)) {
+      int cur = queue[head++];
+      const StarSystem *sys = system_getIndex( cur );
+      for (int i=0; i<array_size(sys->jumps); i++) {
+         const JumpPoint *jp = &sys->jumps[i];
+         if (!path_jumpUsable( jp, 1, show_hidden ))
+            continue;
+         if (row[ jp->target->id ] >= 0)
+            continue;
+         row[ jp->target->id ] = row[cur] + 1;
+         array_push_back( &queue, jp->target->id );
+      }
+   }
+   path_heap = queue;
+   path_hopsValid[show_hidden][s] = 1;
+}
+
+/**
+ * @brief Gets the number of jumps between two systems ignoring what the player knows.
+ *
+ * Results are cached until pathfind_invalidate() is called.
+ *
+ *    @param ssys System to start from.
+ *    @param esys System to end at.
+ *    @param show_hidden Whether or not to use hidden jumps points.
+ *    @return Number of jumps or -1 if not reachable.
+ */
+int pathfind_jumpDist( const StarSystem *ssys, const StarSystem *esys, int show_hidden )
+{
+   int n = array_size(system_getAll());
+   show_hidden = !!show_hidden;
+
+   /* Systems were added or removed. */
+   if (n != path_hopsN)
+      pathfind_exit();
+
+   if (path_hops[show_hidden] == NULL) {
+      path_hopsN = n;
+      path_hops[show_hidden] = malloc( n*n*sizeof(int) );
+      path_hopsValid[show_hidden] = calloc( n, sizeof(char) );
+      if (path_heap == NULL)
+         path_heap = array_create_size( int, n );
+   }
+
+   if (!path_hopsValid[show_hidden][ ssys->id ])
+      path_hopsRow( ssys->id, show_hidden );
+   return path_hops[show_hidden][ ssys->id*n + esys->id ];
+}
+
+/**
+ * @brief Invalidates the cached hop distances, must be called when jumps change.
+ */
+void pathfind_invalidate (void)
+{
+   for (int i=0; i<2; i++)
+      if (path_hopsValid[i] != NULL)
+         memset( path_hopsValid[i], 0, path_hopsN );
+}
+
+/**
+ * @brief Frees the pathfinding data.
+ */
+void pathfind_exit (void)
+{
+   for (int i=0; i<2; i++) {
+      free( path_hops[i] );
+      free( path_hopsValid[i] );
+      path_hops[i] = NULL;
+      path_hopsValid[i] = NULL;
+   }
+   path_hopsN = 0;
+   array_free( path_nodes );
+   array_free( path_heap );
+   path_nodes = NULL;
+   path_heap  = NULL;
+}
@@ -0,0 +1,15 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+#include "space.h"
+
+/* Shortest paths. */
+StarSystem** pathfind_jumpPath( const StarSystem *ssys, const StarSystem *esys,
+      int ignore_known, int show_hidden );
+
+/* Cached hop distances. */
+int pathfind_jumpDist( const StarSystem *ssys, const StarSystem *esys, int show_hidden );
+void pathfind_invalidate (void);
+void pathfind_exit (void);
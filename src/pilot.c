@@ -46,6 +46,7 @@
 #include "player.h"
 #include "player_autonav.h"
 #include "pilot_ship.h"
+#include "profile.h"
 #include "rng.h"
 #include "weapon.h"
 
@@ -57,6 +58,10 @@ static unsigned int pilot_id = PLAYER_ID; /**< Stack of pilot ids to assure uniq
 /* stack of pilots */
 static Pilot** pilot_stack = NULL; /**< All the pilots in space. (Player may have other Pilot objects, e.g. backup ships.) */
 
+/* Handle table. */
+static Pilot** pilot_handles = NULL; /**< Pilots indexed by their id masked by the table size (power of 2). */
+static int pilot_nhandles = 0; /**< Number of pilots in the handle table. */
+
 /* misc */
 static const double pilot_commTimeout  = 15.; /**< Time for text above pilot to time out. */
 static const double pilot_commFade     = 5.; /**< Time for text above pilot to fade out. */
@@ -73,6 +78,12 @@ static void pilot_hyperspace( Pilot* pilot, double dt );
 static void pilot_refuel( Pilot *p, double dt );
 /* Clean up. */
 static void pilot_erase( Pilot *p );
+/* Handles. */
+static void pilot_handleReserve( int n );
+static unsigned int pilot_newID (void);
+static void pilot_handleAdd( Pilot *p );
+static void pilot_handleRemove( const Pilot *p );
+static void pilot_handleClear (void);
 /* Misc. */
 static int pilot_getStackPos( unsigned int id );
 static void pilot_init_trails( Pilot* p );
@@ -115,6 +126,98 @@ static int pilot_getStackPos( unsigned int id )
       return pp - pilot_stack;
 }
 
+/**
+ * @brief Makes sure the handle table can hold a number of pilots.
+ *
+ * The table is kept at most half full so that few ids get skipped. Since all
+ *  ids are different modulo the old size, they remain different modulo the
+ *  new size too.
+ *
+ *    @param n Number of pilots that have to fit in the table.
+ */
+static void pilot_handleReserve( int n )
+{
+   Pilot **old = pilot_handles;
+   int size;
+
+   if (2*n <= array_size(old))
+      return;
+
+   size = MAX( 2*PILOT_SIZE_MIN, 2*array_size(old) );
+   pilot_handles = array_create_size( Pilot*, size );
+   array_resize( &pilot_handles, size );
+   memset( pilot_handles, 0, size*sizeof(Pilot*) );
+   for (int i=0; i<array_size(old); i++)
+      if (old[i] != NULL)
+         pilot_handles[ old[i]->id & (size-1) ] = old[i];
+   array_free( old );
+}
+
+/**
+ * @brief Gets a new unique pilot id.
+ *
+ * Ids keep increasing so that the pilot stack stays sorted, but ids whose
+ *  slot in the handle table is in use are skipped. This way the low bits of
+ *  the id are the slot of the pilot in the table and the rest act as a
+ *  generation: stale ids of removed pilots never match the slot contents.
+ *
+ *    @return New id to use for a pilot.
+ */
+static unsigned int pilot_newID (void)
+{
+   unsigned int mask;
+
+   pilot_handleReserve( pilot_nhandles+1 );
+   mask = array_size(pilot_handles)-1;
+   do {
+      ++pilot_id; /* can't be 0 */
+   } while ((pilot_id == 0) || (pilot_id == PLAYER_ID) || (pilot_handles[ pilot_id & mask ] != NULL));
+   return pilot_id;
+}
+
+/**
+ * @brief Adds a pilot with an id from pilot_newID() to the handle table.
+ *
+ *    @param p Pilot to add.
+ */
+static void pilot_handleAdd( Pilot *p )
+{
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
+   pilot_handles[ p->id & (array_size(pilot_handles)-1) ] = p;
+   pilot_nhandles++;
+}
+
+/**
+ * @brief Removes a pilot from the handle table if it is in it.
+ *
+ *    @param p Pilot to remove.
+ */
+static void pilot_handleRemove( const Pilot *p )
+{
+   Pilot **h;
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
+   if (array_size(pilot_handles) <= 0)
+      return;
+   h = &pilot_handles[ p->id & (array_size(pilot_handles)-1) ];
+   if (*h != p)
+      return;
+   *h = NULL;
+   pilot_nhandles--;
+}
+
+/**
+ * @brief Removes all the pilots from the handle table.
+ */
+static void pilot_handleClear (void)
+{
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
+   memset( pilot_handles, 0, array_size(pilot_handles)*sizeof(Pilot*) );
+   pilot_nhandles = 0;
+}
+
 /**
  * @brief Gets the next pilot based on id.
  *
@@ -314,18 +417,20 @@ unsigned int pilot_getNearestEnemy( const Pilot* p )
 {
    unsigned int tp = 0;
    double d = 0.;
+   const int *near = pilot_nearbySensor( p, 0 );
 
-   for (int i=0; i<array_size(pilot_stack); i++) {
+   for (int j=0; j<array_size(near); j++) {
       double td;
+      const Pilot *t = pilot_stack[ near[j] ];
 
-      if (!pilot_validEnemy( p, pilot_stack[i] ))
+      if (!pilot_validEnemy( p, t ))
          continue;
 
       /* Check distance. */
-      td = vec2_dist2(&pilot_stack[i]->solid->pos, &p->solid->pos);
+      td = vec2_dist2(&t->solid->pos, &p->solid->pos);
       if (!tp || (td < d)) {
          d  = td;
-         tp = pilot_stack[i]->id;
+         tp = t->id;
       }
    }
    return tp;
@@ -343,21 +448,23 @@ unsigned int pilot_getNearestEnemy_size( const Pilot* p, double target_mass_LB,
 {
    unsigned int tp = 0;
    double d = 0.;
+   const int *near = pilot_nearbySensor( p, 0 );
 
-   for (int i=0; i<array_size(pilot_stack); i++) {
+   for (int j=0; j<array_size(near); j++) {
       double td;
+      const Pilot *t = pilot_stack[ near[j] ];
 
-      if (!pilot_validEnemy( p, pilot_stack[i] ))
+      if (!pilot_validEnemy( p, t ))
          continue;
 
-      if (pilot_stack[i]->solid->mass < target_mass_LB || pilot_stack[i]->solid->mass > target_mass_UB)
+      if (t->solid->mass < target_mass_LB || t->solid->mass > target_mass_UB)
          continue;
 
       /* Check distance. */
-      td = vec2_dist2(&pilot_stack[i]->solid->pos, &p->solid->pos);
+      td = vec2_dist2(&t->solid->pos, &p->solid->pos);
       if (!tp || (td < d)) {
          d = td;
-         tp = pilot_stack[i]->id;
+         tp = t->id;
       }
    }
 
@@ -380,10 +487,11 @@ unsigned int pilot_getNearestEnemy_heuristic( const Pilot* p,
 {
    unsigned int tp = 0;
    double current_heuristic_value = 10e3;
+   const int *near = pilot_nearbySensor( p, 0 );
 
-   for (int i=0; i<array_size(pilot_stack); i++) {
+   for (int j=0; j<array_size(near); j++) {
       double temp;
-      Pilot *target = pilot_stack[i];
+      Pilot *target = pilot_stack[ near[j] ];
 
       if (!pilot_validEnemy( p, target ))
          continue;
@@ -493,33 +601,35 @@ unsigned int pilot_getBoss( const Pilot* p )
 double pilot_getNearestPos( const Pilot *p, unsigned int *tp, double x, double y, int disabled )
 {
    double d = 0.;
+   const int *near = pilot_nearbySensor( p, 1 );
 
    *tp = PLAYER_ID;
-   for (int i=0; i<array_size(pilot_stack); i++) {
+   for (int j=0; j<array_size(near); j++) {
       double td;
+      const Pilot *t = pilot_stack[ near[j] ];
 
       /* Must not be self. */
-      if (pilot_stack[i] == p)
+      if (t == p)
          continue;
 
       /* Player doesn't select escorts (unless disabled is active). */
       if (!disabled && pilot_isPlayer(p) &&
-            pilot_isWithPlayer(pilot_stack[i]))
+            pilot_isWithPlayer(t))
          continue;
 
       /* Shouldn't be disabled. */
-      if (!disabled && pilot_isDisabled(pilot_stack[i]))
+      if (!disabled && pilot_isDisabled(t))
          continue;
 
       /* Must be a valid target. */
-      if (!pilot_validTarget( p, pilot_stack[i] ))
+      if (!pilot_validTarget( p, t ))
          continue;
 
       /* Minimum distance. */
-      td = pow2(x-pilot_stack[i]->solid->pos.x) + pow2(y-pilot_stack[i]->solid->pos.y);
+      td = pow2(x-t->solid->pos.x) + pow2(y-t->solid->pos.y);
       if (((*tp==PLAYER_ID) || (td < d))) {
          d = td;
-         *tp = pilot_stack[i]->id;
+         *tp = t->id;
       }
    }
    return d;
@@ -580,26 +690,27 @@ double pilot_getNearestAng( const Pilot *p, unsigned int *tp, double ang, int di
 /**
  * @brief Pulls a pilot out of the pilot_stack based on ID.
  *
- * It's a binary search ( O(logn) ) therefore it's pretty fast and can be
- *  abused all the time. Maximum iterations is 32 on a platform with 32 bit
- *  unsigned ints.
+ * It's a single lookup in the handle table ( O(1) ) therefore it's very fast
+ *  and can be abused all the time.
  *
  *    @param id ID of the pilot to get.
  *    @return The actual pilot who has matching ID or NULL if not found.
  */
 Pilot* pilot_get( unsigned int id )
 {
-   int m;
+   Pilot *p;
 
    if (id==PLAYER_ID)
       return player.p; /* special case player.p */
 
-   m = pilot_getStackPos(id);
+   if (array_size(pilot_handles) <= 0)
+      return NULL;
+   p = pilot_handles[ id & (array_size(pilot_handles)-1) ];
 
-   if ((m==-1) || (pilot_isFlag(pilot_stack[m], PILOT_DELETE)))
+   if ((p==NULL) || (p->id != id) || (pilot_isFlag(p, PILOT_DELETE)))
       return NULL;
    else
-      return pilot_stack[m];
+      return p;
 }
 
 /**
@@ -2341,6 +2452,7 @@ void pilot_update( Pilot* pilot, double dt )
              */
             pilot->solid->speed_max = 0.;
             pilot->solid->update( pilot->solid, dt );
+            pilot_nearbyUpdate( pilot );
 
             if (VMOD(pilot->solid->vel) < 1e-1) {
                vectnull( &pilot->solid->vel ); /* Forcibly zero velocity. */
@@ -2415,6 +2527,7 @@ void pilot_update( Pilot* pilot, double dt )
 
       /* update the solid */
       pilot->solid->update( pilot->solid, dt );
+      pilot_nearbyUpdate( pilot );
 
       gl_getSpriteFromDir( &pilot->tsx, &pilot->tsy,
             pilot->ship->gfx_space, pilot->solid->dir );
@@ -2510,6 +2623,7 @@ void pilot_update( Pilot* pilot, double dt )
 
    /* Update the solid, must be run after limit_speed. */
    pilot->solid->update( pilot->solid, dt );
+   pilot_nearbyUpdate( pilot );
    gl_getSpriteFromDir( &pilot->tsx, &pilot->tsy,
          pilot->ship->gfx_space, pilot->solid->dir );
 
@@ -3196,8 +3310,10 @@ unsigned int pilot_create( const Ship* ship, const char* name, int faction, cons
       p->id = PLAYER_ID;
       qsort( pilot_stack, array_size(pilot_stack), sizeof(Pilot*), pilot_cmp );
    }
-   else
-      p->id = ++pilot_id; /* new unique pilot id based on pilot_id, can't be 0 */
+   else {
+      p->id = pilot_newID();
+      pilot_handleAdd( p );
+   }
 
    /* Initialize AI if applicable. */
    if (ai == NULL)
@@ -3267,6 +3383,8 @@ unsigned int pilot_clone( const Pilot *ref )
    /* Initialize the pilot. */
    pilot_init( dyn, ref->ship, ref->name, ref->faction,
          ref->solid->dir, &ref->solid->pos, &ref->solid->vel, pf, 0, 0 );
+   dyn->id = pilot_newID();
+   pilot_handleAdd( dyn );
 
    /* Add outfits over. */
    for (int i=0; i<array_size(ref->outfits); i++)
@@ -3286,7 +3404,8 @@ unsigned int pilot_clone( const Pilot *ref )
  */
 unsigned int pilot_addStack( Pilot *p )
 {
-   p->id = ++pilot_id; /* new unique pilot id based on pilot_id, can't be 0 */
+   p->id = pilot_newID();
+   pilot_handleAdd( p );
    pilot_setFlag( p, PILOT_NOFREE );
 
    array_push_back( &pilot_stack, p );
@@ -3337,6 +3456,7 @@ Pilot* pilot_setPlayer( Pilot* after )
       else
          pilot_stack[i] = after; /* after overwrites player. */
    }
+   pilot_handleRemove( after ); /* The player is not in the handle table. */
    after->id = PLAYER_ID;
    qsort( pilot_stack, array_size(pilot_stack), sizeof(Pilot*), pilot_cmp );
 
@@ -3522,6 +3642,7 @@ void pilot_free( Pilot *p )
 static void pilot_erase( Pilot *p )
 {
    int i = pilot_getStackPos( p->id );
+   pilot_handleRemove( p );
    pilot_free(p);
    array_erase( &pilot_stack, &pilot_stack[i], &pilot_stack[i+1] );
 }
@@ -3536,6 +3657,7 @@ void pilot_stackRemove( Pilot *p )
    if (i < 0)
       WARN(_("Trying to remove non-existent pilot '%s' from stack!"), p->name);
 #endif /* DEBUGGING */
+   pilot_handleRemove( p );
    p->id = 0;
    array_erase( &pilot_stack, &pilot_stack[i], &pilot_stack[i+1] );
 }
@@ -3546,6 +3668,8 @@ void pilot_stackRemove( Pilot *p )
 void pilots_init (void)
 {
    pilot_stack = array_create_size( Pilot*, PILOT_SIZE_MIN );
+   pilot_handleReserve( PILOT_SIZE_MIN );
+   pilot_nearbyInit();
 }
 
 /**
@@ -3570,6 +3694,10 @@ void pilots_free (void)
       pilot_free(pilot_stack[i]);
    array_free(pilot_stack);
    pilot_stack = NULL;
+   array_free(pilot_handles);
+   pilot_handles = NULL;
+   pilot_nhandles = 0;
+   pilot_nearbyFree();
    player.p = NULL;
    free( player.ps.acquired );
    memset( &player.ps, 0, sizeof(PlayerShip_t) );
@@ -3619,8 +3747,10 @@ void pilots_clean( int persist )
          /* All done. */
          persist_count++;
       }
-      else /* rest get killed */
+      else { /* rest get killed */
+         pilot_handleRemove( pilot_stack[i] );
          pilot_free(pilot_stack[i]);
+      }
    }
    array_erase( &pilot_stack, &pilot_stack[persist_count], array_end(pilot_stack) );
 
@@ -3671,6 +3801,7 @@ void pilots_cleanAll (void)
       memset( &player.ps, 0, sizeof(PlayerShip_t) );
    }
    array_erase( &pilot_stack, array_begin(pilot_stack), array_end(pilot_stack) );
+   pilot_handleClear();
 }
 
 /**
@@ -3680,6 +3811,9 @@ void pilots_cleanAll (void)
  */
 void pilots_update( double dt )
 {
+   /* Pilots are about to move, so rebuild the neighbourhood index once. */
+   pilot_nearbyInvalidate();
+
    /* Delete loop - this should be atomic or we get hook fuckery! */
    for (int i=array_size(pilot_stack)-1; i>=0; i--) {
       Pilot *p = pilot_stack[i];
@@ -3728,8 +3862,11 @@ void pilots_update( double dt )
             !pilot_isFlag(p, PILOT_HYP_END)) {
          if (pilot_isFlag(p, PILOT_PLAYER))
             player_think( p, dt );
-         else
+         else {
+            PROFILE_BEGIN( PROFILE_AI );
             ai_think( p, dt );
+            PROFILE_END( PROFILE_AI );
+         }
       }
    }
 
@@ -218,6 +218,7 @@ typedef struct Pilot_ {
    /* Object characteristics */
    const Ship* ship; /**< ship pilot is flying */
    Solid* solid;     /**< associated solid (physics) */
+   vec2 grid_pos;    /**< Position when the neighbourhood index was built. */
    double base_mass; /**< Ship mass plus core outfit mass. */
    double mass_cargo;/**< Amount of cargo mass added. */
    double mass_outfit;/**< Amount of outfit mass added. */
@@ -342,6 +343,7 @@ typedef struct Pilot_ {
    AI_Profile* ai;   /**< AI personality profile */
    int lua_mem;      /**< AI memory. */
    double tcontrol;  /**< timer for control tick */
+   NLuaBudget ai_budget; /**< Lua time spent by the AI, used to defer control ticks. */
    double timer[MAX_AI_TIMERS]; /**< Timers for AI */
    Task* task;       /**< current action */
    unsigned int shoot_indicator; /**< Indicator to inform the AI if a seeker has been shot recently. */
@@ -405,6 +407,17 @@ const glColour* pilot_getColour( const Pilot* p );
 int pilot_validTarget( const Pilot* p, const Pilot* target );
 int pilot_canTarget( const Pilot* p );
 
+/*
+ * Neighbourhood queries.
+ */
+void pilot_nearbyInit (void);
+void pilot_nearbyFree (void);
+void pilot_nearbyInvalidate (void);
+void pilot_nearbyUpdate( const Pilot *p );
+const int *pilot_nearbyRange( double x, double y, double r );
+const int *pilot_nearbySensor( const Pilot *p, int fuzzy );
+const int *pilot_nearbyStealth( const Pilot *p, double mod );
+
 /* non-lua wrappers */
 double pilot_relsize( const Pilot* cur_pilot, const Pilot* p );
 double pilot_reldps( const Pilot* cur_pilot, const Pilot* p );
@@ -88,6 +88,8 @@ static void pilot_ewUpdate( Pilot *p )
    p->ew_evasion   = p->ew_detection * 0.75 * ew_interference / p->stats.ew_evade;
    /* For stealth we apply the ew_asteroid and ew_interference bonus outside of the max, so that it can go below 1000 with in-system features. */
    p->ew_stealth   = MAX( 1000., p->ew_mass / p->stats.ew_hide * 0.25 / p->stats.ew_stealth ) * p->ew_asteroid * ew_interference * p->ew_jumppoint;
+   /* Sensor ranges bound the neighbourhood queries. */
+   pilot_nearbyUpdate( p );
 }
 
 /**
@@ -234,42 +236,6 @@ int pilot_inRange( const Pilot *p, double x, double y )
    return 0;
 }
 
-/**
- * @brief Check to see if a pilot is in sensor range of another.
- *
- *    @param p Pilot who is trying to check to see if other is in sensor range.
- *    @param target Target of p to check to see if is in sensor range.
- *    @param[out] dist2 Distance squared of the two pilots. Set to NULL if you're not interested.
- *    @return 1 if they are in range, 0 if they aren't and -1 if they are detected fuzzily.
- */
-int pilot_inRangePilot( const Pilot *p, const Pilot *target, double *dist2 )
-{
-   double d;
-
-   /* Get distance if needed. */
-   if (dist2 != NULL)
-      *dist2 = vec2_dist2( &p->solid->pos, &target->solid->pos );
-
-   /* Special case player or omni-visible. */
-   if ((pilot_isPlayer(p) && pilot_isFlag(target, PILOT_VISPLAYER)) ||
-         pilot_isFlag(target, PILOT_VISIBLE) ||
-         target->parent == p->id)
-      return 1;
-
-   /* Stealth detection. */
-   if (pilot_isFlag( target, PILOT_STEALTH ))
-      return 0;
-
-   /* No stealth so normal detection. */
-   d = (dist2!=NULL ? *dist2 : vec2_dist2( &p->solid->pos, &target->solid->pos ) );
-   if (d < pow2( MAX( 0., p->stats.ew_detect * p->stats.ew_track * target->ew_evasion )))
-      return 1;
-   else if  (d < pow2( MAX( 0., p->stats.ew_detect * target->ew_detection )))
-      return -1;
-
-   return 0;
-}
-
 /**
  * @brief Check to see if a spob is in sensor range of the pilot.
  *
@@ -310,8 +276,7 @@ int pilot_inRangeSpob( const Pilot *p, int target )
 int pilot_inRangeAsteroid( const Pilot *p, int ast, int fie )
 {
    double d;
-   Asteroid *as;
-   AsteroidAnchor *f;
+   const AsteroidAnchor *f;
    double sense;
 
    /* pilot must exist */
@@ -320,13 +285,12 @@ int pilot_inRangeAsteroid( const Pilot *p, int ast, int fie )
 
    /* Get the asteroid. */
    f = &cur_system->asteroids[fie];
-   as = &f->asteroids[ast];
 
    /* TODO something better than this. */
    sense = EW_ASTEROID_DIST;
 
    /* Get distance. */
-   d = vec2_dist2( &p->solid->pos, &as->pos );
+   d = pow2( p->solid->pos.x - f->motion.x[ast] ) + pow2( p->solid->pos.y - f->motion.y[ast] );
 
    /* By default, asteroid's hide score is 1. It could be made changeable via xml.*/
    if (d < pow2( MAX( 0., sense * p->stats.ew_detect ) ) )
@@ -405,6 +369,7 @@ double pilot_ewWeaponTrack( const Pilot *p, const Pilot *t, double trackmin, dou
 static int pilot_ewStealthGetNearby( const Pilot *p, double *mod, int *close, int *isplayer )
 {
    Pilot *const* ps;
+   const int *near;
    int n;
 
    /* Check nearby non-allies. */
@@ -416,9 +381,10 @@ static int pilot_ewStealthGetNearby( const Pilot *p, double *mod, int *close, in
       *isplayer = 0;
    n = 0;
    ps = pilot_getAll();
-   for (int i=0; i<array_size(ps); i++) {
+   near = pilot_nearbyStealth( p, (close != NULL) ? 1.5 : 1. );
+   for (int j=0; j<array_size(near); j++) {
       double dist;
-      Pilot *t = ps[i];
+      Pilot *t = ps[ near[j] ];
 
       /* Quick checks first. */
       if (pilot_isDisabled(t))
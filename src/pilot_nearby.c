@@ -0,0 +1,309 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file pilot_nearby.c
+ *
+ * @brief Neighbourhood index of the pilots, used to find the pilots that may
+ *  be near or in sensor range of each other without looping over all of them.
+ *
+ * Only depends on the pilot stack so that it can be tested on its own.
+ */
+/** @cond */
+#include <math.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "pilot.h"
+
+#include "array.h"
+#include "log.h"
+#include "pilot_ew.h"
+#include "spatial.h"
+
+static SpatialGrid pilot_grid; /**< Pilots indexed by position in the pilot stack. */
+static int pilot_gridDirty = 1; /**< Whether the index has to be rebuilt before the next query. */
+static double pilot_gridSlack = 0.; /**< Largest distance a pilot moved since the index was built. */
+static double pilot_gridDetect = 0.; /**< Largest ew_detect stat of the indexed pilots. */
+static double pilot_gridDetection = 0.; /**< Largest ew_detection of the indexed pilots. */
+static double pilot_gridEvasion = 0.; /**< Largest ew_evasion of the indexed pilots. */
+static int *pilot_gridAlways = NULL; /**< Array (array.h): Pilots that may be detected from any distance. */
+static int *pilot_gridRes = NULL; /**< Array (array.h): Results of the last query. */
+static int *pilot_gridQuery = NULL; /**< Array (array.h): Scratch space for queries. */
+
+static void pilot_nearbyBuild (void);
+static const int *pilot_nearbyDetect( const Pilot *p, double r );
+
+/**
+ * @brief Initializes the neighbourhood index.
+ */
+void pilot_nearbyInit (void)
+{
+   spatial_init( &pilot_grid );
+   pilot_gridDirty = 1;
+}
+
+/**
+ * @brief Frees the neighbourhood index.
+ */
+void pilot_nearbyFree (void)
+{
+   spatial_free( &pilot_grid );
+   array_free( pilot_gridAlways );
+   pilot_gridAlways = NULL;
+   array_free( pilot_gridRes );
+   pilot_gridRes = NULL;
+   array_free( pilot_gridQuery );
+   pilot_gridQuery = NULL;
+   pilot_gridDirty = 1;
+}
+
+/**
+ * @brief Marks the neighbourhood index as having to be rebuilt.
+ *
+ * Has to be called whenever the pilot stack changes or a pilot becomes
+ *  visible from any distance.
+ */
+void pilot_nearbyInvalidate (void)
+{
+   pilot_gridDirty = 1;
+}
+
+/**
+ * @brief Tells the neighbourhood index that a pilot moved or changed its
+ *  electronic warfare values.
+ *
+ * The index keeps the positions the pilots had when it was built, so queries
+ *  are grown by the largest distance a pilot moved since then. Once that gets
+ *  too large, the index is rebuilt on the next query.
+ *
+ *    @param p Pilot that changed.
+ */
+void pilot_nearbyUpdate( const Pilot *p )
+{
+   double d2;
+   if (p->solid == NULL)
+      return;
+   d2 = vec2_dist2( &p->solid->pos, &p->grid_pos );
+   if (d2 > pow2(pilot_gridSlack)) {
+      pilot_gridSlack = sqrt(d2);
+      if (pilot_gridSlack > pilot_grid.cellsize)
+         pilot_gridDirty = 1;
+   }
+   pilot_gridDetect     = MAX( pilot_gridDetect, p->stats.ew_detect );
+   pilot_gridDetection  = MAX( pilot_gridDetection, p->ew_detection );
+   pilot_gridEvasion    = MAX( pilot_gridEvasion, p->ew_evasion );
+}
+
+/**
+ * @brief Rebuilds the neighbourhood index from the pilot stack.
+ */
+static void pilot_nearbyBuild (void)
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+
+   if (pilot_gridAlways == NULL) {
+      pilot_gridAlways  = array_create( int );
+      pilot_gridRes     = array_create( int );
+      pilot_gridQuery   = array_create( int );
+   }
+   array_erase( &pilot_gridAlways, array_begin(pilot_gridAlways), array_end(pilot_gridAlways) );
+
+   spatial_clear( &pilot_grid );
+   pilot_gridSlack      = 0.;
+   pilot_gridDetect     = 0.;
+   pilot_gridDetection  = 0.;
+   pilot_gridEvasion    = 0.;
+   for (int i=0; i<array_size(pilot_stack); i++) {
+      Pilot *p = pilot_stack[i];
+      p->grid_pos = p->solid->pos;
+      spatial_add( &pilot_grid, i, p->solid->pos.x, p->solid->pos.y, 0. );
+      pilot_nearbyUpdate( p );
+      /* See pilot_inRangePilot(). */
+      if (pilot_isFlag( p, PILOT_VISIBLE ) || pilot_isFlag( p, PILOT_VISPLAYER ) ||
+            (p->parent != 0))
+         array_push_back( &pilot_gridAlways, i );
+   }
+   spatial_build( &pilot_grid );
+   pilot_gridDirty = 0;
+}
+
+/**
+ * @brief Gets all the pilots in a circle.
+ *
+ * Results are candidates: they are a superset of the pilots in the circle, and
+ *  callers still have to check the distance themselves. They are sorted by
+ *  position in the pilot stack, so that filtering them gives the same result
+ *  as looping over the whole stack.
+ *
+ *    @param x X position of the circle.
+ *    @param y Y position of the circle.
+ *    @param r Radius of the circle.
+ *    @return Array (array.h) of positions in the pilot stack, valid until the
+ *            next query.
+ */
+const int *pilot_nearbyRange( double x, double y, double r )
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+
+   if (pilot_gridDirty)
+      pilot_nearbyBuild();
+
+   /* Can't bound it, so use everything. */
+   if (!isfinite(r)) {
+      array_resize( &pilot_gridRes, array_size(pilot_stack) );
+      for (int i=0; i<array_size(pilot_stack); i++)
+         pilot_gridRes[i] = i;
+      return pilot_gridRes;
+   }
+
+   /* Slightly larger to not lose anything to rounding. */
+   spatial_query( &pilot_grid, &pilot_gridRes, x, y, MAX(0.,r) + pilot_gridSlack + 1. );
+
+#if DEBUG_PARANOID
+   for (int i=0, j=0; i<array_size(pilot_stack); i++) {
+      while ((j < array_size(pilot_gridRes)) && (pilot_gridRes[j] < i))
+         j++;
+      if (((j >= array_size(pilot_gridRes)) || (pilot_gridRes[j] != i)) &&
+            (pow2(x-pilot_stack[i]->solid->pos.x) + pow2(y-pilot_stack[i]->solid->pos.y) <= pow2(r)))
+         WARN(_("Pilot '%s' missing from neighbourhood query!"), pilot_stack[i]->name);
+   }
+#endif /* DEBUG_PARANOID */
+
+   return pilot_gridRes;
+}
+
+/**
+ * @brief Gets pilots within a distance of a pilot, along with those that can
+ *  be detected from any distance.
+ *
+ *    @param p Pilot to get neighbours of.
+ *    @param r Distance to look in.
+ *    @return Array (array.h) of positions in the pilot stack, valid until the
+ *            next query.
+ */
+static const int *pilot_nearbyDetect( const Pilot *p, double r )
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+   int i, j;
+
+   pilot_nearbyRange( p->solid->pos.x, p->solid->pos.y, r );
+   if ((array_size(pilot_gridAlways) <= 0) ||
+         (array_size(pilot_gridRes) >= array_size(pilot_stack)))
+      return pilot_gridRes;
+
+   /* Merge both sorted lists. */
+   array_erase( &pilot_gridQuery, array_begin(pilot_gridQuery), array_end(pilot_gridQuery) );
+   i = j = 0;
+   while ((i < array_size(pilot_gridRes)) || (j < array_size(pilot_gridAlways))) {
+      int v;
+      if (j >= array_size(pilot_gridAlways))
+         v = pilot_gridRes[i++];
+      else if (i >= array_size(pilot_gridRes))
+         v = pilot_gridAlways[j++];
+      else if (pilot_gridRes[i] < pilot_gridAlways[j])
+         v = pilot_gridRes[i++];
+      else if (pilot_gridRes[i] > pilot_gridAlways[j])
+         v = pilot_gridAlways[j++];
+      else {
+         v = pilot_gridRes[i++];
+         j++;
+      }
+      array_push_back( &pilot_gridQuery, v );
+   }
+   array_resize( &pilot_gridRes, array_size(pilot_gridQuery) );
+   memcpy( pilot_gridRes, pilot_gridQuery, sizeof(int) * array_size(pilot_gridQuery) );
+
+   return pilot_gridRes;
+}
+
+/**
+ * @brief Gets pilots that may be in sensor range of a pilot.
+ *
+ *    @param p Pilot to get neighbours of.
+ *    @param fuzzy Whether or not to also include pilots only in fuzzy range.
+ *    @return Array (array.h) of positions in the pilot stack, valid until the
+ *            next query.
+ *    @sa pilot_inRangePilot
+ */
+const int *pilot_nearbySensor( const Pilot *p, int fuzzy )
+{
+   const int *res;
+   double r;
+
+   if (pilot_gridDirty)
+      pilot_nearbyBuild();
+   r = p->stats.ew_detect * p->stats.ew_track * pilot_gridEvasion;
+   if (fuzzy)
+      r = MAX( r, p->stats.ew_detect * pilot_gridDetection );
+   res = pilot_nearbyDetect( p, r );
+
+#if DEBUG_PARANOID
+   Pilot *const* pilot_stack = pilot_getAll();
+   for (int i=0, j=0; i<array_size(pilot_stack); i++) {
+      int ret;
+      while ((j < array_size(res)) && (res[j] < i))
+         j++;
+      if ((j < array_size(res)) && (res[j] == i))
+         continue;
+      ret = pilot_inRangePilot( p, pilot_stack[i], NULL );
+      if ((ret == 1) || (fuzzy && (ret != 0)))
+         WARN(_("Pilot '%s' missing from sensor query of pilot '%s'!"), pilot_stack[i]->name, p->name);
+   }
+#endif /* DEBUG_PARANOID */
+
+   return res;
+}
+
+/**
+ * @brief Gets pilots that may be detecting a stealthed pilot.
+ *
+ *    @param p Stealthed pilot to get neighbours of.
+ *    @param mod Modifier of the detection range.
+ *    @return Array (array.h) of positions in the pilot stack, valid until the
+ *            next query.
+ */
+const int *pilot_nearbyStealth( const Pilot *p, double mod )
+{
+   if (pilot_gridDirty)
+      pilot_nearbyBuild();
+   return pilot_nearbyRange( p->solid->pos.x, p->solid->pos.y,
+         p->ew_stealth * pilot_gridDetect * mod );
+}
+
+/**
+ * @brief Check to see if a pilot is in sensor range of another.
+ *
+ *    @param p Pilot who is trying to check to see if other is in sensor range.
+ *    @param target Target of p to check to see if is in sensor range.
+ *    @param[out] dist2 Distance squared of the two pilots. Set to NULL if you're not interested.
+ *    @return 1 if they are in range, 0 if they aren't and -1 if they are detected fuzzily.
+ */
+int pilot_inRangePilot( const Pilot *p, const Pilot *target, double *dist2 )
+{
+   double d;
+
+   /* Get distance if needed. */
+   if (dist2 != NULL)
+      *dist2 = vec2_dist2( &p->solid->pos, &target->solid->pos );
+
+   /* Special case player or omni-visible. */
+   if ((pilot_isPlayer(p) && pilot_isFlag(target, PILOT_VISPLAYER)) ||
+         pilot_isFlag(target, PILOT_VISIBLE) ||
+         target->parent == p->id)
+      return 1;
+
+   /* Stealth detection. */
+   if (pilot_isFlag( target, PILOT_STEALTH ))
+      return 0;
+
+   /* No stealth so normal detection. */
+   d = (dist2!=NULL ? *dist2 : vec2_dist2( &p->solid->pos, &target->solid->pos ) );
+   if (d < pow2( MAX( 0., p->stats.ew_detect * p->stats.ew_track * target->ew_evasion )))
+      return 1;
+   else if  (d < pow2( MAX( 0., p->stats.ew_detect * target->ew_detection )))
+      return -1;
+
+   return 0;
+}
@@ -21,6 +21,7 @@
 #include "pause.h"
 #include "pilot.h"
 #include "player.h"
+#include "profile.h"
 #include "slots.h"
 #include "space.h"
 #include "nlua.h"
@@ -1131,6 +1132,21 @@ int pilot_slotIsToggleable( const PilotOutfitSlot *o )
    return 1;
 }
 
+/**
+ * @brief Runs a function on an outfit slot, timing the outfit script.
+ */
+static void pilot_outfitLRunSlot( Pilot *p, PilotOutfitSlot *po, void (*const func)( const Pilot *p, PilotOutfitSlot *po, const void *data ), const void *data )
+{
+   /* Outfits without scripts have nothing to time. */
+   if (po->outfit->lua_env == LUA_NOREF) {
+      func( p, po, data );
+      return;
+   }
+   PROFILE_BEGIN_NAME( PROFILE_LUA_OUTFIT, po->outfit->name );
+   func( p, po, data );
+   PROFILE_END( PROFILE_LUA_OUTFIT );
+}
+
 /**
  * @brief Wrapper that does all the work for us.
  */
@@ -1141,13 +1157,13 @@ static void pilot_outfitLRun( Pilot *p, void (*const func)( const Pilot *p, Pilo
       PilotOutfitSlot *po = p->outfits[i];
       if (po->outfit==NULL)
          continue;
-      func( p, po, data );
+      pilot_outfitLRunSlot( p, po, func, data );
    }
    for (int i=0; i<array_size(p->outfit_intrinsic); i++) {
       PilotOutfitSlot *po = &p->outfit_intrinsic[i];
       if (po->outfit==NULL)
          continue;
-      func( p, po, data );
+      pilot_outfitLRunSlot( p, po, func, data );
    }
    /* Recalculate if anything changed. */
    if (pilotoutfit_modified)
@@ -74,6 +74,7 @@ static int pilot_weapSetFire( Pilot *p, PilotWeaponSet *ws, int level )
    Pilot *pt;
    AsteroidAnchor *field;
    Asteroid *ast;
+   vec2 apos, avel;
    double time;
    int isstealth;
 
@@ -122,7 +123,9 @@ static int pilot_weapSetFire( Pilot *p, PilotWeaponSet *ws, int level )
       else if (p->nav_asteroid != -1) {
          field = &cur_system->asteroids[p->nav_anchor];
          ast = &field->asteroids[p->nav_asteroid];
-         time = pilot_weapFlyTime( o, p, &ast->pos, &ast->vel);
+         apos = asteroid_pos( ast );
+         avel = asteroid_vel( ast );
+         time = pilot_weapFlyTime( o, p, &apos, &avel);
       }
 
       /* Only "inrange" outfits. */
@@ -45,6 +45,7 @@
 #include "ndata.h"
 #include "news.h"
 #include "nfile.h"
+#include "nlua_linopt.h"
 #include "nlua_misn.h"
 #include "nlua_outfit.h"
 #include "nlua_ship.h"
@@ -66,6 +67,7 @@
 #include "start.h"
 #include "toolkit.h"
 #include "unidiff.h"
+#include "weapon.h"
 
 /*
  * Player stuff
@@ -337,6 +339,8 @@ static int player_newMake (void)
    start_position( &x, &y );
    vec2_cset( &player.p->solid->pos, x, y );
    vectnull( &player.p->solid->vel );
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
    player.p->solid->dir = RNGF() * 2.*M_PI;
    space_init( start_system(), 1 );
 
@@ -597,6 +601,8 @@ void player_swapShip( const char *shipname, int move_cargo )
    /* Copy position back. */
    player.p->solid->pos = v;
    player.p->solid->dir = dir;
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
 
    /* Fill the tank. */
    if (landed)
@@ -700,6 +706,7 @@ void player_cleanup (void)
    input_enableAll();
 
    /* Clean up other stuff. */
+   linopt_cancel( LUA_NOREF );
    diff_clear();
    var_cleanup();
    missions_cleanup();
@@ -908,6 +915,8 @@ void player_warp( double x, double y )
 {
    unsigned int target = cam_getTarget();
    vec2_cset( &player.p->solid->pos, x, y );
+   pilot_nearbyInvalidate();
+   weapons_gridInvalidate();
    /* Have to move camera over to avoid moving stars when loading. */
    if (target == player.p->id)
       cam_setTargetPilot( target, 0 );
@@ -1194,8 +1203,9 @@ void player_think( Pilot* pplayer, const double dt )
       else if (player.p->nav_asteroid != -1) {
          AsteroidAnchor *field = &cur_system->asteroids[player.p->nav_anchor];
          Asteroid *ast = &field->asteroids[player.p->nav_asteroid];
+         vec2 apos = asteroid_pos( ast );
          pilot_face( pplayer,
-               vec2_angle( &player.p->solid->pos, &ast->pos ));
+               vec2_angle( &player.p->solid->pos, &apos ));
          /* Disable turning. */
          facing = 1;
       }
@@ -1367,7 +1377,8 @@ void player_updateSpecific( Pilot *pplayer, const double dt )
             if (a->scanned) /* Ignore scanned outfits. */
                continue;
 
-            if (vec2_dist2( &a->pos, &player.p->solid->pos ) > r2)
+            if (pow2( ast->motion.x[j] - player.p->solid->pos.x ) +
+                  pow2( ast->motion.y[j] - player.p->solid->pos.y ) > r2)
                continue;
 
             a->scanned = 1;
@@ -3104,6 +3115,8 @@ int player_addEscorts (void)
       vec2_cset( &pe->solid->pos, player.p->solid->pos.x + 50.*cos(pe->solid->dir),
             player.p->solid->pos.y + 50.*sin(pe->solid->dir) );
       vec2_cset( &pe->solid->vel, 0., 0. );
+      pilot_nearbyInvalidate();
+      weapons_gridInvalidate();
 
       /* Update outfit if needed. */
       if (e->type != ESCORT_TYPE_BAY)
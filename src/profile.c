@@ -0,0 +1,485 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file profile.c
+ *
+ * @brief Accumulates the time spent in the different parts of the game loop.
+ *
+ * Zones are only timed while the profiler is enabled, otherwise the
+ * PROFILE_BEGIN() and PROFILE_END() macros boil down to a single branch. A zone
+ * that is entered again before being left (such as hooks running from hooks)
+ * is only timed once from the outermost call.
+ *
+ * Besides the totals, the time spent in each zone minus the zones nested in it
+ * ("self" time) is kept for the last frames to be drawn as a graph, and the
+ * last timed zones are kept so they can be exported as a Chrome trace (which
+ * can be opened with chrome://tracing or https://ui.perfetto.dev). Zones that
+ * run scripts also record the name of the script, so that the trace shows which
+ * one is responsible for a slow frame.
+ */
+/** @cond */
+#include <stddef.h>
+#include "physfs.h"
+#include "SDL_timer.h"
+
+#include "naev.h"
+/** @endcond */
+
+#include "profile.h"
+
+#include "array.h"
+#include "font.h"
+#include "log.h"
+#include "nstring.h"
+#include "opengl.h"
+
+#define PROFILE_FRAMES     240      /**< Number of frames kept for the graph. */
+#define PROFILE_EVENTS     65536    /**< Number of timed zones kept for the trace. */
+#define PROFILE_GRAPH_H    100.     /**< Height of the graph (in pixels). */
+#define PROFILE_GRAPH_MS   (1000./30.) /**< Frame time at the top of the graph (in ms). */
+
+/**
+ * @brief Timing state of a zone.
+ */
+typedef struct ProfileTimer_ {
+   Uint64 start;  /**< Performance counter when the zone was entered. */
+   Uint64 total;  /**< Accumulated performance counter ticks. */
+   Uint64 child;  /**< Accumulated ticks of the zones nested in this one. */
+   Uint64 frame;  /**< Ticks accumulated during the current frame. */
+   Uint64 framechild; /**< Ticks of nested zones accumulated during the current frame. */
+   int depth;     /**< How many times the zone is currently entered. */
+   int calls;     /**< Number of times the zone was timed. */
+   int name;      /**< Name of the script run in the zone (in profile_scripts), or -1. */
+} ProfileTimer;
+
+/**
+ * @brief A timed zone kept for the trace.
+ */
+typedef struct ProfileEvent_ {
+   Uint64 start;  /**< Performance counter when the zone was entered. */
+   Uint64 end;    /**< Performance counter when the zone was left. */
+   ProfileZone zone; /**< Zone that was timed. */
+   int name;      /**< Name of the script run in the zone (in profile_scripts), or -1. */
+} ProfileEvent;
+
+/**
+ * @brief Vertex of the graph.
+ */
+typedef struct ProfileVertex_ {
+   GLfloat x;     /**< X position. */
+   GLfloat y;     /**< Y position. */
+   glColour col;  /**< Colour. */
+} ProfileVertex;
+
+static const char *profile_names[PROFILE_ZONES] = {
+   [PROFILE_FRAME]   = "frame",
+   [PROFILE_SPACE]   = "space",
+   [PROFILE_WEAPONS] = "weapons",
+   [PROFILE_SPFX]    = "spfx",
+   [PROFILE_PILOTS]  = "pilots",
+   [PROFILE_AI]      = "ai",
+   [PROFILE_HOOKS]   = "hooks",
+   [PROFILE_RENDER]  = "render",
+   [PROFILE_LUA_AI]  = "lua_ai",
+   [PROFILE_LUA_HOOK] = "lua_hook",
+   [PROFILE_LUA_OUTFIT] = "lua_outfit",
+   [PROFILE_LUA_SCHEDULER] = "lua_scheduler",
+}; /**< Names of the zones. */
+static const glColour *profile_colours[PROFILE_ZONES] = {
+   [PROFILE_FRAME]   = &cGrey50,
+   [PROFILE_SPACE]   = &cBlue,
+   [PROFILE_WEAPONS] = &cRed,
+   [PROFILE_SPFX]    = &cPurple,
+   [PROFILE_PILOTS]  = &cGreen,
+   [PROFILE_AI]      = &cDarkGreen,
+   [PROFILE_HOOKS]   = &cOrange,
+   [PROFILE_RENDER]  = &cLightBlue,
+   [PROFILE_LUA_AI]  = &cPrimeGreen,
+   [PROFILE_LUA_HOOK] = &cYellow,
+   [PROFILE_LUA_OUTFIT] = &cCyan,
+   [PROFILE_LUA_SCHEDULER] = &cBrown,
+}; /**< Colours of the zones in the graph. */
+static ProfileTimer profile_timers[PROFILE_ZONES]; /**< Timers of the zones. */
+static ProfileZone profile_stack[PROFILE_ZONES]; /**< Zones currently entered, innermost last. */
+static int profile_nstack = 0; /**< Number of zones currently entered. */
+static float profile_frames[PROFILE_FRAMES][PROFILE_ZONES]; /**< Self time of the zones in the last frames (in ms). */
+static int profile_frameHead = 0; /**< Where the next frame will be stored. */
+static int profile_frameCount = 0; /**< Number of frames stored. */
+static ProfileEvent profile_events[PROFILE_EVENTS]; /**< Ring buffer of the last timed zones. */
+static int profile_eventHead = 0; /**< Where the next event will be stored. */
+static int profile_eventCount = 0; /**< Number of events stored. */
+static char **profile_scripts = NULL; /**< Array (array.h): Names of the scripts run in the zones. */
+static ProfileVertex *profile_vertex = NULL; /**< Array (array.h): Vertices of the graph. */
+static gl_vbo *profile_vbo = NULL; /**< VBO of the graph. */
+int profile_enabled = 0; /**< Whether or not the zones are being timed. */
+
+static int profile_script( const char *name );
+static void profile_jsonString( char *out, size_t n, const char *s );
+static void profile_freeScripts (void);
+static void profile_line( double x1, double y1, double x2, double y2, const glColour *c );
+
+/**
+ * @brief Enables or disables the profiler.
+ *
+ *    @param enable Whether or not to time the zones.
+ */
+void profile_enable( int enable )
+{
+   profile_enabled = enable;
+   /* Don't leave zones half open. */
+   for (int i=0; i<PROFILE_ZONES; i++)
+      profile_timers[i].depth = 0;
+   profile_nstack = 0;
+}
+
+/**
+ * @brief Clears all the accumulated times, frames and events.
+ */
+void profile_reset (void)
+{
+   memset( profile_timers, 0, sizeof(profile_timers) );
+   profile_nstack       = 0;
+   profile_frameHead    = 0;
+   profile_frameCount   = 0;
+   profile_eventHead    = 0;
+   profile_eventCount   = 0;
+   profile_freeScripts();
+}
+
+/**
+ * @brief Frees the resources used to draw the graph.
+ */
+void profile_exit (void)
+{
+   profile_freeScripts();
+   array_free( profile_vertex );
+   profile_vertex = NULL;
+   gl_vboDestroy( profile_vbo );
+   profile_vbo = NULL;
+}
+
+/**
+ * @brief Gets the index of the name of a script, adding it if necessary.
+ *
+ * There are few different scripts, so they are just searched linearly.
+ *
+ *    @param name Name of the script, can be NULL.
+ *    @return Index of the name in profile_scripts, or -1 if NULL.
+ */
+static int profile_script( const char *name )
+{
+   if (name == NULL)
+      return -1;
+   if (profile_scripts == NULL)
+      profile_scripts = array_create( char* );
+   for (int i=array_size(profile_scripts)-1; i>=0; i--)
+      if (strcmp( profile_scripts[i], name )==0)
+         return i;
+   array_push_back( &profile_scripts, strdup( name ) );
+   return array_size(profile_scripts)-1;
+}
+
+/**
+ * @brief Frees the names of the scripts.
+ */
+static void profile_freeScripts (void)
+{
+   for (int i=0; i<array_size(profile_scripts); i++)
+      free( profile_scripts[i] );
+   array_free( profile_scripts );
+   profile_scripts = NULL;
+}
+
+/**
+ * @brief Enters a zone.
+ *
+ *    @param zone Zone being entered.
+ */
+void profile_begin( ProfileZone zone )
+{
+   profile_beginName( zone, NULL );
+}
+
+/**
+ * @brief Enters a zone that runs a script.
+ *
+ * The name is copied, and only kept for the outermost call when the zone is
+ * entered again before being left.
+ *
+ *    @param zone Zone being entered.
+ *    @param name Name of the script being run, or NULL.
+ */
+void profile_beginName( ProfileZone zone, const char *name )
+{
+   ProfileTimer *t = &profile_timers[zone];
+   if (t->depth++ > 0)
+      return;
+   if (profile_nstack < PROFILE_ZONES)
+      profile_stack[ profile_nstack++ ] = zone;
+   t->name  = profile_script( name );
+   t->start = SDL_GetPerformanceCounter();
+}
+
+/**
+ * @brief Leaves a zone.
+ *
+ *    @param zone Zone being left.
+ */
+void profile_end( ProfileZone zone )
+{
+   Uint64 end, elapsed;
+   ProfileTimer *t = &profile_timers[zone];
+   ProfileEvent *ev;
+
+   /* Profiler may have been enabled within the zone. */
+   if (t->depth <= 0)
+      return;
+   if (--t->depth > 0)
+      return;
+
+   end = SDL_GetPerformanceCounter();
+   elapsed = end - t->start;
+   t->total += elapsed;
+   t->frame += elapsed;
+   t->calls++;
+
+   /* Charge the time to the zone it is nested in. */
+   if ((profile_nstack > 0) && (profile_stack[profile_nstack-1] == zone))
+      profile_nstack--;
+   if (profile_nstack > 0) {
+      ProfileTimer *parent = &profile_timers[ profile_stack[profile_nstack-1] ];
+      parent->child += elapsed;
+      parent->framechild += elapsed;
+   }
+
+   /* Store for the trace. */
+   ev = &profile_events[ profile_eventHead ];
+   ev->start = t->start;
+   ev->end   = end;
+   ev->zone  = zone;
+   ev->name  = t->name;
+   profile_eventHead = (profile_eventHead+1) % PROFILE_EVENTS;
+   profile_eventCount = MIN( profile_eventCount+1, PROFILE_EVENTS );
+}
+
+/**
+ * @brief Ends a frame, storing the time spent in each zone during it.
+ */
+void profile_frame (void)
+{
+   double freq = (double)SDL_GetPerformanceFrequency() / 1000.;
+   float *f = profile_frames[ profile_frameHead ];
+   for (int i=0; i<PROFILE_ZONES; i++) {
+      ProfileTimer *t = &profile_timers[i];
+      f[i] = (double)(t->frame - MIN(t->frame, t->framechild)) / freq;
+      t->frame = 0;
+      t->framechild = 0;
+   }
+   profile_frameHead = (profile_frameHead+1) % PROFILE_FRAMES;
+   profile_frameCount = MIN( profile_frameCount+1, PROFILE_FRAMES );
+}
+
+/**
+ * @brief Gets the name of a zone.
+ *
+ *    @param zone Zone to get name of.
+ *    @return Name of the zone.
+ */
+const char *profile_name( ProfileZone zone )
+{
+   return profile_names[zone];
+}
+
+/**
+ * @brief Gets the total time spent in a zone since the last reset.
+ *
+ *    @param zone Zone to get time of.
+ *    @return Time spent in the zone (in seconds).
+ */
+double profile_time( ProfileZone zone )
+{
+   return (double)profile_timers[zone].total / (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * @brief Gets the time spent in a zone minus the time spent in the zones nested in it.
+ *
+ *    @param zone Zone to get time of.
+ *    @return Time spent in the zone itself (in seconds).
+ */
+double profile_timeSelf( ProfileZone zone )
+{
+   const ProfileTimer *t = &profile_timers[zone];
+   return (double)(t->total - MIN(t->total, t->child)) / (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * @brief Gets how many times a zone was timed since the last reset.
+ *
+ *    @param zone Zone to get calls of.
+ *    @return Number of times the zone was timed.
+ */
+int profile_calls( ProfileZone zone )
+{
+   return profile_timers[zone].calls;
+}
+
+/**
+ * @brief Adds a line to the graph.
+ */
+static void profile_line( double x1, double y1, double x2, double y2, const glColour *c )
+{
+   ProfileVertex *v = &array_grow( &profile_vertex );
+   v->x   = x1;
+   v->y   = y1;
+   v->col = *c;
+   v = &array_grow( &profile_vertex );
+   v->x   = x2;
+   v->y   = y2;
+   v->col = *c;
+}
+
+/**
+ * @brief Draws the graph of the last frames with a legend.
+ *
+ * Each frame is a column with the self time of every zone stacked, so that the
+ * height of a column is the time taken by the whole frame.
+ *
+ *    @param x X position of the top left corner.
+ *    @param y Y position of the top left corner.
+ *    @return Y position below the graph.
+ */
+double profile_render( double x, double y )
+{
+   GLsizei stride = sizeof(ProfileVertex);
+   double scale = PROFILE_GRAPH_H / PROFILE_GRAPH_MS;
+   double by = y - PROFILE_GRAPH_H;
+   double ly;
+   int n;
+
+   if (profile_vertex == NULL)
+      profile_vertex = array_create_size( ProfileVertex, 2*(PROFILE_FRAMES*PROFILE_ZONES+2) );
+   array_resize( &profile_vertex, 0 );
+
+   /* Columns, oldest on the left. */
+   for (int i=0; i<profile_frameCount; i++) {
+      int f = (profile_frameHead - profile_frameCount + i + PROFILE_FRAMES) % PROFILE_FRAMES;
+      double cx = x + i + 0.5;
+      double cy = by;
+      for (int j=0; j<PROFILE_ZONES; j++) {
+         double h = MIN( profile_frames[f][j] * scale, y - cy );
+         if (h <= 0.)
+            continue;
+         profile_line( cx, cy, cx, cy+h, profile_colours[j] );
+         cy += h;
+      }
+   }
+   /* Marks at 60 and 30 FPS. */
+   profile_line( x, by + scale*1000./60., x+PROFILE_FRAMES, by + scale*1000./60., &cWhite );
+   profile_line( x, y, x+PROFILE_FRAMES, y, &cWhite );
+
+   /* Draw all the lines at once. */
+   n = array_size( profile_vertex );
+   gl_batchFlush();
+   if (profile_vbo == NULL)
+      profile_vbo = gl_vboCreateStream( stride * n, profile_vertex );
+   else
+      gl_vboData( profile_vbo, stride * n, profile_vertex );
+   gl_beginSmoothProgram( gl_view_matrix );
+   gl_vboActivateAttribOffset( profile_vbo, shaders.smooth.vertex,
+         offsetof(ProfileVertex, x), 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( profile_vbo, shaders.smooth.vertex_color,
+         offsetof(ProfileVertex, col), 4, GL_FLOAT, stride );
+   glDrawArrays( GL_LINES, 0, n );
+   gl_drawStatsAdd( 1 );
+   gl_endSmoothProgram();
+
+   /* Legend to the right. */
+   ly = y - gl_smallFont.h;
+   for (int i=0; i<PROFILE_ZONES; i++) {
+      const float *f = profile_frames[ (profile_frameHead + PROFILE_FRAMES - 1) % PROFILE_FRAMES ];
+      gl_print( &gl_smallFont, x + PROFILE_FRAMES + 10., ly, profile_colours[i],
+            "%s %.2f", profile_names[i], (profile_frameCount > 0) ? f[i] : 0. );
+      ly -= gl_smallFont.h + 2.;
+   }
+
+   return MIN( by, ly ) - 5.;
+}
+
+/**
+ * @brief Escapes a string to be written inside a JSON string.
+ *
+ *    @param[out] out Buffer to write to.
+ *    @param n Size of the buffer.
+ *    @param s String to escape.
+ */
+static void profile_jsonString( char *out, size_t n, const char *s )
+{
+   size_t j = 0;
+   for (const unsigned char *c=(const unsigned char*)s; (*c!='\0') && (j+7<n); c++) {
+      if ((*c=='"') || (*c=='\\')) {
+         out[j++] = '\\';
+         out[j++] = *c;
+      }
+      else if (*c < 0x20)
+         j += scnprintf( &out[j], n-j, "\\u%04x", *c );
+      else
+         out[j++] = *c;
+   }
+   out[j] = '\0';
+}
+
+/**
+ * @brief Writes the last timed zones as a Chrome trace.
+ *
+ *    @param filename Name of the file to write to (relative to the write directory).
+ *    @return 0 on success.
+ */
+int profile_trace( const char *filename )
+{
+   PHYSFS_File *f;
+   double freq = (double)SDL_GetPerformanceFrequency() / 1e6;
+   Uint64 t0;
+   char buf[STRMAX_SHORT], name[STRMAX_SHORT];
+
+   if (profile_eventCount <= 0) {
+      WARN(_("No profiling data to write to '%s'!"), filename);
+      return -1;
+   }
+
+   f = PHYSFS_openWrite( filename );
+   if (f == NULL) {
+      WARN(_("Unable to open '%s' for writing: %s"), filename, _(PHYSFS_getErrorByCode( PHYSFS_getLastErrorCode() ) ));
+      return -1;
+   }
+
+   /* Times are in microseconds since the earliest event. Events are stored
+    * when their zone is left, so it is not necessarily the oldest one. */
+   t0 = profile_events[ (profile_eventHead - profile_eventCount + PROFILE_EVENTS) % PROFILE_EVENTS ].start;
+   for (int i=1; i<profile_eventCount; i++) {
+      const ProfileEvent *ev = &profile_events[ (profile_eventHead - profile_eventCount + i + PROFILE_EVENTS) % PROFILE_EVENTS ];
+      t0 = MIN( t0, ev->start );
+   }
+   PHYSFS_writeBytes( f, "{\"traceEvents\":[\n", 17 );
+   for (int i=0; i<profile_eventCount; i++) {
+      const ProfileEvent *ev = &profile_events[ (profile_eventHead - profile_eventCount + i + PROFILE_EVENTS) % PROFILE_EVENTS ];
+      int l;
+      /* Scripts are named after themselves, with the zone as category. */
+      if (ev->name >= 0)
+         profile_jsonString( name, sizeof(name), profile_scripts[ev->name] );
+      else
+         strncpy( name, profile_names[ev->zone], sizeof(name)-1 );
+      name[sizeof(name)-1] = '\0';
+      l = scnprintf( buf, sizeof(buf),
+            "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+            name, profile_names[ev->zone], (double)(ev->start-t0) / freq,
+            (double)(ev->end-ev->start) / freq, (i < profile_eventCount-1) ? "," : "" );
+      PHYSFS_writeBytes( f, buf, l );
+   }
+   PHYSFS_writeBytes( f, "],\"displayTimeUnit\":\"ms\"}\n", 26 );
+   PHYSFS_close( f );
+
+   DEBUG(_("Wrote %d profiling events to '%s%s'"), profile_eventCount, PHYSFS_getWriteDir(), filename);
+   return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+/**
+ * @brief Parts of the game loop that can be timed.
+ */
+typedef enum ProfileZone_ {
+   PROFILE_FRAME,    /**< main_loop(), not counting the frame limiter. */
+   PROFILE_SPACE,    /**< space_update() */
+   PROFILE_WEAPONS,  /**< weapons_update() */
+   PROFILE_SPFX,     /**< spfx_update() */
+   PROFILE_PILOTS,   /**< pilots_update() */
+   PROFILE_AI,       /**< ai_think() */
+   PROFILE_HOOKS,    /**< Update hooks and deferred hooks. */
+   PROFILE_RENDER,   /**< render_all() */
+   PROFILE_LUA_AI,   /**< AI Lua tasks (ai_run()). */
+   PROFILE_LUA_HOOK, /**< Any hook (hook_run()). */
+   PROFILE_LUA_OUTFIT, /**< Outfit Lua scripts (pilot_outfitLRun()). */
+   PROFILE_LUA_SCHEDULER, /**< System spawn scripts (system_scheduler()). */
+   PROFILE_ZONES     /**< Number of zones, not a real zone. */
+} ProfileZone;
+
+extern int profile_enabled;
+
+/**
+ * @brief Starts timing a zone, does nothing if the profiler is disabled.
+ */
+#define PROFILE_BEGIN( z ) \
+do { if (profile_enabled) profile_begin( z ); } while (0)
+/**
+ * @brief Starts timing a zone that runs a script, does nothing (not even
+ *  evaluating the name) if the profiler is disabled.
+ */
+#define PROFILE_BEGIN_NAME( z, name ) \
+do { if (profile_enabled) profile_beginName( z, name ); } while (0)
+/**
+ * @brief Stops timing a zone, does nothing if the profiler is disabled.
+ */
+#define PROFILE_END( z ) \
+do { if (profile_enabled) profile_end( z ); } while (0)
+
+/* Control. */
+void profile_enable( int enable );
+void profile_reset (void);
+void profile_exit (void);
+
+/* Timing. */
+void profile_begin( ProfileZone zone );
+void profile_beginName( ProfileZone zone, const char *name );
+void profile_end( ProfileZone zone );
+void profile_frame (void);
+
+/* Results. */
+const char *profile_name( ProfileZone zone );
+double profile_time( ProfileZone zone );
+double profile_timeSelf( ProfileZone zone );
+int profile_calls( ProfileZone zone );
+double profile_render( double x, double y );
+int profile_trace( const char *filename );
@@ -175,6 +175,9 @@ void render_all( double game_dt, double real_dt )
    int pp_final, pp_gui, pp_game;
    int cur = 0;
 
+   /* New frame for the statistics. */
+   gl_drawStatsReset();
+
    /* See what post-processing is up. */
    pp_game  = (array_size(pp_shaders_list[PP_LAYER_GAME]) > 0);
    pp_gui   = (array_size(pp_shaders_list[PP_LAYER_GUI]) > 0);
@@ -82,6 +82,18 @@ void rng_init (void)
       mt_genArray();
 }
 
+/**
+ * @brief Reseeds the random subsystem so that it gives reproducible numbers.
+ *
+ *    @param seed Seed to use.
+ */
+void rng_seed( unsigned int seed )
+{
+   mt_initArray( seed );
+   for (int i=0; i<10; i++) /* generate numbers to get away from poor initial values */
+      mt_genArray();
+}
+
 /**
  * @fn static uint32_t rng_timeEntropy (void)
  *
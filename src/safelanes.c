@@ -33,6 +33,7 @@
 #else /* HAVE_SUITESPARSE_CHOLMOD_H */
 #include <cholmod.h>
 #endif /* HAVE_SUITESPARSE_CHOLMOD_H */
+#include "physfs.h"
 
 #include "naev.h"
 /** @endcond */
@@ -44,6 +45,11 @@
 #include "log.h"
 #include "union_find.h"
 
+#define SAFELANES_CACHE_PATH     "cache/safelanes/" /**< Where computed lanes are cached in the write dir. */
+#define SAFELANES_CACHE_MAGIC    "NAEVLANE"  /**< Identifies lane cache files. */
+#define SAFELANES_CACHE_VERSION  1           /**< Version of the lane cache format, bump when the algorithm changes. */
+#define SAFELANES_CACHE_MAX      8           /**< Maximum number of cached universes to keep around. */
+
 /*
  * Global parameters.
  */
@@ -51,6 +57,8 @@ static const double ALPHA            = 9.;       /**< Lane efficiency parameter.
 static const double LAMBDA           = 2e10;     /**< Regularization term for score. */
 static const double JUMP_CONDUCTIVITY= 0.001;    /**< Conductivity value for inter-system jump-point connections. */
 static const double MIN_ANGLE        = M_PI/18.; /**< Path triangles can't be more acute. */
+static const uint64_t HASH_INIT      = 14695981039346656037ULL; /**< FNV-1a offset basis. */
+static const uint64_t HASH_PRIME     = 1099511628211ULL;        /**< FNV-1a prime. */
 enum {
    STORAGE_MODE_LOWER_TRIANGULAR_PART= -1,       /**< A CHOLMOD "stype" value: matrix is interpreted as symmetric. */
    STORAGE_MODE_UNSYMMETRIC          = 0,        /**< A CHOLMOD "stype" value: matrix holds whatever we put in it. */
@@ -85,6 +93,15 @@ typedef struct Faction_ {
    double lane_base_cost;           /**< Base cost of a lane. */
 } Faction;
 
+/** @brief Header of a lane cache file, followed by the lane faction of each edge. */
+typedef struct SafeLanesCacheHeader_ {
+   char magic[8];       /**< SAFELANES_CACHE_MAGIC. */
+   uint32_t version;    /**< SAFELANES_CACHE_VERSION. */
+   uint32_t nedges;     /**< Number of edges (and lane factions) stored. */
+   uint64_t hash;       /**< Hash of the inputs the lanes were computed from. */
+   char naev[32];       /**< Version of Naev that computed the lanes. */
+} SafeLanesCacheHeader;
+
 /** @brief A set of lane-building factions, represented as a bitfield. */
 typedef uint32_t FactionMask;
 static const FactionMask MASK_0 = 0, MASK_1 = 1;
@@ -112,6 +129,12 @@ static cholmod_sparse *QtQ;     /**< (Q*)Q where Q is the ExV difference matrix.
 static cholmod_dense *ftilde;   /**< Fluxes (bunch of F columns in the KU=F problem). */
 static cholmod_dense *utilde;   /**< Potentials (bunch of U columns in the KU=F problem). */
 static cholmod_dense **PPl;     /**< Array: (array.h): For each builder faction, The (P*)P in: grad_u(phi)=(Q*)Q U~ (P*)P. */
+static cholmod_factor *stiff_f; /**< Factorization of the K matrix, kept up to date with rank-one updates as lanes get activated. */
+static int *activated_edges;    /**< Array (array.h): Edges activated since stiff_f was last brought up to date. */
+static cholmod_factor *stiff_sym;/**< Cached symbolic factorization of the K matrix, reused while its sparsity pattern is unchanged. */
+static uint64_t stiff_sym_hash; /**< Hash of the sparsity pattern stiff_sym was computed for. */
+static uint64_t lanes_hash;     /**< Hash of the inputs the current lanes were computed from, 0 if they must be recomputed. */
+static int lanes_nodisk = 0;    /**< Whether the next recalculation should ignore the on-disk cache. */
 static double* cmp_key_ref;     /**< To qsort() a list of indices by table value, point this at your table and use cmp_key. */
 static int safelanes_calculated_once = 0; /**< Whether or not the safe lanes have been computed once. */
 
@@ -135,6 +158,16 @@ static void safelanes_updateConductivity ( int ei_activated );
 static void safelanes_initQtQ (void);
 static void safelanes_initFTilde (void);
 static void safelanes_initPPl (void);
+static void safelanes_factorize (void);
+static int safelanes_updateFactor (void);
+#if DEBUG_PARANOID
+static void safelanes_checkFactor (void);
+#endif /* DEBUG_PARANOID */
+static uint64_t safelanes_hash( uint64_t h, const void *data, size_t len );
+static uint64_t safelanes_hashInputs (void);
+static int safelanes_cacheLoad( uint64_t h );
+static void safelanes_cacheSave( uint64_t h );
+static void safelanes_cachePrune (void);
 static int safelanes_triangleTooFlat( const vec2* m, const vec2* n, const vec2* p, double lmn );
 static int vertex_faction( int vi );
 static const vec2* vertex_pos( int vi );
@@ -164,6 +197,8 @@ static inline void array_push_back_edge( Edge **a, int v0, int v1 )
 void safelanes_init (void)
 {
    cholmod_start( &C );
+   /* cholmod_updown() only works on simplicial LDL' factors, so don't bother making supernodal ones. */
+   C.supernodal = CHOLMOD_SIMPLICIAL;
    /* Ideally we would want to recalculate here, but since we load the first
     * save and try to use unidiffs there, we instead defer the safe lane
     * computation to only if necessary after loading save unidiffs. */
@@ -177,6 +212,7 @@ void safelanes_destroy (void)
 {
    safelanes_destroyOptimizer();
    safelanes_destroyStacks();
+   cholmod_free_factor( &stiff_sym, &C );
    cholmod_finish( &C );
 }
 
@@ -252,16 +288,36 @@ SafeLane* safelanes_get( int faction, int standing, const StarSystem* system )
 void safelanes_recalculate (void)
 {
    Uint32 time = SDL_GetTicks();
+   int *lane_faction_prev;
+   uint64_t h;
 
    /* Don't recompute on exit. */
    if (naev_isQuit())
       return;
 
+   /* Hold on to the previous lanes, they are still valid if nothing they depend on changed. */
+   lane_faction_prev = lane_faction;
+   lane_faction = NULL;
    safelanes_initStacks();
-   safelanes_initOptimizer();
-   for (int iters_done=0; safelanes_buildOneTurn(iters_done) > 0; iters_done++)
-      ;
-   safelanes_destroyOptimizer();
+   h = safelanes_hashInputs();
+   if ((h == lanes_hash) && (array_size(lane_faction_prev) == array_size(lane_faction))) {
+      memcpy( lane_faction, lane_faction_prev, array_size(lane_faction)*sizeof(lane_faction[0]) );
+      safelanes_destroyTmp();
+   }
+   else if (!lanes_nodisk && (safelanes_cacheLoad( h ) == 0)) {
+      safelanes_destroyTmp();
+      lanes_hash = h;
+   }
+   else {
+      safelanes_initOptimizer();
+      for (int iters_done=0; safelanes_buildOneTurn(iters_done) > 0; iters_done++)
+         ;
+      safelanes_destroyOptimizer();
+      lanes_hash = h;
+      safelanes_cacheSave( h );
+   }
+   array_free( lane_faction_prev );
+   lanes_nodisk = 0;
    /* Stacks remain available for queries. */
    time = SDL_GetTicks() - time;
    if (conf.devmode)
@@ -270,6 +326,148 @@ void safelanes_recalculate (void)
    safelanes_calculated_once = 1;
 }
 
+/**
+ * @brief Discards the cached factorization and lanes, so the next recalculation starts from scratch like at startup.
+ *
+ *    @param disk Whether or not to also ignore the lanes cached on disk for the next recalculation.
+ */
+void safelanes_invalidate( int disk )
+{
+   cholmod_free_factor( &stiff_sym, &C );
+   stiff_sym_hash = 0;
+   lanes_hash = 0;
+   lanes_nodisk = disk;
+}
+
+/**
+ * @brief Tries to load the lanes computed for the given inputs from the on-disk cache. Stacks must be set up.
+ *
+ *    @param h Hash of the inputs.
+ *    @return 0 if the lanes were loaded, -1 otherwise.
+ */
+static int safelanes_cacheLoad( uint64_t h )
+{
+   char path[PATH_MAX];
+   PHYSFS_File *f;
+   SafeLanesCacheHeader hdr;
+   int n = array_size(lane_faction);
+   size_t len = n*sizeof(lane_faction[0]);
+
+   snprintf( path, sizeof(path), SAFELANES_CACHE_PATH"%016"PRIx64, h );
+   if (!PHYSFS_exists( path ))
+      return -1;
+   f = PHYSFS_openRead( path );
+   if (f == NULL)
+      return -1;
+
+   /* Anything that doesn't match exactly is just stale, not an error. */
+   if ((PHYSFS_readBytes( f, &hdr, sizeof(hdr) ) != sizeof(hdr))
+         || (memcmp( hdr.magic, SAFELANES_CACHE_MAGIC, sizeof(hdr.magic) ) != 0)
+         || (hdr.version != SAFELANES_CACHE_VERSION)
+         || (strncmp( hdr.naev, naev_version(0), sizeof(hdr.naev)-1 ) != 0)
+         || (hdr.hash != h) || (hdr.nedges != (uint32_t)n)
+         || (PHYSFS_readBytes( f, lane_faction, len ) != (PHYSFS_sint64)len)) {
+      PHYSFS_close( f );
+      memset( lane_faction, 0, len );
+      if (conf.devmode)
+         DEBUG( _("Ignoring stale safe lane cache '%s'"), path );
+      return -1;
+   }
+   PHYSFS_close( f );
+
+   /* Make sure the lanes are owned by factions that can build them. */
+   for (int i=0; i<n; i++) {
+      if ((lane_faction[i] != 0) && (FACTION_ID_TO_INDEX( lane_faction[i] ) < 0)) {
+         memset( lane_faction, 0, len );
+         WARN( _("Safe lane cache '%s' is corrupt, recomputing."), path );
+         return -1;
+      }
+   }
+   if (conf.devmode)
+      DEBUG( _("Loaded safe lanes from '%s'"), path );
+   return 0;
+}
+
+/**
+ * @brief Saves the current lanes to the on-disk cache.
+ *
+ *    @param h Hash of the inputs the lanes were computed from.
+ */
+static void safelanes_cacheSave( uint64_t h )
+{
+   char path[PATH_MAX];
+   PHYSFS_File *f;
+   SafeLanesCacheHeader hdr;
+   int n = array_size(lane_faction);
+   size_t len = n*sizeof(lane_faction[0]);
+
+   memset( &hdr, 0, sizeof(hdr) );
+   memcpy( hdr.magic, SAFELANES_CACHE_MAGIC, sizeof(hdr.magic) );
+   hdr.version = SAFELANES_CACHE_VERSION;
+   hdr.nedges  = n;
+   hdr.hash    = h;
+   strncpy( hdr.naev, naev_version(0), sizeof(hdr.naev)-1 );
+
+   if (!PHYSFS_mkdir( SAFELANES_CACHE_PATH ))
+      return;
+   safelanes_cachePrune();
+
+   snprintf( path, sizeof(path), SAFELANES_CACHE_PATH"%016"PRIx64, h );
+   f = PHYSFS_openWrite( path );
+   if (f == NULL) {
+      WARN( _("Unable to write safe lane cache '%s': %s"), path,
+            _(PHYSFS_getErrorByCode( PHYSFS_getLastErrorCode() ) ) );
+      return;
+   }
+   if ((PHYSFS_writeBytes( f, &hdr, sizeof(hdr) ) != sizeof(hdr))
+         || (PHYSFS_writeBytes( f, lane_faction, len ) != (PHYSFS_sint64)len)) {
+      WARN( _("Unable to write safe lane cache '%s': %s"), path,
+            _(PHYSFS_getErrorByCode( PHYSFS_getLastErrorCode() ) ) );
+      PHYSFS_close( f );
+      PHYSFS_delete( path );
+      return;
+   }
+   PHYSFS_close( f );
+}
+
+/**
+ * @brief Deletes the oldest cache files so a new one can be added without exceeding SAFELANES_CACHE_MAX.
+ */
+static void safelanes_cachePrune (void)
+{
+   char path[PATH_MAX];
+   char **files = PHYSFS_enumerateFiles( SAFELANES_CACHE_PATH );
+   int n = 0;
+
+   if (files == NULL)
+      return;
+   for (char **i=files; *i!=NULL; i++)
+      n++;
+
+   for (; n >= SAFELANES_CACHE_MAX; n--) {
+      PHYSFS_sint64 oldest_time = -1;
+      const char *oldest = NULL;
+      for (char **i=files; *i!=NULL; i++) {
+         PHYSFS_Stat stat;
+         if (**i == '\0')
+            continue;
+         snprintf( path, sizeof(path), SAFELANES_CACHE_PATH"%s", *i );
+         if (!PHYSFS_stat( path, &stat ))
+            continue;
+         if ((oldest == NULL) || (stat.modtime < oldest_time)) {
+            oldest = *i;
+            oldest_time = stat.modtime;
+         }
+      }
+      if (oldest == NULL)
+         break;
+      snprintf( path, sizeof(path), SAFELANES_CACHE_PATH"%s", oldest );
+      PHYSFS_delete( path );
+      *(char*)oldest = '\0'; /* Don't consider it again. */
+   }
+   PHYSFS_freeList( files );
+}
+
 /**
  * @brief Whether or not the safe lanes have been calculated at least once.
  */
@@ -288,6 +486,7 @@ static void safelanes_initOptimizer (void)
    safelanes_initFTilde();
    safelanes_initPPl();
    safelanes_destroyTmp();
+   activated_edges = array_create( int );
 }
 
 /**
@@ -302,6 +501,9 @@ static void safelanes_destroyOptimizer (void)
    cholmod_free_dense( &utilde, &C ); /* CAUTION: if we instead save it, ensure it's updated after the final activateByGradient. */
    cholmod_free_dense( &ftilde, &C );
    cholmod_free_sparse( &QtQ, &C );
+   cholmod_free_factor( &stiff_f, &C );
+   array_free( activated_edges );
+   activated_edges = NULL;
    cholmod_free_triplet( &stiff, &C );
 }
 
@@ -310,16 +512,14 @@ static void safelanes_destroyOptimizer (void)
  */
 static int safelanes_buildOneTurn( int iters_done )
 {
-   cholmod_sparse *stiff_s;
-   cholmod_factor *stiff_f;
    cholmod_dense *_QtQutilde, *Lambda_tilde, *Y_workspace, *E_workspace;
    int turns_next_time;
    double zero[] = {0, 0}, neg_1[] = {-1, 0};
 
    Y_workspace = E_workspace = Lambda_tilde = NULL;
-   stiff_s = cholmod_triplet_to_sparse( stiff, 0, &C );
-   stiff_f = cholmod_analyze( stiff_s, &C );
-   cholmod_factorize( stiff_s, stiff_f, &C );
+   /* Only the first turn needs a full factorization, the lanes activated since are rank-one updates. */
+   if ((stiff_f == NULL) || !safelanes_updateFactor())
+      safelanes_factorize();
    cholmod_solve2( CHOLMOD_A, stiff_f, ftilde, NULL, &utilde, NULL, &Y_workspace, &E_workspace, &C );
    _QtQutilde = cholmod_zeros( utilde->nrow, utilde->ncol, CHOLMOD_REAL, &C );
    cholmod_sdmult( QtQ, 0, neg_1, zero, utilde, _QtQutilde, &C );
@@ -327,14 +527,123 @@ static int safelanes_buildOneTurn( int iters_done )
    cholmod_free_dense( &_QtQutilde, &C );
    cholmod_free_dense( &Y_workspace, &C );
    cholmod_free_dense( &E_workspace, &C );
-   cholmod_free_factor( &stiff_f, &C );
-   cholmod_free_sparse( &stiff_s, &C );
    turns_next_time = safelanes_activateByGradient( Lambda_tilde, iters_done );
    cholmod_free_dense( &Lambda_tilde, &C );
 
    return turns_next_time;
 }
 
+/**
+ * @brief Numerically factorizes the K matrix from scratch, reusing the cached symbolic factorization if possible.
+ */
+static void safelanes_factorize (void)
+{
+   cholmod_sparse *stiff_s;
+   uint64_t h;
+
+   /* The symbolic analysis only depends on the pattern, which only changes when the universe does. */
+   h = safelanes_hash( HASH_INIT, &stiff->nrow, sizeof(stiff->nrow) );
+   h = safelanes_hash( h, stiff->i, stiff->nnz*sizeof(int) );
+   h = safelanes_hash( h, stiff->j, stiff->nnz*sizeof(int) );
+
+   stiff_s = cholmod_triplet_to_sparse( stiff, 0, &C );
+   if ((stiff_sym == NULL) || (h != stiff_sym_hash)) {
+      cholmod_free_factor( &stiff_sym, &C );
+      stiff_sym = cholmod_analyze( stiff_s, &C );
+      stiff_sym_hash = h;
+   }
+   cholmod_free_factor( &stiff_f, &C );
+   stiff_f = cholmod_copy_factor( stiff_sym, &C );
+   cholmod_factorize( stiff_s, stiff_f, &C );
+   cholmod_free_sparse( &stiff_s, &C );
+   array_resize( &activated_edges, 0 );
+}
+
+/**
+ * @brief Updates the factorization of the K matrix with the lanes activated since the last turn.
+ *
+ * Activating edge (i,j) with conductivity c adds ALPHA*c*(e_i-e_j)(e_i-e_j)' to K,
+ * so all the activations of a turn are a single rank-k update of the factor.
+ *
+ *    @return 1 on success, 0 if the factor has to be recomputed.
+ */
+static int safelanes_updateFactor (void)
+{
+   int n, k, ret;
+   int *pinv, *cp, *ci;
+   const int *perm;
+   double *cx;
+   cholmod_sparse *W;
+
+   k = array_size(activated_edges);
+   if (k == 0)
+      return 1;
+
+   /* The rows of the update must be permuted like the factor's. */
+   n = stiff_f->n;
+   perm = stiff_f->Perm;
+   pinv = malloc( n*sizeof(int) );
+   for (int i=0; i<n; i++)
+      pinv[ (perm!=NULL) ? perm[i] : i ] = i;
+
+   W = cholmod_allocate_sparse( n, k, 2*k, SORTED, PACKED, STORAGE_MODE_UNSYMMETRIC, CHOLMOD_REAL, &C );
+   cp = W->p;
+   ci = W->i;
+   cx = W->x;
+   cp[0] = 0;
+   for (int c=0; c<k; c++) {
+      int ei = activated_edges[c];
+      int r0 = pinv[ edge_stack[ei][0] ];
+      int r1 = pinv[ edge_stack[ei][1] ];
+      double w = sqrt( ALPHA * safelanes_initialConductivity( ei ) );
+      cp[c+1]     = 2*(c+1);
+      ci[2*c+0]   = MIN( r0, r1 );
+      ci[2*c+1]   = MAX( r0, r1 );
+      cx[2*c+0]   = +w;
+      cx[2*c+1]   = -w;
+   }
+   ret = cholmod_updown( 1, W, stiff_f, &C );
+   cholmod_free_sparse( &W, &C );
+   free( pinv );
+   array_resize( &activated_edges, 0 );
+
+#if DEBUG_PARANOID
+   if (ret)
+      safelanes_checkFactor();
+#endif /* DEBUG_PARANOID */
+   return ret;
+}
+
+#if DEBUG_PARANOID
+/**
+ * @brief Checks that the updated factorization solves the same system as a fresh one.
+ */
+static void safelanes_checkFactor (void)
+{
+   cholmod_sparse *stiff_s;
+   cholmod_factor *ref_f;
+   cholmod_dense *u, *ref_u;
+   double err, norm;
+
+   stiff_s = cholmod_triplet_to_sparse( stiff, 0, &C );
+   ref_f = cholmod_analyze( stiff_s, &C );
+   cholmod_factorize( stiff_s, ref_f, &C );
+   u     = cholmod_solve( CHOLMOD_A, stiff_f, ftilde, &C );
+   ref_u = cholmod_solve( CHOLMOD_A, ref_f, ftilde, &C );
+   err = norm = 0.;
+   for (size_t i=0; i<u->nrow*u->ncol; i++) {
+      err  = MAX( err, fabs( ((double*)u->x)[i] - ((double*)ref_u->x)[i] ) );
+      norm = MAX( norm, fabs( ((double*)ref_u->x)[i] ) );
+   }
+   if (err > 1e-6 * MAX( norm, 1. ))
+      WARN( _("Safe lane factorization update drifted: error %g (norm %g)"), err, norm );
+   cholmod_free_dense( &u, &C );
+   cholmod_free_dense( &ref_u, &C );
+   cholmod_free_factor( &ref_f, &C );
+   cholmod_free_sparse( &stiff_s, &C );
+}
+#endif /* DEBUG_PARANOID */
+
 /**
  * @brief Sets up the local faction/object stacks.
  */
@@ -594,6 +903,8 @@ static void safelanes_updateConductivity ( int ei_activated )
    double *sv = stiff->x;
    for (int i=3*ei_activated; i<3*(ei_activated+1); i++)
       sv[i] *= 1+ALPHA;
+   /* Remember to update the factorization next turn. */
+   array_push_back( &activated_edges, ei_activated );
 }
 
 /**
@@ -834,6 +1145,58 @@ static int safelanes_activateByGradient( cholmod_dense* Lambda_tilde, int iters_
    return turns_next_time;
 }
 
+/**
+ * @brief Mixes some data into an FNV-1a hash.
+ */
+static uint64_t safelanes_hash( uint64_t h, const void *data, size_t len )
+{
+   const unsigned char *b = data;
+   for (size_t i=0; i<len; i++) {
+      h ^= b[i];
+      h *= HASH_PRIME;
+   }
+   return h;
+}
+
+/**
+ * @brief Hashes everything the lane optimization depends on. Stacks must be set up.
+ */
+static uint64_t safelanes_hashInputs (void)
+{
+   uint64_t h = HASH_INIT;
+
+   for (int i=0; i<array_size(vertex_stack); i++) {
+      const vec2 *pos = vertex_pos( i );
+      h = safelanes_hash( h, &vertex_stack[i], sizeof(Vertex) );
+      h = safelanes_hash( h, &pos->x, sizeof(double) );
+      h = safelanes_hash( h, &pos->y, sizeof(double) );
+   }
+   h = safelanes_hash( h, edge_stack, array_size(edge_stack)*sizeof(Edge) );
+   h = safelanes_hash( h, lane_fmask, array_size(lane_fmask)*sizeof(FactionMask) );
+   h = safelanes_hash( h, tmp_edge_conduct, array_size(tmp_edge_conduct)*sizeof(double) );
+   h = safelanes_hash( h, tmp_jump_edges, array_size(tmp_jump_edges)*sizeof(Edge) );
+   h = safelanes_hash( h, tmp_anchor_vertices, array_size(tmp_anchor_vertices)*sizeof(int) );
+   for (int fi=0; fi<array_size(faction_stack); fi++) {
+      h = safelanes_hash( h, &faction_stack[fi].id, sizeof(int) );
+      h = safelanes_hash( h, &faction_stack[fi].lane_length_per_presence, sizeof(double) );
+      h = safelanes_hash( h, &faction_stack[fi].lane_base_cost, sizeof(double) );
+      h = safelanes_hash( h, presence_budget[fi], array_size(presence_budget[fi])*sizeof(double) );
+   }
+   for (int i=0; i<array_size(tmp_spob_indices); i++) {
+      const Vertex *v = &vertex_stack[ tmp_spob_indices[i] ];
+      const Spob *pnt = system_getIndex( v->system )->spobs[ v->index ];
+      h = safelanes_hash( h, &pnt->presence.faction, sizeof(int) );
+      h = safelanes_hash( h, &pnt->presence.base, sizeof(double) );
+      h = safelanes_hash( h, &pnt->presence.bonus, sizeof(double) );
+   }
+   /* Components of the jump graph, which determine the PPl matrices. */
+   for (int i=0; i<array_size(tmp_spob_indices); i++) {
+      int comp = unionfind_find( &tmp_sys_uf, vertex_stack[tmp_spob_indices[i]].system );
+      h = safelanes_hash( h, &comp, sizeof(int) );
+   }
+   return (h != 0) ? h : 1;
+}
+
 /** @brief It's a qsort comparator. Set the cmp_key_ref pointer prior to use, or else. */
 static int cmp_key( const void* p1, const void* p2 )
 {
@@ -5,12 +5,22 @@
  * @file save.c
  *
  * @brief Handles saving/loading games.
+ *
+ * The game state is serialized straight into a flat memory buffer on the main
+ * thread without building a DOM, which is then compressed and written to disk
+ * by a dedicated thread. Saves are written in the order they were made.
  */
 /** @cond */
 #include <errno.h>
+#include <stdio.h>
 #include "physfs.h"
+#include "SDL_thread.h"
 
 #include "naev.h"
+
+#if WIN32
+#include <windows.h>
+#endif /* WIN32 */
 /** @endcond */
 
 #include "save.h"
@@ -36,8 +46,28 @@
 #include "start.h"
 #include "unidiff.h"
 
+/**
+ * @brief A saved game waiting to be written to disk.
+ */
+typedef struct SaveJob_ {
+   xmlBufferPtr buf; /**< Serialized snapshot of the game state. */
+   int compress;  /**< Whether or not to compress the file. */
+   char *path;    /**< Real path of the file to write. */
+   char *backup;  /**< PhysicsFS path of the file to back up first, or NULL. */
+   char *backup_to; /**< PhysicsFS path to back up to. */
+} SaveJob;
+
 int save_loaded   = 0; /**< Just loaded the saved game. */
 
+static SDL_Thread *save_thread   = NULL; /**< Thread writing the saves. */
+static SDL_mutex *save_lock      = NULL; /**< Protects the queue. */
+static SDL_cond *save_cond       = NULL; /**< Signals changes to the queue. */
+static SaveJob *save_queue       = NULL; /**< Array (array.h): Saves waiting to be written, oldest first. */
+static int save_busy             = 0;    /**< Whether or not a save is being written. */
+static int save_quit             = 0;    /**< Tells the thread to stop once the queue is empty. */
+static int save_failed           = 0;    /**< Whether or not a save written by the thread failed since the last save_status(). */
+static int save_size             = 64*1024; /**< Size of the last save, used to size the next buffer. */
+
 /*
  * prototypes
  */
@@ -62,6 +92,9 @@ extern int economy_sysSave( xmlTextWriterPtr writer ); /**< Saves the economy st
 extern int diff_save( xmlTextWriterPtr writer ); /**< Saves the universe diffs. */
 /* static */
 static int save_data( xmlTextWriterPtr writer );
+static int save_thread_main( void *unused );
+static int save_write( SaveJob *job );
+static void save_freeJob( SaveJob *job );
 
 /**
  * @brief Saves all the player's game data.
@@ -72,15 +105,18 @@ static int save_data( xmlTextWriterPtr writer );
 static int save_data( xmlTextWriterPtr writer )
 {
    /* the data itself */
+   /* Sections are written in the order they are loaded in so that loading
+    * can free each one as soon as it has been read. */
    if (diff_save(writer) < 0) return -1; /* Must save first or can get cleared. */
+   if (missions_saveCommodity(writer) < 0) return -1;
+   if (pfaction_save(writer) < 0) return -1;
    if (player_save(writer) < 0) return -1;
+   if (space_sysSave(writer) < 0) return -1;
+   if (var_save(writer) < 0) return -1;
    if (missions_saveActive(writer) < 0) return -1;
    if (events_saveActive(writer) < 0) return -1;
    if (news_saveArticles( writer ) < 0) return -1;
-   if (var_save(writer) < 0) return -1;
-   if (pfaction_save(writer) < 0) return -1;
    if (hook_save(writer) < 0) return -1;
-   if (space_sysSave(writer) < 0) return -1;
    if (economy_sysSave(writer) < 0) return -1;
    if (shiplog_save(writer) < 0) return -1;
    return 0;
@@ -106,17 +142,20 @@ int save_all_with_name( const char *name )
 {
    char file[PATH_MAX];
    const plugin_t *plugins = plugin_list();
-   xmlDocPtr doc;
+   xmlBufferPtr buf;
    xmlTextWriterPtr writer;
+   SaveJob job;
 
    /* Do not save if saving is off. */
    if (player_isFlag(PLAYER_NOSAVE))
       return 0;
 
-   /* Create the writer. */
-   writer = xmlNewTextWriterDoc(&doc, conf.save_compress);
+   /* Create the writer, the buffer is sized from the last save so it rarely grows. */
+   buf = xmlBufferCreateSize( save_size );
+   writer = (buf != NULL) ? xmlNewTextWriterMemory( buf, 0 ) : NULL;
    if (writer == NULL) {
       ERR(_("testXmlwriterDoc: Error creating the xml writer"));
+      xmlBufferFree( buf );
       return -1;
    }
 
@@ -167,44 +206,201 @@ int save_all_with_name( const char *name )
       goto err_writer;
    }
 
-   /* Back up old saved game. */
+   /* Back up old saved game, done by the save thread so it happens after previous saves are written. */
+   memset( &job, 0, sizeof(SaveJob) );
    if (!strcmp(name, "autosave")) {
       if (!save_loaded) {
-         char backup[PATH_MAX];
-         snprintf(file, sizeof(file), "saves/%s/autosave.ns", player.name);
-         snprintf(backup, sizeof(backup), "saves/%s/backup.ns", player.name);
-         if (ndata_copyIfExists(file, backup) < 0) {
-            WARN(_("Aborting save…"));
-            goto err_writer;
-         }
+         SDL_asprintf( &job.backup, "saves/%s/autosave.ns", player.name );
+         SDL_asprintf( &job.backup_to, "saves/%s/backup.ns", player.name );
       }
       save_loaded = 0;
    }
 
-   /* Critical section, if crashes here player's game gets corrupted.
-    * Luckily we have a copy just in case... */
-   xmlFreeTextWriter(writer);
-   snprintf(file, sizeof(file), "%s/saves/%s/%s.ns", PHYSFS_getWriteDir(), player.name, name); /* TODO: write via physfs */
-   if (xmlSaveFileEnc(file, doc, "UTF-8") < 0) {
-      WARN(_("Failed to write saved game!  You'll most likely have to restore it by copying your backup saved game over your current saved game."));
-      goto err;
+   /* The snapshot is complete, hand it over to the save thread. */
+   xmlFreeTextWriter(writer); /* Flushes into the buffer. */
+   save_size = MAX( save_size, xmlBufferLength( buf ) + 1024 );
+   SDL_asprintf( &job.path, "%s/saves/%s/%s.ns", PHYSFS_getWriteDir(), player.name, name ); /* TODO: write via physfs */
+   job.buf = buf;
+   job.compress = conf.save_compress;
+   if (save_thread == NULL) {
+      save_lock   = SDL_CreateMutex();
+      save_cond   = SDL_CreateCond();
+      save_queue  = array_create( SaveJob );
+      save_quit   = 0;
+      save_thread = SDL_CreateThread( save_thread_main, "save_thread", NULL );
+      if (save_thread == NULL)
+         WARN(_("Unable to create save thread: %s"), SDL_GetError());
    }
-   xmlFreeDoc(doc);
+   if (save_thread == NULL)
+      return save_write( &job );
+   SDL_mutexP( save_lock );
+   array_push_back( &save_queue, job );
+   SDL_CondBroadcast( save_cond );
+   SDL_mutexV( save_lock );
 
    return 0;
 
 err_writer:
    xmlFreeTextWriter(writer);
-err:
-   xmlFreeDoc(doc);
+   xmlBufferFree(buf);
    return -1;
 }
 
+/**
+ * @brief Writes saved games in the background, in the order they were made.
+ */
+static int save_thread_main( void *unused )
+{
+   (void) unused;
+   SDL_mutexP( save_lock );
+   while (1) {
+      SaveJob job;
+      int ret;
+      while ((array_size(save_queue) == 0) && !save_quit)
+         SDL_CondWait( save_cond, save_lock );
+      if (array_size(save_queue) == 0)
+         break;
+      job = save_queue[0];
+      array_erase( &save_queue, &save_queue[0], &save_queue[1] );
+      save_busy = 1;
+      SDL_mutexV( save_lock );
+
+      ret = save_write( &job );
+
+      SDL_mutexP( save_lock );
+      if (ret < 0)
+         save_failed = 1;
+      save_busy = 0;
+      SDL_CondBroadcast( save_cond );
+   }
+   SDL_mutexV( save_lock );
+   return 0;
+}
+
+/**
+ * @brief Compresses and writes a saved game to disk, then frees it.
+ *
+ * The file is written next to the destination and renamed over it, so the
+ * previous save survives if the game crashes while writing.
+ *
+ *    @return 0 on success.
+ */
+static int save_write( SaveJob *job )
+{
+   char tmp[PATH_MAX];
+   xmlOutputBufferPtr out;
+   int ret;
+
+   if ((job->backup != NULL) && (ndata_copyIfExists( job->backup, job->backup_to ) < 0)) {
+      WARN(_("Aborting save…"));
+      save_freeJob( job );
+      return -1;
+   }
+
+   snprintf( tmp, sizeof(tmp), "%s.part", job->path );
+   out = xmlOutputBufferCreateFilename( tmp, NULL, job->compress );
+   ret = -1;
+   if (out != NULL) {
+      ret = xmlOutputBufferWrite( out, xmlBufferLength( job->buf ), (const char*)xmlBufferContent( job->buf ) );
+      if (xmlOutputBufferClose( out ) < 0)
+         ret = -1;
+   }
+   if (ret < 0) {
+      WARN(_("Failed to write saved game!  You'll most likely have to restore it by copying your backup saved game over your current saved game."));
+      remove( tmp );
+      save_freeJob( job );
+      return -1;
+   }
+   ret = 0;
+#if WIN32
+   /* rename() doesn't replace existing files on Windows. */
+   if (!MoveFileExA( tmp, job->path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH )) {
+      WARN(_("Failed to rename '%s' to '%s': error %lu"), tmp, job->path, (unsigned long)GetLastError() );
+      ret = -1;
+   }
+#else /* WIN32 */
+   if (rename( tmp, job->path ) != 0) {
+      WARN(_("Failed to rename '%s' to '%s': %s"), tmp, job->path, strerror(errno) );
+      ret = -1;
+   }
+#endif /* WIN32 */
+   save_freeJob( job );
+   return ret;
+}
+
+/**
+ * @brief Frees a save job.
+ */
+static void save_freeJob( SaveJob *job )
+{
+   xmlBufferFree( job->buf );
+   free( job->path );
+   free( job->backup );
+   free( job->backup_to );
+}
+
+/**
+ * @brief Blocks until all the saved games made so far have been written to disk.
+ *
+ * Failures are reported by save_status().
+ */
+void save_flush (void)
+{
+   if (save_thread == NULL)
+      return;
+   SDL_mutexP( save_lock );
+   while ((array_size(save_queue) > 0) || save_busy)
+      SDL_CondWait( save_cond, save_lock );
+   SDL_mutexV( save_lock );
+}
+
+/**
+ * @brief Checks to see if a save failed to be written in the background.
+ *
+ * Saves are written after save_all() returns, so the failure has to be
+ * reported to the player later on. The failure is only reported once.
+ *
+ *    @return 0 on success, -1 if a save failed to be written since the last check.
+ */
+int save_status (void)
+{
+   int failed;
+   if (save_thread == NULL)
+      return 0;
+   SDL_mutexP( save_lock );
+   failed = save_failed;
+   save_failed = 0;
+   SDL_mutexV( save_lock );
+   return failed ? -1 : 0;
+}
+
+/**
+ * @brief Writes the pending saved games and stops the save thread.
+ */
+void save_exit (void)
+{
+   if (save_thread == NULL)
+      return;
+   SDL_mutexP( save_lock );
+   save_quit = 1;
+   SDL_CondBroadcast( save_cond );
+   SDL_mutexV( save_lock );
+   SDL_WaitThread( save_thread, NULL );
+   save_thread = NULL;
+   SDL_DestroyCond( save_cond );
+   save_cond = NULL;
+   SDL_DestroyMutex( save_lock );
+   save_lock = NULL;
+   array_free( save_queue );
+   save_queue = NULL;
+}
+
 /**
  * @brief Reload the current saved game.
  */
 void save_reload (void)
 {
+   save_flush();
    /* Should be refreshed already when menu is opened (load_refresh). */
    const nsave_t *ns = load_getList( player.name );
    if (array_size(ns) <= 0) {
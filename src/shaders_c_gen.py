@@ -69,10 +69,10 @@ SHADERS = [
    ),
    Shader(
       name = "trail",
-      vs_path = "project_pos.vert",
+      vs_path = "trail.vert",
       fs_path = "trail.frag",
-      attributes = ["vertex"],
-      uniforms = ["projection", "c1", "c2", "t1", "t2", "dt", "pos1", "pos2", "r", "nebu_col" ],
+      attributes = ["vertex", "vertex_tex", "vertex_px", "vertex_color", "vertex_trail"],
+      uniforms = ["projection", "nebu_col" ],
       subroutines = {
         "trail_func" : [
             "trail_default",
@@ -101,6 +101,14 @@ SHADERS = [
       uniforms = ["projection", "color", "tex_mat", "sampler"],
       subroutines = {},
    ),
+   Shader(
+      name = "texture_batch",
+      vs_path = "texture_batch.vert",
+      fs_path = "texture_batch.frag",
+      attributes = ["vertex", "vertex_tex", "vertex_color"],
+      uniforms = ["projection", "sampler"],
+      subroutines = {},
+   ),
    Shader(
       name = "texture_interpolate",
       vs_path = "texture.vert",
@@ -20,6 +20,7 @@
 #include "colour.h"
 #include "conf.h"
 #include "log.h"
+#include "nameindex.h"
 #include "ndata.h"
 #include "nfile.h"
 #include "nlua.h"
@@ -46,14 +47,32 @@
 
 #define STATS_DESC_MAX 256 /**< Maximum length for statistics description. */
 
+/**
+ * @brief Graphics and collision polygon of a ship decoded on the threadpool.
+ */
+typedef struct ShipPrep_ {
+   char *gfx;              /**< GFX element the data was decoded for. */
+   CollPoly *polygon;      /**< Array (array.h): Collision polygons or NULL. */
+   char *space_path;       /**< Path of the space sprite. */
+   SDL_RWops *space_rw;    /**< Space sprite file, used to cache the transparency map. */
+   SDL_Surface *space;     /**< Decoded space sprite or NULL. */
+   char *engine_path;      /**< Path of the engine sprite. */
+   SDL_Surface *engine;    /**< Decoded engine sprite or NULL. */
+} ShipPrep;
+
 static Ship* ship_stack = NULL; /**< Stack of ships available in the game. */
+static NameIndex ship_index; /**< Ships indexed by name. */
 
 /*
  * Prototypes
  */
-static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine );
-static int ship_loadPLG( Ship *temp, const char *buf, int size_hint );
-static int ship_parse( Ship *temp, const char *filename );
+static void ship_gfxPath( char *str, size_t size, const char *buf, const char *suffix );
+static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine, ShipPrep *prep );
+static CollPoly* ship_loadPLG( const char *buf, int size_hint );
+static void* ship_prepare( xmlDocPtr doc, const char *filename );
+static void ship_freePrep( void *data );
+static void ship_freePolygon( CollPoly *polygon );
+static int ship_parse( Ship *temp, xmlDocPtr doc, const char *filename, ShipPrep *prep );
 static void ship_freeSlot( ShipOutfitSlot* s );
 
 /**
@@ -89,8 +108,10 @@ const Ship* ship_get( const char* name )
  */
 const Ship* ship_getW( const char* name )
 {
-   const Ship s = {.name = (char*)name };
-   return bsearch( &s, ship_stack, array_size(ship_stack), sizeof(Ship), ship_cmp );
+   int id = nameindex_get( &ship_index, name );
+   if (id < 0)
+      return NULL;
+   return &ship_stack[id];
 }
 
 /**
@@ -395,26 +416,24 @@ static int ship_genTargetGFX( Ship *temp, SDL_Surface *surface, int sx, int sy )
 }
 
 /**
- * @brief Loads the space graphics for a ship from an image.
+ * @brief Loads the space graphics for a ship from a decoded image.
  *
  *    @param temp Ship to load into.
- *    @param str Path of the image to use.
+ *    @param str Path of the image.
+ *    @param rw File of the image, gets closed.
+ *    @param surface Decoded image, gets freed.
  *    @param sx Number of X sprites in image.
  *    @param sy Number of Y sprites in image.
  */
-static int ship_loadSpaceImage( Ship *temp, char *str, int sx, int sy )
+static int ship_loadSpaceSurface( Ship *temp, const char *str, SDL_RWops *rw, SDL_Surface *surface, int sx, int sy )
 {
-   SDL_RWops *rw;
-   SDL_Surface *surface;
    int ret;
 
-   /* Load the space sprite. */
-   rw    = PHYSFSRWOPS_openRead( str );
-   if (rw==NULL) {
-      WARN(_("Unable to open '%s' for reading!"), str);
+   if (surface == NULL) {
+      WARN(_("Unable to load image '%s'."), str);
+      SDL_RWclose( rw );
       return -1;
    }
-   surface = IMG_Load_RW( rw, 0 );
 
    /* Load the texture. */
    /* Don't try to be smart here and avoid loading the transparency map or
@@ -432,12 +451,12 @@ static int ship_loadSpaceImage( Ship *temp, char *str, int sx, int sy )
 
    /* Create the target graphic. */
    ret = ship_genTargetGFX( temp, surface, sx, sy );
-   if (ret != 0)
-      return ret;
 
    /* Free stuff. */
    SDL_RWclose( rw );
    SDL_FreeSurface( surface );
+   if (ret != 0)
+      return ret;
 
    /* Calculate mount angle. */
    temp->mangle  = 2.*M_PI;
@@ -445,6 +464,27 @@ static int ship_loadSpaceImage( Ship *temp, char *str, int sx, int sy )
    return 0;
 }
 
+/**
+ * @brief Loads the space graphics for a ship from an image.
+ *
+ *    @param temp Ship to load into.
+ *    @param str Path of the image to use.
+ *    @param sx Number of X sprites in image.
+ *    @param sy Number of Y sprites in image.
+ */
+static int ship_loadSpaceImage( Ship *temp, char *str, int sx, int sy )
+{
+   SDL_RWops *rw;
+
+   /* Load the space sprite. */
+   rw    = PHYSFSRWOPS_openRead( str );
+   if (rw==NULL) {
+      WARN(_("Unable to open '%s' for reading!"), str);
+      return -1;
+   }
+   return ship_loadSpaceSurface( temp, str, rw, IMG_Load_RW( rw, 0 ), sx, sy );
+}
+
 /**
  * @brief Loads the space graphics for a ship from an image.
  *
@@ -459,6 +499,29 @@ static int ship_loadEngineImage( Ship *temp, char *str, int sx, int sy )
    return (temp->gfx_engine != NULL);
 }
 
+/**
+ * @brief Gets the path of an image of a ship from its GFX element.
+ *
+ * All the images use the extension of the space sprite, WebP if there is one
+ * and PNG otherwise.
+ *
+ *    @param[out] str Where to write the path.
+ *    @param size Size of str.
+ *    @param buf Name of the texture to work with.
+ *    @param suffix Suffix of the image, empty for the space sprite.
+ */
+static void ship_gfxPath( char *str, size_t size, const char *buf, const char *suffix )
+{
+   const char *delim = strchr( buf, '_' );
+   int len = (delim==NULL) ? (int)strlen(buf) : (int)(delim-buf);
+
+   snprintf( str, size, SHIP_GFX_PATH"%.*s/%s.webp", len, buf, buf );
+   if (PHYSFS_exists(str))
+      snprintf( str, size, SHIP_GFX_PATH"%.*s/%s%s.webp", len, buf, buf, suffix );
+   else
+      snprintf( str, size, SHIP_GFX_PATH"%.*s/%s%s.png", len, buf, buf, suffix );
+}
+
 /**
  * @brief Loads the graphics for a ship.
  *
@@ -467,10 +530,12 @@ static int ship_loadEngineImage( Ship *temp, char *str, int sx, int sy )
  *    @param sx Number of X sprites in image.
  *    @param sy Number of Y sprites in image.
  *    @param engine Whether there is also an engine image to load.
+ *    @param prep Images already decoded on the threadpool or NULL, the ones
+ *           used are removed from it.
  */
-static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine )
+static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine, ShipPrep *prep )
 {
-   char str[PATH_MAX], *ext, *base, *delim;
+   char str[PATH_MAX], *base, *delim;
 
    /* Get base path. */
    delim = strchr( buf, '_' );
@@ -481,27 +546,34 @@ static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine
    if (PHYSFS_exists(str)) {
       temp->gfx_3d = object_loadFromFile(str);
    }
+   free( base );
 
    /* Load the space sprite. */
-   ext = ".webp";
-   snprintf( str, sizeof(str), SHIP_GFX_PATH"%s/%s%s", base, buf, ext );
-   if (!PHYSFS_exists(str)) {
-      ext = ".png";
-      snprintf( str, sizeof(str), SHIP_GFX_PATH"%s/%s%s", base, buf, ext );
+   ship_gfxPath( str, sizeof(str), buf, "" );
+   if ((prep != NULL) && (prep->space_rw != NULL) && (strcmp( prep->space_path, str )==0)) {
+      ship_loadSpaceSurface( temp, str, prep->space_rw, prep->space, sx, sy );
+      prep->space_rw = NULL;
+      prep->space    = NULL;
    }
-   ship_loadSpaceImage( temp, str, sx, sy );
+   else
+      ship_loadSpaceImage( temp, str, sx, sy );
 
    /* Load the engine sprite .*/
    if (engine) {
-      snprintf( str, sizeof(str), SHIP_GFX_PATH"%s/%s"SHIP_ENGINE"%s", base, buf, ext );
-      ship_loadEngineImage( temp, str, sx, sy );
+      ship_gfxPath( str, sizeof(str), buf, SHIP_ENGINE );
+      if ((prep != NULL) && (prep->engine != NULL) && (strcmp( prep->engine_path, str )==0)) {
+         temp->gfx_engine = gl_newSpriteSurface( str, prep->engine, sx, sy, OPENGL_TEX_MIPMAPS );
+         prep->engine = NULL;
+      }
+      else
+         ship_loadEngineImage( temp, str, sx, sy );
       if (temp->gfx_engine == NULL)
          WARN(_("Ship '%s' does not have an engine sprite (%s)."), temp->name, str );
    }
 
    /* Get the comm graphic for future loading. */
-   SDL_asprintf( &temp->gfx_comm, SHIP_GFX_PATH"%s/%s"SHIP_COMM"%s", base, buf, ext );
-   free( base );
+   ship_gfxPath( str, sizeof(str), buf, SHIP_COMM );
+   temp->gfx_comm = strdup( str );
 
    return 0;
 }
@@ -509,14 +581,16 @@ static int ship_loadGFX( Ship *temp, const char *buf, int sx, int sy, int engine
 /**
  * @brief Loads the collision polygon for a ship.
  *
- *    @param temp Ship to load into.
+ * Can be called from any thread.
+ *
  *    @param buf Name of the file.
  *    @param size_hint Expected array length required.
+ *    @return Array (array.h) of collision polygons or NULL.
  */
-static int ship_loadPLG( Ship *temp, const char *buf, int size_hint )
+static CollPoly* ship_loadPLG( const char *buf, int size_hint )
 {
    char file[PATH_MAX];
-   CollPoly *polygon;
+   CollPoly *polygon = NULL;
    xmlDocPtr doc;
    xmlNodePtr node;
 
@@ -528,36 +602,119 @@ static int ship_loadPLG( Ship *temp, const char *buf, int size_hint )
                Please use the script 'polygon_from_sprite.py' if sprites are used,\n \
                And 'polygonSTL.py' if 3D model is used in game.\n \
                These files can be found in Naev's artwork repo."), file);
-      return 0;
+      return NULL;
    }
 
    /* Load the XML. */
    doc  = xml_parsePhysFS( file );
    if (doc == NULL)
-      return 0;
+      return NULL;
 
    node = doc->xmlChildrenNode; /* First polygon node */
    if (node == NULL) {
       xmlFreeDoc(doc);
       WARN(_("Malformed %s file: does not contain elements"), file);
-      return 0;
+      return NULL;
    }
 
    do { /* load the polygon data */
       if (xml_isNode(node,"polygons")) {
          xmlNodePtr cur = node->children;
-         temp->polygon = array_create_size( CollPoly, size_hint );
+         polygon = array_create_size( CollPoly, size_hint );
          do {
-            if (xml_isNode(cur,"polygon")) {
-               polygon = &array_grow( &temp->polygon );
-               LoadPolygon( polygon, cur );
-            }
+            if (xml_isNode(cur,"polygon"))
+               LoadPolygon( &array_grow( &polygon ), cur );
          } while (xml_nextNode(cur));
       }
    } while (xml_nextNode(node));
 
    xmlFreeDoc(doc);
-   return 0;
+   return polygon;
+}
+
+/**
+ * @brief Frees an array of collision polygons.
+ */
+static void ship_freePolygon( CollPoly *polygon )
+{
+   for (int j=0; j<array_size(polygon); j++) {
+      free(polygon[j].x);
+      free(polygon[j].y);
+   }
+   array_free(polygon);
+}
+
+/**
+ * @brief Decodes the graphics and collision polygon of a ship on the threadpool.
+ *
+ *    @param doc Parsed XML of the ship.
+ *    @param filename File the ship was loaded from.
+ *    @return The decoded data (ShipPrep) or NULL.
+ */
+static void* ship_prepare( xmlDocPtr doc, const char *filename )
+{
+   char str[PATH_MAX];
+   xmlNodePtr parent = doc->xmlChildrenNode;
+   (void) filename;
+
+   if (parent == NULL)
+      return NULL;
+
+   for (xmlNodePtr node=parent->xmlChildrenNode; node!=NULL; node=node->next) {
+      ShipPrep *prep;
+      SDL_RWops *rw;
+      char *buf;
+      int sx, sy, noengine;
+
+      if (!xml_isNode(node,"GFX"))
+         continue;
+      buf = xml_get(node);
+      if (buf==NULL)
+         return NULL;
+      xmlr_attr_int_def( node, "sx", sx, 8 );
+      xmlr_attr_int_def( node, "sy", sy, 8 );
+      xmlr_attr_int( node, "noengine", noengine );
+
+      prep = calloc( 1, sizeof(ShipPrep) );
+      prep->gfx      = strdup( buf );
+      prep->polygon  = ship_loadPLG( buf, sx*sy );
+
+      /* Decoding the images is the slow part, uploading them is left to the
+       * main thread. */
+      ship_gfxPath( str, sizeof(str), buf, "" );
+      prep->space_path = strdup( str );
+      prep->space_rw = PHYSFSRWOPS_openRead( str );
+      if (prep->space_rw != NULL)
+         prep->space = IMG_Load_RW( prep->space_rw, 0 );
+      if (!noengine) {
+         ship_gfxPath( str, sizeof(str), buf, SHIP_ENGINE );
+         prep->engine_path = strdup( str );
+         rw = PHYSFSRWOPS_openRead( str );
+         if (rw != NULL)
+            prep->engine = IMG_Load_RW( rw, 1 );
+      }
+      return prep;
+   }
+   return NULL;
+}
+
+/**
+ * @brief Frees the data decoded by ship_prepare() that wasn't used.
+ */
+static void ship_freePrep( void *data )
+{
+   ShipPrep *prep = (ShipPrep*) data;
+   if (prep == NULL)
+      return;
+   free( prep->gfx );
+   ship_freePolygon( prep->polygon );
+   free( prep->space_path );
+   if (prep->space_rw != NULL)
+      SDL_RWclose( prep->space_rw );
+   SDL_FreeSurface( prep->space );
+   free( prep->engine_path );
+   SDL_FreeSurface( prep->engine );
+   free( prep );
 }
 
 /**
@@ -649,21 +806,21 @@ static int ship_parseSlot( Ship *temp, ShipOutfitSlot *slot, OutfitSlotType type
  * @brief Extracts the in-game ship from an XML node.
  *
  *    @param temp Ship to load data into.
- *    @param filename File to load ship from.
+ *    @param doc Parsed XML of the ship, gets freed.
+ *    @param filename File the ship was loaded from.
+ *    @param prep Data decoded by ship_prepare() or NULL, what is used is
+ *           removed from it.
  *    @return 0 on success.
  */
-static int ship_parse( Ship *temp, const char *filename )
+static int ship_parse( Ship *temp, xmlDocPtr doc, const char *filename, ShipPrep *prep )
 {
    xmlNodePtr parent, node;
-   xmlDocPtr doc;
    int sx, sy;
    char str[PATH_MAX];
    int noengine;
    ShipStatList *ll;
    ShipTrailEmitter trail;
 
-   /* Load the XML. */
-   doc  = xml_parsePhysFS( filename );
    if (doc == NULL)
       return -1;
 
@@ -724,11 +881,20 @@ static int ship_parse( Ship *temp, const char *filename )
 
          xmlr_attr_int(node, "noengine", noengine );
 
+         /* Use what was decoded on the threadpool if it matches. */
+         if ((prep != NULL) && (strcmp( prep->gfx, buf ) != 0))
+            prep = NULL;
+
          /* Load the polygon. */
-         ship_loadPLG( temp, buf, sx*sy );
+         if (prep != NULL) {
+            temp->polygon = prep->polygon;
+            prep->polygon = NULL;
+         }
+         else
+            temp->polygon = ship_loadPLG( buf, sx*sy );
 
          /* Load the graphics. */
-         ship_loadGFX( temp, buf, sx, sy, !noengine );
+         ship_loadGFX( temp, buf, sx, sy, !noengine, prep );
 
          /* Validity check: there must be 1 polygon per sprite. */
          if ((temp->polygon != NULL) && array_size(temp->polygon) != sx*sy) {
@@ -1033,6 +1199,7 @@ static int ship_parse( Ship *temp, const char *filename )
 int ships_load (void)
 {
    char **ship_files;
+   XmlParseList *ship_docs;
    int nfiles;
    Uint32 time = SDL_GetTicks();
 
@@ -1042,6 +1209,9 @@ int ships_load (void)
    ship_files = ndata_listRecursive( SHIP_DATA_PATH );
    nfiles = array_size( ship_files );
 
+   /* Read and parse the XML in parallel, decoding the graphics too. */
+   ship_docs = xml_parseListCreate( ship_files, "xml", ship_prepare, ship_freePrep );
+
    /* Initialize stack if needed. */
    if (ship_stack == NULL)
       ship_stack = array_create_size(Ship, nfiles);
@@ -1051,22 +1221,31 @@ int ships_load (void)
       if (ndata_matchExt( ship_files[i], "xml" )) {
          /* Load the ship. */
          Ship s;
-         int ret = ship_parse( &s, ship_files[i] );
+         void *prep;
+         xmlDocPtr doc = xml_parseListGet( ship_docs, i, &prep );
+         int ret = ship_parse( &s, doc, ship_files[i], prep );
+         ship_freePrep( prep );
          if (ret == 0)
             array_push_back( &ship_stack, s );
 
          /* Render if necessary. */
          naev_renderLoadscreen();
       }
-
-      /* Clean up. */
-      free( ship_files[i] );
    }
+   xml_parseListFree( ship_docs );
+   for (int i=0; i<nfiles; i++)
+      free( ship_files[i] );
    qsort( ship_stack, array_size(ship_stack), sizeof(Ship), ship_cmp );
 
    /* Shrink stack. */
    array_shrink(&ship_stack);
 
+   /* Index by name. */
+   nameindex_init( &ship_index );
+   nameindex_reserve( &ship_index, array_size(ship_stack) );
+   for (int i=0; i<array_size(ship_stack); i++)
+      nameindex_add( &ship_index, ship_stack[i].name, i );
+
    /* Second pass to load Lua. */
    for (int i=0; i<array_size(ship_stack); i++) {
       Ship *s = &ship_stack[i];
@@ -1166,13 +1345,9 @@ void ships_free (void)
       array_free(s->gfx_overlays);
 
       /* Free collision polygons. */
-      for (int j=0; j<array_size(s->polygon); j++) {
-         free(s->polygon[j].x);
-         free(s->polygon[j].y);
-      }
+      ship_freePolygon(s->polygon);
 
       array_free(s->trail_emitters);
-      array_free(s->polygon);
 
       /* Free tags. */
       for (int j=0; j<array_size(s->tags); j++)
@@ -1187,6 +1362,7 @@ void ships_free (void)
 
    array_free(ship_stack);
    ship_stack = NULL;
+   nameindex_free( &ship_index );
 }
 
 static void ship_freeSlot( ShipOutfitSlot* s )
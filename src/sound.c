@@ -55,28 +55,50 @@
 #include "physics.h"
 #include "player.h"
 #include "nopenal.h"
+#include "threadpool.h"
 #include "nlua_spfx.h"
 
 #define SOUND_FADEOUT         100
 #define SOUND_VOICES           64   /**< Maximum number of simultaneous sounds to play, must be at least 16. */
 
+#define SOUND_BUFFER_BUDGET   (64*1024*1024) /**< Bytes of decoded sounds to keep before evicting unused ones. */
+#define SOUND_EVICT_AGE       30000 /**< Sounds used in the last SOUND_EVICT_AGE ms are never evicted. */
+#define SOUND_EVICT_INTERVAL  1000 /**< Minimum ms between looking for sounds to evict. */
+
 #define SOUND_SUFFIX_WAV   ".wav" /**< Suffix of sounds. */
 #define SOUND_SUFFIX_OGG   ".ogg" /**< Suffix of sounds. */
 
 #define voiceLock()        SDL_LockMutex(voice_mutex)
 #define voiceUnlock()      SDL_UnlockMutex(voice_mutex)
 
+/**
+ * @brief Loading state of a sound buffer.
+ */
+typedef enum sound_state_ {
+   SOUND_UNLOADED,   /**< Only registered, not decoded yet. */
+   SOUND_QUEUED,     /**< Queued to be decoded in the background. */
+   SOUND_LOADING,    /**< Being decoded. */
+   SOUND_LOADED,     /**< Buffer is ready. */
+   SOUND_FAILED      /**< Failed to decode, won't be tried again. */
+} sound_state_t;
+
 /**
  * @struct alSound
  *
  * @brief Contains a sound buffer.
+ *
+ * Sounds found in SOUND_PATH are only decoded the first time they are played,
+ * and may be freed again later when unused (see sound_evict()).
  */
 typedef struct alSound_ {
-   char *filename; /**< Name of the file loaded from. */
+   char *filename; /**< Name of the file loaded from, NULL if it can't be reloaded. */
    char *name; /**< Buffer's name. */
    double length; /**< Length of the buffer. */
    int channels; /**< Number of channels of the buffer. */
    ALuint buf; /**< Buffer data. */
+   size_t size; /**< Size of the buffer data in bytes. */
+   sound_state_t state; /**< Loading state, protected by sound_lock. */
+   unsigned int used; /**< Last time the sound was used (SDL ticks). */
 } alSound;
 
 /**
@@ -137,6 +159,10 @@ static int sound_initialized  = 0; /**< Whether or not sound is initialized. */
  * Sound list.
  */
 static alSound *sound_list    = NULL; /**< List of available sounds. */
+static size_t sound_bytes     = 0; /**< Bytes of decoded sound buffers. */
+static SDL_atomic_t sound_pending; /**< Number of background loads in flight. */
+static SDL_cond *sound_cond   = NULL; /**< Signals sounds finishing loading, used with sound_lock. */
+static unsigned int sound_evicted = 0; /**< Last time sound_evict() looked for sounds to evict. */
 
 /*
  * Voices.
@@ -159,6 +185,10 @@ static double snd_compression_gain = 0.; /**< Current compression gain. */
 /* General. */
 static int sound_makeList (void);
 static void sound_free( alSound *snd );
+static int sound_loadBuffer( int sound );
+static alSound* sound_lazyLoad( int sound );
+static int sound_prefetchJob( void *data );
+static void sound_evict (void);
 /* Voices. */
 
 /*
@@ -301,6 +331,7 @@ static int sound_al_init (void)
 
    /* We'll need a mutex */
    sound_lock = SDL_CreateMutex();
+   sound_cond = SDL_CreateCond();
    soundLock();
 
    /* opening the default device */
@@ -488,6 +519,8 @@ snderr_ctx:
 snderr_dev:
    al_device = NULL;
    soundUnlock();
+   SDL_DestroyCond( sound_cond );
+   sound_cond = NULL;
    SDL_DestroyMutex( sound_lock );
    sound_lock = NULL;
    return ret;
@@ -668,6 +701,12 @@ void sound_exit (void)
    if (sound_disabled || !sound_initialized)
       return;
 
+   /* Wait for background loading to finish. */
+   soundLock();
+   while (SDL_AtomicGet( &sound_pending ) > 0)
+      SDL_CondWait( sound_cond, sound_lock );
+   soundUnlock();
+
    if (voice_mutex != NULL) {
       voiceLock();
       /* free the voices. */
@@ -741,6 +780,8 @@ void sound_exit (void)
 
    soundUnlock();
 
+   SDL_DestroyCond( sound_cond );
+   sound_cond = NULL;
    SDL_DestroyMutex( sound_lock );
 
    /* Sound is done. */
@@ -750,6 +791,8 @@ void sound_exit (void)
 /**
  * @brief Gets the buffer to sound of name.
  *
+ * This does not load the sound, it is only decoded when first used.
+ *
  *    @param name Name of the sound to get the id of.
  *    @return ID of the sound matching name.
  */
@@ -774,10 +817,241 @@ int sound_get( const char* name )
  */
 double sound_getLength( int sound )
 {
+   const alSound *s;
+
    if (sound_disabled)
       return 0.;
 
-   return sound_list[sound].length;
+   s = sound_lazyLoad( sound );
+   if (s == NULL)
+      return 0.;
+   return s->length;
+}
+
+/**
+ * @brief Decodes a sound into its buffer.
+ *
+ * The sound must have been set to SOUND_LOADING by the caller. Can be called
+ * from any thread.
+ *
+ *    @param sound ID of the sound to load.
+ *    @return 0 on success.
+ */
+static int sound_loadBuffer( int sound )
+{
+   alSound tmp, *s;
+   SDL_RWops *rw;
+   const char *filename, *name;
+   int ret;
+
+   /* Strings are never freed while the sound subsystem is running. */
+   soundLock();
+   filename = sound_list[sound].filename;
+   name     = sound_list[sound].name;
+   soundUnlock();
+
+   memset( &tmp, 0, sizeof(alSound) );
+   rw = (filename != NULL) ? PHYSFSRWOPS_openRead( filename ) : NULL;
+   if (rw != NULL) {
+      ret = al_load( &tmp, rw, name );
+      SDL_RWclose( rw );
+   }
+   else {
+      WARN(_("Unable to open sound file '%s'."), (filename != NULL) ? filename : name);
+      ret = -1;
+   }
+
+   soundLock();
+   s = &sound_list[sound];
+   if (ret == 0) {
+      s->buf      = tmp.buf;
+      s->length   = tmp.length;
+      s->channels = tmp.channels;
+      s->size     = tmp.size;
+      s->state    = SOUND_LOADED;
+      sound_bytes += s->size;
+   }
+   else
+      s->state    = SOUND_FAILED;
+   SDL_CondBroadcast( sound_cond );
+   soundUnlock();
+
+   return ret;
+}
+
+/**
+ * @brief Gets a sound making sure it is loaded.
+ *
+ * Should only be called from the main thread, as the returned pointer is only
+ * valid until the sound list is modified.
+ *
+ *    @param sound ID of the sound to get.
+ *    @return The loaded sound or NULL on error.
+ */
+static alSound* sound_lazyLoad( int sound )
+{
+   alSound *s;
+
+   if ((sound < 0) || (sound >= array_size(sound_list)))
+      return NULL;
+
+   soundLock();
+   /* Being prefetched, just wait for it. */
+   while (sound_list[sound].state == SOUND_LOADING)
+      SDL_CondWait( sound_cond, sound_lock );
+   s = &sound_list[sound];
+   if ((s->state == SOUND_UNLOADED) || (s->state == SOUND_QUEUED)) {
+      s->state = SOUND_LOADING;
+      soundUnlock();
+      sound_loadBuffer( sound );
+      soundLock();
+      s = &sound_list[sound];
+   }
+   if (s->state != SOUND_LOADED) {
+      soundUnlock();
+      return NULL;
+   }
+   s->used = SDL_GetTicks();
+   soundUnlock();
+   return s;
+}
+
+/**
+ * @brief Threadpool job that loads a prefetched sound.
+ */
+static int sound_prefetchJob( void *data )
+{
+   int sound = (int)(intptr_t) data;
+   int load  = 0;
+
+   soundLock();
+   if (sound_list[sound].state == SOUND_QUEUED) {
+      sound_list[sound].state = SOUND_LOADING;
+      load = 1;
+   }
+   soundUnlock();
+
+   if (load)
+      sound_loadBuffer( sound );
+
+   soundLock();
+   SDL_AtomicAdd( &sound_pending, -1 );
+   SDL_CondBroadcast( sound_cond );
+   soundUnlock();
+   return 0;
+}
+
+/**
+ * @brief Starts loading a sound in the background if it is not loaded yet.
+ *
+ *    @param sound ID of the sound to prefetch.
+ */
+void sound_prefetch( int sound )
+{
+   int queue = 0;
+
+   if (sound_disabled)
+      return;
+
+   if ((sound < 0) || (sound >= array_size(sound_list)))
+      return;
+
+   soundLock();
+   if (sound_list[sound].state == SOUND_UNLOADED) {
+      sound_list[sound].state = SOUND_QUEUED;
+      queue = 1;
+   }
+   soundUnlock();
+
+   if (queue) {
+      SDL_AtomicAdd( &sound_pending, 1 );
+      threadpool_newJob( sound_prefetchJob, (void*)(intptr_t) sound );
+   }
+}
+
+/**
+ * @brief Compares two buffer names for sorting and searching.
+ */
+static int sound_cmpBuffer( const void *p1, const void *p2 )
+{
+   ALuint b1 = *(const ALuint*) p1;
+   ALuint b2 = *(const ALuint*) p2;
+   return (b1 > b2) - (b1 < b2);
+}
+
+/**
+ * @brief Compares two sounds by when they were last used, oldest first.
+ */
+static int sound_cmpUsed( const void *p1, const void *p2 )
+{
+   const alSound *s1 = *(alSound* const*) p1;
+   const alSound *s2 = *(alSound* const*) p2;
+   return (s1->used > s2->used) - (s1->used < s2->used);
+}
+
+/**
+ * @brief Frees the least recently used sounds while over the memory budget.
+ *
+ * Sounds that were used recently or are still attached to a source are kept,
+ * they will be decoded again the next time they are played. Only looks at the
+ * sounds every SOUND_EVICT_INTERVAL ms.
+ */
+static void sound_evict (void)
+{
+   unsigned int t;
+   ALuint *attached;
+   alSound **lru;
+   size_t bytes;
+
+   t = SDL_GetTicks();
+   if (t - sound_evicted < SOUND_EVICT_INTERVAL)
+      return;
+   sound_evicted = t;
+
+   soundLock();
+   bytes = sound_bytes;
+   soundUnlock();
+   if (bytes <= SOUND_BUFFER_BUDGET)
+      return;
+
+   soundLock();
+
+   /* Buffers attached to sources can't be deleted. */
+   attached = array_create_size( ALuint, source_nall );
+   for (int i=0; i<source_nall; i++) {
+      ALint b;
+      alGetSourcei( source_all[i], AL_BUFFER, &b );
+      if (b != 0)
+         array_push_back( &attached, (ALuint)b );
+   }
+   qsort( attached, array_size(attached), sizeof(ALuint), sound_cmpBuffer );
+
+   /* Candidates, evicted oldest first. */
+   lru = array_create( alSound* );
+   for (int i=0; i<array_size(sound_list); i++) {
+      alSound *s = &sound_list[i];
+      if ((s->state != SOUND_LOADED) || (s->filename == NULL))
+         continue;
+      if (t - s->used < SOUND_EVICT_AGE)
+         continue;
+      if (bsearch( &s->buf, attached, array_size(attached), sizeof(ALuint), sound_cmpBuffer ) != NULL)
+         continue;
+      array_push_back( &lru, s );
+   }
+   qsort( lru, array_size(lru), sizeof(alSound*), sound_cmpUsed );
+
+   for (int i=0; (i<array_size(lru)) && (sound_bytes > SOUND_BUFFER_BUDGET); i++) {
+      alSound *s = lru[i];
+      alDeleteBuffers( 1, &s->buf );
+      s->buf      = 0;
+      s->state    = SOUND_UNLOADED;
+      sound_bytes -= s->size;
+   }
+   al_checkErr();
+
+   soundUnlock();
+   array_free( attached );
+   array_free( lru );
 }
 
 /**
@@ -794,15 +1068,14 @@ int sound_play( int sound )
    if (sound_disabled)
       return 0;
 
-   if ((sound < 0) || (sound >= array_size(sound_list)))
+   /* Get the sound. */
+   s = sound_lazyLoad( sound );
+   if (s == NULL)
       return -1;
 
    /* Gets a new voice. */
    v = voice_new();
 
-   /* Get the sound. */
-   s = &sound_list[sound];
-
    /* Try to play the sound. */
    if (al_playVoice( v, s, 0., 0., 0., 0., AL_TRUE ))
       return -1;
@@ -854,12 +1127,14 @@ int sound_playPos( int sound, double px, double py, double vx, double vy )
          return 0;
    }
 
+   /* Get the sound. */
+   s = sound_lazyLoad( sound );
+   if (s == NULL)
+      return -1;
+
    /* Gets a new voice. */
    v = voice_new();
 
-   /* Get the sound. */
-   s = &sound_list[sound];
-
    /* Try to play the sound. */
    if (al_playVoice( v, s, px, py, vx, vy, AL_FALSE ))
       return -1;
@@ -959,6 +1234,9 @@ int sound_update( double dt )
       }
    }
 
+   /* Free unused sounds if using too much memory. */
+   sound_evict();
+
    if (voice_active == NULL)
       return 0;
 
@@ -1216,12 +1494,12 @@ static int sound_makeList (void)
    /* Create the list. */
    sound_list = array_create( alSound );
 
-   /* load the profiles */
+   /* Register the sounds, they get loaded when first used. */
    suflen = strlen(SOUND_SUFFIX_WAV);
    for (size_t i=0; files[i]!=NULL; i++) {
       int len;
       char path[PATH_MAX];
-      SDL_RWops *rw;
+      alSound *snd;
       int flen = strlen(files[i]);
 
       /* Must be longer than suffix. */
@@ -1233,19 +1511,20 @@ static int sound_makeList (void)
             (strncmp( &files[i][flen - suflen], SOUND_SUFFIX_OGG, suflen)!=0))
          continue;
 
-      /* Load the sound. */
       snprintf( path, sizeof(path), SOUND_PATH"%s", files[i] );
-      rw = PHYSFSRWOPS_openRead( path );
 
       /* remove the suffix */
       len = flen - suflen;
       files[i][len] = '\0';
 
-      source_newRW( rw, files[i], 0 );
-      SDL_RWclose( rw );
+      snd = &array_grow( &sound_list );
+      memset( snd, 0, sizeof(alSound) );
+      snd->filename = strdup( path );
+      snd->name     = strdup( files[i] );
+      snd->state    = SOUND_UNLOADED;
    }
 
-   DEBUG( n_("Loaded %d Sound", "Loaded %d Sounds", array_size(sound_list)), array_size(sound_list) );
+   DEBUG( n_("Registered %d Sound", "Registered %d Sounds", array_size(sound_list)), array_size(sound_list) );
 
    /* Clean up. */
    PHYSFS_freeList( files );
@@ -1315,6 +1594,9 @@ static void sound_free( alSound *snd )
    free(snd->filename);
 
    /* Free internals. */
+   if (snd->state != SOUND_LOADED)
+      return;
+
    soundLock();
 
    alDeleteBuffers( 1, &snd->buf );
@@ -1408,10 +1690,10 @@ int sound_playGroup( int group, int sound, int once )
    if (sound_disabled)
       return 0;
 
-   if ((sound < 0) || (sound >= array_size(sound_list)))
+   s = sound_lazyLoad( sound );
+   if (s == NULL)
       return -1;
 
-   s = &sound_list[sound];
    for (int i=0; i<al_ngroups; i++) {
       alGroup_t *g;
 
@@ -1800,9 +2082,14 @@ int source_newRW( SDL_RWops *rw, const char *name, unsigned int flags )
    if (ret)
       return -1;
 
+   snd.state = SOUND_LOADED;
+   snd.used  = SDL_GetTicks();
+   soundLock();
    sndl = &array_grow( &sound_list );
    memcpy( sndl, &snd, sizeof(alSound) );
    sndl->name = strdup( name );
+   sound_bytes += snd.size;
+   soundUnlock();
 
    return sndl-sound_list;
 }
@@ -2065,6 +2352,7 @@ int al_load( alSound *snd, SDL_RWops *rw, const char *name )
    else
       snd->length = (double)size / (double)(freq * (bits/8) * channels);
    snd->channels = channels;
+   snd->size     = size;
 
    /* Check for errors. */
    al_checkErr();
@@ -32,6 +32,7 @@
 #include "menu.h"
 #include "mission.h"
 #include "music.h"
+#include "nameindex.h"
 #include "ndata.h"
 #include "nebula.h"
 #include "nfile.h"
@@ -47,9 +48,11 @@
 #include "ntime.h"
 #include "nxml.h"
 #include "opengl.h"
+#include "pathfind.h"
 #include "pause.h"
 #include "pilot.h"
 #include "player.h"
+#include "profile.h"
 #include "queue.h"
 #include "rng.h"
 #include "sound.h"
@@ -92,10 +95,10 @@ static char** systemname_stack = NULL; /**< System name stack corresponding to s
 StarSystem *systems_stack = NULL; /**< Star system stack. */
 static Spob *spob_stack = NULL; /**< Spob stack. */
 static VirtualSpob *vspob_stack = NULL; /**< Virtual spob stack. */
-#ifdef DEBUGGING
-static int systemstack_changed = 0; /**< Whether or not the systems_stack was changed after loading. */
-#endif /* DEBUGGING */
-static int spobstack_changed = 0; /**< Whether or not the spob_stack was changed after loading. */
+static NameIndex systems_nameindex; /**< Systems indexed by name. */
+static int systems_nameindexDirty = 1; /**< Whether or not systems_nameindex has to be rebuilt. */
+static NameIndex spob_nameindex; /**< Spobs indexed by name. */
+static int spob_nameindexDirty = 1; /**< Whether or not spob_nameindex has to be rebuilt. */
 static MapShader **mapshaders = NULL; /**< Map shaders. */
 
 /*
@@ -108,6 +111,8 @@ static glTexture *jumpbuoy_gfx = NULL; /**< Jump buoy graphics. */
 static int space_fchg = 0; /**< Faction change counter, to avoid unnecessary calls. */
 static int space_simulating = 0; /**< Are we simulating space? */
 static int space_simulating_effects = 0; /**< Are we doing special effects? */
+static double space_simulate_time = 0.; /**< Real time the last system simulation took (in seconds). */
+static int space_simulate_steps = 0; /**< Number of updates done by the last system simulation. */
 static Spob *space_landQueueSpob = NULL;
 
 /*
@@ -119,22 +124,32 @@ int space_spawn = 1; /**< Spawn enabled by default. */
  * Internal Prototypes.
  */
 /* spob load */
-static int spob_parse( Spob *spob, const char *filename, Commodity **stdList );
+static int spob_parse( Spob *spob, xmlDocPtr doc, const char *filename, Commodity **stdList );
 static int space_parseSpobs( xmlNodePtr parent, StarSystem* sys );
 static int spob_parsePresence( xmlNodePtr node, SpobPresence *ap );
 /* system load */
 static void system_init( StarSystem *sys );
 static int systems_load (void);
-static int system_parse( StarSystem *system, const char *filename );
+static int system_parse( StarSystem *system, xmlDocPtr doc, const char *filename );
 static int system_parseJumpPoint( const xmlNodePtr node, StarSystem *sys );
 static int system_parseJumpPointDiff( const xmlNodePtr node, StarSystem *sys );
-static int system_parseJumps( StarSystem *sys );
+static int system_parseJumps( StarSystem *sys, xmlDocPtr doc );
 static int system_parseAsteroidField( const xmlNodePtr node, StarSystem *sys );
 static int system_parseAsteroidExclusion( const xmlNodePtr node, StarSystem *sys );
 /* misc */
 static int spob_cmp( const void *p1, const void *p2 );
+static void systems_reindex (void);
+static void spobs_reindex (void);
 static int getPresenceIndex( StarSystem *sys, int faction );
+static void system_presenceAddSpobMask( StarSystem *sys, const SpobPresence *ap, const char *mask );
+static int system_presenceRange( const StarSystem *sys );
+static void system_presenceDistance( int *dist, int *const* adj, int radius );
+static int system_presenceMark( char *affected, int *dist, int *const* adj, int sysid, int range );
+#if DEBUG_PARANOID
+static void system_presenceCheck (void);
+#endif /* DEBUG_PARANOID */
 static void system_scheduler( double dt, int init );
+static void space_prefetchSounds (void);
 /* Markers. */
 static int space_addMarkerSystem( int sysid, MissionMarkerType type );
 static int space_addMarkerSpob( int pntid, MissionMarkerType type );
@@ -442,8 +457,29 @@ int spob_rename( Spob *p, char *newname )
    free( p->name );
    p->name = newname;
 
-   /* Order changed, so no more bsearch for us. */
-   spobstack_changed = 1;
+   /* Name changed, so the index has to be rebuilt. */
+   spob_nameindexDirty = 1;
+
+   return 0;
+}
+
+/**
+ * @brief Renames a star system.
+ *
+ *    @param sys System to rename.
+ *    @param newname New name to give the system.
+ *    @return 0 on success.
+ */
+int system_rename( StarSystem *sys, char *newname )
+{
+   for (int i=0; i<array_size(systemname_stack); i++)
+      if (strcmp(systemname_stack[i], sys->name)==0)
+         systemname_stack[i] = newname;
+   free( sys->name );
+   sys->name = newname;
+
+   /* Name changed, so the index has to be rebuilt. */
+   systems_nameindexDirty = 1;
 
    return 0;
 }
@@ -721,7 +757,7 @@ double system_getClosest( const StarSystem *sys, int *pnt, int *jp, int *ast, in
          if (!pilot_inRangeAsteroid( player.p, k, i ))
             continue;
 
-         td = pow2(x-as->pos.x) + pow2(y-as->pos.y);
+         td = pow2(x-f->motion.x[k]) + pow2(y-f->motion.y[k]);
          if (td < d) {
             *pnt  = -1; /* We must clear spob target as asteroid is closer. */
             *ast  = k;
@@ -792,7 +828,7 @@ double system_getClosestAng( const StarSystem *sys, int *pnt, int *jp, int *ast,
          if (as->state != ASTEROID_FG)
             continue;
 
-         ta = atan2( y - as->pos.y, x - as->pos.x);
+         ta = atan2( y - f->motion.y[k], x - f->motion.x[k]);
          if ( ABS(angle_diff(ang, ta)) < ABS(angle_diff(ang, a))) {
             *pnt  = -1; /* We must clear spob target as asteroid is closer. */
             *ast  = k;
@@ -844,16 +880,14 @@ int space_sysReachable( const StarSystem *sys )
  */
 int space_sysReallyReachable( const char* sysname )
 {
-   StarSystem** path;
+   const StarSystem *sys;
 
    if (strcmp(sysname,cur_system->name)==0)
       return 1;
-   path = map_getJumpPath( cur_system->name, sysname, 1, 1, NULL );
-   if (path != NULL) {
-      array_free(path);
-      return 1;
-   }
-   return 0;
+   sys = system_get( sysname );
+   if (sys == NULL)
+      return 0;
+   return (pathfind_jumpDist( cur_system, sys, 1 ) > 0);
 }
 
 /**
@@ -936,6 +970,24 @@ static int system_cmp( const void *p1, const void *p2 )
    return strcmp(s1->name,s2->name);
 }
 
+/**
+ * @brief Rebuilds the name index of the systems.
+ *
+ * Systems that have not been named yet are skipped and leave the index dirty
+ * so that they get picked up by the next lookup.
+ */
+static void systems_reindex (void)
+{
+   nameindex_clear( &systems_nameindex );
+   nameindex_reserve( &systems_nameindex, array_size(systems_stack) );
+   systems_nameindexDirty = 0;
+   for (int i=0; i<array_size(systems_stack); i++) {
+      if (systems_stack[i].name == NULL)
+         systems_nameindexDirty = 1;
+      nameindex_add( &systems_nameindex, systems_stack[i].name, i );
+   }
+}
+
 /**
  * @brief Get the system from its name.
  *
@@ -944,23 +996,16 @@ static int system_cmp( const void *p1, const void *p2 )
  */
 StarSystem* system_get( const char* sysname )
 {
-   if (sysname == NULL)
-      return NULL;
+   int id;
 
-#ifdef DEBUGGING
-   if (systemstack_changed) {
-      for (int i=0; i<array_size(systems_stack); i++)
-         if (strcmp(systems_stack[i].name, sysname)==0)
-            return &systems_stack[i];
-      WARN(_("System '%s' not found in stack"), sysname);
+   if (sysname == NULL)
       return NULL;
-   }
-#endif /* DEBUGGING */
 
-   const StarSystem s = {.name = (char*)sysname};
-   StarSystem *found = bsearch( &s, systems_stack, array_size(systems_stack), sizeof(StarSystem), system_cmp );
-   if (found != NULL)
-      return found;
+   if (systems_nameindexDirty)
+      systems_reindex();
+   id = nameindex_get( &systems_nameindex, sysname );
+   if (id >= 0)
+      return &systems_stack[id];
 
    WARN(_("System '%s' not found in stack"), sysname);
    return NULL;
@@ -1028,6 +1073,24 @@ static int spob_cmp( const void *p1, const void *p2 )
    return strcmp(pnt1->name,pnt2->name);
 }
 
+/**
+ * @brief Rebuilds the name index of the spobs.
+ *
+ * Spobs that have not been named yet are skipped and leave the index dirty so
+ * that they get picked up by the next lookup.
+ */
+static void spobs_reindex (void)
+{
+   nameindex_clear( &spob_nameindex );
+   nameindex_reserve( &spob_nameindex, array_size(spob_stack) );
+   spob_nameindexDirty = 0;
+   for (int i=0; i<array_size(spob_stack); i++) {
+      if (spob_stack[i].name == NULL)
+         spob_nameindexDirty = 1;
+      nameindex_add( &spob_nameindex, spob_stack[i].name, i );
+   }
+}
+
 /**
  * @brief Gets a spob based on its name.
  *
@@ -1036,25 +1099,18 @@ static int spob_cmp( const void *p1, const void *p2 )
  */
 Spob* spob_get( const char* spobname )
 {
+   int id;
+
    if (spobname==NULL) {
       WARN(_("Trying to find NULL spob…"));
       return NULL;
    }
 
-#ifdef DEBUGGING
-   if (spobstack_changed) {
-      for (int i=0; i<array_size(spob_stack); i++)
-         if (strcmp(spob_stack[i].name, spobname)==0)
-            return &spob_stack[i];
-      WARN(_("Spob '%s' not found in the universe"), spobname);
-      return NULL;
-   }
-#endif /* DEBUGGING */
-
-   const Spob p = {.name = (char*)spobname};
-   Spob *found = bsearch( &p, spob_stack, array_size(spob_stack), sizeof(Spob), spob_cmp );
-   if (found != NULL)
-      return found;
+   if (spob_nameindexDirty)
+      spobs_reindex();
+   id = nameindex_get( &spob_nameindex, spobname );
+   if (id >= 0)
+      return &spob_stack[id];
 
    WARN(_("Spob '%s' not found in the universe"), spobname);
    return NULL;
@@ -1257,7 +1313,8 @@ static void system_scheduler( double dt, int init )
 {
    /* Go through all the factions and reduce the timer. */
    for (int i=0; i < array_size(cur_system->presence); i++) {
-      int n;
+      int n, ret;
+      uint64_t t0;
       nlua_env env;
       SystemPresence *p = &cur_system->presence[i];
       if (p->value <= 0.)
@@ -1290,6 +1347,10 @@ static void system_scheduler( double dt, int init )
          if (p->timer >= 0.)
             continue;
 
+         /* Overdue spawns can wait if the faction went over its budget. */
+         if (nlua_budgetDefer( &p->budget ))
+            continue;
+
          nlua_getenv( naevL, env, "spawn" ); /* f */
          if (lua_isnil(naevL,-1)) {
             WARN(_("Lua Spawn script for faction '%s' missing obligatory entry point 'spawn'."),
@@ -1303,7 +1364,12 @@ static void system_scheduler( double dt, int init )
       lua_pushnumber( naevL, p->value ); /* f, [arg,], max */
 
       /* Actually run the function. */
-      if (nlua_pcall(env, n+1, 2)) { /* error has occurred */
+      PROFILE_BEGIN_NAME( PROFILE_LUA_SCHEDULER, faction_name( p->faction ) );
+      t0 = nlua_budgetStart();
+      ret = nlua_pcall(env, n+1, 2);
+      nlua_budgetStop( &p->budget, t0 );
+      PROFILE_END( PROFILE_LUA_SCHEDULER );
+      if (ret) { /* error has occurred */
          WARN(_("Lua Spawn script for faction '%s' : %s"),
                faction_name( p->faction ), lua_tostring(naevL,-1));
          lua_pop(naevL,1);
@@ -1523,6 +1589,43 @@ int space_isSimulationEffects (void)
    return space_simulating_effects;
 }
 
+/**
+ * @brief Gets statistics of the last simulation done when entering a system.
+ *
+ *    @param[out] time Real time the simulation took (in seconds).
+ *    @param[out] steps Number of updates done by the simulation.
+ */
+void space_simulationStats( double *time, int *steps )
+{
+   *time  = space_simulate_time;
+   *steps = space_simulate_steps;
+}
+
+/**
+ * @brief Starts loading the sounds of the outfits of the pilots in the system.
+ */
+static void space_prefetchSounds (void)
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+   for (int i=0; i<array_size(pilot_stack); i++) {
+      const Pilot *p = pilot_stack[i];
+      for (int j=0; j<array_size(p->outfits); j++) {
+         const Outfit *o = p->outfits[j]->outfit;
+         if (o == NULL)
+            continue;
+         if (outfit_isBeam(o)) {
+            sound_prefetch( o->u.bem.sound_warmup );
+            sound_prefetch( o->u.bem.sound );
+            sound_prefetch( o->u.bem.sound_off );
+         }
+         else {
+            sound_prefetch( outfit_sound(o) );
+            sound_prefetch( outfit_soundHit(o) );
+         }
+      }
+   }
+}
+
 /**
  * @brief Initializes the system.
  *
@@ -1626,6 +1729,9 @@ void space_init( const char* sysname, int do_simulate )
    /* Call the scheduler. */
    system_scheduler( 0., 1 );
 
+   /* Decode the weapon sounds while the system is simulated. */
+   space_prefetchSounds();
+
    /* we now know this system */
    sys_setFlag(cur_system,SYSTEM_KNOWN);
 
@@ -1644,23 +1750,28 @@ void space_init( const char* sysname, int do_simulate )
    }
    player_messageToggle( 0 );
    if (do_simulate) {
-      /* Uint32 time = SDL_GetTicks(); */
+      Uint64 time = SDL_GetPerformanceCounter();
       s = sound_disabled;
       sound_disabled = 1;
       ntime_allowUpdate( 0 );
-      n = SYSTEM_SIMULATE_TIME_PRE / fps_min_simulation;
+      /* Nothing is visible yet, so use a coarser time step without effects and
+       * with less frequent AI control ticks. */
+      n = ceil( SYSTEM_SIMULATE_TIME_PRE / SYSTEM_SIMULATE_DT_PRE );
       for (int i=0; i<n; i++)
-         update_routine( fps_min_simulation, 1 );
+         update_routine( SYSTEM_SIMULATE_DT_PRE, 1 );
+      space_simulate_steps = n;
+      /* Finish at the normal rate so effects look natural on arrival. */
       space_simulating_effects = 1;
       n = SYSTEM_SIMULATE_TIME_POST / fps_min_simulation;
       for (int i=0; i<n; i++)
          update_routine( fps_min_simulation, 1 );
+      space_simulate_steps += n;
       ntime_allowUpdate( 1 );
       sound_disabled = s;
-      /*
+      space_simulate_time = (double)(SDL_GetPerformanceCounter() - time) / (double)SDL_GetPerformanceFrequency();
       if (conf.devmode)
-         DEBUG(_("System simulated in %.3f s"), (SDL_GetTicks()-time)/1000.);
-      */
+         DEBUG(_("System simulated in %.3f s (%d updates, %d pilots)"),
+               space_simulate_time, space_simulate_steps, array_size(pilot_getAll()));
    }
    player_messageToggle( 1 );
    if (player.p != NULL) {
@@ -1692,10 +1803,7 @@ Spob *spob_new (void)
    Spob *p, *old_stack;
    int realloced;
 
-#if DEBUGGING
-   if (!systems_loading)
-      spobstack_changed = 1;
-#else /* DEBUGGING */
+#ifndef DEBUGGING
    if (!systems_loading)
       WARN(_("Creating new spob in non-debugging mode. Things are probably going to break horribly."));
 #endif /* DEBUGGING */
@@ -1707,6 +1815,7 @@ Spob *spob_new (void)
    memset( p, 0, sizeof(Spob) );
    p->id       = array_size(spob_stack)-1;
    p->presence.faction = -1;
+   spob_nameindexDirty = 1; /* Gets named by the caller. */
 
    /* Lua doesn't default to 0 as a safe value... */
    p->lua_env     = LUA_NOREF;
@@ -1748,6 +1857,7 @@ const char *spob_name( const Spob *p )
 static int spobs_load (void)
 {
    char **spob_files;
+   XmlParseList *spob_docs;
    Commodity **stdList;
 
    /* Initialize stack if needed. */
@@ -1757,12 +1867,13 @@ static int spobs_load (void)
    /* Extract the list of standard commodities. */
    stdList = standard_commodities();
 
-   /* Load XML stuff. */
+   /* Load XML stuff, reading and parsing is done in parallel. */
    spob_files = ndata_listRecursive( SPOB_DATA_PATH );
+   spob_docs  = xml_parseListCreate( spob_files, "xml", NULL, NULL );
    for (int i=0; i<array_size(spob_files); i++) {
       if (ndata_matchExt( spob_files[i], "xml" )) {
          Spob s;
-         int ret = spob_parse( &s, spob_files[i], stdList );
+         int ret = spob_parse( &s, xml_parseListGet( spob_docs, i, NULL ), spob_files[i], stdList );
          if (ret == 0) {
             s.id = array_size( spob_stack );
             array_push_back( &spob_stack, s );
@@ -1771,13 +1882,14 @@ static int spobs_load (void)
          /* Render if necessary. */
          naev_renderLoadscreen();
       }
-
-      /* Clean up. */
-      free( spob_files[i] );
    }
+   xml_parseListFree( spob_docs );
+   for (int i=0; i<array_size(spob_files); i++)
+      free( spob_files[i] );
    qsort( spob_stack, array_size(spob_stack), sizeof(Spob), spob_cmp );
    for (int j=0; j<array_size(spob_stack); j++)
       spob_stack[j].id = j;
+   spob_nameindexDirty = 1;
 
    /* Clean up. */
    array_free( spob_files );
@@ -2143,18 +2255,17 @@ static int spob_parsePresence( xmlNodePtr node, SpobPresence *ap )
  * @brief Parses a spob from an xml node.
  *
  *    @param spob Spob to fill up.
- *    @param filename Name of the file to parse.
+ *    @param doc Parsed XML of the spob, gets freed.
+ *    @param filename Name of the file the spob was loaded from.
  *    @param[in] stdList The array of standard commodities.
  *    @return 0 on success.
  */
-static int spob_parse( Spob *spob, const char *filename, Commodity **stdList )
+static int spob_parse( Spob *spob, xmlDocPtr doc, const char *filename, Commodity **stdList )
 {
-   xmlDocPtr doc;
    xmlNodePtr node, parent;
    unsigned int flags;
    Commodity **comms;
 
-   doc = xml_parsePhysFS( filename );
    if (doc == NULL)
       return -1;
 
@@ -2467,9 +2578,6 @@ int system_rmSpob( StarSystem *sys, const char *spobname )
    array_erase( &sys->spobs, &sys->spobs[i], &sys->spobs[i+1] );
    array_erase( &sys->spobsid, &sys->spobsid[i], &sys->spobsid[i+1] );
 
-   /* Remove the presence. */
-   space_reconstructPresences(); /* TODO defer this if removing multiple spobs at once. */
-
    /* Remove from the name stack thingy. */
    found = 0;
    for (i=0; i<array_size(spobname_stack); i++)
@@ -2543,8 +2651,6 @@ int system_rmVirtualSpob( StarSystem *sys, const char *spobname )
    /* Remove virtual spob. */
    array_erase( &sys->spobs_virtual, &sys->spobs_virtual[i], &sys->spobs_virtual[i+1] );
 
-   /* Remove the presence. */
-   space_reconstructPresences(); /* TODO defer this if removing multiple spobs at once. */
    system_setFaction(sys);
 
    economy_addQueuedUpdate();
@@ -2604,6 +2710,7 @@ int system_rmJump( StarSystem *sys, const char *jumpname )
 
    /* Remove jump from system. */
    array_erase( &sys->jumps, &sys->jumps[i], &sys->jumps[i+1] );
+   pathfind_invalidate();
 
    /* Refresh presence */
    system_setFaction(sys);
@@ -2636,10 +2743,7 @@ StarSystem *system_new (void)
    StarSystem *sys;
    int id;
 
-#if DEBUGGING
-   if (!systems_loading)
-      systemstack_changed = 1;
-#else /* DEBUGGING */
+#ifndef DEBUGGING
    if (!systems_loading)
       WARN(_("Creating new system in non-debugging mode. Things are probably going to break horribly."));
 #endif /* DEBUGGING */
@@ -2659,6 +2763,7 @@ StarSystem *system_new (void)
    /* Initialize system and id. */
    system_init( sys );
    sys->id = array_size(systems_stack)-1;
+   systems_nameindexDirty = 1; /* Gets named by the caller. */
 
    /* Reconstruct the jumps, only truely necessary if the systems realloced. */
    if (!systems_loading)
@@ -2708,6 +2813,9 @@ void systems_reconstructJumps (void)
       StarSystem *sys = &systems_stack[i];
       system_reconstructJumps(sys);
    }
+
+   /* Cached hop distances depend on the jumps. */
+   pathfind_invalidate();
 }
 
 /**
@@ -2854,17 +2962,15 @@ if (o) WARN(_("Asteroid Exclusion Zone in Star System '%s' has missing/invalid '
  * @brief Creates a system from an XML node.
  *
  *    @param sys System to set up.
- *    @param filename Name of the file to parse.
+ *    @param doc Parsed XML of the system, gets freed.
+ *    @param filename Name of the file the system was loaded from.
  *    @return 0 on success.
  */
-static int system_parse( StarSystem *sys, const char *filename )
+static int system_parse( StarSystem *sys, xmlDocPtr doc, const char *filename )
 {
    xmlNodePtr node, parent;
-   xmlDocPtr doc;
    uint32_t flags;
 
-   /* Load the file. */
-   doc = xml_parsePhysFS( filename );
    if (doc == NULL)
       return -1;
 
@@ -3234,14 +3340,13 @@ static int system_parseJumpPoint( const xmlNodePtr node, StarSystem *sys )
  * @brief Loads the jumps into a system.
  *
  *    @param sys Star system to load jumps of.
+ *    @param doc Parsed XML of the system, gets freed.
  *    @return 0 on success.
  */
-static int system_parseJumps( StarSystem *sys )
+static int system_parseJumps( StarSystem *sys, xmlDocPtr doc )
 {
    xmlNodePtr parent, node;
-   xmlDocPtr doc;
 
-   doc = xml_parsePhysFS( sys->filename );
    if (doc == NULL)
       return -1;
 
@@ -3363,6 +3468,8 @@ int space_loadLua (void)
 static int systems_load (void)
 {
    char **system_files;
+   const char **sorted_files;
+   XmlParseList *system_docs;
    Uint32 time = SDL_GetTicks();
 
    /* Allocate if needed. */
@@ -3370,6 +3477,7 @@ static int systems_load (void)
       systems_stack = array_create( StarSystem );
 
    system_files = ndata_listRecursive( SYSTEM_DATA_PATH );
+   system_docs  = xml_parseListCreate( system_files, "xml", NULL, NULL );
 
    /*
     * First pass - loads all the star systems_stack.
@@ -3380,7 +3488,7 @@ static int systems_load (void)
       if (!ndata_matchExt( system_files[i], "xml" ))
          continue;
 
-      int ret = system_parse( &sys, system_files[i] );
+      int ret = system_parse( &sys, xml_parseListGet( system_docs, i, NULL ), system_files[i] );
       if (ret == 0) {
          sys.filename = system_files[i];
          sys.id = array_size(systems_stack);
@@ -3399,14 +3507,22 @@ static int systems_load (void)
       systems_stack[j].id = j;
       systems_stack[j].note = NULL; /* just to be sure */
    }
+   systems_nameindexDirty = 1;
 
    /*
     * Second pass - loads all the jump routes.
     */
+   xml_parseListFree( system_docs );
+   sorted_files = array_create_size( const char*, array_size(systems_stack) );
    for (int i=0; i<array_size(systems_stack); i++)
-      system_parseJumps( &systems_stack[i] );
+      array_push_back( &sorted_files, systems_stack[i].filename );
+   system_docs = xml_parseListCreate( (char *const *) sorted_files, NULL, NULL, NULL );
+   for (int i=0; i<array_size(systems_stack); i++)
+      system_parseJumps( &systems_stack[i], xml_parseListGet( system_docs, i, NULL ) );
 
    /* Clean up. */
+   xml_parseListFree( system_docs );
+   array_free( sorted_files );
    array_free( system_files );
 
    if (conf.devmode) {
@@ -3556,6 +3672,9 @@ static void space_updateSpob( const Spob *p, double dt, double real_dt )
  */
 void space_exit (void)
 {
+   /* Free pathfinding data. */
+   pathfind_exit();
+
    /* Free standalone graphic textures */
    gl_freeTexture(jumppoint_gfx);
    jumppoint_gfx = NULL;
@@ -3607,6 +3726,8 @@ void space_exit (void)
       nlua_freeEnv( spb->lua_env );
    }
    array_free(spob_stack);
+   nameindex_free( &spob_nameindex );
+   spob_nameindexDirty = 1;
 
    for (int i=0; i<array_size(spob_lua_stack); i++)
       spob_lua_free( &spob_lua_stack[i] );
@@ -3649,6 +3770,8 @@ void space_exit (void)
    }
    array_free(systems_stack);
    systems_stack = NULL;
+   nameindex_free( &systems_nameindex );
+   systems_nameindexDirty = 1;
 
    /* Free asteroids stuff. */
    asteroids_free();
@@ -4047,6 +4170,21 @@ static int getPresenceIndex( StarSystem *sys, int faction )
  *    @param ap Spob presence to add.
  */
 void system_presenceAddSpob( StarSystem *sys, const SpobPresence *ap )
+{
+   system_presenceAddSpobMask( sys, ap, NULL );
+}
+
+/**
+ * @brief Adds (or removes) some presence to a subset of the systems.
+ *
+ * The presence spills exactly as with system_presenceAddSpob(), but it is only
+ * added to the systems that are set in the mask.
+ *
+ *    @param sys Pointer to the system to add to or remove from.
+ *    @param ap Spob presence to add.
+ *    @param mask Per system ID, whether or not to add presence to it. NULL adds to all systems.
+ */
+static void system_presenceAddSpobMask( StarSystem *sys, const SpobPresence *ap, const char *mask )
 {
    int id, curSpill;
    Queue q, qn;
@@ -4076,15 +4214,17 @@ void system_presenceAddSpob( StarSystem *sys, const SpobPresence *ap )
    fgens = faction_generators( faction );
 
    /* Add the presence to the current system. */
-   id = getPresenceIndex(sys, faction);
-   sys->presence[id].base   = MAX( sys->presence[id].base, base );
-   sys->presence[id].bonus += bonus;
-   sys->presence[id].value  = sys->presence[id].base + sys->presence[id].bonus;
-   for (int i=0; i<array_size(fgens); i++) {
-      int x = getPresenceIndex(sys, fgens[i].id);
-      sys->presence[x].base   = MAX( sys->presence[x].base, MAX(0., base*fgens[i].weight) );
-      sys->presence[x].bonus += MAX(0., bonus*fgens[i].weight);
-      sys->presence[x].value  = sys->presence[x].base + sys->presence[x].bonus;
+   if ((mask == NULL) || mask[sys->id]) {
+      id = getPresenceIndex(sys, faction);
+      sys->presence[id].base   = MAX( sys->presence[id].base, base );
+      sys->presence[id].bonus += bonus;
+      sys->presence[id].value  = sys->presence[id].base + sys->presence[id].bonus;
+      for (int i=0; i<array_size(fgens); i++) {
+         int x = getPresenceIndex(sys, fgens[i].id);
+         sys->presence[x].base   = MAX( sys->presence[x].base, MAX(0., base*fgens[i].weight) );
+         sys->presence[x].bonus += MAX(0., bonus*fgens[i].weight);
+         sys->presence[x].value  = sys->presence[x].base + sys->presence[x].bonus;
+      }
    }
 
    /* If there's no range, we're done here. */
@@ -4134,17 +4274,19 @@ void system_presenceAddSpob( StarSystem *sys, const SpobPresence *ap )
       }
 
       /* Spill some presence. */
-      x = getPresenceIndex(cur, faction);
-      spillfactor = 1. / (2. + (double)curSpill);
-      cur->presence[x].base   = MAX( cur->presence[x].base, base * spillfactor );
-      cur->presence[x].bonus += bonus * spillfactor;
-      cur->presence[x].value  = cur->presence[x].base + cur->presence[x].bonus;
-
-      for (int i=0; i<array_size(fgens); i++) {
-         int y = getPresenceIndex(cur, fgens[i].id);
-         cur->presence[y].base   = MAX( cur->presence[y].base, MAX(0., base*spillfactor*fgens[i].weight) );
-         cur->presence[y].bonus += MAX(0., bonus*spillfactor*fgens[i].weight );
-         cur->presence[y].value  = cur->presence[y].base + cur->presence[y].bonus;
+      if ((mask == NULL) || mask[cur->id]) {
+         x = getPresenceIndex(cur, faction);
+         spillfactor = 1. / (2. + (double)curSpill);
+         cur->presence[x].base   = MAX( cur->presence[x].base, base * spillfactor );
+         cur->presence[x].bonus += bonus * spillfactor;
+         cur->presence[x].value  = cur->presence[x].base + cur->presence[x].bonus;
+
+         for (int i=0; i<array_size(fgens); i++) {
+            int y = getPresenceIndex(cur, fgens[i].id);
+            cur->presence[y].base   = MAX( cur->presence[y].base, MAX(0., base*spillfactor*fgens[i].weight) );
+            cur->presence[y].bonus += MAX(0., bonus*spillfactor*fgens[i].weight );
+            cur->presence[y].value  = cur->presence[y].base + cur->presence[y].bonus;
+         }
       }
 
       /* Check to see if we've finished this range and grab the next queue. */
@@ -4281,6 +4423,277 @@ void space_reconstructPresences( void )
       system_scheduler( 0., 1 );
 }
 
+/**
+ * @brief Gets the largest range any presence of a system spills to.
+ *
+ *    @param sys System to get the presence range of.
+ *    @return The range in jumps, or -1 if the system has no presence.
+ */
+static int system_presenceRange( const StarSystem *sys )
+{
+   int range = -1;
+   for (int i=0; i<array_size(sys->spobs); i++) {
+      const SpobPresence *ap = &sys->spobs[i]->presence;
+      if ((ap->base != 0.) || (ap->bonus != 0.))
+         range = MAX( range, ap->range );
+   }
+   for (int i=0; i<array_size(sys->spobs_virtual); i++) {
+      for (int j=0; j<array_size(sys->spobs_virtual[i]->presences); j++) {
+         const SpobPresence *ap = &sys->spobs_virtual[i]->presences[j];
+         if ((ap->base != 0.) || (ap->bonus != 0.))
+            range = MAX( range, ap->range );
+      }
+   }
+   return range;
+}
+
+/**
+ * @brief Computes the distance in jumps to a set of systems, ignoring jump directions.
+ *
+ *    @param[in,out] dist Per system, 0 for the systems in the set and -1 otherwise. Gets set to the distance or -1 if further than radius.
+ *    @param adj Per system, array (array.h) of the systems it is connected to in either direction.
+ *    @param radius Maximum distance to compute.
+ */
+static void system_presenceDistance( int *dist, int *const* adj, int radius )
+{
+   int n = array_size(systems_stack);
+   int *queue = malloc( n * sizeof(int) );
+   int head = 0;
+   int tail = 0;
+
+   for (int i=0; i<n; i++)
+      if (dist[i]==0)
+         queue[tail++] = i;
+
+   while (head < tail) {
+      int s = queue[head++];
+      if (dist[s] >= radius)
+         continue;
+      for (int i=0; i<array_size(adj[s]); i++) {
+         int t = adj[s][i];
+         if (dist[t] < 0) {
+            dist[t] = dist[s]+1;
+            queue[tail++] = t;
+         }
+      }
+   }
+   free( queue );
+}
+
+/**
+ * @brief Marks all the systems within range of a system.
+ *
+ *    @param[in,out] affected Per system ID, whether or not it is marked.
+ *    @param dist Scratch space with an element per system.
+ *    @param adj Per system, array (array.h) of the systems it is connected to in either direction.
+ *    @param sysid ID of the system to mark around.
+ *    @param range Range in jumps to mark.
+ *    @return Number of systems that were newly marked.
+ */
+static int system_presenceMark( char *affected, int *dist, int *const* adj, int sysid, int range )
+{
+   int n = 0;
+   for (int i=0; i<array_size(systems_stack); i++)
+      dist[i] = -1;
+   dist[sysid] = 0;
+   system_presenceDistance( dist, adj, range );
+   for (int i=0; i<array_size(systems_stack); i++) {
+      if ((dist[i] >= 0) && !affected[i]) {
+         affected[i] = 1;
+         n++;
+      }
+   }
+   return n;
+}
+
+/**
+ * @brief Reconstructs the presence of only the systems affected by some changes.
+ *
+ * Presence spills over jumps, so the systems within range of the changed
+ * presence have to be recomputed, and when jumps change, so does the spill of
+ * all the sources near them. Distances are measured on the graph with both
+ * the current and the removed jumps, so that systems that were only reached
+ * through a removed jump are found too. The affected systems are rebuilt from
+ * all the sources that can reach them, giving the same result as
+ * space_reconstructPresences(), which is used instead if most of the universe
+ * is affected.
+ *
+ *    @param changes Array (array.h) of changes to the systems.
+ */
+void space_reconstructPresencesPartial( const PresenceChange *changes )
+{
+   int n = array_size(systems_stack);
+   int rmax, naffected;
+   int **adj, *dist, *ball;
+   char *affected;
+
+   if (array_size(changes) == 0)
+      return;
+
+   /* Largest spill range and the systems connected to each system, including
+    * through the jumps that were removed. */
+   rmax = 0;
+   adj = malloc( n * sizeof(int*) );
+   for (int i=0; i<n; i++)
+      adj[i] = array_create( int );
+   for (int i=0; i<n; i++) {
+      const StarSystem *sys = &systems_stack[i];
+      rmax = MAX( rmax, system_presenceRange( sys ) );
+      for (int j=0; j<array_size(sys->jumps); j++) {
+         array_push_back( &adj[i], sys->jumps[j].targetid );
+         array_push_back( &adj[ sys->jumps[j].targetid ], i );
+      }
+   }
+   for (int c=0; c<array_size(changes); c++) {
+      const PresenceChange *pc = &changes[c];
+      if (pc->removed < 0)
+         continue;
+      array_push_back( &adj[ pc->system ], pc->removed );
+      array_push_back( &adj[ pc->removed ], pc->system );
+   }
+
+   /* Find the affected systems. */
+   naffected = 0;
+   affected = calloc( n, sizeof(char) );
+   dist = malloc( n * sizeof(int) );
+   ball = malloc( n * sizeof(int) );
+   for (int c=0; c<array_size(changes); c++) {
+      const PresenceChange *pc = &changes[c];
+
+      /* Presence that was added or removed spills up to its range. */
+      if (pc->range >= 0)
+         naffected += system_presenceMark( affected, ball, adj, pc->system, pc->range );
+
+      /* Changing jumps changes the spill of all the sources that reach them,
+       * both before and after the change. */
+      if (pc->jumps) {
+         for (int i=0; i<n; i++)
+            dist[i] = -1;
+         dist[pc->system] = 0;
+         if (pc->removed >= 0)
+            dist[pc->removed] = 0;
+         system_presenceDistance( dist, adj, rmax );
+         for (int i=0; i<n; i++) {
+            int r;
+            if (dist[i] < 0)
+               continue;
+            r = system_presenceRange( &systems_stack[i] );
+            if (r >= dist[i])
+               naffected += system_presenceMark( affected, ball, adj, i, r );
+         }
+      }
+   }
+
+   /* Not worth it when most of the universe changed. */
+   if (2*naffected > n)
+      space_reconstructPresences();
+   else if (naffected > 0) {
+      /* Reset the presence of the affected systems. */
+      for (int i=0; i<n; i++) {
+         if (!affected[i])
+            continue;
+         array_free(systems_stack[i].presence);
+         systems_stack[i].presence  = array_create( SystemPresence );
+         systems_stack[i].ownerpresence = 0.;
+      }
+
+      /* Re-add presence from all the sources that can reach them, in the same
+       * order as space_reconstructPresences(). */
+      for (int i=0; i<n; i++)
+         dist[i] = affected[i] ? 0 : -1;
+      system_presenceDistance( dist, adj, rmax );
+      for (int i=0; i<n; i++) {
+         StarSystem *sys = &systems_stack[i];
+         if (dist[i] < 0)
+            continue;
+         for (int j=0; j<array_size(sys->spobs); j++)
+            if (sys->spobs[j]->presence.range >= dist[i])
+               system_presenceAddSpobMask( sys, &sys->spobs[j]->presence, affected );
+         for (int j=0; j<array_size(sys->spobs_virtual); j++)
+            for (int k=0; k<array_size(sys->spobs_virtual[j]->presences); k++)
+               if (sys->spobs_virtual[j]->presences[k].range >= dist[i])
+                  system_presenceAddSpobMask( sys, &sys->spobs_virtual[j]->presences[k], affected );
+      }
+
+      /* Determine dominant faction. */
+      for (int i=0; i<n; i++) {
+         if (!affected[i])
+            continue;
+         system_setFaction( &systems_stack[i] );
+         systems_stack[i].ownerpresence = system_getPresence( &systems_stack[i], systems_stack[i].faction );
+      }
+
+#if DEBUG_PARANOID
+      system_presenceCheck();
+#endif /* DEBUG_PARANOID */
+
+      if ((cur_system != NULL) && affected[cur_system->id])
+         system_scheduler( 0., 1 );
+   }
+
+   for (int i=0; i<n; i++)
+      array_free( adj[i] );
+   free( adj );
+   free( dist );
+   free( ball );
+   free( affected );
+}
+
+#if DEBUG_PARANOID
+/**
+ * @brief Compares the presence of all systems against a full reconstruction.
+ *
+ * The presence is left as it was, only mismatches are warned about.
+ */
+static void system_presenceCheck (void)
+{
+   int n = array_size(systems_stack);
+   SystemPresence **old = malloc( n * sizeof(SystemPresence*) );
+   int *faction = malloc( n * sizeof(int) );
+   double *ownerpresence = malloc( n * sizeof(double) );
+
+   /* Rebuild everything, keeping the partial result aside. */
+   for (int i=0; i<n; i++) {
+      StarSystem *sys = &systems_stack[i];
+      old[i]            = sys->presence;
+      faction[i]        = sys->faction;
+      ownerpresence[i]  = sys->ownerpresence;
+      sys->presence     = array_create( SystemPresence );
+      sys->ownerpresence = 0.;
+   }
+   for (int i=0; i<n; i++)
+      system_addAllSpobsPresence( &systems_stack[i] );
+   for (int i=0; i<n; i++)
+      system_setFaction( &systems_stack[i] );
+
+   /* Compare and restore. */
+   for (int i=0; i<n; i++) {
+      StarSystem *sys = &systems_stack[i];
+      int bad = (sys->faction != faction[i]) ||
+            (array_size(sys->presence) != array_size(old[i]));
+      for (int j=0; !bad && j<array_size(sys->presence); j++) {
+         const SystemPresence *sp = &sys->presence[j];
+         int k;
+         for (k=0; k<array_size(old[i]); k++)
+            if (old[i][k].faction == sp->faction)
+               break;
+         if ((k >= array_size(old[i])) || (FABS(old[i][k].value-sp->value) > 1e-6))
+            bad = 1;
+      }
+      if (bad)
+         WARN(_("Partial presence reconstruction of system '%s' does not match a full reconstruction!"), sys->name);
+      array_free( sys->presence );
+      sys->presence      = old[i];
+      sys->faction       = faction[i];
+      sys->ownerpresence = ownerpresence[i];
+   }
+
+   free( old );
+   free( faction );
+   free( ownerpresence );
+}
+#endif /* DEBUG_PARANOID */
+
 /**
  * @brief See if the system has a spob.
  *
@@ -17,6 +17,8 @@
 
 #define SYSTEM_SIMULATE_TIME_PRE   25. /**< Time to simulate system before player is added, during this time special effect creation is disabled. */
 #define SYSTEM_SIMULATE_TIME_POST   5. /**< Time to simulate the system before the player is added, however, effects are added. */
+#define SYSTEM_SIMULATE_DT_PRE      0.1 /**< Time step used while simulating the system without effects. */
+#define SYSTEM_SIMULATE_AI_PRE      2. /**< Factor by which the AI control rate is slowed down while simulating the system without effects. */
 #define MAX_HYPERSPACE_VEL    25. /**< Speed to brake to before jumping. */
 
 /*
@@ -175,8 +177,21 @@ typedef struct SystemPresence_ {
    double curUsed;   /**< Presence currently used. */
    double timer;     /**< Current faction timer. */
    int disabled;     /**< Whether or not spawning is disabled for this presence. */
+   NLuaBudget budget; /**< Lua time spent by the spawn script, used to defer spawns. */
 } SystemPresence;
 
+/**
+ * @brief Represents a change to the presence sources of a system.
+ *
+ * @sa space_reconstructPresencesPartial
+ */
+typedef struct PresenceChange_ {
+   int system; /**< ID of the system that changed. */
+   int range;  /**< Range (in jumps) of the presence that was added or removed, or -1 if none. */
+   int jumps;  /**< Whether or not the jumps of the system changed. */
+   int removed; /**< ID of the target of a jump that was removed from the system, or -1 if none. */
+} PresenceChange;
+
 /*
  * Jump point flags.
  */
@@ -334,6 +349,7 @@ int spob_addCommodity( Spob *p, Commodity *c );
 int spob_addService( Spob *p, int service );
 int spob_rmService( Spob *p, int service );
 int spob_rename( Spob *p, char *newname );
+int system_rename( StarSystem *sys, char *newname );
 /* Land related stuff. */
 char spob_getColourChar( const Spob *p );
 const char *spob_getSymbol( const Spob *p );
@@ -385,6 +401,7 @@ double system_getPresence( const StarSystem *sys, int faction );
 double system_getPresenceFull( const StarSystem *sys, int faction, double *base, double *bonus );
 void system_addAllSpobsPresence( StarSystem *sys );
 void space_reconstructPresences( void );
+void space_reconstructPresencesPartial( const PresenceChange *changes );
 void system_rmCurrentPresence( StarSystem *sys, int faction, double amount );
 
 /*
@@ -393,6 +410,7 @@ void system_rmCurrentPresence( StarSystem *sys, int faction, double amount );
 void space_update( double dt, double real_dt );
 int space_isSimulation (void);
 int space_isSimulationEffects (void);
+void space_simulationStats( double *time, int *steps );
 
 /*
  * Graphics.
@@ -0,0 +1,269 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file spatial.c
+ *
+ * @brief Uniform grid for broadphase proximity queries.
+ *
+ * Objects are inserted only in the cell that contains their centre and the
+ * queries are grown by the largest bounding radius in the grid. This keeps the
+ * building a simple counting sort and ensures each object is reported at most
+ * once. Query results are always sorted by id so that callers iterating over
+ * them behave exactly as if they had looped over the whole stack.
+ */
+/** @cond */
+#include <math.h>
+#include <stdlib.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "spatial.h"
+
+#include "array.h"
+
+#define SPATIAL_CELL_MIN   256. /**< Minimum size of a cell. */
+#define SPATIAL_DIM_MAX    128  /**< Maximum amount of cells along an axis. */
+
+static int spatial_cmp( const void *p1, const void *p2 );
+static void spatial_cellRange( const SpatialGrid *grid,
+      double xmin, double ymin, double xmax, double ymax,
+      int *x0, int *y0, int *x1, int *y1 );
+
+/**
+ * @brief Initializes an empty spatial grid.
+ *
+ *    @param grid Grid to initialize.
+ */
+void spatial_init( SpatialGrid *grid )
+{
+   memset( grid, 0, sizeof(SpatialGrid) );
+   grid->cells    = array_create( int );
+   grid->objs     = array_create( SpatialObject );
+   grid->staged   = array_create( SpatialObject );
+   grid->cellof   = array_create( int );
+   grid->cellsize = SPATIAL_CELL_MIN;
+}
+
+/**
+ * @brief Frees the resources used by a spatial grid.
+ *
+ *    @param grid Grid to free.
+ */
+void spatial_free( SpatialGrid *grid )
+{
+   array_free( grid->cells );
+   array_free( grid->objs );
+   array_free( grid->staged );
+   array_free( grid->cellof );
+   memset( grid, 0, sizeof(SpatialGrid) );
+}
+
+/**
+ * @brief Clears all the objects in the grid and starts staging new ones.
+ *
+ *    @param grid Grid to clear.
+ */
+void spatial_clear( SpatialGrid *grid )
+{
+   array_erase( &grid->staged, array_begin(grid->staged), array_end(grid->staged) );
+   array_erase( &grid->objs, array_begin(grid->objs), array_end(grid->objs) );
+   array_erase( &grid->cells, array_begin(grid->cells), array_end(grid->cells) );
+   grid->nx    = 0;
+   grid->ny    = 0;
+   grid->rmax  = 0.;
+}
+
+/**
+ * @brief Stages an object to be added to the grid on the next spatial_build().
+ *
+ *    @param grid Grid to add object to.
+ *    @param id Identifier of the object.
+ *    @param x X position of the object.
+ *    @param y Y position of the object.
+ *    @param r Bounding radius of the object.
+ */
+void spatial_add( SpatialGrid *grid, int id, double x, double y, double r )
+{
+   SpatialObject *o = &array_grow( &grid->staged );
+   o->id = id;
+   o->x  = x;
+   o->y  = y;
+   o->r  = r;
+}
+
+/**
+ * @brief Buckets all the staged objects into the cells of the grid.
+ *
+ *    @param grid Grid to build.
+ */
+void spatial_build( SpatialGrid *grid )
+{
+   int n = array_size( grid->staged );
+   int ncells;
+   double xmin, ymin, xmax, ymax, len;
+
+   array_erase( &grid->objs, array_begin(grid->objs), array_end(grid->objs) );
+   array_erase( &grid->cells, array_begin(grid->cells), array_end(grid->cells) );
+   grid->nx    = 0;
+   grid->ny    = 0;
+   grid->rmax  = 0.;
+   if (n <= 0)
+      return;
+
+   /* Compute the bounds. */
+   xmin = xmax = grid->staged[0].x;
+   ymin = ymax = grid->staged[0].y;
+   for (int i=0; i<n; i++) {
+      const SpatialObject *o = &grid->staged[i];
+      xmin = MIN( xmin, o->x );
+      xmax = MAX( xmax, o->x );
+      ymin = MIN( ymin, o->y );
+      ymax = MAX( ymax, o->y );
+      grid->rmax = MAX( grid->rmax, o->r );
+   }
+
+   /* Aim for roughly one object per cell, but don't let cells get too small
+    * or the grid get too large when objects are spread out. */
+   len = MAX( xmax-xmin, ymax-ymin );
+   grid->cellsize = MAX( SPATIAL_CELL_MIN, len / sqrt(n) );
+   grid->cellsize = MAX( grid->cellsize, len / (SPATIAL_DIM_MAX-1) );
+   grid->x  = xmin;
+   grid->y  = ymin;
+   grid->nx = (int)floor( (xmax-xmin) / grid->cellsize ) + 1;
+   grid->ny = (int)floor( (ymax-ymin) / grid->cellsize ) + 1;
+   grid->nx = MIN( grid->nx, SPATIAL_DIM_MAX );
+   grid->ny = MIN( grid->ny, SPATIAL_DIM_MAX );
+   ncells = grid->nx * grid->ny;
+
+   /* Counting sort into the cells. */
+   array_resize( &grid->cells, ncells+1 );
+   array_resize( &grid->cellof, n );
+   array_resize( &grid->objs, n );
+   memset( grid->cells, 0, sizeof(int) * (ncells+1) );
+   for (int i=0; i<n; i++) {
+      const SpatialObject *o = &grid->staged[i];
+      int cx = CLAMP( 0, grid->nx-1, (int)((o->x - grid->x) / grid->cellsize) );
+      int cy = CLAMP( 0, grid->ny-1, (int)((o->y - grid->y) / grid->cellsize) );
+      grid->cellof[i] = cy * grid->nx + cx;
+      grid->cells[ grid->cellof[i]+1 ]++;
+   }
+   for (int i=0; i<ncells; i++)
+      grid->cells[i+1] += grid->cells[i];
+   for (int i=0; i<n; i++)
+      grid->objs[ grid->cells[ grid->cellof[i] ]++ ] = grid->staged[i];
+   /* Filling in shifted the offsets by one cell, restore them. */
+   for (int i=ncells; i>0; i--)
+      grid->cells[i] = grid->cells[i-1];
+   grid->cells[0] = 0;
+}
+
+/**
+ * @brief Compares two ids for qsort.
+ */
+static int spatial_cmp( const void *p1, const void *p2 )
+{
+   int i1 = *(const int*) p1;
+   int i2 = *(const int*) p2;
+   return i1 - i2;
+}
+
+/**
+ * @brief Gets the range of cells overlapping a bounding box.
+ */
+static void spatial_cellRange( const SpatialGrid *grid,
+      double xmin, double ymin, double xmax, double ymax,
+      int *x0, int *y0, int *x1, int *y1 )
+{
+   /* Objects outside the grid are clamped to the border cells. Clamping is
+    * done before converting so that huge ranges don't overflow. */
+   *x0 = (int)CLAMP( 0., grid->nx-1., floor( (xmin - grid->x) / grid->cellsize ) );
+   *y0 = (int)CLAMP( 0., grid->ny-1., floor( (ymin - grid->y) / grid->cellsize ) );
+   *x1 = (int)CLAMP( 0., grid->nx-1., floor( (xmax - grid->x) / grid->cellsize ) );
+   *y1 = (int)CLAMP( 0., grid->ny-1., floor( (ymax - grid->y) / grid->cellsize ) );
+}
+
+/**
+ * @brief Gets all the objects whose bounding circle overlaps a circle.
+ *
+ *    @param grid Grid to query.
+ *    @param[out] res Array (array.h) to store the ids of the objects in, sorted in ascending order.
+ *    @param x X position of the circle.
+ *    @param y Y position of the circle.
+ *    @param r Radius of the circle.
+ *    @return Number of objects found.
+ */
+int spatial_query( const SpatialGrid *grid, int **res,
+      double x, double y, double r )
+{
+   int x0, y0, x1, y1;
+   double ext = r + grid->rmax;
+
+   array_erase( res, array_begin(*res), array_end(*res) );
+   if (grid->nx <= 0)
+      return 0;
+
+   spatial_cellRange( grid, x-ext, y-ext, x+ext, y+ext, &x0, &y0, &x1, &y1 );
+   for (int cy=y0; cy<=y1; cy++) {
+      for (int cx=x0; cx<=x1; cx++) {
+         int c = cy * grid->nx + cx;
+         for (int i=grid->cells[c]; i<grid->cells[c+1]; i++) {
+            const SpatialObject *o = &grid->objs[i];
+            if (pow2(o->x-x) + pow2(o->y-y) <= pow2(o->r+r))
+               array_push_back( res, o->id );
+         }
+      }
+   }
+
+   if (array_size(*res) > 1)
+      qsort( *res, array_size(*res), sizeof(int), spatial_cmp );
+   return array_size(*res);
+}
+
+/**
+ * @brief Gets all the objects whose bounding circle overlaps a line segment.
+ *
+ *    @param grid Grid to query.
+ *    @param[out] res Array (array.h) to store the ids of the objects in, sorted in ascending order.
+ *    @param x X position of the start of the segment.
+ *    @param y Y position of the start of the segment.
+ *    @param dir Direction of the segment.
+ *    @param len Length of the segment.
+ *    @param r Thickness (radius) of the segment.
+ *    @return Number of objects found.
+ */
+int spatial_queryLine( const SpatialGrid *grid, int **res,
+      double x, double y, double dir, double len, double r )
+{
+   int x0, y0, x1, y1;
+   double dx, dy, ex, ey, ext;
+
+   array_erase( res, array_begin(*res), array_end(*res) );
+   if (grid->nx <= 0)
+      return 0;
+
+   dx  = cos(dir);
+   dy  = sin(dir);
+   ex  = x + len*dx;
+   ey  = y + len*dy;
+   ext = r + grid->rmax;
+   spatial_cellRange( grid, MIN(x,ex)-ext, MIN(y,ey)-ext,
+         MAX(x,ex)+ext, MAX(y,ey)+ext, &x0, &y0, &x1, &y1 );
+   for (int cy=y0; cy<=y1; cy++) {
+      for (int cx=x0; cx<=x1; cx++) {
+         int c = cy * grid->nx + cx;
+         for (int i=grid->cells[c]; i<grid->cells[c+1]; i++) {
+            const SpatialObject *o = &grid->objs[i];
+            /* Distance from the object to the closest point of the segment. */
+            double t = CLAMP( 0., len, (o->x-x)*dx + (o->y-y)*dy );
+            if (pow2(o->x-x-t*dx) + pow2(o->y-y-t*dy) <= pow2(o->r+r))
+               array_push_back( res, o->id );
+         }
+      }
+   }
+
+   if (array_size(*res) > 1)
+      qsort( *res, array_size(*res), sizeof(int), spatial_cmp );
+   return array_size(*res);
+}
@@ -0,0 +1,49 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+/**
+ * @brief An object stored in a spatial grid.
+ */
+typedef struct SpatialObject_ {
+   int id;     /**< Identifier given by the user (usually an index into a stack). */
+   double x;   /**< X position of the object. */
+   double y;   /**< Y position of the object. */
+   double r;   /**< Bounding radius of the object. */
+} SpatialObject;
+
+/**
+ * @brief Uniform grid used as a broadphase for proximity queries.
+ *
+ * The grid is rebuilt from scratch whenever the objects move (usually once per
+ * frame): objects are staged with spatial_add() and then bucketed into cells
+ * by spatial_build(). Each object is stored only in the cell containing its
+ * centre, queries are expanded by the largest bounding radius instead.
+ */
+typedef struct SpatialGrid_ {
+   double x;         /**< X coordinate of the lower left corner of the grid. */
+   double y;         /**< Y coordinate of the lower left corner of the grid. */
+   double cellsize;  /**< Length of the side of a cell. */
+   int nx;           /**< Number of cells along the X axis. */
+   int ny;           /**< Number of cells along the Y axis. */
+   double rmax;      /**< Largest bounding radius of the stored objects. */
+   int *cells;       /**< Array (array.h): Offset of each cell into objs, has nx*ny+1 elements. */
+   SpatialObject *objs; /**< Array (array.h): Objects sorted by cell. */
+   SpatialObject *staged; /**< Array (array.h): Objects added since the last build. */
+   int *cellof;      /**< Array (array.h): Scratch space, cell of each staged object. */
+} SpatialGrid;
+
+void spatial_init( SpatialGrid *grid );
+void spatial_free( SpatialGrid *grid );
+
+/* Building. */
+void spatial_clear( SpatialGrid *grid );
+void spatial_add( SpatialGrid *grid, int id, double x, double y, double r );
+void spatial_build( SpatialGrid *grid );
+
+/* Queries. */
+int spatial_query( const SpatialGrid *grid, int **res,
+      double x, double y, double r );
+int spatial_queryLine( const SpatialGrid *grid, int **res,
+      double x, double y, double dir, double len, double r );
@@ -8,6 +8,7 @@
  */
 /** @cond */
 #include <inttypes.h>
+#include <stddef.h>
 #include "SDL.h"
 #include "SDL_haptic.h"
 
@@ -46,8 +47,18 @@
 
 /* Trail stuff. */
 #define TRAIL_UPDATE_DT       0.05  /**< Rate (in seconds) at which trail is updated. */
+/**
+ * @brief A trail queued for rendering.
+ */
+typedef struct TrailRender_ {
+   const Trail_spfx *trail; /**< Trail to render. */
+   int order;        /**< Position of the trail in trail_spfx_stack. */
+} TrailRender;
 static TrailSpec* trail_spec_stack; /**< Trail specifications. */
 static Trail_spfx** trail_spfx_stack; /**< Active trail effects. */
+static TrailRender* trail_render = NULL; /**< Array (array.h): Trails being rendered. */
+static TrailVertex* trail_mesh = NULL; /**< Array (array.h): Trail mesh being rendered. */
+static gl_vbo *trail_vbo = NULL; /**< Streaming VBO for the trail meshes. */
 
 /*
  * Special hard-coded special effects
@@ -149,6 +160,7 @@ static void spfx_hapticRumble( double mod );
 static void spfx_update_trails( double dt );
 static void spfx_trail_update( Trail_spfx* trail, double dt );
 static void spfx_trail_free( Trail_spfx* trail );
+static void spfx_trail_drawBack (void);
 
 /**
  * @brief Parses an xml node containing a SPFX.
@@ -436,6 +448,12 @@ void spfx_free (void)
       spfx_trail_free( trail_spfx_stack[i] );
    array_free( trail_spfx_stack );
    trail_spfx_stack = NULL;
+   array_free( trail_render );
+   trail_render = NULL;
+   array_free( trail_mesh );
+   trail_mesh = NULL;
+   gl_vboDestroy( trail_vbo );
+   trail_vbo = NULL;
 
    /* Free the trail styles. */
    for (int i=0; i<array_size(trail_spec_stack); i++) {
@@ -472,6 +490,10 @@ void spfx_add( int effect,
       return;
    }
 
+   /* Effects won't be seen while entering a system. */
+   if (space_isSimulation() && !space_isSimulationEffects())
+      return;
+
    /*
     * Select the Layer
     */
@@ -793,86 +815,155 @@ static void spfx_trail_free( Trail_spfx* trail )
 }
 
 /**
- * @brief Draws a trail on screen.
+ * @brief Gets the transformation from in-game coordinates to screen coordinates.
+ *
+ *    @param[out] z Zoom (scale).
+ *    @param[out] ox X offset.
+ *    @param[out] oy Y offset.
  */
-void spfx_trail_draw( const Trail_spfx* trail )
+static void spfx_trail_view( double *z, double *ox, double *oy )
 {
-   const TrailStyle *styles;
-   size_t n;
-   GLfloat len;
-   double z;
+   *z = cam_getZoom();
+   gl_gameToScreenCoords( ox, oy, 0., 0. );
+}
 
-   n = trail_size(trail);
-   if (n==0)
+/**
+ * @brief Draws a tessellated trail mesh with a single draw call.
+ *
+ *    @param type Shader subroutine to use.
+ *    @param mesh Vertices of the mesh.
+ *    @param n Number of vertices in the mesh.
+ */
+static void spfx_trail_drawMesh( GLuint type, const TrailVertex *mesh, int n )
+{
+   GLsizei stride = sizeof(TrailVertex);
+
+   if (n <= 0)
       return;
-   styles = trail->spec->style;
 
-   /* Stuff that doesn't change for the entire trail. */
+   /* Sprites batched so far have to go below. */
+   gl_batchFlush();
+
+   if (trail_vbo == NULL)
+      trail_vbo = gl_vboCreateStream( stride * n, mesh );
+   else
+      gl_vboData( trail_vbo, stride * n, mesh );
+
    glUseProgram( shaders.trail.program );
    if (gl_has( OPENGL_SUBROUTINES ))
-      glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &trail->spec->type );
+      glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &type );
    glEnableVertexAttribArray( shaders.trail.vertex );
-   gl_vboActivateAttribOffset( gl_squareVBO, shaders.trail.vertex, 0, 2, GL_FLOAT, 0 );
-   glUniform1f( shaders.trail.dt, trail->dt );
-   glUniform1f( shaders.trail.r, trail->r );
-
-   z   = cam_getZoom();
-   len = 0.;
-   for (size_t i=trail->iread + 1; i < trail->iwrite; i++) {
-      mat4 projection;
-      const TrailStyle *sp, *spp;
-      double x1, y1, x2, y2, s;
-      TrailPoint *tp  = &trail_at( trail, i );
-      TrailPoint *tpp = &trail_at( trail, i-1 );
-
-      /* Ignore none modes. */
-      if (tp->mode == MODE_NONE || tpp->mode == MODE_NONE)
-         continue;
-
-      gl_gameToScreenCoords( &x1, &y1,  tp->x,  tp->y );
-      gl_gameToScreenCoords( &x2, &y2, tpp->x, tpp->y );
-
-      s = hypot( x2-x1, y2-y1 );
-
-      /* Make sure in bounds. */
-      if ((MAX(x1,x2) < 0.) || (MIN(x1,x2) > (double)SCREEN_W) ||
-          (MAX(y1,y2) < 0.) || (MIN(y1,y2) > (double)SCREEN_H)) {
-         len += s;
-         continue;
-      }
-
-      sp  = &styles[tp->mode];
-      spp = &styles[tpp->mode];
-
-      /* Set vertex. */
-      projection = gl_view_matrix;
-      mat4_translate( &projection, x1, y1, 0. );
-      mat4_rotate2dv( &projection, (x2-x1)/s, (y2-y1)/s );
-      mat4_scale( &projection, s, z*(sp->thick+spp->thick), 1. );
-      mat4_translate( &projection, 0., -0.5, 0. );
-
-      /* Set uniforms. */
-      gl_uniformMat4(shaders.trail.projection, &projection);
-      gl_uniformColor(shaders.trail.c1, &sp->col);
-      gl_uniformColor(shaders.trail.c2, &spp->col);
-      glUniform1f(shaders.trail.t1, tp->t);
-      glUniform1f(shaders.trail.t2, tpp->t);
-      glUniform2f(shaders.trail.pos2, len, sp->thick);
-      len += s;
-      glUniform2f(shaders.trail.pos1, len, spp->thick);
-
-      /* Draw. */
-      glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-   }
+   glEnableVertexAttribArray( shaders.trail.vertex_tex );
+   glEnableVertexAttribArray( shaders.trail.vertex_px );
+   glEnableVertexAttribArray( shaders.trail.vertex_color );
+   glEnableVertexAttribArray( shaders.trail.vertex_trail );
+   gl_vboActivateAttribOffset( trail_vbo, shaders.trail.vertex,
+         offsetof(TrailVertex, x), 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( trail_vbo, shaders.trail.vertex_tex,
+         offsetof(TrailVertex, t), 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( trail_vbo, shaders.trail.vertex_px,
+         offsetof(TrailVertex, px), 2, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( trail_vbo, shaders.trail.vertex_color,
+         offsetof(TrailVertex, col), 4, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( trail_vbo, shaders.trail.vertex_trail,
+         offsetof(TrailVertex, dt), 2, GL_FLOAT, stride );
+   gl_uniformMat4( shaders.trail.projection, &gl_view_matrix );
+
+   /* Draw. */
+   glDrawArrays( GL_TRIANGLES, 0, n );
+   gl_drawStatsAdd( 1 );
 
    /* Clear state. */
    glDisableVertexAttribArray( shaders.trail.vertex );
+   glDisableVertexAttribArray( shaders.trail.vertex_tex );
+   glDisableVertexAttribArray( shaders.trail.vertex_px );
+   glDisableVertexAttribArray( shaders.trail.vertex_color );
+   glDisableVertexAttribArray( shaders.trail.vertex_trail );
    glUseProgram(0);
 
    /* Check errors. */
    gl_checkErr();
 }
 
+/**
+ * @brief Draws a trail on screen.
+ */
+void spfx_trail_draw( const Trail_spfx* trail )
+{
+   double z, ox, oy;
+   int n;
+
+   if (trail_size(trail) < 2)
+      return;
+
+   spfx_trail_view( &z, &ox, &oy );
+   if (trail_mesh == NULL)
+      trail_mesh = array_create( TrailVertex );
+   array_erase( &trail_mesh, array_begin(trail_mesh), array_end(trail_mesh) );
+   n = spfx_trail_tessellate( &trail_mesh, trail, z, ox, oy, SCREEN_W, SCREEN_H );
+   spfx_trail_drawMesh( trail->spec->type, trail_mesh, n );
+}
+
+/**
+ * @brief Compares trails by shader subroutine for qsort, keeping the order of
+ *  the trail stack within each subroutine.
+ */
+static int spfx_trail_cmp( const void *p1, const void *p2 )
+{
+   const TrailRender *r1 = (const TrailRender*) p1;
+   const TrailRender *r2 = (const TrailRender*) p2;
+   if (r1->trail->spec->type != r2->trail->spec->type)
+      return (r1->trail->spec->type < r2->trail->spec->type) ? -1 : 1;
+   return r1->order - r2->order;
+}
+
+/**
+ * @brief Draws all the trails that are not on top of their ships.
+ *
+ * Trails sharing a shader subroutine are put in the same mesh, so there is a
+ * single draw call per type of trail. Trails of the same type are still
+ * blended in the order of the trail stack, but all the trails of a type are
+ * now drawn over those of the types before it, instead of being interleaved.
+ * Overlapping background trails of different types are rare and faint enough
+ * for this not to be noticeable.
+ */
+static void spfx_trail_drawBack (void)
+{
+   double z, ox, oy;
+   int n;
+
+   if (trail_render == NULL)
+      trail_render = array_create( TrailRender );
+   array_erase( &trail_render, array_begin(trail_render), array_end(trail_render) );
+   for (int i=0; i<array_size(trail_spfx_stack); i++) {
+      Trail_spfx *trail = trail_spfx_stack[i];
+      if (!trail->ontop && (trail_size(trail) > 1)) {
+         TrailRender *r = &array_grow( &trail_render );
+         r->trail = trail;
+         r->order = i;
+      }
+   }
+   if (array_size(trail_render) <= 0)
+      return;
+   qsort( trail_render, array_size(trail_render), sizeof(TrailRender), spfx_trail_cmp );
+
+   spfx_trail_view( &z, &ox, &oy );
+   if (trail_mesh == NULL)
+      trail_mesh = array_create( TrailVertex );
+   array_erase( &trail_mesh, array_begin(trail_mesh), array_end(trail_mesh) );
+   n = 0;
+   for (int i=0; i<array_size(trail_render); i++) {
+      const Trail_spfx *trail = trail_render[i].trail;
+      if ((i > 0) && (trail->spec->type != trail_render[i-1].trail->spec->type)) {
+         spfx_trail_drawMesh( trail_render[i-1].trail->spec->type, trail_mesh, n );
+         array_erase( &trail_mesh, array_begin(trail_mesh), array_end(trail_mesh) );
+         n = 0;
+      }
+      n += spfx_trail_tessellate( &trail_mesh, trail, z, ox, oy, SCREEN_W, SCREEN_H );
+   }
+   spfx_trail_drawMesh( array_back(trail_render).trail->spec->type, trail_mesh, n );
+}
+
 /**
  * @brief Increases the current rumble level.
  *
@@ -996,6 +1087,7 @@ void spfx_cinematic (void)
 
 static void spfx_renderStack( SPFX *spfx_stack )
 {
+   gl_batchBegin();
    for (int i=array_size(spfx_stack)-1; i>=0; i--) {
       SPFX *spfx        = &spfx_stack[i];
       SPFX_Base *effect = &spfx_effects[ spfx->effect ];
@@ -1018,6 +1110,7 @@ static void spfx_renderStack( SPFX *spfx_stack )
             continue;
 
          /* Let's get to business. */
+         gl_batchFlush();
          glUseProgram( effect->shader );
 
          /* Set up the vertex. */
@@ -1067,6 +1160,7 @@ static void spfx_renderStack( SPFX *spfx_stack )
                NULL );
       }
    }
+   gl_batchEnd();
 }
 
 /**
@@ -1094,11 +1188,7 @@ void spfx_render( int layer, double dt )
          spfxL_renderbg( dt );
 
          /* Trails are special (for now?). */
-         for (int i=0; i<array_size(trail_spfx_stack); i++) {
-            Trail_spfx *trail = trail_spfx_stack[i];
-            if (!trail->ontop)
-               spfx_trail_draw( trail );
-         }
+         spfx_trail_drawBack();
          break;
 
       default:
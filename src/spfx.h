@@ -73,6 +73,17 @@ typedef struct Trail_spfx_ {
    unsigned int ontop; /**< Boolean to decide if the trail is drawn before or after the ship. */
 } Trail_spfx;
 
+/**
+ * @brief A vertex of a tessellated trail mesh.
+ */
+typedef struct TrailVertex_ {
+   GLfloat x, y;     /**< Position on screen. */
+   GLfloat t, side;  /**< Timer of the trail and position across it [-1,1]. */
+   GLfloat px, py;   /**< Position in pixels along and across the trail. */
+   glColour col;     /**< Colour. */
+   GLfloat dt, r;    /**< Timer accumulator and random variable of the trail. */
+} TrailVertex;
+
 /** @brief Indexes into a trail's circular buffer.  */
 #define trail_at( trail, i ) ( (trail)->point_ringbuf[ (i) & ((trail)->capacity - 1) ] )
 /** @brief Returns the number of elements of a trail's circular buffer.  */
@@ -102,6 +113,8 @@ Trail_spfx* spfx_trail_create( const TrailSpec* spec );
 void spfx_trail_sample( Trail_spfx* trail, double x, double y, TrailMode mode, int force );
 void spfx_trail_remove( Trail_spfx* trail );
 void spfx_trail_draw( const Trail_spfx* trail );
+int spfx_trail_tessellate( TrailVertex **mesh, const Trail_spfx* trail,
+      double z, double ox, double oy, double w, double h );
 
 /*
  * Misc effects.
@@ -0,0 +1,132 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file spfx_trail.c
+ *
+ * @brief Turns trails into triangle meshes.
+ *
+ * Kept apart from spfx.c as it doesn't touch OpenGL or the rest of the game,
+ * so that it can be tested on its own.
+ */
+/** @cond */
+#include "naev.h"
+/** @endcond */
+
+#include "spfx.h"
+
+#include "array.h"
+
+/**
+ * @brief Gets the normal of a trail at a control point.
+ *
+ *    @param trail Trail to get normal of.
+ *    @param i Index of the control point.
+ *    @param[out] nx X component of the normal.
+ *    @param[out] ny Y component of the normal.
+ *    @return 0 on success, -1 if the neighbours of the point coincide.
+ */
+static int spfx_trail_normal( const Trail_spfx *trail, size_t i, double *nx, double *ny )
+{
+   const TrailPoint *tp  = &trail_at( trail, (i > trail->iread) ? i-1 : i );
+   const TrailPoint *tpn = &trail_at( trail, (i+1 < trail->iwrite) ? i+1 : i );
+   double dx = tpn->x - tp->x;
+   double dy = tpn->y - tp->y;
+   double d  = hypot( dx, dy );
+
+   if (d <= 0.)
+      return -1;
+   *nx =  dy / d;
+   *ny = -dx / d;
+   return 0;
+}
+
+/**
+ * @brief Adds a vertex of a trail to a mesh.
+ */
+static void spfx_trail_vertex( TrailVertex **mesh, const Trail_spfx *trail,
+      const TrailPoint *tp, double x, double y, double nx, double ny,
+      double side, double len, double z )
+{
+   const TrailStyle *sp = &trail->spec->style[ tp->mode ];
+   TrailVertex *v = &array_grow( mesh );
+   v->x     = x + side * nx * z * sp->thick;
+   v->y     = y + side * ny * z * sp->thick;
+   v->t     = tp->t;
+   v->side  = side;
+   v->px    = len;
+   v->py    = (side > 0.) ? sp->thick : 0.;
+   v->col   = sp->col;
+   v->dt    = trail->dt;
+   v->r     = trail->r;
+}
+
+/**
+ * @brief Tessellates a trail into a triangle mesh.
+ *
+ * Each segment between two control points becomes a quad (two triangles) in
+ * screen coordinates. Adjacent quads share the edge at their common control
+ * point, which is perpendicular to the direction of the trail there. Segments
+ * that are off screen or have a "none" mode are skipped. This only depends on
+ * its parameters so that trails can be processed without touching OpenGL.
+ *
+ *    @param[out] mesh Array (array.h) to append the vertices to.
+ *    @param trail Trail to tessellate.
+ *    @param z Scale from in-game to screen coordinates.
+ *    @param ox X offset from in-game to screen coordinates.
+ *    @param oy Y offset from in-game to screen coordinates.
+ *    @param w Width of the screen.
+ *    @param h Height of the screen.
+ *    @return Number of vertices added to the mesh.
+ */
+int spfx_trail_tessellate( TrailVertex **mesh, const Trail_spfx* trail,
+      double z, double ox, double oy, double w, double h )
+{
+   int n = 0;
+   double len = 0.;
+
+   for (size_t i=trail->iread + 1; i < trail->iwrite; i++) {
+      double x1, y1, x2, y2, s, snx, sny, nx1, ny1, nx2, ny2, len1;
+      const TrailPoint *tp  = &trail_at( trail, i-1 );
+      const TrailPoint *tpn = &trail_at( trail, i );
+
+      x1 = tp->x  * z + ox;
+      y1 = tp->y  * z + oy;
+      x2 = tpn->x * z + ox;
+      y2 = tpn->y * z + oy;
+      s  = hypot( x2-x1, y2-y1 );
+      len1 = len;
+      len += s;
+
+      /* Ignore none modes and degenerate segments. */
+      if (tp->mode == MODE_NONE || tpn->mode == MODE_NONE || s <= 0.)
+         continue;
+
+      /* Make sure in bounds. */
+      if ((MAX(x1,x2) < 0.) || (MIN(x1,x2) > w) ||
+          (MAX(y1,y2) < 0.) || (MIN(y1,y2) > h))
+         continue;
+
+      /* Normals at both ends, falling back to the one of the segment. */
+      snx =  (y2-y1) / s;
+      sny = -(x2-x1) / s;
+      if (spfx_trail_normal( trail, i-1, &nx1, &ny1 )) {
+         nx1 = snx;
+         ny1 = sny;
+      }
+      if (spfx_trail_normal( trail, i, &nx2, &ny2 )) {
+         nx2 = snx;
+         ny2 = sny;
+      }
+
+      /* Two triangles. */
+      spfx_trail_vertex( mesh, trail, tp,  x1, y1, nx1, ny1, -1., len1, z );
+      spfx_trail_vertex( mesh, trail, tp,  x1, y1, nx1, ny1,  1., len1, z );
+      spfx_trail_vertex( mesh, trail, tpn, x2, y2, nx2, ny2, -1., len,  z );
+      spfx_trail_vertex( mesh, trail, tpn, x2, y2, nx2, ny2, -1., len,  z );
+      spfx_trail_vertex( mesh, trail, tp,  x1, y1, nx1, ny1,  1., len1, z );
+      spfx_trail_vertex( mesh, trail, tpn, x2, y2, nx2, ny2,  1., len,  z );
+      n += 6;
+   }
+   return n;
+}
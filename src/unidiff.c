@@ -156,6 +156,9 @@ static UniDiff_t *diff_stack = NULL; /**< Currently applied universe diffs. */
 /* Useful variables. */
 static int diff_universe_changed = 0; /**< Whether or not the universe changed. */
 static int diff_universe_defer = 0; /**< Defers changes to later. */
+static PresenceChange *diff_presence = NULL; /**< Array (array.h): Presence changes since the last universe update. */
+static int *diff_econ = NULL; /**< Array (array.h): Systems whose prices changed since the last universe update. */
+static int diff_lanes = 0; /**< Whether or not the safe lanes have to be recomputed on the next universe update. */
 
 /*
  * Prototypes.
@@ -174,6 +177,11 @@ static void diff_cleanup( UniDiff_t *diff );
 static void diff_cleanupHunk( UniHunk_t *hunk );
 /* Misc. */
 static int diff_checkUpdateUniverse (void);
+static void diff_touchPresence( const StarSystem *sys, int range, int jumps, const StarSystem *removed );
+static void diff_touchEconomy( const StarSystem *sys );
+static void diff_touchSpob( const StarSystem *sys, const Spob *p );
+static const StarSystem *diff_spobSystem( const Spob *p );
+static int diff_virtualRange( const char *name );
 /* Externed. */
 int diff_save( xmlTextWriterPtr writer ); /**< Used in save.c */
 int diff_load( xmlNodePtr parent ); /**< Used in save.c */
@@ -259,6 +267,19 @@ int diff_isApplied( const char *name )
    return 0;
 }
 
+/**
+ * @brief Gets the names of all the available diffs.
+ *
+ *    @return Array (array.h) of the names of the available diffs. The array must be freed, but not the names.
+ */
+const char **diff_getAvailable (void)
+{
+   const char **names = array_create_size( const char*, array_size(diff_available) );
+   for (int i=0; i<array_size(diff_available); i++)
+      array_push_back( &names, diff_available[i].name );
+   return names;
+}
+
 /**
  * @brief Gets a diff by name.
  *
@@ -1089,31 +1110,48 @@ static int diff_patchHunk( UniHunk_t *hunk )
 
       /* Adding an spob. */
       case HUNK_TYPE_SPOB_ADD:
-         spob_luaInit( spob_get(hunk->u.name) );
+         p = spob_get( hunk->u.name );
+         ssys = system_get( hunk->target.u.name );
+         spob_luaInit( p );
          diff_universe_changed = 1;
-         return system_addSpob( system_get(hunk->target.u.name), hunk->u.name );
+         diff_touchSpob( ssys, p );
+         return system_addSpob( ssys, hunk->u.name );
       /* Removing an spob. */
       case HUNK_TYPE_SPOB_REMOVE:
+         ssys = system_get( hunk->target.u.name );
          diff_universe_changed = 1;
-         return system_rmSpob( system_get(hunk->target.u.name), hunk->u.name );
+         diff_touchSpob( ssys, spob_get( hunk->u.name ) );
+         return system_rmSpob( ssys, hunk->u.name );
 
       /* Adding an spob. */
       case HUNK_TYPE_VSPOB_ADD:
+         ssys = system_get( hunk->target.u.name );
          diff_universe_changed = 1;
-         return system_addVirtualSpob( system_get(hunk->target.u.name), hunk->u.name );
+         diff_touchPresence( ssys, diff_virtualRange( hunk->u.name ), 0, NULL );
+         return system_addVirtualSpob( ssys, hunk->u.name );
       /* Removing an spob. */
       case HUNK_TYPE_VSPOB_REMOVE:
+         ssys = system_get( hunk->target.u.name );
          diff_universe_changed = 1;
-         return system_rmVirtualSpob( system_get(hunk->target.u.name), hunk->u.name );
+         diff_touchPresence( ssys, diff_virtualRange( hunk->u.name ), 0, NULL );
+         return system_rmVirtualSpob( ssys, hunk->u.name );
 
       /* Adding a Jump. */
       case HUNK_TYPE_JUMP_ADD:
+         ssys = system_get( hunk->target.u.name );
          diff_universe_changed = 1;
-         return system_addJumpDiff( system_get(hunk->target.u.name), hunk->node );
+         diff_touchPresence( ssys, -1, 1, NULL );
+         diff_touchEconomy( ssys );
+         return system_addJumpDiff( ssys, hunk->node );
       /* Removing a jump. */
       case HUNK_TYPE_JUMP_REMOVE:
+         ssys = system_get( hunk->target.u.name );
          diff_universe_changed = 1;
-         return system_rmJump( system_get(hunk->target.u.name), hunk->u.name );
+         /* Presence that spilled through the jump has to be found while
+          * searching the graph from after the removal. */
+         diff_touchPresence( ssys, -1, 1, system_get( hunk->u.name ) );
+         diff_touchEconomy( ssys );
+         return system_rmJump( ssys, hunk->u.name );
 
       /* Changing system background. */
       case HUNK_TYPE_SSYS_BACKGROUND:
@@ -1154,12 +1192,14 @@ static int diff_patchHunk( UniHunk_t *hunk )
          else
             hunk->o.name = faction_name( p->presence.faction );
          diff_universe_changed = 1;
+         diff_touchSpob( diff_spobSystem( p ), p );
          return spob_setFaction( p, faction_get(hunk->u.name) );
       case HUNK_TYPE_SPOB_FACTION_REMOVE:
          p = spob_get( hunk->target.u.name );
          if (p==NULL)
             return -1;
          diff_universe_changed = 1;
+         diff_touchSpob( diff_spobSystem( p ), p );
          if (hunk->o.name==NULL)
             return spob_setFaction( p, -1 );
          else
@@ -1172,12 +1212,16 @@ static int diff_patchHunk( UniHunk_t *hunk )
             return -1;
          hunk->o.data = p->population;
          p->population = hunk->u.data;
+         diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) ); /* Prices depend on the population. */
          return 0;
       case HUNK_TYPE_SPOB_POPULATION_REMOVE:
          p = spob_get( hunk->target.u.name );
          if (p==NULL)
             return -1;
          p->population = hunk->o.data;
+         diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
 
       /* Changing spob displayname. */
@@ -1234,6 +1278,7 @@ static int diff_patchHunk( UniHunk_t *hunk )
             return -1;
          spob_addService( p, hunk->u.data );
          diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
       case HUNK_TYPE_SPOB_SERVICE_REMOVE:
          p = spob_get( hunk->target.u.name );
@@ -1243,6 +1288,7 @@ static int diff_patchHunk( UniHunk_t *hunk )
             return -1;
          spob_rmService( p, hunk->u.data );
          diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
 
       /* Modifying tech stuff. */
@@ -1297,6 +1343,7 @@ static int diff_patchHunk( UniHunk_t *hunk )
          hunk->o.name = p->gfx_spaceName;
          p->gfx_spaceName = hunk->u.name;
          diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) ); /* Prices use the graphics as a seed. */
          return 0;
       case HUNK_TYPE_SPOB_SPACE_REVERT:
          p = spob_get( hunk->target.u.name );
@@ -1304,6 +1351,7 @@ static int diff_patchHunk( UniHunk_t *hunk )
             return -1;
          p->gfx_spaceName = (char*)hunk->o.name;
          diff_universe_changed = 1;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
 
       /* Changing spob exterior graphics. */
@@ -1313,12 +1361,14 @@ static int diff_patchHunk( UniHunk_t *hunk )
             return -1;
          hunk->o.name = p->gfx_exterior;
          p->gfx_exterior = hunk->u.name;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
       case HUNK_TYPE_SPOB_EXTERIOR_REVERT:
          p = spob_get( hunk->target.u.name );
          if (p==NULL)
             return -1;
          p->gfx_exterior = (char*)hunk->o.name;
+         diff_touchEconomy( diff_spobSystem( p ) );
          return 0;
 
       /* Change Lua stuff. */
@@ -1342,9 +1392,11 @@ static int diff_patchHunk( UniHunk_t *hunk )
 
       /* Making a faction visible. */
       case HUNK_TYPE_FACTION_VISIBLE:
+         diff_lanes = 1; /* Only visible factions build lanes. */
          return faction_setInvisible( faction_get(hunk->target.u.name), 0 );
       /* Making a faction invisible. */
       case HUNK_TYPE_FACTION_INVISIBLE:
+         diff_lanes = 1;
          return faction_setInvisible( faction_get(hunk->target.u.name), 1 );
       /* Making two factions allies. */
       case HUNK_TYPE_FACTION_ALLY:
@@ -1492,6 +1544,10 @@ void diff_free (void)
    }
    array_free(diff_available);
    diff_available = NULL;
+   array_free(diff_presence);
+   diff_presence = NULL;
+   array_free(diff_econ);
+   diff_econ = NULL;
 }
 
 /**
@@ -1781,12 +1837,14 @@ static int diff_checkUpdateUniverse (void)
    if (!diff_universe_changed || diff_universe_defer)
       return 0;
 
-   space_reconstructPresences();
-   safelanes_recalculate();
+   /* Only recompute what the diffs touched. */
+   space_reconstructPresencesPartial( diff_presence );
+   if (diff_lanes || !safelanes_calculated())
+      safelanes_recalculate();
 
    /* Re-compute the economy. */
    economy_execQueued();
-   economy_initialiseCommodityPrices();
+   economy_initialiseCommodityPricesPartial( diff_econ );
 
    /* Have to update planet graphics if necessary. */
    if (cur_system != NULL) {
@@ -1821,9 +1879,98 @@ static int diff_checkUpdateUniverse (void)
    player_targetHyperspaceSet( -1, 0 );
 
    diff_universe_changed = 0;
+   array_free( diff_presence );
+   diff_presence = NULL;
+   array_free( diff_econ );
+   diff_econ = NULL;
+   diff_lanes = 0;
    return 1;
 }
 
+/**
+ * @brief Records that the presence sources of a system changed.
+ *
+ *    @param sys System that changed.
+ *    @param range Range of the presence that was added or removed, -1 if none.
+ *    @param jumps Whether or not the jumps of the system changed.
+ *    @param removed Target of a jump that was removed from the system, NULL if none.
+ */
+static void diff_touchPresence( const StarSystem *sys, int range, int jumps, const StarSystem *removed )
+{
+   PresenceChange pc;
+   if (sys == NULL)
+      return;
+   if (diff_presence == NULL)
+      diff_presence = array_create( PresenceChange );
+   pc.system = sys->id;
+   pc.range  = range;
+   pc.jumps  = jumps;
+   pc.removed = (removed != NULL) ? removed->id : -1;
+   array_push_back( &diff_presence, pc );
+   diff_lanes = 1;
+}
+
+/**
+ * @brief Records that the commodity prices of a system have to be recomputed.
+ *
+ *    @param sys System that changed.
+ */
+static void diff_touchEconomy( const StarSystem *sys )
+{
+   if (sys == NULL)
+      return;
+   if (diff_econ == NULL)
+      diff_econ = array_create( int );
+   for (int i=0; i<array_size(diff_econ); i++)
+      if (diff_econ[i] == sys->id)
+         return;
+   array_push_back( &diff_econ, sys->id );
+}
+
+/**
+ * @brief Records that a spob of a system was added, removed or changed faction.
+ *
+ *    @param sys System the spob is in.
+ *    @param p Spob that changed.
+ */
+static void diff_touchSpob( const StarSystem *sys, const Spob *p )
+{
+   if (p == NULL)
+      return;
+   diff_touchPresence( sys, p->presence.range, 0, NULL );
+   diff_touchEconomy( sys );
+}
+
+/**
+ * @brief Gets the system a spob is in.
+ *
+ *    @param p Spob to get the system of.
+ *    @return The system of the spob or NULL if not placed.
+ */
+static const StarSystem *diff_spobSystem( const Spob *p )
+{
+   if (!spob_hasSystem( p ))
+      return NULL;
+   return system_get( spob_getSystem( p->name ) );
+}
+
+/**
+ * @brief Gets the largest range of the presences of a virtual spob.
+ *
+ *    @param name Name of the virtual spob.
+ *    @return The largest range or -1 if not found.
+ */
+static int diff_virtualRange( const char *name )
+{
+   int range = -1;
+   const VirtualSpob *va = virtualspob_get( name );
+   if (va == NULL)
+      return -1;
+   for (int i=0; i<array_size(va->presences); i++)
+      range = MAX( range, va->presences[i].range );
+   return range;
+}
+
 /**
  * @brief Sets whether or not to defer universe change stuff.
  *
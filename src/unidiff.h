@@ -11,4 +11,5 @@ NONNULL( 1 ) void diff_remove( const char *name );
 void diff_clear (void);
 void diff_free (void);
 NONNULL( 1 ) int diff_isApplied( const char *name );
+const char **diff_getAvailable (void);
 void unidiff_universeDefer( int enable );
@@ -22,6 +22,7 @@
 #include "ai.h"
 #include "camera.h"
 #include "collision.h"
+#include "conf.h"
 #include "explosion.h"
 #include "gui.h"
 #include "log.h"
@@ -32,10 +33,15 @@
 #include "pilot.h"
 #include "player.h"
 #include "rng.h"
+#include "spatial.h"
 #include "spfx.h"
+#include "threadpool.h"
 
 #define weapon_isSmart(w)     (w->think != NULL) /**< Checks if the weapon w is smart. */
 
+#define WEAPON_COLL_MARGIN    2. /**< Slack added to bounding radii to account for sprite rounding. */
+#define WEAPON_PARALLEL_CHUNK 64 /**< Minimum amount of weapons per parallel collision job. */
+
 /* Weapon status */
 typedef enum WeaponStatus_ {
    WEAPON_STATUS_LOCKING,  /**< Weapon is locking on. */
@@ -47,6 +53,7 @@ typedef enum WeaponStatus_ {
 
 /* Weapon flags. */
 #define WEAPON_FLAG_DESTROYED    1
+#define WEAPON_FLAG_COLLFOUND    2 /**< Collisions were already found by weapons_collideLayer(). */
 #define weapon_isFlag(w,f)    ((w)->flags & (f))
 #define weapon_setFlag(w,f)   ((w)->flags |= (f))
 #define weapon_rmFlag(w,f)    ((w)->flags &= ~(f))
@@ -84,6 +91,9 @@ typedef struct Weapon_ {
    int sx; /**< Current X sprite to use. */
    int sy; /**< Current Y sprite to use. */
    Trail_spfx *trail; /**< Trail graphic if applicable, else NULL. */
+   int coll_job; /**< Job that found the collisions (with WEAPON_FLAG_COLLFOUND). */
+   int coll_start; /**< Position of the first collision in the job. */
+   int coll_n; /**< Number of collisions found by the job. */
 
    /* position update and render */
    void (*update)(struct Weapon_*, const double, WeaponLayer); /**< Updates the weapon */
@@ -92,6 +102,28 @@ typedef struct Weapon_ {
    WeaponStatus status; /**< Weapon status - to check for jamming */
 } Weapon;
 
+/**
+ * @brief Overlap between a weapon and a pilot or asteroid.
+ */
+typedef struct WeaponHit_ {
+   int ast; /**< Whether it's an asteroid or a pilot. */
+   int id; /**< Position in weapon_astList or in the pilot stack. */
+   Pilot *p; /**< Pilot overlapped if applicable. */
+   vec2 crash[2]; /**< Collision points. */
+} WeaponHit;
+
+/**
+ * @brief Finds the collisions of a chunk of the weapons of a layer.
+ */
+typedef struct WeaponCollJob_ {
+   Weapon **wlayer; /**< Layer the weapons belong to. */
+   int start; /**< First weapon of the chunk. */
+   int end; /**< Weapon after the last weapon of the chunk. */
+   WeaponHit *hits; /**< Array (array.h): Collisions found. */
+   int *cand; /**< Array (array.h): Candidates returned by the broadphase. */
+   long checks; /**< Narrow-phase checks done. */
+} WeaponCollJob;
+
 /* Weapon layers. */
 static Weapon** wbackLayer = NULL; /**< behind pilots */
 static Weapon** wfrontLayer = NULL; /**< in front of pilots, behind player */
@@ -104,6 +136,18 @@ static size_t weapon_vboSize   = 0; /**< Size of the VBO. */
 /* Internal stuff. */
 static unsigned int beam_idgen = 0; /**< Beam identifier generator. */
 
+/* Collision broadphase, rebuilt every update. */
+static SpatialGrid weapon_pilotGrid; /**< Pilots indexed by position in the pilot stack. */
+static int weapon_pilotGridN  = 0; /**< Size of the pilot stack when weapon_pilotGrid was built. */
+static int weapon_gridDirty   = 1; /**< Whether pilots moved or the stack changed since the grids were built. */
+static unsigned int weapon_gridGen = 0; /**< Incremented every time the grids are built. */
+static unsigned int weapon_collGen = 0; /**< Value of weapon_gridGen when collisions were found in parallel. */
+static SpatialGrid weapon_astGrid; /**< Foreground asteroids indexed by position in weapon_astList. */
+static Asteroid **weapon_astList = NULL; /**< Asteroids in weapon_astGrid. */
+static WeaponCollJob *weapon_collJobs = NULL; /**< Array (array.h): Parallel collision jobs. */
+static WeaponCollJob weapon_collSerial; /**< Used when finding collisions in order. */
+static WeaponCollisionStats weapon_collStats; /**< Collision statistics. */
+
 /*
  * Prototypes
  */
@@ -124,7 +168,22 @@ static double weapon_computeTimes( double rdir, double rx, double ry, double dvx
 static void weapon_render( Weapon* w, const double dt );
 static void weapons_updateLayer( const double dt, const WeaponLayer layer );
 static void weapon_update( Weapon* w, const double dt, WeaponLayer layer );
+static int weapon_collide( Weapon* w, const double dt, WeaponLayer layer );
+static int weapon_collidePilot( const Weapon *w, const Pilot *p,
+      const glTexture *gfx, const CollPoly *polygon, int usePolyW, vec2 crash[2] );
+static int weapon_ignoresPilot( const Weapon *w, const Pilot *p );
+static void weapon_collideFind( Weapon *w, WeaponCollJob *job );
+static int weapon_collideJob( void *data );
+static void weapons_collideLayer( Weapon **wlayer );
+static int weapon_tryHitPilot( Weapon *w, Pilot *p, vec2 crash[2],
+      const double dt, WeaponLayer layer );
+static int weapon_tryHitAst( Weapon *w, Asteroid *a, vec2 crash[2],
+      const double dt, WeaponLayer layer );
 static void weapon_sample_trail( Weapon* w );
+static double weapon_collRadius( const glTexture *gfx, const CollPoly *plg );
+static void weapons_buildGrids (void);
+static Uint64 weapons_collTimerStart (void);
+static void weapons_collTimerStop( Uint64 t0 );
 /* Destruction. */
 static void weapon_destroy( Weapon* w );
 static void weapon_free( Weapon* w );
@@ -158,6 +217,14 @@ void weapon_init (void)
 {
    wfrontLayer = array_create(Weapon*);
    wbackLayer  = array_create(Weapon*);
+
+   /* Broadphase. */
+   spatial_init( &weapon_pilotGrid );
+   spatial_init( &weapon_astGrid );
+   weapon_astList = array_create( Asteroid* );
+   weapon_collJobs = array_create( WeaponCollJob );
+   weapon_collSerial.hits = array_create( WeaponHit );
+   weapon_collSerial.cand = array_create( int );
 }
 
 /**
@@ -514,7 +581,8 @@ static void think_beam( Weapon* w, const double dt )
             turn_off = 0;
       }
       if (ast != NULL) {
-         if (vec2_dist( &p->solid->pos, &ast->pos ) <= slot->outfit->u.bem.range)
+         vec2 apos = asteroid_pos( ast );
+         if (vec2_dist( &p->solid->pos, &apos ) <= slot->outfit->u.bem.range)
             turn_off = 0;
       }
 
@@ -553,8 +621,9 @@ static void think_beam( Weapon* w, const double dt )
          t = (w->target != w->parent) ? pilot_get(w->target) : NULL;
          if (t == NULL) {
             if (ast != NULL) {
+               vec2 apos = asteroid_pos( ast );
                diff = angle_diff(w->solid->dir, /* Get angle to target pos */
-                     vec2_angle(&w->solid->pos, &ast->pos));
+                     vec2_angle(&w->solid->pos, &apos));
             }
             else
                diff = angle_diff(w->solid->dir, p->solid->dir);
@@ -579,6 +648,18 @@ static void think_beam( Weapon* w, const double dt )
  */
 void weapons_update( const double dt )
 {
+   Uint64 t0 = weapons_collTimerStart();
+
+   /* Pilots and asteroids don't move while weapons are updated, so the
+    * broadphase only has to be built once unless hooks move pilots. */
+   weapons_buildGrids();
+
+   weapons_collTimerStop( t0 );
+   if (weapon_collStats.enabled) {
+      weapon_collStats.ticks++;
+      weapon_collStats.weapons += array_size(wbackLayer) + array_size(wfrontLayer);
+   }
+
    /* When updating, just mark weapons for deletion. */
    weapons_updateLayer(dt,WEAPON_LAYER_BG);
    weapons_updateLayer(dt,WEAPON_LAYER_FG);
@@ -612,6 +693,14 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
          return;
    }
 
+   /* Find the collisions of all the weapons at once if worth it. Side
+    * effects are still applied in order when updating each weapon below. */
+   Uint64 t0 = weapons_collTimerStart();
+   if (weapon_gridDirty)
+      weapons_buildGrids();
+   weapons_collideLayer( wlayer );
+   weapons_collTimerStop( t0 );
+
    for (int i=0; i<array_size(wlayer); i++) {
       Weapon *w = wlayer[i];
 
@@ -722,6 +811,113 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
    }
 }
 
+/**
+ * @brief Gets a radius bounding both a sprite and its collision polygon.
+ *
+ *    @param gfx Sprite to bound.
+ *    @param plg Collision polygon to bound (may be rotated) or NULL.
+ *    @return Radius of a circle containing both.
+ */
+static double weapon_collRadius( const glTexture *gfx, const CollPoly *plg )
+{
+   double r = 0.5*sqrt( pow2(gfx->sw) + pow2(gfx->sh) );
+   if ((plg != NULL) && (plg->npt > 0))
+      r = MAX( r, sqrt( pow2( MAX(-plg->xmin, plg->xmax) ) +
+               pow2( MAX(-plg->ymin, plg->ymax) ) ) );
+   return r + WEAPON_COLL_MARGIN;
+}
+
+/**
+ * @brief Builds the broadphase grids of pilots and asteroids for the weapons.
+ */
+static void weapons_buildGrids (void)
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+
+   spatial_clear( &weapon_pilotGrid );
+   for (int i=0; i<array_size(pilot_stack); i++) {
+      const Pilot *p = pilot_stack[i];
+      const CollPoly *plg = NULL;
+      if (array_size(p->ship->polygon) > 0) {
+         int k = p->ship->gfx_space->sx * p->tsy + p->tsx;
+         plg = &p->ship->polygon[k];
+      }
+      spatial_add( &weapon_pilotGrid, i, p->solid->pos.x, p->solid->pos.y,
+            weapon_collRadius( p->ship->gfx_space, plg ) );
+   }
+   spatial_build( &weapon_pilotGrid );
+   weapon_pilotGridN = array_size(pilot_stack);
+
+   spatial_clear( &weapon_astGrid );
+   array_erase( &weapon_astList, array_begin(weapon_astList), array_end(weapon_astList) );
+   for (int i=0; i<array_size(cur_system->asteroids); i++) {
+      AsteroidAnchor *ast = &cur_system->asteroids[i];
+      for (int j=0; j<ast->nb; j++) {
+         Asteroid *a = &ast->asteroids[j];
+         /* Asteroids can only leave the foreground while weapons update. */
+         if (a->state != ASTEROID_FG)
+            continue;
+         spatial_add( &weapon_astGrid, array_size(weapon_astList),
+               ast->motion.x[j], ast->motion.y[j], weapon_collRadius( a->gfx, a->polygon ) );
+         array_push_back( &weapon_astList, a );
+      }
+   }
+   spatial_build( &weapon_astGrid );
+
+   weapon_gridDirty = 0;
+   weapon_gridGen++;
+}
+
+/**
+ * @brief Marks the broadphase grids as outdated.
+ *
+ * Has to be called when pilots are moved or the pilot stack changes outside
+ *  of the physics update, such as from hooks run while weapons are updated.
+ */
+void weapons_gridInvalidate (void)
+{
+   weapon_gridDirty = 1;
+}
+
+/**
+ * @brief Starts timing collisions if collecting statistics.
+ *
+ *    @return Starting time to pass to weapons_collTimerStop() or 0.
+ */
+static Uint64 weapons_collTimerStart (void)
+{
+   if (!weapon_collStats.enabled)
+      return 0;
+   return SDL_GetPerformanceCounter();
+}
+
+/**
+ * @brief Adds the time since weapons_collTimerStart() to the collision statistics.
+ *
+ *    @param t0 Value returned by weapons_collTimerStart().
+ */
+static void weapons_collTimerStop( Uint64 t0 )
+{
+   if (!weapon_collStats.enabled || (t0 == 0))
+      return;
+   weapon_collStats.time += (double)(SDL_GetPerformanceCounter() - t0) /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * @brief Gets the weapon collision statistics and resets them.
+ *
+ *    @param[out] stats Statistics since the last call (can be NULL).
+ *    @param enable Whether or not to keep collecting statistics.
+ */
+void weapons_collisionStats( WeaponCollisionStats *stats, int enable )
+{
+   if (stats != NULL)
+      *stats = weapon_collStats;
+   memset( &weapon_collStats, 0, sizeof(WeaponCollisionStats) );
+   weapon_collStats.enabled = enable;
+}
+
 /**
  * @brief Purges weapons marked for deletion.
  *
@@ -761,8 +957,10 @@ void weapons_render( const WeaponLayer layer, const double dt )
          return;
    }
 
+   gl_batchBegin();
    for (int i=0; i<array_size(wlayer); i++)
       weapon_render( wlayer[i], dt );
+   gl_batchEnd();
 }
 
 static void weapon_renderBeam( Weapon* w, const double dt )
@@ -774,6 +972,7 @@ static void weapon_renderBeam( Weapon* w, const double dt )
    w->anim += dt;
 
    /* Load GLSL program */
+   gl_batchFlush();
    glUseProgram(shaders.beam.program);
 
    /* Zoom. */
@@ -845,6 +1044,7 @@ static void weapon_render( Weapon* w, const double dt )
             col_blend( &col, &cYellow, &cRed, st );
             col.a = 0.5;
 
+            gl_batchFlush();
             glUseProgram( shaders.iflockon.program );
             glUniform1f( shaders.iflockon.paramf, st );
             gl_renderShader( x, y, r, r, r, &shaders.iflockon, &col, 1 );
@@ -974,21 +1174,88 @@ static int weapon_checkCanHit( const Weapon* w, const Pilot *p )
 }
 
 /**
- * @brief Updates an individual weapon.
+ * @brief Checks whether a weapon geometrically overlaps a pilot.
  *
- *    @param w Weapon to update.
- *    @param dt Current delta tick.
- *    @param layer Layer to which the weapon belongs.
+ *    @param w Weapon to check.
+ *    @param p Pilot to check.
+ *    @param gfx Graphic of the weapon (NULL for beams).
+ *    @param polygon Collision polygon of the weapon (NULL for beams).
+ *    @param usePolyW Whether or not the weapon has a collision polygon.
+ *    @param[out] crash Collision points.
+ *    @return 1 if they collide, 0 otherwise.
  */
-static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
+static int weapon_collidePilot( const Weapon *w, const Pilot *p,
+      const glTexture *gfx, const CollPoly *polygon, int usePolyW, vec2 crash[2] )
 {
-   int b, psx, psy, n;
+   int usePoly, k;
+   int psx = p->tsx;
+   int psy = p->tsy;
+
+   /* See if the ship has a collision polygon. */
+   usePoly = usePolyW;
+   if (array_size(p->ship->polygon) == 0)
+      usePoly = 0;
+   k = p->ship->gfx_space->sx * psy + psx;
+
+   /* Beam weapons have special collisions. */
+   if (outfit_isBeam(w->outfit)) {
+      if (usePoly)
+         return CollideLinePolygon( &w->solid->pos, w->solid->dir,
+               w->outfit->u.bem.range, &p->ship->polygon[k],
+               &p->solid->pos, crash );
+      return CollideLineSprite( &w->solid->pos, w->solid->dir,
+            w->outfit->u.bem.range, p->ship->gfx_space, psx, psy,
+            &p->solid->pos, crash );
+   }
+
+   if (usePoly)
+      return CollidePolygon( &p->ship->polygon[k], &p->solid->pos,
+            polygon, &w->solid->pos, &crash[0] );
+   return CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+         p->ship->gfx_space, psx, psy, &p->solid->pos, &crash[0] );
+}
+
+/**
+ * @brief Checks whether a weapon can only hit its target.
+ *
+ *    @param w Weapon to check.
+ *    @param p Pilot to check.
+ *    @return 1 if the weapon ignores the pilot, 0 otherwise.
+ */
+static int weapon_ignoresPilot( const Weapon *w, const Pilot *p )
+{
+   int isjammed;
+
+   if (w->parent == p->id)
+      return 1; /* pilot is self */
+
+   /* smart weapons only collide with their target */
+   if (!outfit_isBeam(w->outfit) && weapon_isSmart(w)) {
+      isjammed = ((w->status == WEAPON_STATUS_JAMMED) || (w->status == WEAPON_STATUS_JAMMED_SLOWED));
+      if ((p->id != w->target) && !isjammed)
+         return 1;
+   }
+   return 0;
+}
+
+/**
+ * @brief Finds all the pilots and asteroids a weapon overlaps with.
+ *
+ * This does not modify anything but the weapon's sprite, so it can be run for
+ * many weapons in parallel. Whether or not the collisions actually happen is
+ * decided by weapon_collide(), which has to be run in order.
+ *
+ *    @param w Weapon to find collisions of.
+ *    @param job Job to store the collisions in.
+ */
+static void weapon_collideFind( Weapon *w, WeaponCollJob *job )
+{
+   int b, n;
    unsigned int coll, usePoly, usePolyW = 1;
    const glTexture *gfx;
    const CollPoly *plg, *polygon;
-   vec2 crash[2];
    Pilot *const* pilot_stack;
-   int isjammed;
+   double wr;
 
    gfx = NULL;
    polygon = NULL;
@@ -1012,8 +1279,271 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
          if (array_size(w->outfit->u.lau.polygon) == 0)
             usePolyW = 0;
       }
+
+      /* Get the pilots that can be touched by the weapon. */
+      wr = weapon_collRadius( gfx, usePolyW ? polygon : NULL );
+      spatial_query( &weapon_pilotGrid, &job->cand,
+            w->solid->pos.x, w->solid->pos.y, wr );
    }
    else {
+      /* Get the pilots that can be touched by the beam. */
+      wr = 0.;
+      spatial_queryLine( &weapon_pilotGrid, &job->cand,
+            w->solid->pos.x, w->solid->pos.y, w->solid->dir,
+            w->outfit->u.bem.range, wr );
+   }
+   job->checks += array_size(job->cand);
+
+   /* Candidates are sorted so pilots are checked in stack order. */
+   for (int j=0; j<array_size(job->cand); j++) {
+      int i = job->cand[j];
+      WeaponHit hit;
+
+      /* Stack may have shrunk. */
+      if (i >= array_size(pilot_stack))
+         break;
+      if (weapon_ignoresPilot( w, pilot_stack[i] ))
+         continue;
+
+      if (weapon_collidePilot( w, pilot_stack[i], gfx, polygon, usePolyW, hit.crash )) {
+         hit.ast  = 0;
+         hit.id   = i;
+         hit.p    = pilot_stack[i];
+         array_push_back( &job->hits, hit );
+      }
+   }
+
+   /* Collide with asteroids*/
+   if (outfit_isLauncher(w->outfit) || outfit_isBolt(w->outfit)) {
+      spatial_query( &weapon_astGrid, &job->cand,
+            w->solid->pos.x, w->solid->pos.y, wr );
+      job->checks += array_size(job->cand);
+      for (int j=0; j<array_size(job->cand); j++) {
+         WeaponHit hit;
+         Asteroid *a = weapon_astList[ job->cand[j] ];
+         vec2 apos = asteroid_pos( a );
+
+         /* In-range check with the actual asteroid. */
+         /* This is advantageous because we are going to rotate the polygon afterwards. */
+         if ( vec2_dist2( &w->solid->pos, &apos ) > pow2( gfx->sw/2. + a->gfx->sw/2. ) )
+            continue;
+
+         /* See if the asteroid has a collision polygon. */
+         usePoly = usePolyW;
+         if (a->polygon->npt == 0)
+            usePoly = 0;
+
+         if (usePoly) {
+            CollPoly rpoly;
+            RotatePolygon( &rpoly, a->polygon, (float) asteroid_ang( a ) );
+            coll = CollidePolygon( &rpoly, &apos,
+                     polygon, &w->solid->pos, &hit.crash[0] );
+            free(rpoly.x);
+            free(rpoly.y);
+         }
+         else {
+            coll = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+                                  a->gfx, 0, 0, &apos, &hit.crash[0] );
+         }
+
+         if (coll) {
+            hit.ast  = 1;
+            hit.id   = job->cand[j];
+            hit.p    = NULL;
+            array_push_back( &job->hits, hit );
+         }
+      }
+   }
+
+   else if (b) { /* Beam */
+      spatial_queryLine( &weapon_astGrid, &job->cand,
+            w->solid->pos.x, w->solid->pos.y, w->solid->dir,
+            w->outfit->u.bem.range, wr );
+      job->checks += array_size(job->cand);
+      for (int j=0; j<array_size(job->cand); j++) {
+         WeaponHit hit;
+         Asteroid *a = weapon_astList[ job->cand[j] ];
+         vec2 apos = asteroid_pos( a );
+
+         /* In-range check with the actual asteroid. */
+         if ( vec2_dist2( &w->solid->pos, &apos ) > pow2( w->outfit->u.bem.range + a->gfx->sw/2. ) )
+            continue;
+
+         /* See if the asteroid has a collision polygon. */
+         usePoly = usePolyW;
+         if (a->polygon->npt == 0)
+            usePoly = 0;
+
+         if (usePoly) {
+            CollPoly rpoly;
+            RotatePolygon( &rpoly, a->polygon, (float) asteroid_ang( a ) );
+            coll = CollideLinePolygon( &w->solid->pos, w->solid->dir,
+                                 w->outfit->u.bem.range,
+                                 &rpoly, &apos, hit.crash );
+            free(rpoly.x);
+            free(rpoly.y);
+         }
+         else {
+            coll = CollideLineSprite( &w->solid->pos, w->solid->dir,
+                                 w->outfit->u.bem.range,
+                                 a->gfx, 0, 0, &apos, hit.crash );
+         }
+
+         if (coll) {
+            hit.ast  = 1;
+            hit.id   = job->cand[j];
+            hit.p    = NULL;
+            array_push_back( &job->hits, hit );
+         }
+      }
+   }
+}
+
+/**
+ * @brief Finds the collisions of a chunk of weapons, run from the threadpool.
+ *
+ *    @param data Job to run (WeaponCollJob).
+ *    @return 0 always.
+ */
+static int weapon_collideJob( void *data )
+{
+   WeaponCollJob *job = data;
+
+   for (int i=job->start; i<job->end; i++) {
+      Weapon *w = job->wlayer[i];
+      if (weapon_isFlag(w, WEAPON_FLAG_DESTROYED))
+         continue;
+      w->coll_start = array_size(job->hits);
+      weapon_collideFind( w, job );
+      w->coll_n   = array_size(job->hits) - w->coll_start;
+      w->coll_job = job - weapon_collJobs;
+      weapon_setFlag( w, WEAPON_FLAG_COLLFOUND );
+   }
+   return 0;
+}
+
+/**
+ * @brief Finds the collisions of all the weapons of a layer in parallel.
+ *
+ * Weapons don't collide with each other and pilots and asteroids don't move
+ * while weapons are updated, so the collisions found are the same as if each
+ * weapon looked for them right before being updated.
+ *
+ *    @param wlayer Layer to find collisions of.
+ */
+static void weapons_collideLayer( Weapon **wlayer )
+{
+   int n, njobs, nthreads, chunk;
+   ThreadQueue *q;
+
+   nthreads = (conf.weapon_threads > 0) ? conf.weapon_threads : SDL_GetCPUCount();
+   n = array_size(wlayer);
+   njobs = MIN( nthreads, n / WEAPON_PARALLEL_CHUNK );
+   if (njobs <= 1)
+      return;
+
+   /* Set up the jobs, their arrays are kept around between updates. */
+   while (array_size(weapon_collJobs) < njobs) {
+      WeaponCollJob *job = &array_grow( &weapon_collJobs );
+      memset( job, 0, sizeof(WeaponCollJob) );
+      job->hits = array_create( WeaponHit );
+      job->cand = array_create( int );
+   }
+   chunk = (n + njobs - 1) / njobs;
+   q = vpool_create();
+   for (int i=0; i<njobs; i++) {
+      WeaponCollJob *job = &weapon_collJobs[i];
+      job->wlayer = wlayer;
+      job->start  = i*chunk;
+      job->end    = MIN( n, (i+1)*chunk );
+      job->checks = 0;
+      array_erase( &job->hits, array_begin(job->hits), array_end(job->hits) );
+      vpool_enqueue( q, weapon_collideJob, job );
+   }
+   vpool_wait( q );
+   weapon_collGen = weapon_gridGen;
+
+   for (int i=0; i<njobs; i++)
+      weapon_collStats.checks += weapon_collJobs[i].checks;
+}
+
+/**
+ * @brief Tries to have a weapon hit a pilot it overlaps with.
+ *
+ *    @param w Weapon hitting.
+ *    @param p Pilot being hit.
+ *    @param crash Collision points.
+ *    @param dt Current delta tick.
+ *    @param layer Layer to which the weapon belongs.
+ *    @return 1 if the weapon was destroyed, 0 otherwise.
+ */
+static int weapon_tryHitPilot( Weapon *w, Pilot *p, vec2 crash[2],
+      const double dt, WeaponLayer layer )
+{
+   /* Ignore pilots being deleted. */
+   if (pilot_isFlag(p, PILOT_DELETE))
+      return 0;
+
+   if (weapon_ignoresPilot( w, p ) || !weapon_checkCanHit( w, p ))
+      return 0;
+
+   if (outfit_isBeam(w->outfit)) {
+      weapon_hitBeam( w, p, layer, crash, dt );
+      /* No return because beam can still think, it's not
+       * destroyed like the other weapons.*/
+      return 0;
+   }
+
+   weapon_hit( w, p, &crash[0] );
+   return 1; /* Weapon is destroyed. */
+}
+
+/**
+ * @brief Tries to have a weapon hit an asteroid it overlaps with.
+ *
+ *    @param w Weapon hitting.
+ *    @param a Asteroid being hit.
+ *    @param crash Collision points.
+ *    @param dt Current delta tick.
+ *    @param layer Layer to which the weapon belongs.
+ *    @return 1 if the weapon was destroyed, 0 otherwise.
+ */
+static int weapon_tryHitAst( Weapon *w, Asteroid *a, vec2 crash[2],
+      const double dt, WeaponLayer layer )
+{
+   /* Asteroid may have been destroyed by another weapon. */
+   if (a->state != ASTEROID_FG)
+      return 0;
+
+   if (outfit_isBeam(w->outfit)) {
+      weapon_hitAstBeam( w, a, layer, crash, dt );
+      /* No return because beam can still think, it's not
+       * destroyed like the other weapons.*/
+      return 0;
+   }
+
+   weapon_hitAst( w, a, layer, &crash[0] );
+   return 1; /* Weapon is destroyed. */
+}
+
+/**
+ * @brief Checks and handles the collisions of a weapon with pilots and asteroids.
+ *
+ * Uses the collisions found in parallel by weapons_collideLayer() if
+ * available, otherwise they are found now.
+ *
+ *    @param w Weapon to check collisions of.
+ *    @param dt Current delta tick.
+ *    @param layer Layer to which the weapon belongs.
+ *    @return 1 if the weapon was destroyed, 0 otherwise.
+ */
+static int weapon_collide( Weapon* w, const double dt, WeaponLayer layer )
+{
+   const WeaponHit *hits;
+   int nhits;
+   Pilot *const* pilot_stack = pilot_getAll();
+
+   if (outfit_isBeam(w->outfit)) {
       Pilot *p = pilot_get( w->parent );
       if (p != NULL) {
          /* Beams need to update their properties online. */
@@ -1029,180 +1559,100 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
       }
    }
 
-   for (int i=0; i<array_size(pilot_stack); i++) {
-      Pilot *p = pilot_stack[i];
+   /* Hooks of previous weapons may have moved or removed pilots. */
+   if (weapon_gridDirty) {
+      weapons_buildGrids();
+      pilot_stack = pilot_getAll();
+   }
 
-      /* Ignore pilots being deleted. */
-      if (pilot_isFlag(p, PILOT_DELETE))
-         continue;
+   /* Get the overlapping objects, the ones found in parallel are outdated if
+    * the grids were rebuilt since. */
+   if (weapon_isFlag(w, WEAPON_FLAG_COLLFOUND) && (weapon_collGen == weapon_gridGen)) {
+      weapon_rmFlag(w, WEAPON_FLAG_COLLFOUND);
+      hits  = &weapon_collJobs[ w->coll_job ].hits[ w->coll_start ];
+      nhits = w->coll_n;
+   }
+   else {
+      weapon_rmFlag(w, WEAPON_FLAG_COLLFOUND);
+      weapon_collSerial.checks = 0;
+      array_erase( &weapon_collSerial.hits, array_begin(weapon_collSerial.hits),
+            array_end(weapon_collSerial.hits) );
+      weapon_collideFind( w, &weapon_collSerial );
+      weapon_collStats.checks += weapon_collSerial.checks;
+      hits  = weapon_collSerial.hits;
+      nhits = array_size(weapon_collSerial.hits);
+   }
 
-      if (w->parent == pilot_stack[i]->id)
-         continue; /* pilot is self */
-
-      psx = pilot_stack[i]->tsx;
-      psy = pilot_stack[i]->tsy;
-
-      /* See if the ship has a collision polygon. */
-      usePoly = usePolyW;
-      if (array_size(p->ship->polygon) == 0)
-         usePoly = 0;
-
-      /* Beam weapons have special collisions. */
-      if (b) {
-         /* Check for collision. */
-         if (weapon_checkCanHit(w,p)) {
-            if (usePoly) {
-               int k = p->ship->gfx_space->sx * psy + psx;
-               coll = CollideLinePolygon( &w->solid->pos, w->solid->dir,
-                     w->outfit->u.bem.range, &p->ship->polygon[k],
-                     &p->solid->pos, crash);
-            }
-            else {
-               coll = CollideLineSprite( &w->solid->pos, w->solid->dir,
-                     w->outfit->u.bem.range, p->ship->gfx_space, psx, psy,
-                     &p->solid->pos, crash);
-            }
-            if (coll)
-               weapon_hitBeam( w, p, layer, crash, dt );
-               /* No return because beam can still think, it's not
-                * destroyed like the other weapons.*/
-         }
-      }
-      /* smart weapons only collide with their target */
-      else if (weapon_isSmart(w)) {
-         isjammed = ((w->status == WEAPON_STATUS_JAMMED) || (w->status == WEAPON_STATUS_JAMMED_SLOWED));
-         if ((((pilot_stack[i]->id == w->target) && !isjammed) || isjammed) &&
-               weapon_checkCanHit(w,p) ) {
-            if (usePoly) {
-               int k = p->ship->gfx_space->sx * psy + psx;
-               coll = CollidePolygon( &p->ship->polygon[k], &p->solid->pos,
-                        polygon, &w->solid->pos, &crash[0] );
-            }
-            else {
-               coll = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                        p->ship->gfx_space, psx, psy,
-                        &p->solid->pos, &crash[0] );
-            }
-            if (coll) {
-               weapon_hit( w, p, &crash[0] );
-               return; /* Weapon is destroyed. */
-            }
-         }
-      }
-      /* unguided weapons hit anything not of the same faction */
-      else {
-         if (weapon_checkCanHit(w,p)) {
-            if (usePoly) {
-               int k = p->ship->gfx_space->sx * psy + psx;
-               coll = CollidePolygon( &p->ship->polygon[k], &p->solid->pos,
-                        polygon, &w->solid->pos, &crash[0] );
-            }
-            else {
-               coll = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                        p->ship->gfx_space, psx, psy,
-                        &p->solid->pos, &crash[0] );
-            }
+   /* Overlapping pilots come first and are sorted in stack order. */
+   for (int j=0; j<nhits; j++) {
+      vec2 crash[2];
+      if (hits[j].ast)
+         continue;
+      /* Stack may have shrunk. */
+      if ((hits[j].id >= array_size(pilot_stack)) || (pilot_stack[hits[j].id] != hits[j].p))
+         continue;
+      crash[0] = hits[j].crash[0];
+      crash[1] = hits[j].crash[1];
+      if (weapon_tryHitPilot( w, hits[j].p, crash, dt, layer ))
+         return 1;
+   }
 
-            if (coll) {
-            weapon_hit( w, p, &crash[0] );
-            return; /* Weapon is destroyed. */
-            }
-         }
+   /* Pilots added after the broadphase was built have to be checked always. */
+   for (int i=weapon_pilotGridN; i<array_size(pilot_stack); i++) {
+      vec2 crash[2];
+      Pilot *p = pilot_stack[i];
+      const glTexture *gfx = NULL;
+      const CollPoly *polygon = NULL;
+      int usePolyW = 1;
+      if (weapon_ignoresPilot( w, p ))
+         continue;
+      if (!outfit_isBeam(w->outfit)) {
+         int n;
+         gfx = outfit_gfx(w->outfit);
+         n = gfx->sx * w->sy + w->sx;
+         polygon = &outfit_plg(w->outfit)[n];
+         usePolyW = outfit_isBolt(w->outfit) ? (array_size(w->outfit->u.blt.polygon) > 0) :
+               (array_size(w->outfit->u.lau.polygon) > 0);
       }
+      weapon_collStats.checks++;
+      if (!weapon_collidePilot( w, p, gfx, polygon, usePolyW, crash ))
+         continue;
+      if (weapon_tryHitPilot( w, p, crash, dt, layer ))
+         return 1;
    }
 
    /* Collide with asteroids*/
-   if (outfit_isLauncher(w->outfit) || outfit_isBolt(w->outfit)) {
-      for (int i=0; i<array_size(cur_system->asteroids); i++) {
-         AsteroidAnchor *ast = &cur_system->asteroids[i];
-
-         /* Early in-range check with the asteroid field. */
-         if ( vec2_dist2( &w->solid->pos, &ast->pos ) >
-              pow2( ast->radius + ast->margin + gfx->sw/2. ))
-            continue;
-
-         for (int j=0; j<ast->nb; j++) {
-            Asteroid *a = &ast->asteroids[j];
-            if (a->state != ASTEROID_FG)
-               continue;
-
-            /* In-range check with the actual asteroid. */
-            /* This is advantageous because we are going to rotate the polygon afterwards. */
-            if ( vec2_dist2( &w->solid->pos, &a->pos ) > pow2( gfx->sw/2. + a->gfx->sw/2. ) )
-               continue;
-
-            /* See if the asteroid has a collision polygon. */
-            usePoly = usePolyW;
-            if (a->polygon->npt == 0)
-               usePoly = 0;
-
-            if (usePoly) {
-               CollPoly rpoly;
-               RotatePolygon( &rpoly, a->polygon, (float) a->ang );
-               coll = CollidePolygon( &rpoly, &a->pos,
-                        polygon, &w->solid->pos, &crash[0] );
-               free(rpoly.x);
-               free(rpoly.y);
-            }
-            else {
-               coll = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                                     a->gfx, 0, 0, &a->pos, &crash[0] );
-            }
-
-            if (coll) {
-               weapon_hitAst( w, a, layer, &crash[0] );
-               return; /* Weapon is destroyed. */
-            }
-         }
-      }
+   for (int j=0; j<nhits; j++) {
+      vec2 crash[2];
+      if (!hits[j].ast)
+         continue;
+      crash[0] = hits[j].crash[0];
+      crash[1] = hits[j].crash[1];
+      if (weapon_tryHitAst( w, weapon_astList[ hits[j].id ], crash, dt, layer ))
+         return 1;
    }
 
-   else if (b) { /* Beam */
-      for (int i=0; i<array_size(cur_system->asteroids); i++) {
-         AsteroidAnchor *ast = &cur_system->asteroids[i];
+   return 0;
+}
 
-         /* Early in-range check. */
-         if (vec2_dist2( &w->solid->pos, &ast->pos ) >
-            pow2( ast->radius + ast->margin + w->outfit->u.bem.range ))
-            continue;
+/**
+ * @brief Updates an individual weapon.
+ *
+ *    @param w Weapon to update.
+ *    @param dt Current delta tick.
+ *    @param layer Layer to which the weapon belongs.
+ */
+static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
+{
+   int destroyed;
+   Uint64 t0 = weapons_collTimerStart();
 
-         for (int j=0; j<ast->nb; j++) {
-            Asteroid *a = &ast->asteroids[j];
-            if (a->state != ASTEROID_FG)
-               continue;
-
-            /* In-range check with the actual asteroid. */
-            if ( vec2_dist2( &w->solid->pos, &a->pos ) > pow2( w->outfit->u.bem.range + a->gfx->sw/2. ) )
-               continue;
-
-            /* See if the asteroid has a collision polygon. */
-            usePoly = usePolyW;
-            if (a->polygon->npt == 0)
-               usePoly = 0;
-
-            if (usePoly) {
-               CollPoly rpoly;
-               RotatePolygon( &rpoly, a->polygon, (float) a->ang );
-               coll = CollideLinePolygon( &w->solid->pos, w->solid->dir,
-                                    w->outfit->u.bem.range,
-                                    &rpoly, &a->pos, crash );
-               free(rpoly.x);
-               free(rpoly.y);
-            }
-            else {
-               coll = CollideLineSprite( &w->solid->pos, w->solid->dir,
-                                    w->outfit->u.bem.range,
-                                    a->gfx, 0, 0, &a->pos, crash );
-            }
+   destroyed = weapon_collide( w, dt, layer );
 
-            if (coll) {
-               weapon_hitAstBeam( w, a, layer, crash, dt );
-               /* No return because beam can still think, it's not
-                * destroyed like the other weapons.*/
-            }
-         }
-      }
-   }
+   weapons_collTimerStop( t0 );
+
+   if (destroyed)
+      return; /* Weapon is destroyed. */
 
    /* smart weapons also get to think their next move */
    if (weapon_isSmart(w))
@@ -1390,6 +1840,7 @@ static void weapon_hitAst( Weapon* w, Asteroid* a, WeaponLayer layer, vec2* pos
    const Damage *odmg;
    Pilot *parent;
    double mining_bonus;
+   vec2 avel;
 
    /* Get general details. */
    odmg              = outfit_damage( w->outfit );
@@ -1409,7 +1860,8 @@ static void weapon_hitAst( Weapon* w, Asteroid* a, WeaponLayer layer, vec2* pos
 
    /* Add the spfx */
    spfx = outfit_spfxArmour(w->outfit);
-   spfx_add( spfx, pos->x, pos->y,VX(a->vel), VY(a->vel), layer );
+   avel = asteroid_vel( a );
+   spfx_add( spfx, pos->x, pos->y,VX(avel), VY(avel), layer );
 
    weapon_destroy(w);
 
@@ -1505,12 +1957,13 @@ static void weapon_hitAstBeam( Weapon* w, Asteroid* a, WeaponLayer layer,
    /* Add sprite. */
    if (w->timer2 == -1.) {
       int spfx = outfit_spfxArmour(w->outfit);
+      vec2 avel = asteroid_vel( a );
 
       /* Add graphic. */
       spfx_add( spfx, pos[0].x, pos[0].y,
-            VX(a->vel), VY(a->vel), SPFX_LAYER_MIDDLE );
+            VX(avel), VY(avel), SPFX_LAYER_MIDDLE );
       spfx_add( spfx, pos[1].x, pos[1].y,
-            VX(a->vel), VY(a->vel), SPFX_LAYER_MIDDLE );
+            VX(avel), VY(avel), SPFX_LAYER_MIDDLE );
       w->timer2 = -2.;
    }
 }
@@ -1532,6 +1985,7 @@ static double weapon_aimTurret( const Outfit *outfit, const Pilot *parent,
       double swivel, double time )
 {
    vec2 *target_pos, *target_vel;
+   vec2 astpos, astvel;
    double rx, ry, x, y, t, lead, rdir, off;
 
    if (pilot_target != NULL) {
@@ -1544,8 +1998,10 @@ static double weapon_aimTurret( const Outfit *outfit, const Pilot *parent,
 
       AsteroidAnchor *field = &cur_system->asteroids[parent->nav_anchor];
       Asteroid *ast = &field->asteroids[parent->nav_asteroid];
-      target_pos = &ast->pos;
-      target_vel = &ast->vel;
+      astpos = asteroid_pos( ast );
+      astvel = asteroid_vel( ast );
+      target_pos = &astpos;
+      target_vel = &astvel;
    }
 
    /* Get the vector : shooter -> target */
@@ -1873,6 +2329,7 @@ static Weapon* weapon_create( PilotOutfitSlot *po, double T,
    Pilot *pilot_target;
    AsteroidAnchor *field;
    Asteroid *ast;
+   vec2 apos;
    Weapon* w;
    const Outfit *outfit = po->outfit;
 
@@ -1918,7 +2375,8 @@ static Weapon* weapon_create( PilotOutfitSlot *po, double T,
             else if (parent->nav_asteroid >= 0) {
                field = &cur_system->asteroids[parent->nav_anchor];
                ast = &field->asteroids[parent->nav_asteroid];
-               rdir = vec2_angle(pos, &ast->pos);
+               apos = asteroid_pos( ast );
+               rdir = vec2_angle(pos, &apos);
             }
          }
 
@@ -2218,6 +2676,21 @@ void weapon_exit (void)
    /* Destroy back layer. */
    array_free(wfrontLayer);
 
+   /* Destroy broadphase. */
+   spatial_free( &weapon_pilotGrid );
+   spatial_free( &weapon_astGrid );
+   array_free( weapon_astList );
+   weapon_astList = NULL;
+   for (int i=0; i<array_size(weapon_collJobs); i++) {
+      array_free( weapon_collJobs[i].hits );
+      array_free( weapon_collJobs[i].cand );
+   }
+   array_free( weapon_collJobs );
+   weapon_collJobs = NULL;
+   array_free( weapon_collSerial.hits );
+   array_free( weapon_collSerial.cand );
+   memset( &weapon_collSerial, 0, sizeof(WeaponCollJob) );
+
    /* Destroy VBO. */
    free( weapon_vboData );
    weapon_vboData = NULL;
@@ -14,6 +14,17 @@
  */
 typedef enum { WEAPON_LAYER_BG, WEAPON_LAYER_FG } WeaponLayer;
 
+/**
+ * @brief Statistics of the weapon collision detection, used for benchmarking.
+ */
+typedef struct WeaponCollisionStats_ {
+   int enabled;   /**< Whether or not statistics are being collected. */
+   int ticks;     /**< Number of updates. */
+   double time;   /**< Time spent doing collision detection (in seconds). */
+   long checks;   /**< Number of candidates returned by the broadphase. */
+   long weapons;  /**< Sum of the number of weapons alive at each update. */
+} WeaponCollisionStats;
+
 /*
  * Addition.
  */
@@ -42,6 +53,8 @@ void weapon_hitAI( Pilot *p, const Pilot *shooter, double dmg );
  */
 void weapons_update( const double dt );
 void weapons_render( const WeaponLayer layer, const double dt );
+void weapons_collisionStats( WeaponCollisionStats *stats, int enable );
+void weapons_gridInvalidate (void);
 
 /*
  * Clean.
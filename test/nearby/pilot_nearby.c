@@ -0,0 +1,288 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file pilot_nearby.c
+ *
+ * @brief Checks the neighbourhood queries of the pilots against brute force.
+ *
+ * Random sets of pilots are moved around and have their electronic warfare
+ *  values changed the way the game does, and every query has to return all
+ *  the pilots a loop over the whole stack would find.
+ */
+/** @cond */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "array.h"
+#include "pilot.h"
+#include "pilot_ew.h"
+
+#define SEEDS     20    /**< Number of random pilot sets. */
+#define STEPS     50    /**< Number of updates of each set. */
+#define QUERIES   20    /**< Number of queries of each kind per update. */
+#define AREA      20000. /**< Side of the area pilots are in. */
+
+static Pilot **stack = NULL; /**< Array (array.h): Test pilot stack. */
+static unsigned int seed = 1; /**< State of the random number generator. */
+static int failed = 0; /**< Number of failed checks. */
+
+/*
+ * The rest of the game isn't linked in, so only what the neighbourhood index
+ *  uses is provided.
+ */
+Pilot*const* pilot_getAll (void)
+{
+   return stack;
+}
+int logprintf( FILE *stream, int newline, const char *fmt, ... )
+{
+   va_list ap;
+   va_start( ap, fmt );
+   vfprintf( stream, fmt, ap );
+   va_end( ap );
+   if (newline)
+      fputc( '\n', stream );
+   return 0;
+}
+const char* gettext_ngettext( const char* msgid, const char* msgid_plural, uint64_t n )
+{
+   return (n == 1) ? msgid : msgid_plural;
+}
+
+/**
+ * @brief Random number in [0,1).
+ */
+static double rnd (void)
+{
+   seed = seed * 1103515245u + 12345u;
+   return (double)(seed >> 8) / (double)(1u << 24);
+}
+
+/**
+ * @brief Random number in [a,b).
+ */
+static double rndr( double a, double b )
+{
+   return a + (b-a) * rnd();
+}
+
+/**
+ * @brief Gives a pilot random electronic warfare values and flags.
+ */
+static void pilot_randomise( Pilot *p )
+{
+   p->stats.ew_detect   = rndr( 0.5, 2. );
+   p->stats.ew_track    = rndr( 0.5, 2. );
+   p->ew_detection      = rndr( 0., 4000. );
+   p->ew_evasion        = rndr( 0., 3000. );
+   p->ew_stealth        = rndr( 0., 2000. );
+   memset( p->flags, 0, sizeof(PilotFlags) );
+   if (rnd() < 0.05)
+      pilot_setFlag( p, PILOT_VISIBLE );
+   if (rnd() < 0.05)
+      pilot_setFlag( p, PILOT_VISPLAYER );
+   if (rnd() < 0.1)
+      pilot_setFlag( p, PILOT_STEALTH );
+   if (rnd() < 0.05)
+      pilot_setFlag( p, PILOT_PLAYER );
+}
+
+/**
+ * @brief Adds a random pilot to the stack.
+ */
+static void pilot_addRandom (void)
+{
+   Pilot *p = calloc( 1, sizeof(Pilot) );
+   p->solid = calloc( 1, sizeof(Solid) );
+   p->id    = array_size(stack)+1;
+   p->name  = "test";
+   /* Some pilots are on top of each other. */
+   if ((array_size(stack) > 0) && (rnd() < 0.1))
+      p->solid->pos = stack[ (int)(rnd()*array_size(stack)) ]->solid->pos;
+   else {
+      p->solid->pos.x = rndr( -AREA/2., AREA/2. );
+      p->solid->pos.y = rndr( -AREA/2., AREA/2. );
+   }
+   pilot_randomise( p );
+   if ((array_size(stack) > 0) && (rnd() < 0.05))
+      p->parent = stack[ (int)(rnd()*array_size(stack)) ]->id;
+   array_push_back( &stack, p );
+   pilot_nearbyInvalidate();
+}
+
+/**
+ * @brief Removes a random pilot from the stack.
+ */
+static void pilot_rmRandom (void)
+{
+   int i = rnd() * array_size(stack);
+   free( stack[i]->solid );
+   free( stack[i] );
+   array_erase( &stack, &stack[i], &stack[i+1] );
+   pilot_nearbyInvalidate();
+}
+
+/**
+ * @brief Checks that a query result is sorted positions in the stack and
+ *  finds its position.
+ *
+ *    @return Whether or not the result is well formed.
+ */
+static int check_result( const char *query, const int *res )
+{
+   for (int i=0; i<array_size(res); i++) {
+      if ((res[i] < 0) || (res[i] >= array_size(stack)) ||
+            ((i > 0) && (res[i] <= res[i-1]))) {
+         fprintf( stderr, "%s: result %d (%d) is out of order or out of the stack\n",
+               query, i, res[i] );
+         failed++;
+         return 0;
+      }
+   }
+   return 1;
+}
+
+/**
+ * @brief Checks whether a sorted result contains a position in the stack.
+ */
+static int has( const int *res, int i )
+{
+   int lo = 0, hi = array_size(res)-1;
+   while (lo <= hi) {
+      int mid = (lo+hi) / 2;
+      if (res[mid] == i)
+         return 1;
+      else if (res[mid] < i)
+         lo = mid+1;
+      else
+         hi = mid-1;
+   }
+   return 0;
+}
+
+/**
+ * @brief Checks range queries against brute force.
+ */
+static void check_range( double x, double y, double r )
+{
+   const int *res = pilot_nearbyRange( x, y, r );
+   if (!check_result( "range", res ))
+      return;
+   for (int i=0; i<array_size(stack); i++) {
+      const vec2 *v = &stack[i]->solid->pos;
+      if ((pow2(v->x-x) + pow2(v->y-y) <= pow2(r)) && !has( res, i )) {
+         fprintf( stderr, "range: pilot %d at (%g,%g) missing from circle (%g,%g) r=%g\n",
+               i, v->x, v->y, x, y, r );
+         failed++;
+      }
+   }
+}
+
+/**
+ * @brief Checks sensor queries against brute force.
+ */
+static void check_sensor( const Pilot *p, int fuzzy )
+{
+   const int *res = pilot_nearbySensor( p, fuzzy );
+   if (!check_result( "sensor", res ))
+      return;
+   for (int i=0; i<array_size(stack); i++) {
+      int ret = pilot_inRangePilot( p, stack[i], NULL );
+      if (((ret == 1) || (fuzzy && (ret != 0))) && !has( res, i )) {
+         fprintf( stderr, "sensor: pilot %d missing from query of pilot %u (fuzzy=%d, ret=%d)\n",
+               i, p->id, fuzzy, ret );
+         failed++;
+      }
+   }
+}
+
+/**
+ * @brief Checks stealth queries against brute force.
+ */
+static void check_stealth( const Pilot *p, double mod )
+{
+   const int *res = pilot_nearbyStealth( p, mod );
+   if (!check_result( "stealth", res ))
+      return;
+   for (int i=0; i<array_size(stack); i++) {
+      const Pilot *t = stack[i];
+      double d2 = vec2_dist2( &p->solid->pos, &t->solid->pos );
+      if ((d2 <= pow2( MAX( 0., p->ew_stealth * t->stats.ew_detect * mod ) )) && !has( res, i )) {
+         fprintf( stderr, "stealth: pilot %d missing from query of pilot %u (mod=%g)\n",
+               i, p->id, mod );
+         failed++;
+      }
+   }
+}
+
+int main( void )
+{
+   stack = array_create( Pilot* );
+   pilot_nearbyInit();
+
+   for (int s=0; s<SEEDS; s++) {
+      int n;
+      seed = s+1;
+      n = 1 + (int)(rnd() * 300.);
+      for (int i=0; i<n; i++)
+         pilot_addRandom();
+
+      for (int step=0; step<STEPS; step++) {
+         /* Move the pilots, sometimes by a lot, the way the game does. */
+         for (int i=0; i<array_size(stack); i++) {
+            Pilot *p = stack[i];
+            double d = (rnd() < 0.02) ? 5000. : 50.;
+            p->solid->pos.x += rndr( -d, d );
+            p->solid->pos.y += rndr( -d, d );
+            if (rnd() < 0.05) {
+               pilot_randomise( p );
+               pilot_nearbyInvalidate();
+            }
+            else {
+               p->ew_detection = rndr( 0., 4000. );
+               p->ew_evasion   = rndr( 0., 3000. );
+               p->ew_stealth   = rndr( 0., 2000. );
+            }
+            pilot_nearbyUpdate( p );
+
+            /* Leaders change after the index was built, as with pilot.setLeader(). */
+            if (rnd() < 0.01) {
+               p->parent = (rnd() < 0.5) ? 0 : stack[ (int)(rnd()*array_size(stack)) ]->id;
+               pilot_nearbyInvalidate();
+            }
+         }
+
+         /* Pilots come and go. */
+         if (rnd() < 0.3)
+            pilot_addRandom();
+         if ((array_size(stack) > 1) && (rnd() < 0.3))
+            pilot_rmRandom();
+
+         for (int q=0; q<QUERIES; q++) {
+            const Pilot *p = stack[ (int)(rnd()*array_size(stack)) ];
+            check_range( rndr(-AREA/2., AREA/2.), rndr(-AREA/2., AREA/2.), rndr(0., 5000.) );
+            check_range( p->solid->pos.x, p->solid->pos.y, 0. );
+            check_sensor( p, 0 );
+            check_sensor( p, 1 );
+            check_stealth( p, 1. );
+            check_stealth( p, 1.5 );
+         }
+      }
+
+      while (array_size(stack) > 0)
+         pilot_rmRandom();
+   }
+
+   pilot_nearbyFree();
+   array_free( stack );
+   if (failed > 0) {
+      fprintf( stderr, "%d checks failed\n", failed );
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file trail_tessellate.c
+ *
+ * @brief Checks the meshes spfx_trail_tessellate() builds from trails.
+ */
+/** @cond */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "naev.h"
+/** @endcond */
+
+#include "array.h"
+#include "spfx.h"
+
+#define EPS       1e-4  /**< Tolerance when comparing positions. */
+#define THICK     2.    /**< Thickness of the test trails. */
+#define SCREEN    1000. /**< Width and height of the test screen. */
+
+static int failed = 0; /**< Number of failed checks. */
+
+/**
+ * @brief Reports a failed check.
+ */
+#define CHECK( cond, ... ) \
+do { if (!(cond)) { \
+   fprintf( stderr, "%s:%d: ", __FILE__, __LINE__ ); \
+   fprintf( stderr, __VA_ARGS__ ); \
+   fprintf( stderr, "\n" ); \
+   failed++; \
+} } while (0)
+
+/**
+ * @brief Sets up a trail from a list of points.
+ *
+ *    @param trail Trail to set up.
+ *    @param spec Spec to use.
+ *    @param pts X and Y coordinates of the points.
+ *    @param modes Mode of each point, or NULL for all idle.
+ *    @param n Number of points.
+ *    @param start Where in the circular buffer the trail starts.
+ */
+static void trail_setup( Trail_spfx *trail, const TrailSpec *spec,
+      const double *pts, const TrailMode *modes, int n, size_t start )
+{
+   memset( trail, 0, sizeof(Trail_spfx) );
+   trail->spec     = spec;
+   trail->capacity = 8;
+   trail->point_ringbuf = calloc( trail->capacity, sizeof(TrailPoint) );
+   trail->iread    = start;
+   trail->iwrite   = start;
+   for (int i=0; i<n; i++) {
+      TrailPoint *tp = &trail_at( trail, trail->iwrite++ );
+      tp->x    = pts[2*i];
+      tp->y    = pts[2*i+1];
+      tp->t    = 1.;
+      tp->mode = (modes != NULL) ? modes[i] : MODE_IDLE;
+   }
+}
+
+/**
+ * @brief Checks a vertex of the mesh.
+ */
+static void check_vertex( const char *name, const TrailVertex *mesh, int i,
+      double x, double y, double side, double px )
+{
+   const TrailVertex *v = &mesh[i];
+   CHECK( (fabs(v->x-x) < EPS) && (fabs(v->y-y) < EPS),
+         "%s: vertex %d at (%g,%g), expected (%g,%g)", name, i, v->x, v->y, x, y );
+   CHECK( v->side == side, "%s: vertex %d on side %g, expected %g", name, i, v->side, side );
+   CHECK( fabs(v->px-px) < EPS, "%s: vertex %d at length %g, expected %g", name, i, v->px, px );
+}
+
+/**
+ * @brief Checks the two triangles of a segment.
+ *
+ * Both ends are given by their centre and the normal at that end.
+ */
+static void check_quad( const char *name, const TrailVertex *mesh, int seg,
+      double x1, double y1, double nx1, double ny1, double len1,
+      double x2, double y2, double nx2, double ny2, double len2 )
+{
+   int i = 6*seg;
+   check_vertex( name, mesh, i+0, x1-nx1*THICK, y1-ny1*THICK, -1., len1 );
+   check_vertex( name, mesh, i+1, x1+nx1*THICK, y1+ny1*THICK,  1., len1 );
+   check_vertex( name, mesh, i+2, x2-nx2*THICK, y2-ny2*THICK, -1., len2 );
+   check_vertex( name, mesh, i+3, x2-nx2*THICK, y2-ny2*THICK, -1., len2 );
+   check_vertex( name, mesh, i+4, x1+nx1*THICK, y1+ny1*THICK,  1., len1 );
+   check_vertex( name, mesh, i+5, x2+nx2*THICK, y2+ny2*THICK,  1., len2 );
+}
+
+/**
+ * @brief Checks that all the vertices of the mesh are finite.
+ */
+static void check_finite( const char *name, const TrailVertex *mesh, int n )
+{
+   for (int i=0; i<n; i++)
+      CHECK( isfinite(mesh[i].x) && isfinite(mesh[i].y),
+            "%s: vertex %d is not finite", name, i );
+}
+
+/**
+ * @brief Tessellates a trail given by its points.
+ *
+ *    @return Number of vertices in the mesh.
+ */
+static int tessellate( TrailVertex **mesh, const TrailSpec *spec,
+      const double *pts, const TrailMode *modes, int n, size_t start )
+{
+   Trail_spfx trail;
+   int nv;
+   trail_setup( &trail, spec, pts, modes, n, start );
+   array_erase( mesh, array_begin(*mesh), array_end(*mesh) );
+   /* Offset everything to the middle of the screen. */
+   nv = spfx_trail_tessellate( mesh, &trail, 1., SCREEN/2., SCREEN/2., SCREEN, SCREEN );
+   CHECK( nv == array_size(*mesh), "returned %d vertices but added %d", nv, array_size(*mesh) );
+   free( trail.point_ringbuf );
+   return nv;
+}
+
+int main( void )
+{
+   TrailSpec spec;
+   TrailVertex *mesh = array_create( TrailVertex );
+   const double c = SCREEN/2.;
+   const double s = M_SQRT1_2;
+   int n;
+
+   memset( &spec, 0, sizeof(TrailSpec) );
+   for (int i=0; i<MODE_MAX; i++)
+      spec.style[i].thick = THICK;
+
+   /* Straight line, wrapping around the circular buffer. */
+   {
+      const double pts[] = { 0.,0., 10.,0., 20.,0. };
+      n = tessellate( &mesh, &spec, pts, NULL, 3, 7 );
+      CHECK( n == 12, "straight: %d vertices, expected 12", n );
+      if (n == 12) {
+         check_quad( "straight", mesh, 0, c, c, 0., -1., 0., c+10., c, 0., -1., 10. );
+         check_quad( "straight", mesh, 1, c+10., c, 0., -1., 10., c+20., c, 0., -1., 20. );
+      }
+   }
+
+   /* Right angle, the corner edge is along the bisector and shared. */
+   {
+      const double pts[] = { 0.,0., 10.,0., 10.,10. };
+      n = tessellate( &mesh, &spec, pts, NULL, 3, 0 );
+      CHECK( n == 12, "corner: %d vertices, expected 12", n );
+      if (n == 12) {
+         check_quad( "corner", mesh, 0, c, c, 0., -1., 0., c+10., c, s, -s, 10. );
+         check_quad( "corner", mesh, 1, c+10., c, s, -s, 10., c+10., c+10., 1., 0., 20. );
+      }
+   }
+
+   /* Turning back on itself, the corner falls back to the segment normals. */
+   {
+      const double pts[] = { 0.,0., 10.,0., 0.,0. };
+      n = tessellate( &mesh, &spec, pts, NULL, 3, 0 );
+      CHECK( n == 12, "u-turn: %d vertices, expected 12", n );
+      check_finite( "u-turn", mesh, n );
+      if (n == 12) {
+         check_quad( "u-turn", mesh, 0, c, c, 0., -1., 0., c+10., c, 0., -1., 10. );
+         check_quad( "u-turn", mesh, 1, c+10., c, 0., 1., 10., c, c, 0., 1., 20. );
+      }
+   }
+
+   /* Degenerate trails. */
+   {
+      const double pts[] = { 0.,0., 0.,0., 0.,0., 10.,0. };
+      n = tessellate( &mesh, &spec, pts, NULL, 1, 0 );
+      CHECK( n == 0, "single point: %d vertices, expected 0", n );
+      n = tessellate( &mesh, &spec, pts, NULL, 3, 0 );
+      CHECK( n == 0, "repeated point: %d vertices, expected 0", n );
+      n = tessellate( &mesh, &spec, pts, NULL, 4, 0 );
+      CHECK( n == 6, "repeated then moving: %d vertices, expected 6", n );
+      check_finite( "repeated then moving", mesh, n );
+      if (n == 6)
+         check_quad( "repeated then moving", mesh, 0, c, c, 0., -1., 0., c+10., c, 0., -1., 10. );
+   }
+
+   /* Segments touching a point with no emission or off screen are skipped. */
+   {
+      const double pts[] = { 0.,0., 10.,0., 20.,0., SCREEN,0., SCREEN+10.,0. };
+      const TrailMode modes[] = { MODE_IDLE, MODE_NONE, MODE_IDLE, MODE_IDLE, MODE_IDLE };
+      n = tessellate( &mesh, &spec, pts, modes, 5, 0 );
+      CHECK( n == 6, "skipped: %d vertices, expected 6", n );
+      if (n == 6)
+         check_quad( "skipped", mesh, 0, c+20., c, 0., -1., 20., c+SCREEN, c, 0., -1., SCREEN );
+   }
+
+   array_free( mesh );
+   if (failed > 0) {
+      fprintf( stderr, "%d checks failed\n", failed );
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
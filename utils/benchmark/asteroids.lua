@@ -0,0 +1,24 @@
+-- Benchmarks the movement of asteroids on a synthetic field, comparing the
+-- vectorized update with the scalar one. The field is not part of the current
+-- system so the results don't depend on where the player is. asteroid.benchmark()
+-- is only available in debug builds.
+local bench = require "utils.benchmark.common"
+local reps = 5
+local n = 50000
+local steps = 600
+
+local tstart = bench.start()
+local tsimd = {}
+local tscalar = {}
+for i=1,reps do
+   local simd, scalar = asteroid.benchmark( n, steps )
+   -- Time per update in ms
+   table.insert( tsimd, simd / steps * 1000 )
+   table.insert( tscalar, scalar / steps * 1000 )
+end
+local msimd, ssimd = bench.stats( tsimd )
+local mscalar, sscalar = bench.stats( tscalar )
+print(string.format("vectorized: %d asteroids, %.3f ms/update (%.3f ms std dev)", n, msimd, ssimd ))
+print(string.format("scalar: %d asteroids, %.3f ms/update (%.3f ms std dev)", n, mscalar, sscalar ))
+print(string.format("speedup: %.2fx", mscalar / msimd ))
+bench.finish( tstart )
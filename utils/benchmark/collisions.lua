@@ -0,0 +1,55 @@
+-- Benchmarks the weapon collision broadphase by having two large fleets fight
+-- each other and reporting the time spent in weapon collisions. The game is
+-- run with naev.simulate(), so it needs a debug build and the player in space.
+local bench = require "utils.benchmark.common"
+local reps = 3
+local npilots = 200 -- Pilots per side
+local nticks = 600 -- Updates per repetition
+local ships = { "Hyena", "Shark", "Lancelot", "Admonisher", "Pacifier" }
+
+local pp = player.pilot()
+pp:setInvincible()
+pp:setInvisible()
+pilot.toggleSpawn(false)
+
+local fa = faction.dynAdd( "Mercenary", "bench_red", _("Red"), {clear_allies=true, clear_enemies=true} )
+local fb = faction.dynAdd( "Mercenary", "bench_blue", _("Blue"), {clear_allies=true, clear_enemies=true} )
+fa:dynEnemy( fb )
+
+local function run()
+   pilot.clear()
+   local c = pp:pos()
+   for i=1,npilots do
+      local s = ships[ (i-1) % #ships + 1 ]
+      local pa = pilot.add( s, fa, c + vec2.newP( 1500*rnd.rnd(), rnd.angle() ) + vec2.new(-1000,0) )
+      local pb = pilot.add( s, fb, c + vec2.newP( 1500*rnd.rnd(), rnd.angle() ) + vec2.new( 1000,0) )
+      pa:setNoDeath()
+      pb:setNoDeath()
+   end
+
+   naev.collisionStats( true )
+   naev.simulate( nticks )
+   return naev.collisionStats( false )
+end
+
+local tstart = bench.start()
+local tms = {}
+local checks = 0
+local weapons = 0
+local ticks = 0
+for i=1,reps do
+   local s = run()
+   table.insert( tms, s.time*1000 / math.max(s.ticks,1) )
+   checks = checks + s.checks
+   weapons = weapons + s.weapons
+   ticks = ticks + s.ticks
+end
+local mean, stddev = bench.stats( tms )
+print(string.format("%d pilots: %.4f ms/update (%.4f ms std dev), %.1f narrow-phase checks and %.1f weapons per update",
+      2*npilots, mean, stddev, checks / math.max(ticks,1), weapons / math.max(ticks,1) ))
+
+pilot.clear()
+pilot.toggleSpawn(true)
+pp:setInvincible(false)
+pp:setInvisible(false)
+bench.finish( tstart )
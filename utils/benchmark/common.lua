@@ -0,0 +1,32 @@
+-- Helpers shared by the benchmark scripts.
+local common = {}
+
+-- Returns the mean and standard deviation of a list of values.
+function common.stats( vals )
+   local mean = 0
+   local stddev = 0
+   for k,v in ipairs(vals) do
+      mean = mean + v
+   end
+   mean = mean / #vals
+   for k,v in ipairs(vals) do
+      stddev = stddev + math.pow(v-mean, 2)
+   end
+   stddev = math.sqrt(stddev / #vals)
+   return mean, stddev
+end
+
+-- Marks the start of the measurements and returns the starting time.
+function common.start()
+   print("====== BENCHMARK START ======")
+   return naev.clock()
+end
+
+-- Prints the total time since common.start() and marks the end of the
+-- measurements.
+function common.finish( tstart )
+   print(string.format("Total time: %.3f s", naev.clock()-tstart))
+   print("====== BENCHMARK END ======")
+end
+
+return common
@@ -1,6 +1,9 @@
 local equipopt = require 'equipopt'
+local common = require "utils.benchmark.common"
 local benchmark = {}
-function benchmark.run( _testname, reps, sparams )
+-- Runs the benchmark, the solution cache is only used if cache is true and
+-- the hit rate is returned as the fourth value.
+function benchmark.run( _testname, reps, sparams, cache )
    local ships = {
       "Llama",
       "Hyena",
@@ -25,6 +28,9 @@ function benchmark.run( _testname, reps, sparams )
       equipopt.proteron,
    }
 
+   equipopt.optimize.cache_enabled = cache or false
+   equipopt.optimize.cache_clear()
+
    pilot.clear()
    local pos = vec2.new(0,0)
    local vals = {}
@@ -47,18 +53,16 @@ function benchmark.run( _testname, reps, sparams )
       collectgarbage('restart')
    end
 
-   local mean = 0
-   local stddev = 0
-   for k,v in ipairs(vals) do
-      mean = mean + v
-   end
-   mean = mean / #vals
-   for k,v in ipairs(vals) do
-      stddev = stddev + math.pow(v-mean, 2)
+   local mean, stddev = common.stats( vals )
+
+   local hits, misses = equipopt.optimize.cache_stats()
+   local hitrate = 0
+   if hits+misses > 0 then
+      hitrate = hits / (hits+misses)
    end
-   stddev = math.sqrt(stddev / #vals)
+   equipopt.optimize.cache_enabled = true
 
-   return mean, stddev, vals
+   return mean, stddev, vals, hitrate
 end
 
 function benchmark.csv_open( header, reps )
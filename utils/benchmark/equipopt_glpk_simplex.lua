@@ -8,6 +8,9 @@ local tstart = naev.clock()
 print("====== BENCHMARK START ======")
 local bl_mean, bl_stddev, bl_vals = benchmark.run( "Baseline", reps )
 local def_mean, def_stddev, def_vals = benchmark.run( "Defaults", reps, {} )
+local cache_mean, cache_stddev, _cache_vals, cache_hitrate = benchmark.run( "Cached", reps, {}, true )
+print(string.format("Defaults: %.3f (%.3f) ms, Cached: %.3f (%.3f) ms, %.1f%% cache hits",
+   def_mean, def_stddev, cache_mean, cache_stddev, cache_hitrate*100 ) )
 csvfile:write(string.format("%f,%f,-,-,-,-", bl_mean, bl_stddev ) )
 benchmark.csv_writereps( csvfile, bl_vals )
 csvfile:write(string.format("%f,%f,def,def,def,def", def_mean, def_stddev ) )
@@ -0,0 +1,37 @@
+-- Benchmarks the jump pathfinding by querying paths and distances between
+-- all the pairs of systems of the universe. The first jumpDist repetition
+-- includes building the cached hop tables, later ones should only be lookups.
+local bench = require "utils.benchmark.common"
+local reps = 3
+
+local function run( testname, f )
+   local systems = system.getAll()
+   local vals = {}
+   local n = 0
+   for i=1,reps do
+      collectgarbage("collect")
+      collectgarbage('stop')
+      local rstart = naev.clock()
+      n = 0
+      for a,sa in ipairs(systems) do
+         for b,sb in ipairs(systems) do
+            f( sa, sb )
+            n = n+1
+         end
+      end
+      table.insert( vals, (naev.clock()-rstart)*1000 )
+      collectgarbage('restart')
+   end
+   local mean, stddev = bench.stats( vals )
+   print(string.format("%s: %d queries, %.3f ms (%.3f ms std dev), first rep %.3f ms",
+         testname, n, mean, stddev, vals[1] ))
+   return mean, stddev
+end
+
+local tstart = bench.start()
+run( "jumpPath", function( sa, sb ) return sa:jumpPath( sb ) end )
+run( "jumpPath (hidden)", function( sa, sb ) return sa:jumpPath( sb, true ) end )
+run( "jumpDist", function( sa, sb ) return sa:jumpDist( sb ) end )
+run( "jumpDist (hidden)", function( sa, sb ) return sa:jumpDist( sb, true ) end )
+run( "jumpDist (known)", function( sa, sb ) return sa:jumpDist( sb, false, true ) end )
+bench.finish( tstart )
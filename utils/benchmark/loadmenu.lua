@@ -0,0 +1,35 @@
+-- Benchmarks listing the saved games for the load menu, which only reads the
+-- start of each save, against fully parsing them like older versions did.
+-- Creates synthetic saves by copying the autosave of the current player, and
+-- removes them afterwards.
+local bench = require "utils.benchmark.common"
+local nsaves = 200
+local reps = 3
+
+-- Copy the autosave over, this and naev.savesRefresh() need a debug build
+naev.savesBenchmark( nsaves )
+local f = file.new( "saves/"..player.name().."/autosave.ns" )
+f:open("r")
+local size = f:getSize()
+f:close()
+
+local tstart = bench.start()
+local theader = {}
+local tfull = {}
+local n
+for i=1,reps do
+   local t = naev.clock()
+   n = naev.savesRefresh()
+   table.insert( theader, (naev.clock()-t)*1000 )
+   t = naev.clock()
+   naev.savesRefresh( true )
+   table.insert( tfull, (naev.clock()-t)*1000 )
+end
+local mean, stddev = bench.stats( theader )
+print(string.format("header: %d saves (%d bytes each), %.3f ms (%.3f ms std dev)", n, size, mean, stddev ))
+mean, stddev = bench.stats( tfull )
+print(string.format("full parse: %d saves, %.3f ms (%.3f ms std dev)", n, mean, stddev ))
+bench.finish( tstart )
+
+naev.savesBenchmark()
+naev.savesRefresh()
@@ -0,0 +1,57 @@
+-- Benchmarks looking up universe objects by name, which Lua and unidiffs do
+-- all the time through system_get(), spob_get(), outfit_get(), ship_get() and
+-- commodity_get(). Every object of each kind is looked up repeatedly.
+local bench = require "utils.benchmark.common"
+local reps = 5
+local lookups = 1000000 -- Total lookups per repetition
+
+local function names( objs )
+   local t = {}
+   for k,o in ipairs(objs) do
+      table.insert( t, o:nameRaw() )
+   end
+   return t
+end
+
+local function run( label, get, list )
+   local passes = math.ceil( lookups / #list )
+   local vals = {}
+   for i=1,reps do
+      collectgarbage("collect")
+      collectgarbage('stop')
+      local rstart = naev.clock()
+      for j=1,passes do
+         for k,n in ipairs(list) do
+            get( n )
+         end
+      end
+      local t = naev.clock()-rstart
+      table.insert( vals, passes*#list / t / 1e6 )
+      collectgarbage('restart')
+   end
+   local mean, stddev = bench.stats( vals )
+   print(string.format("%s (%d): %.3f million lookups/s (%.3f std dev)", label, #list, mean, stddev ))
+end
+
+-- Commodities have no getAll, so gather the ones sold anywhere
+local commodities = {}
+do
+   local seen = {}
+   for k,s in ipairs(spob.getAll()) do
+      for i,c in ipairs(s:commoditiesSold()) do
+         local n = c:nameRaw()
+         if not seen[n] then
+            seen[n] = true
+            table.insert( commodities, n )
+         end
+      end
+   end
+end
+
+local tstart = bench.start()
+run( "systems", system.get, names( system.getAll() ) )
+run( "spobs", spob.get, names( spob.getAll() ) )
+run( "outfits", outfit.get, names( outfit.getAll() ) )
+run( "ships", ship.get, names( ship.getAll() ) )
+run( "commodities", commodity.get, commodities )
+bench.finish( tstart )
@@ -0,0 +1,51 @@
+-- Benchmarks the neighbourhood queries done by the AI and scripts. Pilots of
+-- two hostile factions are spread over a large area and each one asks for its
+-- enemies and for the pilots around it, like AI control ticks usually do.
+local bench = require "utils.benchmark.common"
+local reps = 5
+local radius = 3000
+
+local function run( n )
+   pilot.clear()
+   local plts = {}
+   local area = 300 * math.sqrt(n) -- Keep the density constant
+   for i=1,n do
+      local pos = vec2.newP( area*math.sqrt(rnd.rnd()), rnd.angle() )
+      local fct = (i%2==0) and "Empire" or "Pirate"
+      table.insert( plts, pilot.add( "Llama", fct, pos, nil, {naked=true} ) )
+   end
+
+   local tenemies = {}
+   local tinrange = {}
+   local found = 0
+   for i=1,reps do
+      collectgarbage("collect")
+      collectgarbage('stop')
+      local rstart = naev.clock()
+      for k,p in ipairs(plts) do
+         found = found + #p:getEnemies( radius )
+      end
+      table.insert( tenemies, (naev.clock()-rstart)*1000 )
+      rstart = naev.clock()
+      for k,p in ipairs(plts) do
+         found = found + #pilot.getInrange( p:pos(), radius )
+      end
+      table.insert( tinrange, (naev.clock()-rstart)*1000 )
+      collectgarbage('restart')
+   end
+   local mean, stddev = bench.stats( tenemies )
+   print(string.format("%d pilots: getEnemies %.3f ms (%.3f ms std dev)", n, mean, stddev ))
+   mean, stddev = bench.stats( tinrange )
+   print(string.format("%d pilots: getInrange %.3f ms (%.3f ms std dev), %.1f found per query",
+         n, mean, stddev, found / (2*reps*n) ))
+
+   for k,p in ipairs(plts) do
+      p:rm()
+   end
+end
+
+local tstart = bench.start()
+run( 50 )
+run( 500 )
+run( 2000 )
+bench.finish( tstart )
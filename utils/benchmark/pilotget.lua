@@ -0,0 +1,43 @@
+-- Benchmarks looking up pilots by their id, which every pilot method does
+-- through pilot_get(). Pilots are created in the current system and each one
+-- is then looked up repeatedly with the cheapest pilot method.
+local bench = require "utils.benchmark.common"
+local reps = 5
+local lookups = 1000000 -- Total lookups per repetition
+
+local function run( n )
+   pilot.clear()
+   local plts = {}
+   for i=1,n do
+      local pos = vec2.newP( 1000*rnd.rnd(), rnd.angle() )
+      table.insert( plts, pilot.add( "Llama", "Dummy", pos, nil, {naked=true} ) )
+   end
+   local passes = math.ceil( lookups / n )
+
+   local vals = {}
+   for i=1,reps do
+      collectgarbage("collect")
+      collectgarbage('stop')
+      local rstart = naev.clock()
+      for j=1,passes do
+         for k,p in ipairs(plts) do
+            p:exists()
+         end
+      end
+      local t = naev.clock()-rstart
+      table.insert( vals, passes*n / t / 1e6 )
+      collectgarbage('restart')
+   end
+   local mean, stddev = bench.stats( vals )
+   print(string.format("%d pilots: %.3f million lookups/s (%.3f std dev)", n, mean, stddev ))
+
+   for k,p in ipairs(plts) do
+      p:rm()
+   end
+end
+
+local tstart = bench.start()
+run( 50 )
+run( 500 )
+run( 5000 )
+bench.finish( tstart )
@@ -0,0 +1,50 @@
+-- Benchmarks the safe lane computation. A cold start recalculates from
+-- scratch, and a startup with the disk cache loads the lanes from it, while
+-- recalculating an unchanged universe and applying then removing every
+-- available diff that is not already applied can reuse the cached
+-- factorization and lanes.
+local bench = require "utils.benchmark.common"
+local reps = 3
+
+local diffs = {}
+for k,d in ipairs(diff.available()) do
+   if not diff.isApplied(d) then
+      table.insert( diffs, d )
+   end
+end
+
+local tstart = bench.start()
+local tcold = {}
+local tdisk = {}
+local twarm = {}
+local tdiff = {}
+for i=1,reps do
+   local t = naev.clock()
+   safelanes.recalculate( true )
+   table.insert( tcold, (naev.clock()-t)*1000 )
+   t = naev.clock()
+   safelanes.recalculate( true, true )
+   table.insert( tdisk, (naev.clock()-t)*1000 )
+   t = naev.clock()
+   safelanes.recalculate()
+   table.insert( twarm, (naev.clock()-t)*1000 )
+end
+for i=1,reps do
+   for k,d in ipairs(diffs) do
+      local t = naev.clock()
+      diff.apply( d )
+      diff.remove( d )
+      table.insert( tdiff, (naev.clock()-t)*1000 )
+   end
+end
+local mean, stddev = bench.stats( tcold )
+print(string.format("cold: %.3f ms (%.3f ms std dev)", mean, stddev ))
+mean, stddev = bench.stats( tdisk )
+print(string.format("disk cache: %.3f ms (%.3f ms std dev)", mean, stddev ))
+mean, stddev = bench.stats( twarm )
+print(string.format("unchanged: %.3f ms (%.3f ms std dev)", mean, stddev ))
+if #tdiff > 0 then
+   mean, stddev = bench.stats( tdiff )
+   print(string.format("diff apply+remove: %d diffs, %.3f ms (%.3f ms std dev)", #diffs, mean, stddev ))
+end
+bench.finish( tstart )
@@ -0,0 +1,29 @@
+-- Benchmarks rendering sprites one by one against rendering them in batches,
+-- using a ship sprite sheet. To measure without a GPU, run with a software
+-- renderer, for example with Mesa's llvmpipe:
+--    LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe naev
+-- gfx.benchmarkSprites() is only available in debug builds.
+local bench = require "utils.benchmark.common"
+local reps = 5
+local n = 2000
+local frames = 20 -- Times all the sprites get rendered per repetition
+
+local tex = ship.get("Llama"):gfx()
+
+local tstart = bench.start()
+local timm = {}
+local tbat = {}
+local dimm, dbat
+for i=1,reps do
+   local imm, bat
+   imm, bat, dimm, dbat = gfx.benchmarkSprites( tex, n, frames )
+   -- Time per frame in ms
+   table.insert( timm, imm / frames * 1000 )
+   table.insert( tbat, bat / frames * 1000 )
+end
+local mimm, simm = bench.stats( timm )
+local mbat, sbat = bench.stats( tbat )
+print(string.format("immediate: %d sprites, %d draw calls, %.3f ms/frame (%.3f ms std dev)", n, dimm, mimm, simm ))
+print(string.format("batched: %d sprites, %d draw calls, %.3f ms/frame (%.3f ms std dev)", n, dbat, mbat, sbat ))
+print(string.format("speedup: %.2fx", mimm / mbat ))
+bench.finish( tstart )
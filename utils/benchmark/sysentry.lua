@@ -0,0 +1,46 @@
+-- Benchmarks the simulation done when entering a system by teleporting the
+-- player to the systems with the most presence. The time reported is the one
+-- measured by the engine for the simulation only, not the whole teleport.
+local bench = require "utils.benchmark.common"
+local nsys = 10
+local reps = 3
+
+local function presence( sys )
+   local p = 0
+   for k,v in pairs(sys:presences()) do
+      p = p + v
+   end
+   return p
+end
+
+-- Busiest systems first
+local systems = {}
+for k,s in ipairs(system.getAll()) do
+   if s:known() then
+      table.insert( systems, { sys=s, p=presence(s) } )
+   end
+end
+table.sort( systems, function( a, b ) return a.p > b.p end )
+
+local tstart = bench.start()
+local start = system.cur()
+local all = {}
+for i=1,math.min(nsys,#systems) do
+   local s = systems[i].sys
+   local vals = {}
+   local steps
+   for r=1,reps do
+      player.teleport( s )
+      local t
+      t, steps = naev.simulationStats()
+      table.insert( vals, t*1000 )
+      table.insert( all, t*1000 )
+   end
+   local mean, stddev = bench.stats( vals )
+   print(string.format("%s (presence %.0f, %d pilots): %.3f ms (%.3f ms std dev), %d updates",
+         s:nameRaw(), systems[i].p, #pilot.get(), mean, stddev, steps ))
+end
+player.teleport( start )
+local mean, stddev = bench.stats( all )
+print(string.format("All: %.3f ms (%.3f ms std dev)", mean, stddev ))
+bench.finish( tstart )
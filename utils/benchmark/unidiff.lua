@@ -0,0 +1,41 @@
+-- Benchmarks updating the universe after unidiffs by applying and then
+-- removing every available diff that is not already applied. Each application
+-- and removal triggers the universe update (presence, safe lanes and economy).
+local bench = require "utils.benchmark.common"
+local reps = 3
+
+local diffs = {}
+for k,d in ipairs(diff.available()) do
+   if not diff.isApplied(d) then
+      table.insert( diffs, d )
+   end
+end
+
+local tstart = bench.start()
+local tapply = {}
+local tremove = {}
+local worst, worstname = 0, nil
+for i=1,reps do
+   for k,d in ipairs(diffs) do
+      local t = naev.clock()
+      diff.apply( d )
+      local ta = (naev.clock()-t)*1000
+      t = naev.clock()
+      diff.remove( d )
+      local tr = (naev.clock()-t)*1000
+      table.insert( tapply, ta )
+      table.insert( tremove, tr )
+      if math.max(ta,tr) > worst then
+         worst = math.max(ta,tr)
+         worstname = d
+      end
+   end
+end
+local mean, stddev = bench.stats( tapply )
+print(string.format("apply: %d diffs, %.3f ms (%.3f ms std dev)", #diffs, mean, stddev ))
+mean, stddev = bench.stats( tremove )
+print(string.format("remove: %d diffs, %.3f ms (%.3f ms std dev)", #diffs, mean, stddev ))
+if worstname then
+   print(string.format("worst: '%s' with %.3f ms", worstname, worst ))
+end
+bench.finish( tstart )